@@ -0,0 +1,117 @@
+# Stockfish port: builds the engine sources as static libraries, one per
+# CPU variant in STOCKFISH_VARIANTS. Flags and defines follow the ARCH
+# table in Stockfish's own Makefile so each variant gets the same NNUE
+# kernels an official build of that architecture would.
+#
+# Provides:
+#   STOCKFISH_INCLUDE_DIR   Stockfish src/ directory
+#   STOCKFISH_LIBRARIES     Library of the baseline variant
+#   stockfish_variant_library(<arch> <out_var>)
+#                           Library target of any variant
+#   stockfish_variant_suffix(<arch> <out_var>)
+#                           Short name used in file names, e.g. "avx2"
+
+set(STOCKFISH_INCLUDE_DIR "${STOCKFISH_SOURCE_DIR}/src")
+
+if(NOT EXISTS "${STOCKFISH_INCLUDE_DIR}/main.cpp")
+    message(FATAL_ERROR
+        "Stockfish source not found in ${STOCKFISH_SOURCE_DIR}.\n"
+        "Run scripts/download-stockfish-source.sh first.")
+endif()
+
+file(GLOB_RECURSE STOCKFISH_SOURCES CONFIGURE_DEPENDS "${STOCKFISH_INCLUDE_DIR}/*.cpp")
+list(REMOVE_ITEM STOCKFISH_SOURCES "${STOCKFISH_INCLUDE_DIR}/main.cpp")
+
+# The networks are embedded with INCBIN, which needs them next to the sources
+file(STRINGS "${STOCKFISH_INCLUDE_DIR}/evaluate.h" STOCKFISH_NETS REGEX "#define EvalFileDefaultName")
+foreach(line IN LISTS STOCKFISH_NETS)
+    string(REGEX MATCH "nn-[0-9a-f]+\\.nnue" net "${line}")
+    if(net AND NOT EXISTS "${STOCKFISH_INCLUDE_DIR}/${net}")
+        message(WARNING "NNUE network ${net} missing; run 'make -C ${STOCKFISH_INCLUDE_DIR} net'")
+    endif()
+endforeach()
+
+function(stockfish_variant_suffix arch out_var)
+    string(REGEX REPLACE "^x86-64-" "" suffix "${arch}")
+    set(${out_var} "${suffix}" PARENT_SCOPE)
+endfunction()
+
+# Compiler flags and defines of one Stockfish ARCH
+function(stockfish_arch_flags arch out_flags out_defines)
+    set(flags "")
+    set(defines IS_64BIT USE_PTHREADS "ARCH=${arch}")
+
+    if(arch MATCHES "^x86-64")
+        list(APPEND flags -msse -msse2 -mssse3 -msse4.1 -mpopcnt)
+        list(APPEND defines USE_SSE2 USE_SSSE3 USE_SSE41 USE_POPCNT)
+
+        if(arch MATCHES "avx2|bmi2|avx512|vnni")
+            list(APPEND flags -mavx2 -mbmi)
+            list(APPEND defines USE_AVX2)
+        endif()
+        if(arch MATCHES "bmi2|avx512|vnni")
+            list(APPEND flags -mbmi2)
+            list(APPEND defines USE_PEXT)
+        endif()
+        if(arch MATCHES "avx512|vnni")
+            list(APPEND flags -mavx512f -mavx512bw)
+            list(APPEND defines USE_AVX512)
+        endif()
+        if(arch MATCHES "vnni")
+            list(APPEND flags -mavx512dq -mavx512vl -mavx512vnni)
+            list(APPEND defines USE_VNNI)
+        endif()
+    elseif(arch STREQUAL "apple-silicon")
+        list(APPEND flags -march=armv8.2-a+dotprod)
+        list(APPEND defines USE_NEON=8 USE_NEON_DOTPROD USE_POPCNT)
+    elseif(arch STREQUAL "armv8")
+        list(APPEND defines USE_NEON=8 USE_POPCNT)
+    else()
+        message(FATAL_ERROR "Unsupported Stockfish architecture: ${arch}")
+    endif()
+
+    # MSVC has no per-feature switches; the baseline build only needs SSE4.1,
+    # which x64 MSVC emits for these intrinsics without a flag
+    if(MSVC)
+        set(flags "")
+    endif()
+
+    set(${out_flags} "${flags}" PARENT_SCOPE)
+    set(${out_defines} "${defines}" PARENT_SCOPE)
+endfunction()
+
+function(stockfish_variant_library arch out_var)
+    stockfish_variant_suffix("${arch}" suffix)
+    set(${out_var} "stockfish_${suffix}" PARENT_SCOPE)
+endfunction()
+
+foreach(arch IN LISTS STOCKFISH_VARIANTS)
+    stockfish_variant_library("${arch}" target)
+    stockfish_arch_flags("${arch}" flags defines)
+
+    # Built only when a binding links it
+    add_library(${target} STATIC EXCLUDE_FROM_ALL ${STOCKFISH_SOURCES})
+    target_include_directories(${target} PUBLIC "${STOCKFISH_INCLUDE_DIR}")
+    target_compile_definitions(${target} PUBLIC ${defines} PRIVATE NDEBUG)
+    target_compile_options(${target} PUBLIC ${flags})
+
+    # Let the assembler find the networks for INCBIN
+    if(NOT MSVC)
+        target_compile_options(${target} PRIVATE "-Wa,-I${STOCKFISH_INCLUDE_DIR}")
+    endif()
+
+    find_package(Threads REQUIRED)
+    target_link_libraries(${target} PUBLIC Threads::Threads)
+
+    set_target_properties(${target} PROPERTIES
+        POSITION_INDEPENDENT_CODE ON
+        INTERPROCEDURAL_OPTIMIZATION OFF
+        ARCHIVE_OUTPUT_DIRECTORY "${STOCKFISH_BUILD_OUTPUT_DIR}"
+    )
+endforeach()
+
+list(GET STOCKFISH_VARIANTS 0 STOCKFISH_BASELINE_ARCH)
+stockfish_variant_library("${STOCKFISH_BASELINE_ARCH}" STOCKFISH_LIBRARIES)
+
+message(STATUS "Stockfish port: ${STOCKFISH_VARIANTS}")
+message(STATUS "  Baseline library: ${STOCKFISH_LIBRARIES}")
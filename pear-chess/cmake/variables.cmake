@@ -58,6 +58,18 @@ else()
     message(FATAL_ERROR "Unsupported platform: ${CMAKE_SYSTEM_NAME}")
 endif()
 
+# CPU variants of the Stockfish library. The first entry is the baseline
+# that runs anywhere on the platform; the binding picks the best variant the
+# host supports at load time (see src/ai/native/cpu_dispatch.cpp).
+if(TARGET_PLATFORM MATCHES "-x64$" AND NOT MSVC)
+    set(STOCKFISH_DEFAULT_VARIANTS
+        "${STOCKFISH_ARCH};x86-64-avx2;x86-64-bmi2;x86-64-avx512;x86-64-vnni512")
+else()
+    set(STOCKFISH_DEFAULT_VARIANTS "${STOCKFISH_ARCH}")
+endif()
+set(STOCKFISH_VARIANTS "${STOCKFISH_DEFAULT_VARIANTS}" CACHE STRING
+    "Stockfish architectures to build, baseline first")
+
 # Output configuration
 set(NATIVE_MODULE_OUTPUT_DIR "${PREBUILD_DIR}/${TARGET_PLATFORM}")
 set(STOCKFISH_BUILD_OUTPUT_DIR "${STOCKFISH_BINARY_DIR}/${TARGET_PLATFORM}")
@@ -88,6 +100,7 @@ endif()
 message(STATUS "===== Pear Chess Build Configuration =====")
 message(STATUS "Target Platform: ${TARGET_PLATFORM}")
 message(STATUS "Stockfish Architecture: ${STOCKFISH_ARCH}")
+message(STATUS "Stockfish Variants: ${STOCKFISH_VARIANTS}")
 message(STATUS "Build Type: ${CMAKE_BUILD_TYPE}")
 message(STATUS "Output Directory: ${NATIVE_MODULE_OUTPUT_DIR}")
 message(STATUS "Stockfish Source: ${STOCKFISH_SOURCE_DIR}")
@@ -97,5 +110,6 @@ message(STATUS "==========================================")
 # Export variables for use in other CMake files
 set(TARGET_PLATFORM "${TARGET_PLATFORM}" PARENT_SCOPE)
 set(STOCKFISH_ARCH "${STOCKFISH_ARCH}" PARENT_SCOPE)
+set(STOCKFISH_VARIANTS "${STOCKFISH_VARIANTS}" PARENT_SCOPE)
 set(NATIVE_MODULE_OUTPUT_DIR "${NATIVE_MODULE_OUTPUT_DIR}" PARENT_SCOPE)
 set(STOCKFISH_BUILD_OUTPUT_DIR "${STOCKFISH_BUILD_OUTPUT_DIR}" PARENT_SCOPE)
\ No newline at end of file
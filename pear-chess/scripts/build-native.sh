@@ -41,6 +41,7 @@ if [ $? -eq 0 ]; then
     echo "🧪 To test the binding:"
     echo "  ./scripts/test-native-binding.sh"
     echo "  cmake --build build/release --target test_native_binding"
+    echo "  cmake --build build/release --target bench_native_binding"
 else
     echo "❌ Native binding build failed!"
     exit 1
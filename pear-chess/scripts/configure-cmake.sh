@@ -50,6 +50,7 @@ if [ $? -eq 0 ]; then
     echo "🚀 Next steps:"
     echo "  cmake --build build/release --target build_native_binding"
     echo "  cmake --build build/release --target test_native_binding"
+    echo "  cmake --build build/release --target bench_native_binding"
 else
     echo "❌ CMake configuration failed!"
     exit 1
@@ -1,7 +1,7 @@
 /**
- * Pear's Gambit - AI vs AI Game Mode
+ * Pear's Gambit - AI Game Modes
  * 
- * Automated chess matches between AI engines
+ * Automated chess matches between AI engines, and games against the computer
  */
 
 import { SimpleStockfishEngine } from './external-engine-simple.js'
@@ -9,6 +9,127 @@ import { OpeningBook } from './opening-book.js'
 import { Chess } from 'chess.js'
 import { EventEmitter } from 'events'
 
+/**
+ * Result and reason of a finished game, '*' while it is still going
+ */
+function gameResult(game) {
+  let result = '*'
+  let reason = 'Unknown'
+  
+  if (game.isCheckmate()) {
+    result = game.turn() === 'w' ? '0-1' : '1-0'
+    reason = 'Checkmate'
+  } else if (game.isDraw()) {
+    result = '1/2-1/2'
+    if (game.isStalemate()) reason = 'Stalemate'
+    else if (game.isThreefoldRepetition()) reason = 'Threefold repetition'
+    else if (game.isInsufficientMaterial()) reason = 'Insufficient material'
+    else reason = 'Draw'
+  }
+  
+  return { result, reason }
+}
+
+/**
+ * Engine side of a game that thinks on the opponent's time
+ * After each of its moves it ponders on the reply the engine expects. When
+ * the opponent's move arrives it either confirms the guess (ponderhit, the
+ * search keeps its tree and the time already spent and answers almost at
+ * once) or abandons it and searches the actual position.
+ * Works with any engine offering ponder(), ponderHit() and stopPondering()
+ * next to go(); other engines just search on their own turn.
+ */
+export class PonderingPlayer extends EventEmitter {
+  constructor(engine, options = {}) {
+    super()
+    
+    this.engine = engine
+    this.options = {
+      ponder: options.ponder !== false,
+      ...options
+    }
+    
+    this.pondering = null // { moves, expectedMove, search }
+    this.stats = { hits: 0, misses: 0 }
+  }
+
+  get canPonder() {
+    return this.options.ponder && typeof this.engine.ponder === 'function'
+  }
+
+  /**
+   * Choose a move
+   * @param {string} fen - Starting position of the game
+   * @param {string[]} moves - Every move since, in UCI notation
+   * @param {Object} limits - go() limits, e.g. { movetime }
+   * @returns {Promise<{bestMove: string, ponderMove: string, ponderHit: boolean}>}
+   */
+  async getMove(fen, moves, limits = {}) {
+    let result = null
+    let ponderHit = false
+    
+    if (this.pondering) {
+      const { moves: before, expectedMove, search } = this.pondering
+      this.pondering = null
+      
+      const lastMove = moves[moves.length - 1]
+      const sameGame = moves.length === before.length + 1 &&
+        before.every((move, i) => move === moves[i])
+      
+      if (sameGame && lastMove === expectedMove && await this.engine.ponderHit()) {
+        result = await search
+        ponderHit = Boolean(result && result.bestMove)
+      } else {
+        await this.engine.stopPondering()
+      }
+      
+      if (ponderHit) {
+        this.stats.hits++
+      } else {
+        this.stats.misses++
+      }
+      this.emit('ponder-result', { hit: ponderHit, expectedMove, actualMove: lastMove })
+    }
+    
+    if (!ponderHit) {
+      await this.engine.position(fen, moves)
+      result = await this.engine.go(limits)
+    }
+    
+    if (!result || !result.bestMove) {
+      throw new Error('Engine returned no move')
+    }
+    
+    return { bestMove: result.bestMove, ponderMove: result.ponderMove, ponderHit }
+  }
+
+  /**
+   * Ponder on the expected reply to the move just played. The search runs
+   * until getMove() or cancel(); nothing waits on it here.
+   */
+  startPondering(fen, moves, expectedMove, limits = {}) {
+    if (!this.canPonder || !expectedMove || this.pondering) {
+      return false
+    }
+    
+    const search = this.engine.ponder(fen, moves, expectedMove, limits)
+    search.catch(error => this.emit('error', error))
+    this.pondering = { moves: [...moves], expectedMove, search }
+    this.emit('pondering', { expectedMove })
+    return true
+  }
+
+  /**
+   * Drop any ponder search, e.g. when the game ends or the side to move
+   * plays from the book instead
+   */
+  async cancel() {
+    if (!this.pondering) return
+    this.pondering = null
+    await this.engine.stopPondering()
+  }
+}
+
 /**
  * AI vs AI Game Manager
  * Orchestrates matches between AI engines
@@ -24,12 +145,15 @@ export class AIGame extends EventEmitter {
       debug: options.debug || false,
       useOpeningBook: options.useOpeningBook !== false,
       bookDepth: options.bookDepth || 8,
+      ponder: options.ponder || false, // Each engine thinks on the other's time
       ...options
     }
     
     this.game = new Chess()
+    this.startFen = this.game.fen()
     this.whiteEngine = null
     this.blackEngine = null
+    this.players = { white: null, black: null }
     this.openingBook = new OpeningBook()
     
     this.gameState = {
@@ -62,6 +186,11 @@ export class AIGame extends EventEmitter {
     })
     await this.blackEngine.start()
     
+    for (const [color, engine] of [['white', this.whiteEngine], ['black', this.blackEngine]]) {
+      this.players[color] = new PonderingPlayer(engine, { ponder: this.options.ponder })
+      this.players[color].on('ponder-result', (result) => this.emit('ponder-result', { player: color, ...result }))
+    }
+    
     this.emit('status', 'Engines initialized')
     this.emit('engines-ready', {
       white: this.whiteEngine,
@@ -80,6 +209,7 @@ export class AIGame extends EventEmitter {
     await this.initialize()
     
     this.game.reset()
+    this.startFen = this.game.fen()
     this.gameState = {
       moves: [],
       evaluations: [],
@@ -107,7 +237,6 @@ export class AIGame extends EventEmitter {
     }
     
     const isWhite = this.game.turn() === 'w'
-    const engine = isWhite ? this.whiteEngine : this.blackEngine
     const player = isWhite ? 'white' : 'black'
     
     this.emit('thinking', {
@@ -118,16 +247,19 @@ export class AIGame extends EventEmitter {
     
     const startTime = Date.now()
     let move = null
+    let engineMove = null
     
     try {
       // Check if we should use opening book
       if (this.options.useOpeningBook && this.game.moveNumber() <= this.options.bookDepth) {
         move = await this.getBookMove()
+        if (move) await this.players[player].cancel()
       }
       
       // If no book move, use engine
       if (!move) {
-        move = await this.getEngineMove(engine, player)
+        engineMove = await this.getEngineMove(this.players[player])
+        move = engineMove.bestMove
       }
       
       const endTime = Date.now()
@@ -155,9 +287,15 @@ export class AIGame extends EventEmitter {
         timeUsed,
         fen: this.game.fen(),
         moveNumber: Math.floor(this.game.moveNumber()),
+        ponderHit: engineMove ? engineMove.ponderHit : false,
         evaluation: null // Will be filled by analysis if requested
       })
       
+      // Think on the opponent's time
+      if (engineMove && !this.game.isGameOver()) {
+        this.players[player].startPondering(this.startFen, this.uciMoves(), engineMove.ponderMove, this.searchLimits())
+      }
+      
       // Schedule next move
       setTimeout(() => this.playNextMove(), 100)
       
@@ -167,7 +305,7 @@ export class AIGame extends EventEmitter {
         error: error.message,
         fen: this.game.fen()
       })
-      this.endGame()
+      await this.endGame()
     }
   }
 
@@ -198,43 +336,32 @@ export class AIGame extends EventEmitter {
   /**
    * Get a move from the engine
    */
-  async getEngineMove(engine, player) {
-    // Set position
-    await engine.position(this.game.fen())
-    
-    // Get the move
-    const result = await engine.go({
-      movetime: this.options.moveTime
-    })
-    
-    if (!result.bestMove) {
-      throw new Error('Engine returned no move')
-    }
-    
-    return result.bestMove
+  async getEngineMove(player) {
+    // The whole move list, so the engine sees repetitions and a ponder
+    // search can be matched against the move actually played
+    return player.getMove(this.startFen, this.uciMoves(), this.searchLimits())
+  }
+
+  uciMoves() {
+    return this.gameState.moves.map(move => move.uci)
+  }
+
+  searchLimits() {
+    return { movetime: this.options.moveTime }
   }
 
   /**
-   * End the current game
+   * End the current game, once any ponder search has stopped
    */
-  endGame() {
+  async endGame() {
     this.gameState.isPlaying = false
-    
-    // Determine result
-    let result = '*'
-    let reason = 'Unknown'
-    
-    if (this.game.isCheckmate()) {
-      result = this.game.turn() === 'w' ? '0-1' : '1-0'
-      reason = 'Checkmate'
-    } else if (this.game.isDraw()) {
-      result = '1/2-1/2'
-      if (this.game.isStalemate()) reason = 'Stalemate'
-      else if (this.game.isThreefoldRepetition()) reason = 'Threefold repetition'
-      else if (this.game.isInsufficientMaterial()) reason = 'Insufficient material'
-      else if (this.game.isDraw()) reason = 'Draw'
+    try {
+      await this.cancelPondering()
+    } catch (error) {
+      this.emit('error', { error: error.message, fen: this.game.fen() })
     }
     
+    const { result, reason } = gameResult(this.game)
     this.gameState.result = { result, reason }
     
     this.emit('game-end', {
@@ -252,9 +379,14 @@ export class AIGame extends EventEmitter {
    */
   async stopGame() {
     this.gameState.isPlaying = false
+    await this.cancelPondering()
     this.emit('game-stopped')
   }
 
+  async cancelPondering() {
+    await Promise.all(Object.values(this.players).filter(Boolean).map(player => player.cancel()))
+  }
+
   /**
    * Get current game state
    */
@@ -311,7 +443,11 @@ export class AIGame extends EventEmitter {
     return {
       white: this.options.whiteEngine,
       black: this.options.blackEngine,
-      initialized: !!(this.whiteEngine && this.blackEngine)
+      initialized: !!(this.whiteEngine && this.blackEngine),
+      ponder: {
+        white: this.players.white ? this.players.white.stats : null,
+        black: this.players.black ? this.players.black.stats : null
+      }
     }
   }
 
@@ -320,6 +456,8 @@ export class AIGame extends EventEmitter {
    */
   async shutdown() {
     this.gameState.isPlaying = false
+    await this.cancelPondering()
+    this.players = { white: null, black: null }
     
     if (this.whiteEngine) {
       await this.whiteEngine.quit()
@@ -335,6 +473,154 @@ export class AIGame extends EventEmitter {
   }
 }
 
+/**
+ * Human vs computer game
+ * The engine answers each human move and ponders while the human thinks,
+ * so most replies arrive almost at once
+ */
+export class ComputerGame extends EventEmitter {
+  constructor(options = {}) {
+    super()
+    
+    this.options = {
+      engine: options.engine || { depth: 15, skillLevel: 20 },
+      computerColor: options.computerColor || 'black',
+      moveTime: options.moveTime || 1000, // ms per move
+      ponder: options.ponder !== false,
+      debug: options.debug || false,
+      ...options
+    }
+    
+    this.game = new Chess()
+    this.startFen = this.game.fen()
+    this.moves = [] // UCI
+    this.engine = null
+    this.player = null
+  }
+
+  /**
+   * Start the engine and a new game; the computer moves first as white
+   */
+  async startGame(fen = null) {
+    const rematch = Boolean(this.engine)
+    if (!this.engine) {
+      this.engine = new SimpleStockfishEngine({
+        ...this.options.engine,
+        debug: this.options.debug
+      })
+      await this.engine.start()
+      
+      this.player = new PonderingPlayer(this.engine, { ponder: this.options.ponder })
+      this.player.on('ponder-result', (result) => this.emit('ponder-result', result))
+    }
+    
+    await this.player.cancel()
+    if (rematch) {
+      // The running engine is reused; only its hash and history are reset
+      await this.engine.newGame()
+    }
+    this.game = fen ? new Chess(fen) : new Chess()
+    this.startFen = this.game.fen()
+    this.moves = []
+    
+    this.emit('game-start', {
+      fen: this.game.fen(),
+      turn: this.game.turn(),
+      computerColor: this.options.computerColor
+    })
+    
+    if (this.isComputerTurn()) {
+      await this.playComputerMove()
+    }
+  }
+
+  isComputerTurn() {
+    return this.game.turn() === this.options.computerColor[0]
+  }
+
+  /**
+   * Play the human's move and wait for the computer's reply
+   * @param {string|Object} move - SAN, UCI or { from, to, promotion }
+   * @returns {Promise<Object>} The human's move as chess.js reports it
+   */
+  async makeMove(move) {
+    if (!this.engine || this.game.isGameOver() || this.isComputerTurn()) {
+      throw new Error('Not your turn')
+    }
+    
+    const moveObj = this.game.move(move)
+    if (!moveObj) {
+      throw new Error(`Invalid move: ${JSON.stringify(move)}`)
+    }
+    this.moves.push(moveObj.from + moveObj.to + (moveObj.promotion || ''))
+    
+    this.emit('move', { move: moveObj, player: 'human', fen: this.game.fen() })
+    
+    if (this.game.isGameOver()) {
+      await this.endGame()
+    } else {
+      await this.playComputerMove()
+    }
+    return moveObj
+  }
+
+  async playComputerMove() {
+    this.emit('thinking', { fen: this.game.fen() })
+    
+    const limits = { movetime: this.options.moveTime, priority: 'live' }
+    const startTime = Date.now()
+    const { bestMove, ponderMove, ponderHit } = await this.player.getMove(this.startFen, this.moves, limits)
+    
+    const moveObj = this.game.move(bestMove)
+    if (!moveObj) {
+      throw new Error(`Invalid move: ${bestMove}`)
+    }
+    this.moves.push(bestMove)
+    
+    this.emit('move', {
+      move: moveObj,
+      player: 'computer',
+      timeUsed: Date.now() - startTime,
+      ponderHit,
+      fen: this.game.fen()
+    })
+    
+    if (this.game.isGameOver()) {
+      await this.endGame()
+    } else {
+      this.player.startPondering(this.startFen, this.moves, ponderMove, limits)
+    }
+  }
+
+  async endGame() {
+    try {
+      await this.player.cancel()
+    } catch (error) {
+      this.emit('error', error)
+    }
+    this.emit('game-end', {
+      ...gameResult(this.game),
+      ponder: this.player.stats,
+      finalFen: this.game.fen(),
+      pgn: this.game.pgn()
+    })
+  }
+
+  async shutdown() {
+    if (this.player) {
+      await this.player.cancel()
+      this.player = null
+    }
+    
+    if (this.engine) {
+      await this.engine.quit()
+      this.engine = null
+    }
+    
+    this.emit('shutdown')
+  }
+}
+
 /**
  * Tournament Manager for multiple AI games
  */
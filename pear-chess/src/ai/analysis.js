@@ -97,6 +97,11 @@ export class PositionAnalysis {
       critical: false
     }
     
+    // Tablebase positions have an exact result; no need to read the score
+    if (engineAnalysis.tablebase) {
+      return this.assessTablebase(engineAnalysis)
+    }
+    
     if (!engineAnalysis.evaluation) {
       return assessment
     }
@@ -133,6 +138,38 @@ export class PositionAnalysis {
     return assessment
   }
 
+  /**
+   * Assess a position from its Syzygy result
+   * @param {Object} engineAnalysis - Engine analysis with tablebase { wdl, dtz }
+   * @returns {Object} Position assessment, with exact set
+   */
+  assessTablebase(engineAnalysis) {
+    const { wdl } = engineAnalysis.tablebase
+    const fen = engineAnalysis.fen || (engineAnalysis.position && engineAnalysis.position.fen) || ''
+    
+    // wdl is for the side to move; the assessment is from White's side
+    const whiteWdl = fen.split(' ')[1] === 'b' ? -wdl : wdl
+    const side = whiteWdl > 0 ? 'White' : 'Black'
+    
+    const assessment = {
+      advantage: whiteWdl > 0 ? 'white' : whiteWdl < 0 ? 'black' : 'equal',
+      magnitude: Math.abs(whiteWdl) === 2 ? 'winning' : 'small',
+      winning: whiteWdl === 2,
+      losing: whiteWdl === -2,
+      critical: Math.abs(whiteWdl) === 2,
+      exact: true
+    }
+    
+    if (whiteWdl === 0) {
+      assessment.description = 'Tablebase draw'
+    } else if (Math.abs(whiteWdl) === 2) {
+      assessment.description = `Tablebase win for ${side}`
+    } else {
+      assessment.description = `${side} is winning, but the 50-move rule saves the draw`
+    }
+    return assessment
+  }
+
   /**
    * Generate human-readable position description
    * @param {Object} assessment - Position assessment
@@ -29,6 +29,41 @@ try {
   console.warn('Binary manager not available:', error.message)
 }
 
+// Longest a ponder search may wait for the opponent (setTimeout's maximum)
+const PONDER_TIMEOUT = 2 ** 31 - 1
+
+// UCI go command for depth, time and clock limits
+function goCommand(prefix, options) {
+  let command = prefix
+  
+  if (options.depth) command += ` depth ${options.depth}`
+  if (options.nodes) command += ` nodes ${options.nodes}`
+  if (options.movetime) command += ` movetime ${options.movetime}`
+  if (options.wtime !== undefined) command += ` wtime ${options.wtime}`
+  if (options.btime !== undefined) command += ` btime ${options.btime}`
+  if (options.winc) command += ` winc ${options.winc}`
+  if (options.binc) command += ` binc ${options.binc}`
+  if (options.movestogo) command += ` movestogo ${options.movestogo}`
+  if (options.infinite) command += ' infinite'
+  
+  return command
+}
+
+// Below Skill Level 20 Stockfish picks its move at depth 1 + level and
+// deeper iterations are wasted, so weak searches stop there, within a node
+// budget that grows with the level. Same caps as Strength in
+// native/stockfish_wrapper.h.
+function skillLimits(options, skillLevel) {
+  if (skillLevel >= 20 || options.infinite || options.mate) return options
+  const depth = 1 + Math.floor(skillLevel)
+  const nodes = Math.round(2000 * Math.pow(1.6, skillLevel))
+  return {
+    ...options,
+    depth: options.depth ? Math.min(options.depth, depth) : depth,
+    nodes: options.nodes ? Math.min(options.nodes, nodes) : nodes
+  }
+}
+
 /**
  * Simplified external Stockfish engine
  */
@@ -41,7 +76,7 @@ export class SimpleStockfishEngine extends EventEmitter {
       hashSize: options.hashSize || 256,
       threads: options.threads || 1,
       multiPV: options.multiPV || 1,
-      skillLevel: options.skillLevel || 20,
+      skillLevel: options.skillLevel === undefined ? 20 : options.skillLevel,
       debug: options.debug || false,
       ...options
     }
@@ -49,6 +84,7 @@ export class SimpleStockfishEngine extends EventEmitter {
     this.process = null
     this.uci = new SimpleUCI()
     this.isReady = false
+    this.ponderSearch = null
     this.binaryManager = null
     
     // Initialize binary manager if available
@@ -170,9 +206,16 @@ export class SimpleStockfishEngine extends EventEmitter {
   }
 
   async setOption(name, value) {
+    if (name === 'Skill Level') this.options.skillLevel = Number(value)
     await this.uci.send(`setoption name ${name} value ${value}`)
   }
 
+  // ucinewgame: clear hash and history between games and keep the process
+  async newGame() {
+    await this.uci.send('ucinewgame')
+    await this.uci.send('isready', 'readyok')
+  }
+
   async position(fen = 'startpos', moves = []) {
     let command = 'position '
     command += fen === 'startpos' ? 'startpos' : `fen ${fen}`
@@ -183,13 +226,44 @@ export class SimpleStockfishEngine extends EventEmitter {
   }
 
   async go(options = {}) {
-    let command = 'go'
+    return await this.uci.send(goCommand('go', skillLimits(options, this.options.skillLevel)), 'bestmove')
+  }
+
+  /**
+   * go ponder on the position after expectedMove. Settles with bestmove
+   * once ponderHit() turns it into a normal search, or after
+   * stopPondering() with a result to discard.
+   */
+  async ponder(fen, moves, expectedMove, options = {}) {
+    await this.position(fen, [...moves, expectedMove])
     
-    if (options.depth) command += ` depth ${options.depth}`
-    if (options.movetime) command += ` movetime ${options.movetime}`
-    if (options.infinite) command += ' infinite'
+    // The opponent may think for as long as they like
+    const limits = skillLimits(options, this.options.skillLevel)
+    const search = this.uci.send(goCommand('go ponder', limits), 'bestmove', PONDER_TIMEOUT)
+    this.ponderSearch = search
+    search.then(() => {
+      if (this.ponderSearch === search) this.ponderSearch = null
+    }, () => {})
+    return search
+  }
+
+  async ponderHit() {
+    if (!this.ponderSearch) return false
+    await this.uci.send('ponderhit')
+    return true
+  }
+
+  async stopPondering() {
+    const search = this.ponderSearch
+    if (!search) return
     
-    return await this.uci.send(command, 'bestmove')
+    // The ponder search's own waiter receives the bestmove
+    await this.uci.send('stop')
+    await search.catch(() => {})
+  }
+
+  get isPondering() {
+    return Boolean(this.ponderSearch)
   }
 
   async stop() {
@@ -210,7 +284,8 @@ export class SimpleStockfishEngine extends EventEmitter {
     const infoHandler = (info) => {
       if (info.depth) analysis.depth = info.depth
       if (info.pv && info.pv.length > 0) {
-        analysis.lines[0] = {
+        // With MultiPV each line reports under its own index
+        analysis.lines[(info.multipv || 1) - 1] = {
           moves: info.pv,
           score: info.score,
           depth: info.depth
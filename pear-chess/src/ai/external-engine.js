@@ -29,6 +29,7 @@ export class ExternalStockfishEngine extends EventEmitter {
       threads: options.threads || 1,
       multiPV: options.multiPV || 1,
       skillLevel: options.skillLevel || 20, // 0-20, 20 is strongest
+      syzygyPath: options.syzygyPath || null, // Syzygy tablebase directories
       debug: options.debug || false,
       ...options
     }
@@ -208,6 +209,10 @@ export class ExternalStockfishEngine extends EventEmitter {
       await this.setOption('Skill Level', this.options.skillLevel)
     }
     
+    if (this.options.syzygyPath) {
+      await this.setOption('SyzygyPath', this.options.syzygyPath)
+    }
+    
     // Send isready and wait for response
     await this.uci.send('isready')
     await this.uci.waitFor('readyok')
@@ -23,6 +23,11 @@ export class GameAnalyzer {
       ...options
     }
     
+    // An AnalysisOffload (see p2p/analysis-offload.js) spreads the review's
+    // positions over opted-in peers, searching the rest on its own engine
+    this.offload = options.offload || null
+    this.prefetched = new Map() // FEN -> analysis of the current review
+    
     this.engine = null
     this.openingBook = new OpeningBook()
     this.isAnalyzing = false
@@ -71,6 +76,10 @@ export class GameAnalyzer {
       // Analyze opening
       analysis.opening = this.openingBook.getOpening(moves.slice(0, 10))
       
+      if (this.offload) {
+        await this.prefetch(game.fen(), moves)
+      }
+      
       // Analyze each position
       let previousEval = 0
       const moveAnalyses = []
@@ -147,6 +156,7 @@ export class GameAnalyzer {
       throw error
     } finally {
       this.isAnalyzing = false
+      this.prefetched.clear()
     }
     
     return analysis
@@ -161,14 +171,10 @@ export class GameAnalyzer {
    */
   async analyzePosition(fenBefore, fenAfter, movePlayed) {
     // Analyze position before move to get best move
-    const beforeAnalysis = await this.engine.analyze(fenBefore, {
-      depth: this.options.engineDepth
-    })
+    const beforeAnalysis = await this.searchPosition(fenBefore)
     
     // Analyze position after move for evaluation
-    const afterAnalysis = await this.engine.analyze(fenAfter, {
-      depth: this.options.engineDepth
-    })
+    const afterAnalysis = await this.searchPosition(fenAfter)
     
     // Convert evaluations to centipawns
     const evalBefore = this.scoreToCP(beforeAnalysis.lines[0]?.score)
@@ -180,7 +186,59 @@ export class GameAnalyzer {
       bestMove: this.convertUCIToSAN(beforeAnalysis.bestMove, fenBefore),
       bestLine: beforeAnalysis.lines[0]?.moves.slice(0, 5),
       depth: beforeAnalysis.depth,
-      wasbestMove: movePlayed === this.convertUCIToSAN(beforeAnalysis.bestMove, fenBefore)
+      wasbestMove: movePlayed === this.convertUCIToSAN(beforeAnalysis.bestMove, fenBefore),
+      // From a peer, and not searched here
+      untrusted: Boolean(beforeAnalysis.untrusted || afterAnalysis.untrusted)
+    }
+  }
+
+  /**
+   * Engine analysis of fen, from the offloaded batch when it has one.
+   * Reviews are the first searches a native engine preempts for a live game.
+   * @param {string} fen - Position to analyze
+   * @returns {Object} Analysis in the engine's analyze() shape
+   */
+  async searchPosition(fen) {
+    const prefetched = this.prefetched.get(fen)
+    if (prefetched) return prefetched
+    
+    return this.engine.analyze(fen, {
+      depth: this.options.engineDepth,
+      priority: 'review'
+    })
+  }
+
+  /**
+   * Analyze every position of the game at once through the offload. Each
+   * position is searched once, by a peer or locally; positions it could not
+   * cover are searched one by one as before. Peer results the offload did
+   * not check carry untrusted, which marks the plies that use them.
+   * @param {string} startFen - Position before the first move
+   * @param {Array} moves - Moves in SAN or UCI notation
+   */
+  async prefetch(startFen, moves) {
+    const replay = new Chess(startFen)
+    const uciMoves = []
+    for (const san of moves) {
+      let move = null
+      try {
+        move = replay.move(san)
+      } catch {
+        move = null
+      }
+      if (!move) break
+      uciMoves.push(move.from + move.to + (move.promotion || ''))
+    }
+    
+    try {
+      const plies = await this.offload.analyzeGame(startFen, uciMoves, {
+        depth: this.options.engineDepth
+      })
+      for (const { fen, analysis } of plies) {
+        if (analysis) this.prefetched.set(fen, analysis)
+      }
+    } catch (error) {
+      console.warn('Distributed analysis failed, analyzing locally:', error.message)
     }
   }
 
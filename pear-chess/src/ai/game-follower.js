@@ -0,0 +1,233 @@
+/**
+ * Pear's Gambit - Live Game Evaluation
+ *
+ * One engine per watched game, whatever the number of spectators
+ */
+
+import { EventEmitter } from 'events'
+import { NativeStockfishEngine, isNativeEngineAvailable } from './native-engine.js'
+
+// Followers by game id, while anyone holds them
+const followers = new Map()
+
+/**
+ * Evaluation of one live game, shared by its spectators. A single engine
+ * follows the game (see NativeStockfishEngine.follow()): each move steers
+ * its running search rather than starting a new one per viewer, and the
+ * throttled lines go out to every listener as 'update' events.
+ */
+export class GameFollower extends EventEmitter {
+  constructor(gameId, options = {}) {
+    super()
+
+    this.gameId = gameId
+    this.options = {
+      interval: 250, // Fewest milliseconds between updates
+      ...options
+    }
+
+    this.engine = null
+    this.refs = 0
+    this.ready = null
+    this.latest = null
+
+    // Ply the engine searches, and the start of the current follow() in
+    // game plies; updates count plies from there
+    this.ply = 0
+    this.basePly = 0
+    this.generation = 0
+
+    // Steering calls run one at a time, in arrival order
+    this.steering = Promise.resolve()
+  }
+
+  async start(fen, ply = 0) {
+    this.engine = new NativeStockfishEngine(this.options)
+    await this.engine.start()
+    await this.followFrom(fen, ply)
+  }
+
+  /**
+   * The game reached fen at ply, by move when given. Every spectator of the
+   * game reports each move, so reports for a ply already followed are
+   * dropped; a gap or an illegal move restarts the follow from fen.
+   * @param {string} fen - Position after the move
+   * @param {number} ply - Moves played in the game
+   * @param {string} [move] - The move, in UCI notation
+   */
+  update(fen, ply, move = null) {
+    this.steering = this.steering.then(async () => {
+      if (!this.engine || ply <= this.ply) return
+
+      if (move && ply === this.ply + 1 && await this.engine.followMove(move)) {
+        this.ply = ply
+        return
+      }
+      await this.engine.unfollow()
+      await this.followFrom(fen, ply)
+    }).catch(error => this.emit('error', error))
+    return this.steering
+  }
+
+  async followFrom(fen, ply) {
+    // Updates already posted by an earlier follow() carry its generation
+    // and are dropped
+    const generation = ++this.generation
+    this.engine.removeAllListeners('follow')
+    this.engine.on('follow', (info) => {
+      if (generation !== this.generation) return
+      this.latest = { ...info, ply: this.basePly + info.ply, gameId: this.gameId }
+      this.emit('update', this.latest)
+    })
+
+    this.ply = ply
+    this.basePly = ply
+    this.latest = null
+    if (!await this.engine.follow(fen, [], { interval: this.options.interval })) {
+      throw new Error(`Cannot follow game ${this.gameId} from ${fen}`)
+    }
+  }
+
+  /**
+   * Drop one hold on the follower; the last one stops and frees its engine
+   */
+  async release() {
+    if (--this.refs > 0) return
+    followers.delete(this.gameId)
+    this.generation++
+    this.removeAllListeners('update')
+
+    await this.steering
+    if (this.engine) {
+      const engine = this.engine
+      this.engine = null
+      await engine.quit()
+    }
+  }
+}
+
+/**
+ * Follower of a game, started at fen on first use. Every call must be
+ * matched by a release() on the returned follower.
+ * @param {string} gameId - Game being watched
+ * @param {string} fen - Current position of the game
+ * @param {number} ply - Moves played so far
+ * @param {Object} options - Engine options, plus interval (ms)
+ * @returns {Promise<GameFollower>}
+ */
+export async function followGame(gameId, fen, ply = 0, options = {}) {
+  let follower = followers.get(gameId)
+  if (!follower) {
+    follower = new GameFollower(gameId, options)
+    followers.set(gameId, follower)
+    follower.ready = follower.start(fen, ply)
+  }
+
+  follower.refs++
+  try {
+    await follower.ready
+  } catch (error) {
+    await follower.release()
+    throw error
+  }
+  return follower
+}
+
+/**
+ * A spectator manager's share of its game's follower. watch() starts
+ * following on first use and resyncs after that, update() passes on each
+ * live move, and close() lets go. Updates go to onEvaluation.
+ */
+export class SpectatorEvaluation {
+  constructor(gameId, onEvaluation, log = () => {}) {
+    this.gameId = gameId
+    this.onEvaluation = onEvaluation
+    this.log = log
+    this.follower = null
+    this.starting = null
+    this.closed = false
+    this.handleUpdate = (update) => this.onEvaluation(update)
+  }
+
+  /**
+   * The game is at fen after ply moves, as synced rather than by a move
+   */
+  async watch(fen, ply) {
+    if (this.starting) await this.starting
+    if (this.closed) return
+    if (this.follower) {
+      this.follower.update(fen, ply)
+      return
+    }
+    if (!isGameFollowAvailable()) {
+      this.log('Native engine not available, no live evaluation')
+      return
+    }
+
+    this.starting = this.start(fen, ply)
+    try {
+      await this.starting
+    } finally {
+      this.starting = null
+    }
+  }
+
+  async start(fen, ply) {
+    try {
+      const follower = await followGame(this.gameId, fen, ply)
+      if (this.closed) {
+        await follower.release()
+        return
+      }
+      this.follower = follower
+      follower.on('update', this.handleUpdate)
+      if (follower.latest) {
+        this.onEvaluation(follower.latest)
+      }
+    } catch (error) {
+      this.log('Failed to start live evaluation:', error)
+    }
+  }
+
+  /**
+   * A live move reached the game; ignored until watch() has started
+   */
+  update(fen, ply, move) {
+    if (this.follower) {
+      this.follower.update(fen, ply, move)
+    }
+  }
+
+  async close() {
+    this.closed = true
+    if (this.starting) await this.starting
+    if (this.follower) {
+      const follower = this.follower
+      this.follower = null
+      follower.off('update', this.handleUpdate)
+      await follower.release()
+    }
+  }
+}
+
+// Without the native binding there is nothing real to show
+export function isGameFollowAvailable() {
+  return isNativeEngineAvailable()
+}
+
+// Games followed in this process, and their spectator counts
+export function followedGames() {
+  return Array.from(followers.values(), follower => ({
+    gameId: follower.gameId,
+    ply: follower.ply,
+    spectators: follower.refs
+  }))
+}
+
+export default {
+  GameFollower,
+  SpectatorEvaluation,
+  followGame,
+  followedGames,
+  isGameFollowAvailable
+}
@@ -13,6 +13,7 @@ import { StubEngine, StubGameAnalyzer } from './engine-stub.js'
 // Try to import real engines (Node.js only)
 let SimpleStockfishEngine = null
 let NativeStockfishEngine = null
+let hasNativeBinding = false
 
 try {
   const externalEngineModule = await import('./external-engine-simple.js')
@@ -24,6 +25,7 @@ try {
 try {
   const nativeEngineModule = await import('./native-engine.js')
   NativeStockfishEngine = nativeEngineModule.NativeStockfishEngine
+  hasNativeBinding = nativeEngineModule.isNativeEngineAvailable()
 } catch (error) {
   console.warn('Native engine not available:', error.message)
 }
@@ -49,8 +51,9 @@ export function createStockfishAnalysis(options = {}) {
       ...options
     })
   } else if (engineType === 'auto') {
-    // Auto-select best available engine
-    if (NativeStockfishEngine) {
+    // Auto-select best available engine; the native engine only counts
+    // once its binding has loaded, otherwise it is a stub
+    if (NativeStockfishEngine && hasNativeBinding) {
       return new NativeStockfishEngine({
         debug: false,
         ...options
@@ -5,30 +5,72 @@
  */
 
 import { EventEmitter } from 'events'
-import path from 'path'
-import { fileURLToPath } from 'url'
 
-// Try to load the native binding
+// Try to load the native binding (a Bare addon, see native/binding.cpp)
 let nativeBinding = null
+let packedMoveToUci = null
+let packedSearchInfo = null
 
 try {
-  const __filename = fileURLToPath(import.meta.url)
-  const __dirname = path.dirname(__filename)
-  const projectRoot = path.join(__dirname, '../..')
-  
-  // Look for the compiled binding in prebuilds
-  const { detectPlatform } = await import('../../scripts/platform-utils.js')
-  const platform = detectPlatform()
-  const bindingPath = path.join(projectRoot, 'prebuilds', platform, 'libstockfish_binding.so')
-  
-  // For now, we'll use FFI or dlopen approach
-  // This is a placeholder - in production we'd use proper N-API or Bare bindings
-  console.log('Native binding would be loaded from:', bindingPath)
-  
+  const nativeModule = await import('./native/index.js')
+  nativeBinding = (nativeModule.default || nativeModule).binding || null
+  packedMoveToUci = (nativeModule.default || nativeModule).packedMoveToUci
+  packedSearchInfo = (nativeModule.default || nativeModule).packedSearchInfo
 } catch (error) {
   console.warn('Native binding not available:', error.message)
 }
 
+// go() options that bound a search; without any the search gets a default depth
+const SEARCH_LIMITS = ['depth', 'nodes', 'movetime', 'mate', 'wtime', 'btime', 'winc', 'binc', 'movestogo', 'infinite']
+
+function searchLimits(options) {
+  const limits = {}
+  for (const name of SEARCH_LIMITS) {
+    if (options[name] !== undefined) limits[name] = options[name]
+  }
+  if (Object.keys(limits).length === 0) {
+    limits.depth = 20 // Default depth
+  }
+  // useBook / useTablebase: false searches even in book or tablebase positions
+  if (options.useBook !== undefined) limits.useBook = options.useBook
+  if (options.useTablebase !== undefined) limits.useTablebase = options.useTablebase
+  // useCache: false searches again even when the analysis cache holds the answer
+  if (options.useCache !== undefined) limits.useCache = options.useCache
+  // usePeerCache: true also accepts unverified peer analyses (see analyze())
+  if (options.usePeerCache !== undefined) limits.usePeerCache = options.usePeerCache
+  // priority ('live', 'hint', 'spectator' or 'review') and deadline (ms)
+  // queue the search behind more urgent ones; see queueStats()
+  if (options.priority !== undefined) limits.priority = options.priority
+  if (options.deadline !== undefined) limits.deadline = options.deadline
+  return limits
+}
+
+// Search result of the stub implementation, one line per MultiPV index
+function stubResult(options, multiPV) {
+  const stubMoves = ['e2e4', 'd2d4', 'g1f3', 'b1c3']
+  const lines = Array.from({ length: multiPV || 1 }, (_, i) => ({
+    depth: options.depth || 20,
+    nodes: (options.depth || 20) * 1000,
+    nps: 100000,
+    timeMs: (options.depth || 20) * 10,
+    scoreCp: 25 - 10 * i,
+    pv: [stubMoves[i % stubMoves.length], 'e7e5', 'g1f3'],
+    multipv: i + 1
+  }))
+  
+  return {
+    bestMove: 'e2e4',
+    ponderMove: 'e7e5',
+    finalInfo: lines[0],
+    lines,
+    fromBook: false,
+    fromTablebase: false,
+    tablebase: null,
+    fromCache: false,
+    preempted: false
+  }
+}
+
 /**
  * Native Stockfish Engine using compiled binding
  */
@@ -43,10 +85,79 @@ export class NativeStockfishEngine extends EventEmitter {
     
     this.isReady = false
     this.isSearching = false
+    this.isFollowing = false
     this.currentPosition = null
+    this.handle = null
     
-    // For now, fall back to stub behavior
-    this.stub = true
+    // Ponder search in flight, see ponder()
+    this.ponderSearch = null
+    this.stubPonder = null
+    
+    // Without the compiled binding, fall back to stub behavior
+    this.stub = nativeBinding === null
+  }
+
+  /**
+   * Counters of the analysis cache that every native engine shares
+   * @returns {{hits, misses, stores, evictions, entries, bytes, capacity}|null}
+   *   null without the native binding
+   */
+  static cacheStats() {
+    return nativeBinding ? nativeBinding.cacheStats() : null
+  }
+
+  static setCacheSize(mb) {
+    if (nativeBinding) nativeBinding.setCacheSize(mb)
+  }
+
+  static clearCache() {
+    if (nativeBinding) nativeBinding.clearCache()
+  }
+
+  /**
+   * State of the queue that searches with a priority wait in, shared by
+   * every native engine
+   * @returns {{slots, running, queued, classes}|null} classes holds
+   *   {submitted, completed, preempted, cancelled, deadlineMissed, waitMs}
+   *   per priority; null without the native binding
+   */
+  static queueStats() {
+    return nativeBinding ? nativeBinding.queueStats() : null
+  }
+
+  static setSearchSlots(count) {
+    if (nativeBinding) nativeBinding.setSearchSlots(count)
+  }
+
+  /**
+   * Counters and histograms ({count, sum, p50, p90, p99}) of the native
+   * binding, across every engine
+   * @returns {{searches, bookHits, tablebaseHits, cacheHits, cacheMisses,
+   *   searchMs, nps, hashfull, queueWaitMs, initMs, engines, memoryBytes}|null}
+   *   null without the native binding
+   */
+  static metrics() {
+    return nativeBinding ? nativeBinding.metrics() : null
+  }
+
+  // The same in Prometheus text exposition format, for a /metrics endpoint
+  static metricsText() {
+    return nativeBinding ? nativeBinding.metricsText() : ''
+  }
+
+  static setLogLevel(level) {
+    if (nativeBinding) nativeBinding.setLogLevel(level)
+  }
+
+  /**
+   * Build native engines ahead of time, off the event loop, so start()
+   * does not decode the networks itself. A stopped engine is kept for the
+   * next start() in any case; prewarm covers the first game and several
+   * engines at once.
+   * @param {number} count - Engines to keep ready
+   */
+  static prewarm(count = 1) {
+    if (nativeBinding) nativeBinding.prewarm(count)
   }
 
   async start() {
@@ -61,8 +172,19 @@ export class NativeStockfishEngine extends EventEmitter {
     try {
       if (nativeBinding && !this.stub) {
         // Use real native binding
-        this.engine = nativeBinding.createEngine()
-        await this.engine.initialize()
+        this.handle = nativeBinding.create()
+        if (!nativeBinding.initialize(this.handle)) {
+          this.handle = null
+          throw new Error('Failed to initialize native Stockfish engine')
+        }
+        if (this.options.multiPV > 1) {
+          nativeBinding.setOption(this.handle, 'MultiPV', String(this.options.multiPV))
+        }
+        // Tables are mapped once per process and shared by every engine,
+        // off this thread; searches run without them until they are in
+        if (this.options.syzygyPath) {
+          nativeBinding.setOption(this.handle, 'SyzygyPath', this.options.syzygyPath)
+        }
       } else {
         // Use stub implementation
         if (this.options.debug) {
@@ -89,13 +211,81 @@ export class NativeStockfishEngine extends EventEmitter {
     }
     
     if (nativeBinding && !this.stub) {
-      return this.engine.setOption(name, value)
+      return nativeBinding.setOption(this.handle, name, String(value))
     } else {
       // Stub implementation
       return true
     }
   }
 
+  /**
+   * Play at a rating instead of full strength. Below full strength the
+   * native engine stops each search at the depth Stockfish picks its
+   * (deliberately imperfect) move at, under a node budget for the rating,
+   * so a weak bot costs a small fraction of a full search. Skill Level set
+   * through setOption() is capped the same way.
+   * @param {number} elo - 1320 to 3190; 0 for full strength
+   */
+  async setStrength(elo) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (nativeBinding && !this.stub) {
+      return nativeBinding.setStrength(this.handle, elo)
+    }
+    return true
+  }
+
+  /**
+   * Start a new game on the running engine: hash and history are cleared
+   * and the position goes back to the start, options are kept
+   */
+  async newGame() {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (nativeBinding && !this.stub) {
+      nativeBinding.newGame(this.handle)
+    }
+    this.currentPosition = null
+  }
+
+  /**
+   * Answer searches from a native opening book while the position is in it
+   * (see native/book_builder.cpp). Book moves come back at once with
+   * fromBook set; no search runs.
+   * @param {string|null} path - Book file, or null to remove the book
+   */
+  async setBook(path) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (nativeBinding && !this.stub) {
+      nativeBinding.setBook(this.handle, path)
+      return true
+    }
+    return false
+  }
+
+  /**
+   * Book moves of a position, heaviest first
+   * @returns {Promise<Array<{move: string, weight: number, games: number}>>}
+   */
+  async bookMoves(fen, moves = []) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (nativeBinding && !this.stub) {
+      await this.position(fen, moves)
+      return nativeBinding.bookMoves(this.handle)
+    }
+    return []
+  }
+
   async position(fen, moves = []) {
     if (!this.isReady) {
       throw new Error('Engine not ready')
@@ -111,11 +301,7 @@ export class NativeStockfishEngine extends EventEmitter {
     }
     
     if (nativeBinding && !this.stub) {
-      if (moves.length > 0) {
-        return this.engine.setPositionWithMoves(fen, moves)
-      } else {
-        return this.engine.setPosition(fen)
-      }
+      return nativeBinding.setPosition(this.handle, fen, moves)
     } else {
       // Stub implementation
       return true
@@ -141,32 +327,15 @@ export class NativeStockfishEngine extends EventEmitter {
       let result
       
       if (nativeBinding && !this.stub) {
-        // Use native binding
-        if (options.depth) {
-          result = await this.engine.search(options.depth)
-        } else if (options.movetime) {
-          result = await this.engine.searchTime(options.movetime)
-        } else if (options.nodes) {
-          result = await this.engine.searchNodes(options.nodes)
-        } else {
-          result = await this.engine.search(20) // Default depth
-        }
+        // Use native binding. The search runs on native threads; info
+        // updates arrive as events while the promise is pending.
+        result = await nativeBinding.search(this.handle, searchLimits(options), (packed) => {
+          this.emit('info', packedSearchInfo(packed))
+        })
       } else {
         // Stub implementation
         await new Promise(resolve => setTimeout(resolve, 50)) // Simulate search time
-        
-        result = {
-          bestMove: 'e2e4',
-          ponderMove: 'e7e5',
-          finalInfo: {
-            depth: options.depth || 20,
-            nodes: (options.depth || 20) * 1000,
-            nps: 100000,
-            timeMs: (options.depth || 20) * 10,
-            scoreCp: 25,
-            pv: ['e2e4', 'e7e5', 'g1f3']
-          }
-        }
+        result = stubResult(options, this.options.multiPV)
       }
       
       this.emit('bestmove', result.bestMove, result.ponderMove)
@@ -177,6 +346,94 @@ export class NativeStockfishEngine extends EventEmitter {
     }
   }
 
+  /**
+   * Think on the opponent's time: search the position after expectedMove
+   * in ponder mode, where time limits only start to bite after ponderHit().
+   * @param {string} fen - Position before the opponent's move
+   * @param {string[]} moves - Moves played from fen, in UCI notation
+   * @param {string} expectedMove - The opponent's expected reply
+   * @param {Object} options - Limits for the eventual search, as for go()
+   * @returns {Promise<Object>} Settles with the answer after ponderHit(), or
+   *   with a result to discard after stopPondering()
+   */
+  async ponder(fen, moves, expectedMove, options = {}) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (this.isSearching) {
+      throw new Error('Search already in progress')
+    }
+    
+    await this.position(fen, moves)
+    this.isSearching = true
+    
+    if (nativeBinding && !this.stub) {
+      this.ponderSearch = nativeBinding.ponder(this.handle, expectedMove, searchLimits(options), (packed) => {
+        this.emit('info', packedSearchInfo(packed))
+      })
+    } else {
+      // The stub ponders until told the outcome
+      this.ponderSearch = new Promise(resolve => {
+        this.stubPonder = () => resolve(stubResult(options, this.options.multiPV))
+      })
+    }
+    
+    // Settled either way, the engine is free again; errors are the
+    // caller's to handle on the returned promise
+    const search = this.ponderSearch
+    const settled = () => {
+      if (this.ponderSearch === search) {
+        this.ponderSearch = null
+        this.isSearching = false
+      }
+    }
+    search.then(settled, settled)
+    
+    return search
+  }
+
+  /**
+   * The opponent played the expected move; the ponder search becomes the
+   * real one and its promise settles with the engine's answer
+   * @returns {Promise<boolean>} False when no ponder search was running
+   */
+  async ponderHit() {
+    if (!this.ponderSearch) {
+      return false
+    }
+    
+    if (nativeBinding && !this.stub) {
+      return nativeBinding.ponderHit(this.handle)
+    }
+    
+    this.stubPonder()
+    return true
+  }
+
+  /**
+   * The opponent played something else: abandon the ponder search. Set the
+   * actual position before searching again.
+   */
+  async stopPondering() {
+    const search = this.ponderSearch
+    if (!search) {
+      return
+    }
+    
+    if (nativeBinding && !this.stub) {
+      nativeBinding.stopPondering(this.handle)
+    } else {
+      this.stubPonder()
+    }
+    
+    await search.catch(() => {})
+  }
+
+  get isPondering() {
+    return this.ponderSearch !== null
+  }
+
   async stop() {
     if (!this.isSearching) {
       return
@@ -187,34 +444,179 @@ export class NativeStockfishEngine extends EventEmitter {
     }
     
     if (nativeBinding && !this.stub) {
-      this.engine.stopSearch()
+      nativeBinding.stop(this.handle)
     }
     
     this.isSearching = false
     this.emit('searchStopped')
   }
 
+  /**
+   * Analyse a live game until unfollow(): one infinite search, steered to
+   * each new position by followMove() with the hash kept, so the work on
+   * one move carries into the next. Updates come as 'follow' events.
+   * @param {string} fen - Game start position
+   * @param {string[]} moves - Moves played so far, in UCI notation
+   * @param {Object} options - interval: fewest milliseconds between updates
+   * @returns {Promise<boolean>} false for an invalid position
+   */
+  async follow(fen, moves = [], { interval = 250 } = {}) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+
+    if (this.isSearching || this.isFollowing) {
+      throw new Error('Search already in progress')
+    }
+
+    if (nativeBinding && !this.stub) {
+      this.isFollowing = await nativeBinding.follow(this.handle, fen, moves, (update) => {
+        this.emit('follow', update)
+      }, interval)
+    } else {
+      // Stub implementation: one line per position
+      this.isFollowing = true
+      this.stubPly = moves.length
+      this.emitStubFollow(fen)
+    }
+    return this.isFollowing
+  }
+
+  /**
+   * Steer a followed game to the position after move
+   * @param {string} move - Move in UCI notation
+   * @returns {Promise<boolean>} false for an illegal move, which is ignored
+   */
+  async followMove(move) {
+    if (!this.isFollowing) {
+      throw new Error('Not following a game')
+    }
+
+    if (nativeBinding && !this.stub) {
+      return nativeBinding.followMove(this.handle, move)
+    }
+    this.stubPly++
+    this.emitStubFollow(null)
+    return true
+  }
+
+  async unfollow() {
+    if (!this.isFollowing) {
+      return
+    }
+
+    if (nativeBinding && !this.stub) {
+      nativeBinding.unfollow(this.handle)
+    }
+    this.isFollowing = false
+  }
+
+  emitStubFollow(fen) {
+    const ply = this.stubPly
+    setTimeout(() => {
+      if (this.isFollowing && ply === this.stubPly) {
+        this.emit('follow', { ...stubResult({}, 1).finalInfo, ply, fen })
+      }
+    }, 50)
+  }
+
   async analyze(fen, options = {}) {
     await this.position(fen)
-    const result = await this.go(options)
+    
+    // With a shared store (see p2p/analysis-store.js), a peer's deeper
+    // analysis seeds the native peer cache and a review or spectator search
+    // below is answered from it; finished searches go back to the store for
+    // other peers. Peer analyses are unverified, so searches for a move to
+    // play never see them.
+    const store = this.options.analysisStore
+    const native = nativeBinding && !this.stub
+    const usePeerCache = Boolean(store && native && options.useCache !== false &&
+      (options.priority === 'review' || options.priority === 'spectator'))
+    if (usePeerCache) {
+      const shared = store.getResult(fen, { multipv: this.options.multiPV || 1 })
+      if (shared) nativeBinding.seedCache(this.handle, shared)
+    }
+    
+    const result = await this.go({ ...options, usePeerCache })
+    if (store && native) {
+      store.put(fen, result).catch(error => {
+        if (this.options.debug) console.warn('Failed to share analysis:', error.message)
+      })
+    }
+    
+    // Under MultiPV one search yields every line, best first
+    const infos = result.lines && result.lines.length > 0 ? result.lines : [result.finalInfo]
     
     return {
       fen,
       bestMove: result.bestMove,
-      lines: [{
-        moves: result.finalInfo.pv || [result.bestMove],
-        score: result.finalInfo.scoreCp,
-        depth: result.finalInfo.depth
-      }],
-      depth: result.finalInfo.depth
+      lines: infos.map(info => ({
+        moves: info.pv && info.pv.length > 0 ? info.pv : [result.bestMove],
+        score: info.isMate
+          ? { unit: 'mate', value: info.mateIn }
+          : { unit: 'cp', value: info.scoreCp },
+        depth: info.depth
+      })),
+      depth: result.finalInfo.depth,
+      // Exact Syzygy result for the side to move when the root was probed
+      tablebase: result.tablebase || null,
+      exact: Boolean(result.fromTablebase),
+      // Taken from a peer's analysis rather than searched here
+      untrusted: Boolean(result.fromPeer)
     }
   }
 
+  /**
+   * Look a position up in the Syzygy tables without searching
+   * @returns {Promise<{wdl: number, dtz: number|null}|null>} wdl is -2..2 for
+   *   the side to move (loss, blessed loss, draw, cursed win, win); null
+   *   when the position is not in the loaded tables
+   */
+  async probeTablebase(fen) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    if (nativeBinding && !this.stub) {
+      await this.position(fen)
+      return nativeBinding.probeTablebase(this.handle)
+    }
+    return null
+  }
+
+  /**
+   * Review a whole game in one native call, off the event loop
+   * @param {string} fen - Starting position
+   * @param {string[]} moves - Moves in UCI notation
+   * @param {Object} options - Search limits per position, plus workers and
+   *   packed (return { records, moves } buffers, see native/index.js)
+   * @returns {Promise<Object[]|Object>} One entry per ply: { ply, move, bestMove, info }
+   */
+  async analyzeGame(fen, moves, options = {}) {
+    if (!this.isReady) {
+      throw new Error('Engine not ready')
+    }
+    
+    const { workers = 1, packed = false, ...limits } = options
+    
+    if (nativeBinding && !this.stub) {
+      return nativeBinding.analyzeGame(this.handle, fen, moves, { depth: 12, ...limits }, workers, packed)
+    }
+    
+    // Stub implementation
+    return [fen, ...moves].map((_, ply) => ({
+      ply,
+      move: ply > 0 ? moves[ply - 1] : '',
+      bestMove: 'e2e4',
+      info: { depth: limits.depth || 12, scoreCp: 25, pv: ['e2e4'] }
+    }))
+  }
+
   async evaluate(fen) {
     await this.position(fen)
     
     if (nativeBinding && !this.stub) {
-      return this.engine.evaluateCurrentPosition()
+      return nativeBinding.evaluate(this.handle)
     } else {
       // Stub implementation
       return 25
@@ -227,7 +629,7 @@ export class NativeStockfishEngine extends EventEmitter {
     }
     
     if (nativeBinding && !this.stub) {
-      return this.engine.getLegalMoves()
+      return nativeBinding.legalMoves(this.handle)
     } else {
       // Stub implementation
       return ['e2e4', 'd2d4', 'g1f3', 'b1c3']
@@ -240,7 +642,7 @@ export class NativeStockfishEngine extends EventEmitter {
     }
     
     if (nativeBinding && !this.stub) {
-      return this.engine.isLegalMove(move)
+      return nativeBinding.isLegalMove(this.handle, move)
     } else {
       // Stub implementation
       const legalMoves = await this.getLegalMoves()
@@ -249,6 +651,14 @@ export class NativeStockfishEngine extends EventEmitter {
   }
 
   async quit() {
+    if (this.ponderSearch) {
+      await this.stopPondering()
+    }
+    
+    if (this.isFollowing) {
+      await this.unfollow()
+    }
+    
     if (this.isSearching) {
       await this.stop()
     }
@@ -257,9 +667,9 @@ export class NativeStockfishEngine extends EventEmitter {
       console.log('Shutting down native engine...')
     }
     
-    if (nativeBinding && !this.stub && this.engine) {
-      this.engine.shutdown()
-      this.engine = null
+    if (nativeBinding && !this.stub && this.handle) {
+      nativeBinding.shutdown(this.handle)
+      this.handle = null
     }
     
     this.isReady = false
@@ -267,12 +677,17 @@ export class NativeStockfishEngine extends EventEmitter {
   }
 
   getStats() {
+    const native = nativeBinding && !this.stub
     return {
       isReady: this.isReady,
       isSearching: this.isSearching,
+      isFollowing: this.isFollowing,
       engineType: 'native',
       currentPosition: this.currentPosition,
-      usingStub: this.stub
+      usingStub: this.stub,
+      // This engine's memory and hash use, then the process-wide metrics
+      engine: native && this.handle ? nativeBinding.engineStats(this.handle) : null,
+      metrics: native ? nativeBinding.metrics() : null
     }
   }
 }
@@ -287,8 +702,64 @@ export function isNativeEngineAvailable() {
   return nativeBinding !== null
 }
 
+/**
+ * Games of a PGN archive, read and replayed natively in batches off the
+ * event loop. Games stop at their first illegal move, with complete: false.
+ * @param {string} path - PGN file
+ * @param {Object} options - batchSize: games per native call; offset: byte
+ *   offset of the game to start at
+ * @yields {{tags, fen, finalFen, result, complete, moves: string[]}} tags
+ *   by name, on an object without a prototype
+ */
+export async function * importPgn(path, { batchSize = 1000, offset = 0 } = {}) {
+  if (!nativeBinding) {
+    throw new Error('PGN import needs the native binding')
+  }
+
+  for (;;) {
+    const batch = await nativeBinding.importPgn(path, offset, batchSize)
+    for (const game of batch.games) {
+      const moves = Array.from(batch.moves.subarray(game.start, game.start + game.length), packedMoveToUci)
+      // Names come from the file: a "__proto__" tag stays a tag
+      const tags = Object.create(null)
+      for (const [name, value] of game.tags) {
+        tags[name] = value
+      }
+      yield {
+        tags,
+        fen: game.fen,
+        finalFen: game.finalFen,
+        result: game.result,
+        complete: game.complete,
+        moves
+      }
+    }
+    if (batch.done) return
+    offset = batch.offset
+  }
+}
+
+// Strict FEN check, or null without the native binding
+export function isValidFen(fen) {
+  return nativeBinding ? nativeBinding.isValidFen(fen) : null
+}
+
+// SAN of a UCI move in fen and back; null for an illegal move, or without
+// the native binding
+export function sanToUci(fen, san) {
+  return nativeBinding ? nativeBinding.sanToUci(fen, san) : null
+}
+
+export function uciToSan(fen, uci) {
+  return nativeBinding ? nativeBinding.uciToSan(fen, uci) : null
+}
+
 export default {
   NativeStockfishEngine,
   createNativeEngine,
-  isNativeEngineAvailable
+  isNativeEngineAvailable,
+  importPgn,
+  isValidFen,
+  sanToUci,
+  uciToSan
 }
\ No newline at end of file
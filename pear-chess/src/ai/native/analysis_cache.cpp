@@ -0,0 +1,146 @@
+#include "analysis_cache.h"
+#include <algorithm>
+
+namespace StockfishBinding {
+
+AnalysisCache::AnalysisCache(size_t max_bytes)
+    : capacity_(max_bytes) {
+}
+
+bool AnalysisCache::cacheable(const SearchLimits& limits) {
+    bool clock = limits.wtime_ms || limits.btime_ms || limits.winc_ms || limits.binc_ms;
+    bool bounded = limits.depth > 0 || limits.nodes > 0 || limits.movetime_ms > 0;
+    return bounded && !clock && !limits.infinite && limits.mate == 0 && limits.use_cache;
+}
+
+// Whether a search that produced info did at least what limits asks for.
+// Every set limit has to be met, since the request would have stopped at
+// whichever came first.
+static bool covers(const SearchInfo& info, const SearchLimits& limits) {
+    if (limits.depth > 0 && info.depth < limits.depth) return false;
+    if (limits.nodes > 0 && info.nodes < limits.nodes) return false;
+    if (limits.movetime_ms > 0 && info.time_ms < limits.movetime_ms) return false;
+    return true;
+}
+
+bool AnalysisCache::lookup(uint64_t key, const SearchLimits& limits, int multipv, SearchResult& out) {
+    if (!cacheable(limits)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->multipv < multipv || !covers(it->second->result.final_info, limits)) {
+        misses_++;
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    const SearchResult& cached = it->second->result;
+
+    out.best_move = cached.best_move;
+    out.ponder_move = cached.ponder_move;
+    out.final_info = cached.final_info;
+    out.lines.assign(cached.lines.begin(), cached.lines.begin() + std::min<size_t>(multipv, cached.lines.size()));
+    out.all_info.clear();
+    for (const auto& info : cached.all_info) {
+        if (info.multipv <= multipv) {
+            out.all_info.push_back(info);
+        }
+    }
+    out.from_cache = true;
+    hits_++;
+    return true;
+}
+
+void AnalysisCache::store(uint64_t key, const SearchLimits& limits, int multipv, const SearchResult& result) {
+    if (cacheable(limits)) {
+        insert(key, multipv, result);
+    }
+}
+
+void AnalysisCache::insert(uint64_t key, int multipv, const SearchResult& result) {
+    if (result.best_move.empty() || result.from_book || result.from_tablebase || result.stopped) {
+        return;
+    }
+
+    Entry entry{key, multipv, result, 0};
+    entry.result.from_cache = false;
+    entry.bytes = footprint(entry.result);
+    if (entry.bytes > capacity_) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        const Entry& old = *it->second;
+        bool deeper = result.final_info.depth >= old.result.final_info.depth;
+        bool wider = multipv >= old.multipv;
+
+        // Replace only with at least as much work on both counts: a wider
+        // but shallower result would lose depth for the lines it shares
+        if (!deeper || !wider) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+        bytes_ -= old.bytes;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(std::move(entry));
+    index_[key] = lru_.begin();
+    bytes_ += lru_.front().bytes;
+    stores_++;
+    evict_locked();
+}
+
+void AnalysisCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void AnalysisCache::set_capacity(size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = max_bytes;
+    evict_locked();
+}
+
+AnalysisCache::Stats AnalysisCache::stats() const {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.stores = stores_;
+    stats.evictions = evictions_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.entries = lru_.size();
+    stats.bytes = bytes_;
+    stats.capacity = capacity_;
+    return stats;
+}
+
+// Heap use of a stored result, close enough to bound the cache. UCI moves
+// fit std::string's inline buffer, so a PV costs its vector only.
+size_t AnalysisCache::footprint(const SearchResult& result) {
+    auto info_bytes = [](const SearchInfo& info) {
+        return sizeof(SearchInfo) + info.pv.capacity() * sizeof(std::string);
+    };
+
+    size_t bytes = sizeof(Entry) + 2 * sizeof(void*) * 4;  // List node and index slot
+    bytes += info_bytes(result.final_info);
+    for (const auto& info : result.lines) bytes += info_bytes(info);
+    for (const auto& info : result.all_info) bytes += info_bytes(info);
+    return bytes;
+}
+
+void AnalysisCache::evict_locked() {
+    while (bytes_ > capacity_ && !lru_.empty()) {
+        const Entry& last = lru_.back();
+        bytes_ -= last.bytes;
+        index_.erase(last.key);
+        lru_.pop_back();
+        evictions_++;
+    }
+}
+
+} // namespace StockfishBinding
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "stockfish_wrapper.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace StockfishBinding {
+
+// Search results by position, shared by any number of engines. Entries are
+// keyed by the Zobrist key (which covers the side to move) and MultiPV,
+// and a stored result answers every request it did at least as much work
+// for: a depth 20 search stands in for a depth 12 one, and three lines for
+// one. Like the transposition table it ignores the game history, so
+// repetition and 50-move draws are judged on the first search's history.
+// Least recently used entries go first once max_bytes is reached.
+class AnalysisCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t capacity = 0;
+    };
+
+    explicit AnalysisCache(size_t max_bytes = 32 * 1024 * 1024);
+
+    // Only searches bounded by depth, nodes or movetime are repeatable;
+    // clock, mate and infinite searches are neither stored nor served
+    static bool cacheable(const SearchLimits& limits);
+
+    // A result for key that meets limits with at least multipv lines,
+    // trimmed to multipv lines. Counts a hit or a miss.
+    bool lookup(uint64_t key, const SearchLimits& limits, int multipv, SearchResult& out);
+
+    // Keeps result if it is at least as deep and as wide as the entry for
+    // key; stopped searches are partial and never kept
+    void store(uint64_t key, const SearchLimits& limits, int multipv, const SearchResult& result);
+
+    // store() for results that did not come from a local search with known
+    // limits, such as analyses replicated from peers
+    void insert(uint64_t key, int multipv, const SearchResult& result);
+
+    void clear();
+    void set_capacity(size_t max_bytes);
+    Stats stats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        int multipv;
+        SearchResult result;
+        size_t bytes;
+    };
+    using List = std::list<Entry>;
+
+    static size_t footprint(const SearchResult& result);
+    void evict_locked();
+
+    mutable std::mutex mutex_;
+    List lru_;  // Most recently used first
+    std::unordered_map<uint64_t, List::iterator> index_;
+    size_t bytes_ = 0;
+    size_t capacity_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> stores_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+} // namespace StockfishBinding
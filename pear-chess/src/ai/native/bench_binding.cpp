@@ -0,0 +1,334 @@
+// Native benchmark for StockfishEngine, free of the JS and IPC overhead in
+// src/ai/benchmark.js. Runs the standard, tactical and endgame suites and
+// prints JSON; with --baseline it compares against an earlier run and exits
+// non-zero on a regression.
+//
+//   bench_binding [--depth N] [--iterations N] [--threads N] [--hash MB]
+//                 [--suite NAME] [--out FILE] [--baseline FILE] [--threshold PCT]
+
+#include "stockfish_wrapper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace StockfishBinding;
+
+using Clock = std::chrono::steady_clock;
+
+struct Suite {
+    std::string name;
+    std::vector<std::string> fens;
+};
+
+// Same positions as the suites in benchmark.js
+static const std::vector<Suite>& suites() {
+    static const std::vector<Suite> all = {
+        {"standard", {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2",
+            "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+            "rnbqkb1r/pppppp1p/5np1/8/2PP4/2N5/PP2PPPP/R1BQKBNR b KQkq - 0 3",
+            "r1bqkb1r/pppp1ppp/2n2n2/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        }},
+        {"tactical", {
+            "rnbqkb1r/pppp1ppp/5n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 2 4",
+            "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+            "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/3P1N2/PPP2PPP/RNBQK2R w KQkq - 4 4",
+            "r5k1/ppp2ppp/3p4/8/8/8/PPP2PPP/4R1K1 w - - 0 1",
+            "r3k2r/ppp2p1p/2n3p1/2Np4/2P5/8/PP3PPP/R3K2R w KQkq - 0 1",
+        }},
+        {"endgame", {
+            "8/8/8/3k4/3P4/3K4/8/8 w - - 0 1",
+            "8/8/8/8/8/3k4/3p4/3K3R w - - 0 1",
+            "8/8/8/8/8/3k4/3p4/3KQ3 w - - 0 1",
+            "8/8/8/8/8/2bk4/3p4/3KB3 w - - 0 1",
+            "8/8/8/8/8/3k4/3p4/3KN3 w - - 0 1",
+        }},
+    };
+    return all;
+}
+
+struct Options {
+    int depth = 14;
+    int iterations = 3;
+    int threads = 1;
+    int hash_mb = 16;
+    std::string suite;      // Empty runs every suite
+    std::string out;
+    std::string baseline;
+    double threshold = 10;  // Percent
+};
+
+struct Metrics {
+    int searches = 0;
+    int64_t nodes = 0;
+    double search_ms = 0;
+    std::vector<double> latency_ms;
+    std::vector<double> first_info_ms;
+
+    void add(const Metrics& other) {
+        searches += other.searches;
+        nodes += other.nodes;
+        search_ms += other.search_ms;
+        latency_ms.insert(latency_ms.end(), other.latency_ms.begin(), other.latency_ms.end());
+        first_info_ms.insert(first_info_ms.end(), other.first_info_ms.begin(), other.first_info_ms.end());
+    }
+
+    int64_t nps() const {
+        return search_ms > 0 ? static_cast<int64_t>(nodes * 1000.0 / search_ms) : 0;
+    }
+};
+
+// Nearest-rank percentile
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+static double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+static long peak_rss_kb() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static Metrics run_suite(StockfishEngine& engine, const Suite& suite, const Options& options) {
+    Metrics metrics;
+
+    SearchLimits limits;
+    limits.depth = options.depth;
+
+    // The info callback runs on the search thread; the first update of
+    // each search stamps its time-to-first-info
+    std::atomic<bool> first_seen{false};
+    Clock::time_point started;
+    double first_info = 0;
+    engine.set_info_callback([&](const SearchInfo&) {
+        if (!first_seen.exchange(true)) {
+            first_info = elapsed_ms(started);
+        }
+    });
+
+    for (int i = 0; i < options.iterations; ++i) {
+        for (const auto& fen : suite.fens) {
+            // Cold hash every time, so iterations measure the same work
+            engine.new_game();
+            if (!engine.set_position(fen)) {
+                std::cerr << "bench: invalid position " << fen << std::endl;
+                continue;
+            }
+
+            first_seen = false;
+            first_info = 0;
+            started = Clock::now();
+            SearchResult result = engine.search(limits);
+            double latency = elapsed_ms(started);
+
+            metrics.searches++;
+            metrics.nodes += result.final_info.nodes;
+            metrics.search_ms += latency;
+            metrics.latency_ms.push_back(latency);
+            if (first_seen) {
+                metrics.first_info_ms.push_back(first_info);
+            }
+        }
+    }
+
+    engine.set_info_callback(nullptr);
+    return metrics;
+}
+
+static void write_metrics(std::ostream& out, const Metrics& metrics) {
+    out << "{\"searches\": " << metrics.searches
+        << ", \"nodes\": " << metrics.nodes
+        << ", \"nps\": " << metrics.nps()
+        << ", \"first_info_p50_ms\": " << percentile(metrics.first_info_ms, 50)
+        << ", \"latency_p50_ms\": " << percentile(metrics.latency_ms, 50)
+        << ", \"latency_p95_ms\": " << percentile(metrics.latency_ms, 95)
+        << ", \"latency_p99_ms\": " << percentile(metrics.latency_ms, 99)
+        << "}";
+}
+
+// The baseline is an earlier run of this program, so a number is found by
+// its section name and key rather than with a general JSON parser
+static bool find_number(const std::string& json, const std::string& section, const std::string& key, double& out) {
+    size_t start = 0;
+    if (!section.empty()) {
+        start = json.find("\"" + section + "\"");
+        if (start == std::string::npos) return false;
+    }
+    size_t at = json.find("\"" + key + "\":", start);
+    if (at == std::string::npos) return false;
+    if (!section.empty() && json.find('}', start) < at) return false;
+
+    out = std::strtod(json.c_str() + at + key.size() + 3, nullptr);
+    return true;
+}
+
+struct Check {
+    std::string section;
+    std::string key;
+    bool higher_is_better;
+};
+
+// Returns the number of regressions beyond the threshold
+static int compare(const std::string& current, const std::string& baseline, double threshold) {
+    std::vector<Check> checks;
+    for (const auto& suite : suites()) {
+        checks.push_back({suite.name, "nps", true});
+        checks.push_back({suite.name, "latency_p95_ms", false});
+    }
+    checks.push_back({"total", "nps", true});
+    checks.push_back({"total", "latency_p95_ms", false});
+    checks.push_back({"total", "first_info_p50_ms", false});
+    checks.push_back({"", "peak_rss_kb", false});
+
+    int regressions = 0;
+    for (const auto& check : checks) {
+        double now = 0, before = 0;
+        if (!find_number(current, check.section, check.key, now) ||
+            !find_number(baseline, check.section, check.key, before) || before <= 0) {
+            continue;
+        }
+
+        double change = (now - before) / before * 100.0;
+        bool worse = check.higher_is_better ? change < -threshold : change > threshold;
+        std::string name = check.section.empty() ? check.key : check.section + "." + check.key;
+
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-28s %12.2f -> %12.2f  %+7.1f%%%s",
+                      name.c_str(), before, now, change, worse ? "  REGRESSION" : "");
+        std::cerr << line << std::endl;
+        if (worse) regressions++;
+    }
+    return regressions;
+}
+
+static bool parse_args(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "bench: missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--depth") options.depth = std::atoi(value.c_str());
+        else if (arg == "--iterations") options.iterations = std::atoi(value.c_str());
+        else if (arg == "--threads") options.threads = std::atoi(value.c_str());
+        else if (arg == "--hash") options.hash_mb = std::atoi(value.c_str());
+        else if (arg == "--suite") options.suite = value;
+        else if (arg == "--out") options.out = value;
+        else if (arg == "--baseline") options.baseline = value;
+        else if (arg == "--threshold") options.threshold = std::atof(value.c_str());
+        else {
+            std::cerr << "bench: unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return options.depth > 0 && options.iterations > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) {
+        return 2;
+    }
+
+    auto init_start = Clock::now();
+    StockfishEngine engine;
+    if (!engine.initialize()) {
+        std::cerr << "bench: engine initialization failed" << std::endl;
+        return 1;
+    }
+    double init_ms = elapsed_ms(init_start);
+
+    engine.set_option("Threads", options.threads);
+    engine.set_option("Hash", options.hash_mb);
+
+    // Warm up once so network loading and page faults stay out of the numbers
+    engine.set_position(suites().front().fens.front());
+    SearchLimits warmup;
+    warmup.depth = std::min(options.depth, 8);
+    engine.search(warmup);
+
+    std::ostringstream json;
+    json << "{\n  \"config\": {\"depth\": " << options.depth
+         << ", \"iterations\": " << options.iterations
+         << ", \"threads\": " << options.threads
+         << ", \"hash_mb\": " << options.hash_mb << "},\n";
+    json << "  \"init_ms\": " << init_ms << ",\n";
+    json << "  \"suites\": {\n";
+
+    Metrics total;
+    bool first = true;
+    for (const auto& suite : suites()) {
+        if (!options.suite.empty() && suite.name != options.suite) continue;
+
+        Metrics metrics = run_suite(engine, suite, options);
+        total.add(metrics);
+
+        json << (first ? "" : ",\n") << "    \"" << suite.name << "\": ";
+        write_metrics(json, metrics);
+        first = false;
+
+        std::cerr << suite.name << ": " << metrics.nps() << " nps, p95 "
+                  << percentile(metrics.latency_ms, 95) << " ms" << std::endl;
+    }
+
+    json << "\n  },\n  \"total\": ";
+    write_metrics(json, total);
+    json << ",\n  \"peak_rss_kb\": " << peak_rss_kb() << "\n}\n";
+
+    engine.shutdown();
+
+    const std::string report = json.str();
+    std::cout << report;
+    if (!options.out.empty()) {
+        std::ofstream(options.out) << report;
+    }
+
+    if (!options.baseline.empty()) {
+        std::ifstream in(options.baseline);
+        if (!in) {
+            std::cerr << "bench: cannot read baseline " << options.baseline << std::endl;
+            return 2;
+        }
+        std::stringstream baseline;
+        baseline << in.rdbuf();
+
+        int regressions = compare(report, baseline.str(), options.threshold);
+        if (regressions > 0) {
+            std::cerr << regressions << " regression(s) beyond " << options.threshold << "%" << std::endl;
+            return 1;
+        }
+        std::cerr << "No regressions beyond " << options.threshold << "%" << std::endl;
+    }
+
+    return 0;
+}
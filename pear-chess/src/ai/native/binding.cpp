@@ -1,31 +1,2016 @@
-// Placeholder binding.cpp for now - this will contain the 
-// JavaScript/Bare runtime binding when we add Bare support
+// JavaScript binding for the Bare runtime. Built by the add_bare_module
+// branch of CMakeLists.txt; the standalone library keeps a small C
+// interface for testing instead.
+//
+// Searches never block the JS thread: they run on the engine's own search
+// threads, and info updates and the final result come back through a
+// threadsafe function. Whole-game analysis runs on the libuv thread pool.
+// Bulk results can come back packed (see PackedInfo), as buffers JS views
+// in place instead of one object per record.
 
 #include "stockfish_wrapper.h"
 #include <iostream>
 
+#ifdef BUILDING_FOR_BARE
+
+#include "analysis_cache.h"
+#include "cpu_dispatch.h"
+#include "follow_session.h"
+#include "pgn_codec.h"
+#include "search_queue.h"
+#include "metrics.h"
+
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <uv.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Stockfish ARCH this binding was built for, set per variant by CMakeLists.txt
+#ifndef STOCKFISH_BINDING_ARCH
+#define STOCKFISH_BINDING_ARCH "unknown"
+#endif
+
+using StockfishBinding::AnalysisCache;
+using StockfishBinding::BookEntry;
+using StockfishBinding::FollowSession;
+using StockfishBinding::FollowUpdate;
+using StockfishBinding::GameReplayer;
+using StockfishBinding::OpeningBook;
+using StockfishBinding::PackedInfo;
+using StockfishBinding::PackedResults;
+using StockfishBinding::PgnGame;
+using StockfishBinding::PgnReader;
+using StockfishBinding::Histogram;
+using StockfishBinding::LogLevel;
+using StockfishBinding::Metrics;
+using StockfishBinding::PlyAnalysis;
+using StockfishBinding::QueueOptions;
+using StockfishBinding::QueueOutcome;
+using StockfishBinding::ReplayedGame;
+using StockfishBinding::SearchInfo;
+using StockfishBinding::SearchArena;
+using StockfishBinding::SearchLimits;
+using StockfishBinding::SearchPriority;
+using StockfishBinding::SearchPriorityCount;
+using StockfishBinding::SearchQueue;
+using StockfishBinding::SearchResult;
+using StockfishBinding::StockfishEngine;
+using StockfishBinding::TablebaseProbe;
+
+namespace {
+
+// What a JS engine handle points at
+struct FollowRequest;
+
+struct Handover;
+
+struct EngineHandle {
+    StockfishEngine engine;
+    std::future<SearchResult> search;  // Latest search, until it is replaced
+    uint64_t queued = 0;               // SearchQueue id of the latest search, if it was queued
+    bool analyzing = false;            // analyzeGame owns the engine
+    FollowRequest* follow = nullptr;   // follow() owns the engine
+    Handover* handover = nullptr;      // A start waiting for the last search to wind down
+};
+
+// A search or follow() that has to wait for the engine's running search,
+// which is stopped, to finish. The wait runs on the thread pool so the JS
+// thread never blocks on it; start then runs on the JS thread, with false
+// instead if a later start or stop() displaced it.
+struct Handover {
+    uv_work_t work;
+    js_env_t* env = nullptr;
+    EngineHandle* engine = nullptr;
+    js_ref_t* handle = nullptr;  // Keeps the engine alive until the wait is over
+    std::future<SearchResult> previous;
+    std::function<void(bool)> start;
+};
+
+struct SearchRequest {
+    std::string root_fen;              // Set when the result is packed
+    bool packed = false;
+    js_deferred_t* deferred = nullptr;
+    js_ref_t* handle = nullptr;        // Keeps the engine alive meanwhile
+    js_threadsafe_function_t* events = nullptr;
+};
+
+// Posted from the search thread to the JS thread. An update carries its
+// packed record and PV, which copy without allocating.
+struct SearchMessage {
+    bool done = false;
+    SearchResult result;
+    std::shared_ptr<PackedResults> packed;  // One record per update; every one with the result, if asked for
+    bool queued = false;
+    QueueOutcome outcome;
+};
+
+// A followed game: the session steering the engine, and the JS callback
+// its updates are posted to
+struct FollowRequest {
+    std::unique_ptr<FollowSession> session;
+    js_ref_t* handle = nullptr;  // Keeps the engine alive while it is followed
+    js_threadsafe_function_t* events = nullptr;
+};
+
+struct FollowMessage {
+    FollowUpdate update;
+};
+
+struct AnalyzeRequest {
+    uv_work_t work;
+    js_env_t* env = nullptr;
+    js_deferred_t* deferred = nullptr;
+    js_ref_t* handle = nullptr;
+    EngineHandle* engine = nullptr;
+
+    std::string fen;
+    std::vector<std::string> moves;
+    SearchLimits limits;
+    int workers = 1;
+    bool packed = false;
+    std::vector<PlyAnalysis> result;
+    std::shared_ptr<PackedResults> packed_result;
+};
+
+struct ImportedGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    ReplayedGame replay;
+};
+
+// setOption(handle, "SyzygyPath", dirs) on the thread pool: the swap waits
+// for every engine's searches to let go of the old tables
+struct TablebaseLoad {
+    uv_work_t work;
+    js_env_t* env = nullptr;
+    js_deferred_t* deferred = nullptr;
+
+    std::string path;
+    bool loaded = false;
+};
+
+struct PgnImportRequest {
+    uv_work_t work;
+    js_env_t* env = nullptr;
+    js_deferred_t* deferred = nullptr;
+
+    std::string path;
+    int64_t offset = 0;
+    uint32_t max_games = 0;
+    bool readable = true;
+    bool done = false;
+    std::vector<ImportedGame> games;
+};
+
+// Conversions
+
+js_value_t* to_js(js_env_t* env, const std::string& value) {
+    js_value_t* result;
+    int err = js_create_string_utf8(env, reinterpret_cast<const utf8_t*>(value.data()), value.size(), &result);
+    assert(err == 0);
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, int64_t value) {
+    js_value_t* result;
+    int err = js_create_int64(env, value, &result);
+    assert(err == 0);
+    return result;
+}
+
+js_value_t* to_js_bool(js_env_t* env, bool value) {
+    js_value_t* result;
+    int err = js_get_boolean(env, value, &result);
+    assert(err == 0);
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, const std::vector<std::string>& values) {
+    js_value_t* result;
+    int err = js_create_array_with_length(env, values.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        err = js_set_element(env, result, static_cast<uint32_t>(i), to_js(env, values[i]));
+        assert(err == 0);
+    }
+    return result;
+}
+
+void set(js_env_t* env, js_value_t* object, const char* name, js_value_t* value) {
+    int err = js_set_named_property(env, object, name, value);
+    assert(err == 0);
+}
+
+js_value_t* to_js(js_env_t* env, const SearchInfo& info) {
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+
+    set(env, result, "depth", to_js(env, info.depth));
+    set(env, result, "seldepth", to_js(env, info.seldepth));
+    set(env, result, "nodes", to_js(env, info.nodes));
+    set(env, result, "nps", to_js(env, info.nps));
+    set(env, result, "timeMs", to_js(env, info.time_ms));
+    set(env, result, "scoreCp", to_js(env, info.score_cp));
+    set(env, result, "isMate", to_js_bool(env, info.is_mate));
+    set(env, result, "mateIn", to_js(env, info.mate_in));
+    set(env, result, "pv", to_js(env, info.pv));
+    set(env, result, "multipv", to_js(env, info.multipv));
+    set(env, result, "hashfull", to_js(env, info.hashfull));
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, const std::vector<SearchInfo>& infos) {
+    js_value_t* result;
+    int err = js_create_array_with_length(env, infos.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < infos.size(); ++i) {
+        err = js_set_element(env, result, static_cast<uint32_t>(i), to_js(env, infos[i]));
+        assert(err == 0);
+    }
+    return result;
+}
+
+// { wdl, dtz } with dtz null without DTZ tables; null when not in the tables
+js_value_t* to_js(js_env_t* env, const TablebaseProbe& probe) {
+    js_value_t* result;
+    int err;
+    if (!probe.found) {
+        err = js_get_null(env, &result);
+        assert(err == 0);
+        return result;
+    }
+
+    err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "wdl", to_js(env, static_cast<int64_t>(probe.wdl)));
+    if (probe.has_dtz) {
+        set(env, result, "dtz", to_js(env, static_cast<int64_t>(probe.dtz)));
+    } else {
+        js_value_t* null_value;
+        err = js_get_null(env, &null_value);
+        assert(err == 0);
+        set(env, result, "dtz", null_value);
+    }
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, const SearchResult& search) {
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+
+    set(env, result, "bestMove", to_js(env, search.best_move));
+    set(env, result, "ponderMove", to_js(env, search.ponder_move));
+    set(env, result, "finalInfo", to_js(env, search.final_info));
+    set(env, result, "lines", to_js(env, search.lines));
+    set(env, result, "fromBook", to_js_bool(env, search.from_book));
+    set(env, result, "fromTablebase", to_js_bool(env, search.from_tablebase));
+    set(env, result, "tablebase", to_js(env, search.tablebase));
+    set(env, result, "fromCache", to_js_bool(env, search.from_cache));
+    set(env, result, "fromPeer", to_js_bool(env, search.from_peer));
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, const std::vector<BookEntry>& entries) {
+    js_value_t* result;
+    int err = js_create_array_with_length(env, entries.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        js_value_t* entry;
+        err = js_create_object(env, &entry);
+        assert(err == 0);
+        set(env, entry, "move", to_js(env, StockfishBinding::Utils::packed_move_to_uci(entries[i].move)));
+        set(env, entry, "weight", to_js(env, static_cast<int64_t>(entries[i].weight)));
+        set(env, entry, "games", to_js(env, static_cast<int64_t>(entries[i].games)));
+        err = js_set_element(env, result, static_cast<uint32_t>(i), entry);
+        assert(err == 0);
+    }
+    return result;
+}
+
+js_value_t* to_js(js_env_t* env, const std::vector<PlyAnalysis>& plies) {
+    js_value_t* result;
+    int err = js_create_array_with_length(env, plies.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < plies.size(); ++i) {
+        js_value_t* ply;
+        err = js_create_object(env, &ply);
+        assert(err == 0);
+        set(env, ply, "ply", to_js(env, plies[i].ply));
+        set(env, ply, "move", to_js(env, plies[i].move));
+        set(env, ply, "bestMove", to_js(env, plies[i].best_move));
+        set(env, ply, "info", to_js(env, plies[i].info));
+        err = js_set_element(env, result, static_cast<uint32_t>(i), ply);
+        assert(err == 0);
+    }
+    return result;
+}
+
+// The buffers alias the vectors; each one keeps the results alive until
+// JS collects it
+void finalize_packed(js_env_t* env, void* data, void* hint) {
+    delete static_cast<std::shared_ptr<PackedResults>*>(hint);
+}
+
+js_value_t* external_buffer(js_env_t* env, const std::shared_ptr<PackedResults>& owner, void* data, size_t len) {
+    js_value_t* result;
+    int err;
+    if (len == 0) {
+        void* unused;
+        err = js_create_arraybuffer(env, 0, &unused, &result);
+    } else {
+        err = js_create_external_arraybuffer(env, data, len, finalize_packed, new std::shared_ptr<PackedResults>(owner), &result);
+    }
+    assert(err == 0);
+    return result;
+}
+
+// { records: ArrayBuffer of PackedInfo, moves: Uint16Array }
+js_value_t* to_js(js_env_t* env, const std::shared_ptr<PackedResults>& packed) {
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+
+    set(env, result, "records", external_buffer(env, packed, packed->records.data(), packed->records.size() * sizeof(PackedInfo)));
+
+    js_value_t* moves;
+    js_value_t* arena = external_buffer(env, packed, packed->moves.data(), packed->moves.size() * sizeof(uint16_t));
+    err = js_create_typedarray(env, js_uint16array, packed->moves.size(), arena, 0, &moves);
+    assert(err == 0);
+    set(env, result, "moves", moves);
+    return result;
+}
+
+js_value_type_t type_of(js_env_t* env, js_value_t* value) {
+    js_value_type_t type;
+    int err = js_typeof(env, value, &type);
+    assert(err == 0);
+    return type;
+}
+
+bool from_js(js_env_t* env, js_value_t* value, std::string& out) {
+    if (type_of(env, value) != js_string) return false;
+
+    size_t len;
+    int err = js_get_value_string_utf8(env, value, nullptr, 0, &len);
+    assert(err == 0);
+
+    // Room for the terminator, which is then dropped
+    out.resize(len + 1);
+    err = js_get_value_string_utf8(env, value, reinterpret_cast<utf8_t*>(&out[0]), len + 1, &len);
+    assert(err == 0);
+    out.resize(len);
+    return true;
+}
+
+bool from_js(js_env_t* env, js_value_t* value, std::vector<std::string>& out) {
+    bool is_array;
+    int err = js_is_array(env, value, &is_array);
+    assert(err == 0);
+    if (!is_array) return false;
+
+    uint32_t len;
+    err = js_get_array_length(env, value, &len);
+    assert(err == 0);
+
+    out.resize(len);
+    for (uint32_t i = 0; i < len; ++i) {
+        js_value_t* element;
+        err = js_get_element(env, value, i, &element);
+        assert(err == 0);
+        if (!from_js(env, element, out[i])) return false;
+    }
+    return true;
+}
+
+// Numeric field of an options object; missing or non-numeric leaves out alone
+template <typename T>
+void read_number(js_env_t* env, js_value_t* object, const char* name, T& out) {
+    js_value_t* value;
+    int err = js_get_named_property(env, object, name, &value);
+    assert(err == 0);
+    if (type_of(env, value) != js_number) return;
+
+    int64_t number;
+    err = js_get_value_int64(env, value, &number);
+    assert(err == 0);
+    out = static_cast<T>(number);
+}
+
+// { depth, nodes, movetime, mate, wtime, btime, winc, binc, movestogo, infinite }
+// with the same names as the UCI "go" parameters, plus useBook,
+// useTablebase, useCache and usePeerCache
+SearchLimits limits_from_js(js_env_t* env, js_value_t* value) {
+    SearchLimits limits;
+    if (type_of(env, value) != js_object) return limits;
+
+    read_number(env, value, "depth", limits.depth);
+    read_number(env, value, "nodes", limits.nodes);
+    read_number(env, value, "movetime", limits.movetime_ms);
+    read_number(env, value, "mate", limits.mate);
+    read_number(env, value, "wtime", limits.wtime_ms);
+    read_number(env, value, "btime", limits.btime_ms);
+    read_number(env, value, "winc", limits.winc_ms);
+    read_number(env, value, "binc", limits.binc_ms);
+    read_number(env, value, "movestogo", limits.movestogo);
+
+    js_value_t* infinite;
+    int err = js_get_named_property(env, value, "infinite", &infinite);
+    assert(err == 0);
+    if (type_of(env, infinite) == js_boolean) {
+        err = js_get_value_bool(env, infinite, &limits.infinite);
+        assert(err == 0);
+    }
+
+    js_value_t* use_book;
+    err = js_get_named_property(env, value, "useBook", &use_book);
+    assert(err == 0);
+    if (type_of(env, use_book) == js_boolean) {
+        err = js_get_value_bool(env, use_book, &limits.use_book);
+        assert(err == 0);
+    }
+
+    js_value_t* use_tablebase;
+    err = js_get_named_property(env, value, "useTablebase", &use_tablebase);
+    assert(err == 0);
+    if (type_of(env, use_tablebase) == js_boolean) {
+        err = js_get_value_bool(env, use_tablebase, &limits.use_tablebase);
+        assert(err == 0);
+    }
+
+    js_value_t* use_cache;
+    err = js_get_named_property(env, value, "useCache", &use_cache);
+    assert(err == 0);
+    if (type_of(env, use_cache) == js_boolean) {
+        err = js_get_value_bool(env, use_cache, &limits.use_cache);
+        assert(err == 0);
+    }
+
+    js_value_t* use_peer_cache;
+    err = js_get_named_property(env, value, "usePeerCache", &use_peer_cache);
+    assert(err == 0);
+    if (type_of(env, use_peer_cache) == js_boolean) {
+        err = js_get_value_bool(env, use_peer_cache, &limits.use_peer_cache);
+        assert(err == 0);
+    }
+    return limits;
+}
+
+// The reverse of to_js(SearchInfo), for results handed back by JS
+SearchInfo info_from_js(js_env_t* env, js_value_t* value) {
+    SearchInfo info;
+    if (type_of(env, value) != js_object) return info;
+
+    read_number(env, value, "depth", info.depth);
+    read_number(env, value, "seldepth", info.seldepth);
+    read_number(env, value, "nodes", info.nodes);
+    read_number(env, value, "nps", info.nps);
+    read_number(env, value, "timeMs", info.time_ms);
+    read_number(env, value, "scoreCp", info.score_cp);
+    read_number(env, value, "mateIn", info.mate_in);
+    read_number(env, value, "multipv", info.multipv);
+
+    js_value_t* is_mate;
+    int err = js_get_named_property(env, value, "isMate", &is_mate);
+    assert(err == 0);
+    if (type_of(env, is_mate) == js_boolean) {
+        err = js_get_value_bool(env, is_mate, &info.is_mate);
+        assert(err == 0);
+    }
+
+    js_value_t* pv;
+    err = js_get_named_property(env, value, "pv", &pv);
+    assert(err == 0);
+    from_js(env, pv, info.pv);
+    return info;
+}
+
+// { bestMove, ponderMove, finalInfo, lines }, as search() resolves with
+bool result_from_js(js_env_t* env, js_value_t* value, SearchResult& result) {
+    if (type_of(env, value) != js_object) return false;
+
+    js_value_t* property;
+    int err = js_get_named_property(env, value, "bestMove", &property);
+    assert(err == 0);
+    if (!from_js(env, property, result.best_move)) return false;
+
+    err = js_get_named_property(env, value, "ponderMove", &property);
+    assert(err == 0);
+    from_js(env, property, result.ponder_move);
+
+    err = js_get_named_property(env, value, "finalInfo", &property);
+    assert(err == 0);
+    result.final_info = info_from_js(env, property);
+
+    err = js_get_named_property(env, value, "lines", &property);
+    assert(err == 0);
+    bool is_array;
+    err = js_is_array(env, property, &is_array);
+    assert(err == 0);
+    if (is_array) {
+        uint32_t len;
+        err = js_get_array_length(env, property, &len);
+        assert(err == 0);
+        for (uint32_t i = 0; i < len; ++i) {
+            js_value_t* line;
+            err = js_get_element(env, property, i, &line);
+            assert(err == 0);
+            result.lines.push_back(info_from_js(env, line));
+        }
+    }
+    return true;
+}
+
+// Arguments and the engine handle, which is always the first argument
+
+template <size_t N>
+size_t get_args(js_env_t* env, js_callback_info_t* info, js_value_t* (&argv)[N]) {
+    size_t argc = N;
+    int err = js_get_callback_info(env, info, &argc, argv, nullptr, nullptr);
+    assert(err == 0);
+    return argc;
+}
+
+EngineHandle* get_handle(js_env_t* env, js_value_t* value) {
+    if (type_of(env, value) != js_external) {
+        js_throw_error(env, nullptr, "Expected an engine handle");
+        return nullptr;
+    }
+
+    void* data;
+    int err = js_get_value_external(env, value, &data);
+    assert(err == 0);
+    return static_cast<EngineHandle*>(data);
+}
+
+// Engines are in use by analyzeGame until its promise settles
+EngineHandle* get_idle_handle(js_env_t* env, js_value_t* value) {
+    EngineHandle* handle = get_handle(env, value);
+    if (handle && handle->analyzing) {
+        js_throw_error(env, nullptr, "Engine is busy analysing a game");
+        return nullptr;
+    }
+    if (handle && handle->follow) {
+        js_throw_error(env, nullptr, "Engine is following a game");
+        return nullptr;
+    }
+    return handle;
+}
+
+js_value_t* undefined(js_env_t* env) {
+    js_value_t* result;
+    int err = js_get_undefined(env, &result);
+    assert(err == 0);
+    return result;
+}
+
+// Lifecycle
+
+// One analysis cache for every engine in the process, so a position any
+// game has searched is answered at once for the others
+std::shared_ptr<AnalysisCache> shared_cache() {
+    static auto cache = std::make_shared<AnalysisCache>();
+    return cache;
+}
+
+// Analyses seeded from peers, unverified. Apart from shared_cache() so they
+// only answer searches that ask for them (usePeerCache), never game moves.
+std::shared_ptr<AnalysisCache> peer_cache() {
+    static auto cache = std::make_shared<AnalysisCache>(8 * 1024 * 1024);
+    return cache;
+}
+
+void finalize_engine(js_env_t* env, void* data, void* hint) {
+    delete static_cast<EngineHandle*>(data);
+}
+
+js_value_t* create(js_env_t* env, js_callback_info_t* info) {
+    auto handle = new EngineHandle();
+    handle->engine.set_analysis_cache(shared_cache());
+    handle->engine.set_peer_cache(peer_cache());
+
+    js_value_t* result;
+    int err = js_create_external(env, handle, finalize_engine, nullptr, &result);
+    assert(err == 0);
+    return result;
+}
+
+js_value_t* initialize(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "initialize(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.initialize());
+}
+
+js_value_t* shutdown(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "shutdown(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    handle->engine.shutdown();
+    return undefined(env);
+}
+
+js_value_t* new_game(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "newGame(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    handle->engine.new_game();
+    return undefined(env);
+}
+
+js_value_t* set_strength(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    int32_t elo;
+    if (get_args(env, info, argv) < 2 || js_get_value_int32(env, argv[1], &elo) != 0) {
+        js_throw_error(env, nullptr, "setStrength(handle, elo)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.set_strength(elo));
+}
+
+js_value_t* prewarm(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    uint32_t count;
+    if (get_args(env, info, argv) < 1 || js_get_value_uint32(env, argv[0], &count) != 0) {
+        js_throw_error(env, nullptr, "prewarm(count)");
+        return nullptr;
+    }
+
+    StockfishEngine::prewarm(count);
+    return undefined(env);
+}
+
+void tablebase_work(uv_work_t* work) {
+    auto* load = static_cast<TablebaseLoad*>(work->data);
+    load->loaded = StockfishEngine::load_tablebases(load->path);
+}
+
+void tablebase_done(uv_work_t* work, int status) {
+    std::unique_ptr<TablebaseLoad> load(static_cast<TablebaseLoad*>(work->data));
+    js_env_t* env = load->env;
+    int err;
+
+    js_handle_scope_t* scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    err = js_resolve_deferred(env, load->deferred, to_js_bool(env, load->loaded));
+    assert(err == 0);
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+js_value_t* load_tablebases(js_env_t* env, const std::string& path) {
+    auto load = std::make_unique<TablebaseLoad>();
+    load->path = path;
+
+    int err;
+    uv_loop_t* loop;
+    err = js_get_env_loop(env, &loop);
+    assert(err == 0);
+
+    js_value_t* promise;
+    err = js_create_promise(env, &load->deferred, &promise);
+    assert(err == 0);
+
+    load->env = env;
+    load->work.data = load.get();
+    err = uv_queue_work(loop, &load->work, tablebase_work, tablebase_done);
+    assert(err == 0);
+    load.release();
+
+    return promise;
+}
+
+// Returns a promise of whether the option took, for every option alike;
+// SyzygyPath settles once the tables are loaded on the thread pool
+js_value_t* set_option(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[3];
+    std::string name, value;
+    if (get_args(env, info, argv) < 3 || !from_js(env, argv[1], name) || !from_js(env, argv[2], value)) {
+        js_throw_error(env, nullptr, "setOption(handle, name, value) takes string name and value");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    if (name == "SyzygyPath") return load_tablebases(env, value);
+
+    js_deferred_t* deferred;
+    js_value_t* promise;
+    int err = js_create_promise(env, &deferred, &promise);
+    assert(err == 0);
+    err = js_resolve_deferred(env, deferred, to_js_bool(env, handle->engine.set_option(name, value)));
+    assert(err == 0);
+    return promise;
+}
+
+js_value_t* set_info_interval(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    int32_t interval_ms;
+    if (get_args(env, info, argv) < 2 || js_get_value_int32(env, argv[1], &interval_ms) != 0) {
+        js_throw_error(env, nullptr, "setInfoInterval(handle, ms)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    handle->engine.set_info_interval(interval_ms);
+    return undefined(env);
+}
+
+// Position
+
+js_value_t* set_position(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[3];
+    size_t argc = get_args(env, info, argv);
+    std::string fen;
+    std::vector<std::string> moves;
+    if (argc < 2 || !from_js(env, argv[1], fen) || (argc > 2 && type_of(env, argv[2]) != js_undefined && !from_js(env, argv[2], moves))) {
+        js_throw_error(env, nullptr, "setPosition(handle, fen, [moves])");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.set_position_with_moves(fen, moves));
+}
+
+js_value_t* push_move(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string move;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[1], move)) {
+        js_throw_error(env, nullptr, "pushMove(handle, move)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.push_move(move));
+}
+
+js_value_t* pop_move(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "popMove(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.pop_move());
+}
+
+js_value_t* get_fen(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "getFen(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js(env, handle->engine.get_fen());
+}
+
+// Search
+
+void on_search_message(js_env_t* env, js_value_t* function, void* context, void* data) {
+    std::unique_ptr<SearchRequest> request;
+    std::unique_ptr<SearchMessage> message(static_cast<SearchMessage*>(data));
+    int err;
+
+    js_handle_scope_t* scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    if (!message->done) {
+        if (type_of(env, function) == js_function) {
+            // Handed over as the packed buffers, for JS to decode what it reads
+            js_value_t* argv[1] = { to_js(env, message->packed) };
+            js_call_function(env, undefined(env), function, 1, argv, nullptr);
+        }
+    } else {
+        // The last message of a search; nothing refers to the request after this
+        request.reset(static_cast<SearchRequest*>(context));
+        js_value_t* result = to_js(env, message->result);
+        if (message->packed) {
+            set(env, result, "packed", to_js(env, message->packed));
+        }
+        if (message->queued) {
+            set(env, result, "preempted", to_js_bool(env, message->outcome.preempted));
+            set(env, result, "cancelled", to_js_bool(env, message->outcome.cancelled));
+            set(env, result, "deadlineMissed", to_js_bool(env, message->outcome.deadline_missed));
+            set(env, result, "waitMs", to_js(env, static_cast<int64_t>(message->outcome.wait_ms)));
+        }
+        err = js_resolve_deferred(env, request->deferred, result);
+        assert(err == 0);
+        err = js_delete_reference(env, request->handle);
+        assert(err == 0);
+    }
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+// A result without all_info, which JS never sees and which is the bulk of
+// a long search; the packed form, when asked for, is built from it first
+SearchResult reply_of(const SearchResult& result) {
+    SearchResult reply;
+    reply.best_move = result.best_move;
+    reply.ponder_move = result.ponder_move;
+    reply.final_info = result.final_info;
+    reply.lines = result.lines;
+    reply.from_book = result.from_book;
+    reply.from_tablebase = result.from_tablebase;
+    reply.tablebase = result.tablebase;
+    reply.from_cache = result.from_cache;
+    reply.from_peer = result.from_peer;
+    reply.stopped = result.stopped;
+    return reply;
+}
+
+// Searches that name a priority go through one queue for the process, so
+// live games are not kept waiting by reviews on other engines
+SearchQueue& search_queue() {
+    // Never destroyed: at exit it would wait on searches of engines that
+    // may already be gone
+    static auto* queue = new SearchQueue(std::max(1u, std::thread::hardware_concurrency()));
+    return *queue;
+}
+
+// limits.priority and limits.deadline; false when no priority is given.
+// Throws for a priority the queue does not know.
+bool queue_options_from_js(js_env_t* env, js_value_t* limits, QueueOptions& out, bool& invalid) {
+    invalid = false;
+    if (type_of(env, limits) != js_object) return false;
+
+    js_value_t* priority;
+    int err = js_get_named_property(env, limits, "priority", &priority);
+    assert(err == 0);
+    std::string name;
+    if (!from_js(env, priority, name)) return false;
+
+    if (!StockfishBinding::parse_priority(name, out.priority)) {
+        js_throw_error(env, nullptr, "priority must be live, hint, spectator or review");
+        invalid = true;
+        return false;
+    }
+    read_number(env, limits, "deadline", out.deadline_ms);
+    return true;
+}
+
+void handover_work(uv_work_t* work) {
+    static_cast<Handover*>(work->data)->previous.wait();
+}
+
+void handover_done(uv_work_t* work, int status) {
+    std::unique_ptr<Handover> handover(static_cast<Handover*>(work->data));
+    js_env_t* env = handover->env;
+    handover->engine->handover = nullptr;
+
+    js_handle_scope_t* scope;
+    int err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+    if (handover->start) {
+        handover->start(true);
+    }
+    err = js_delete_reference(env, handover->handle);
+    assert(err == 0);
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+// The start still waiting on the engine, if any, is told it will not run
+void drop_pending_start(EngineHandle* handle) {
+    if (!handle->handover || !handle->handover->start) return;
+    auto dropped = std::move(handle->handover->start);
+    handle->handover->start = nullptr;
+    dropped(false);
+}
+
+// Runs start(true) once the engine has no search: at once when it is
+// free, else after its search is stopped and has wound down. A start
+// already waiting is displaced by this one.
+void when_engine_free(js_env_t* env, js_value_t* handle_value, EngineHandle* handle, std::function<void(bool)> start) {
+    if (handle->handover) {
+        drop_pending_start(handle);
+        handle->handover->start = std::move(start);
+        return;
+    }
+    if (!handle->search.valid()
+        || handle->search.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        start(true);
+        return;
+    }
+
+    if (handle->queued) {
+        search_queue().cancel(handle->queued);
+    }
+    handle->engine.stop_search();
+
+    auto* handover = new Handover();
+    handover->env = env;
+    handover->engine = handle;
+    handover->previous = std::move(handle->search);
+    handover->start = std::move(start);
+    handover->work.data = handover;
+
+    int err = js_create_reference(env, handle_value, 1, &handover->handle);
+    assert(err == 0);
+    uv_loop_t* loop;
+    err = js_get_env_loop(env, &loop);
+    assert(err == 0);
+    err = uv_queue_work(loop, &handover->work, handover_work, handover_done);
+    assert(err == 0);
+    handle->handover = handover;
+}
+
+// Shared by search() and ponder(); ponder_move is null for a normal search.
+// Ponder searches run on the opponent's time and are never queued.
+js_value_t* start_search(js_env_t* env, js_value_t* handle_value, EngineHandle* handle,
+                         js_value_t* limits_value, js_value_t* on_info, const std::string* ponder_move) {
+    SearchLimits limits = limits_from_js(env, limits_value);
+    QueueOptions queue_options;
+    bool invalid;
+    bool queued = !ponder_move && queue_options_from_js(env, limits_value, queue_options, invalid);
+    if (invalid) return nullptr;
+    int err;
+
+    auto* request = new SearchRequest();
+
+    // limits.packed also returns every info update as PackedResults; an
+    // infinite search keeps none
+    js_value_t* packed;
+    if (type_of(env, limits_value) == js_object) {
+        err = js_get_named_property(env, limits_value, "packed", &packed);
+        assert(err == 0);
+        if (type_of(env, packed) == js_boolean) {
+            err = js_get_value_bool(env, packed, &request->packed);
+            assert(err == 0);
+        }
+    }
+
+    js_value_t* promise;
+    err = js_create_promise(env, &request->deferred, &promise);
+    assert(err == 0);
+    err = js_create_reference(env, handle_value, 1, &request->handle);
+    assert(err == 0);
+
+    bool streaming = type_of(env, on_info) == js_function;
+    err = js_create_threadsafe_function(env, on_info, 0, 1, nullptr, nullptr, request, on_search_message, &request->events);
+    assert(err == 0);
+
+    js_threadsafe_function_t* events = request->events;
+    auto complete = [handle, request, events](const SearchResult& result, const QueueOutcome* outcome) {
+        // Later internal searches (evaluate() in check) must not post here
+        handle->engine.set_packed_info_callback(nullptr);
+
+        auto* message = new SearchMessage();
+        message->done = true;
+        message->result = reply_of(result);
+        if (outcome) {
+            message->queued = true;
+            message->outcome = *outcome;
+        }
+        if (request->packed) {
+            message->packed = std::make_shared<PackedResults>(
+                handle->engine.pack_infos(request->root_fen, result.all_info));
+        }
+        js_call_threadsafe_function(events, message, js_threadsafe_function_blocking);
+        js_release_threadsafe_function(events, js_threadsafe_function_release);
+    };
+
+    // A new search replaces the running one, and may only start once that
+    // has handed over its last message. The position is taken now, as JS
+    // may set another one in the meantime.
+    std::string root_fen = handle->engine.get_root_fen();
+    std::vector<std::string> moves = handle->engine.get_moves();
+    std::string ponder = ponder_move ? *ponder_move : std::string();
+    bool pondering = ponder_move != nullptr;
+
+    when_engine_free(env, handle_value, handle, [=](bool run) {
+        if (!run) {
+            // Replaced or stopped before it began: settles empty, like a
+            // cancelled queued search
+            SearchResult dropped;
+            dropped.stopped = true;
+            complete(dropped, nullptr);
+            return;
+        }
+
+        StockfishEngine& engine = handle->engine;
+        if (engine.get_root_fen() != root_fen || engine.get_moves() != moves) {
+            engine.set_position_with_moves(root_fen, moves);
+        }
+        if (request->packed) {
+            // A ponder search is rooted one move further on
+            if (pondering && engine.push_move(ponder)) {
+                request->root_fen = engine.get_fen();
+                engine.pop_move();
+            } else {
+                request->root_fen = engine.get_fen();
+            }
+        }
+        if (streaming) {
+            engine.set_packed_info_callback([events](const SearchArena& arena, const PackedInfo& record) {
+                auto* message = new SearchMessage();
+                message->packed = std::make_shared<PackedResults>();
+                message->packed->records.push_back(record);
+                message->packed->records[0].pv_offset = 0;
+                message->packed->moves.assign(arena.pv(record), arena.pv(record) + record.pv_length);
+                if (js_call_threadsafe_function(events, message, js_threadsafe_function_nonblocking) != 0) {
+                    delete message;  // Queue full or closing; the next update replaces this one
+                }
+            });
+        } else {
+            engine.set_packed_info_callback(nullptr);
+        }
+
+        if (queued) {
+            // The future settles once the queue is done with the engine, so
+            // a search replacing this one waits for that too
+            auto settled = std::make_shared<std::promise<SearchResult>>();
+            handle->search = settled->get_future();
+            handle->queued = search_queue().submit(engine, limits, queue_options,
+                [complete, settled](const SearchResult& result, const QueueOutcome& outcome) {
+                    complete(result, &outcome);
+                    settled->set_value(result);
+                });
+            return;
+        }
+
+        auto on_complete = [complete](const SearchResult& result) {
+            complete(result, nullptr);
+        };
+        handle->queued = 0;
+        handle->search = pondering
+            ? engine.ponder_async(ponder, limits, on_complete)
+            : engine.search_async(limits, on_complete);
+    });
+
+    return promise;
+}
+
+js_value_t* search(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[3];
+    size_t argc = get_args(env, info, argv);
+    if (argc < 2) {
+        js_throw_error(env, nullptr, "search(handle, limits, [onInfo])");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return start_search(env, argv[0], handle, argv[1], argc > 2 ? argv[2] : undefined(env), nullptr);
+}
+
+// The promise settles once the ponder search ends: with the answer after
+// ponderHit(), or with a partial, discardable result after stopPondering()
+js_value_t* ponder(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[4];
+    size_t argc = get_args(env, info, argv);
+    std::string move;
+    if (argc < 3 || !from_js(env, argv[1], move)) {
+        js_throw_error(env, nullptr, "ponder(handle, move, limits, [onInfo])");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return start_search(env, argv[0], handle, argv[2], argc > 3 ? argv[3] : undefined(env), &move);
+}
+
+js_value_t* ponder_hit(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "ponderHit(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.ponder_hit());
+}
+
+js_value_t* stop_pondering(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "stopPondering(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    handle->engine.stop_pondering();
+    return undefined(env);
+}
+
+js_value_t* is_pondering(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "isPondering(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.is_pondering());
+}
+
+js_value_t* stop(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "stop(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    // A queued search that has not started yet is dropped, resolving empty,
+    // and so is one still waiting for the last search to wind down
+    drop_pending_start(handle);
+    if (handle->queued) {
+        search_queue().cancel(handle->queued);
+    }
+    handle->engine.stop_search();
+    return undefined(env);
+}
+
+js_value_t* is_searching(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "isSearching(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.is_searching());
+}
+
+js_value_t* engine_stats(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "engineStats(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "memoryBytes", to_js(env, static_cast<int64_t>(handle->engine.memory_bytes())));
+    set(env, result, "hashfull", to_js(env, handle->engine.get_hashfull()));
+    return result;
+}
+
+// Following a live game. One engine searches the game's position for as
+// long as it is followed, and every move steers that search instead of
+// starting a new one; updates go to a single callback for JS to fan out.
+
+void on_follow_message(js_env_t* env, js_value_t* function, void* context, void* data) {
+    std::unique_ptr<FollowMessage> message(static_cast<FollowMessage*>(data));
+    int err;
+
+    js_handle_scope_t* scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    if (type_of(env, function) == js_function) {
+        js_value_t* update = to_js(env, message->update.info);
+        set(env, update, "ply", to_js(env, static_cast<int64_t>(message->update.ply)));
+        set(env, update, "fen", to_js(env, message->update.fen));
+        js_value_t* argv[1] = { update };
+        js_call_function(env, undefined(env), function, 1, argv, nullptr);
+    }
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+// Ends the session and waits for its search, after which nothing posts to
+// the callback; updates already posted are still delivered
+void end_follow(js_env_t* env, EngineHandle* handle) {
+    std::unique_ptr<FollowRequest> request(handle->follow);
+    handle->follow = nullptr;
+    drop_pending_start(handle);  // A follow() that never started resolves false
+    request->session.reset();
+
+    int err = js_release_threadsafe_function(request->events, js_threadsafe_function_release);
+    assert(err == 0);
+    err = js_delete_reference(env, request->handle);
+    assert(err == 0);
+}
+
+js_value_t* follow(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[5];
+    size_t argc = get_args(env, info, argv);
+    std::string fen;
+    std::vector<std::string> moves;
+    if (argc < 4 || !from_js(env, argv[1], fen) || (type_of(env, argv[2]) != js_undefined && !from_js(env, argv[2], moves))
+        || type_of(env, argv[3]) != js_function) {
+        js_throw_error(env, nullptr, "follow(handle, fen, moves, onUpdate, [intervalMs])");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    int32_t interval_ms = 250;
+    if (argc > 4 && type_of(env, argv[4]) == js_number) {
+        js_get_value_int32(env, argv[4], &interval_ms);
+    }
+
+    auto* request = new FollowRequest();
+    int err = js_create_reference(env, argv[0], 1, &request->handle);
+    assert(err == 0);
+    err = js_create_threadsafe_function(env, argv[3], 0, 1, nullptr, nullptr, nullptr, on_follow_message, &request->events);
+    assert(err == 0);
+
+    js_deferred_t* deferred;
+    js_value_t* promise;
+    err = js_create_promise(env, &deferred, &promise);
+    assert(err == 0);
+
+    // The engine is the session's from now on, though the session only
+    // takes over the info callback once the last search is done with it
+    handle->follow = request;
+    when_engine_free(env, argv[0], handle, [=](bool run) {
+        bool started = false;
+        if (run) {
+            request->session = std::make_unique<FollowSession>(handle->engine, interval_ms);
+            started = request->session->start(fen, moves);
+        }
+        if (started) {
+            js_threadsafe_function_t* events = request->events;
+            request->session->subscribe([events](const FollowUpdate& update) {
+                auto* message = new FollowMessage();
+                message->update = update;
+                if (js_call_threadsafe_function(events, message, js_threadsafe_function_nonblocking) != 0) {
+                    delete message;  // Queue full or closing; the next update replaces this one
+                }
+            });
+        } else if (handle->follow == request) {
+            end_follow(env, handle);
+        }
+
+        int err = js_resolve_deferred(env, deferred, to_js_bool(env, started));
+        assert(err == 0);
+    });
+    return promise;
+}
+
+js_value_t* follow_move(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string move;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[1], move)) {
+        js_throw_error(env, nullptr, "followMove(handle, move)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+    if (!handle->follow) {
+        js_throw_error(env, nullptr, "Engine is not following a game");
+        return nullptr;
+    }
+    if (!handle->follow->session) {
+        return to_js_bool(env, false);  // follow() has not started the session yet
+    }
+
+    return to_js_bool(env, handle->follow->session->push_move(move));
+}
+
+js_value_t* unfollow(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "unfollow(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    if (handle->follow) {
+        end_follow(env, handle);
+    }
+    return undefined(env);
+}
+
+// Game analysis, on the thread pool
+
+void analyze_work(uv_work_t* work) {
+    auto* request = static_cast<AnalyzeRequest*>(work->data);
+    StockfishEngine& engine = request->engine->engine;
+    request->result = engine.analyze_game(request->fen, request->moves, request->limits, request->workers);
+    if (request->packed) {
+        request->packed_result = std::make_shared<PackedResults>(engine.pack_game_analysis(request->fen, request->result));
+    }
+}
+
+void analyze_done(uv_work_t* work, int status) {
+    std::unique_ptr<AnalyzeRequest> request(static_cast<AnalyzeRequest*>(work->data));
+    js_env_t* env = request->env;
+    int err;
+
+    js_handle_scope_t* scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    request->engine->analyzing = false;
+    js_value_t* result = request->packed ? to_js(env, request->packed_result) : to_js(env, request->result);
+    err = js_resolve_deferred(env, request->deferred, result);
+    assert(err == 0);
+    err = js_delete_reference(env, request->handle);
+    assert(err == 0);
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+js_value_t* analyze_game(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[6];
+    size_t argc = get_args(env, info, argv);
+
+    auto request = std::make_unique<AnalyzeRequest>();
+    if (argc < 4 || !from_js(env, argv[1], request->fen) || !from_js(env, argv[2], request->moves)) {
+        js_throw_error(env, nullptr, "analyzeGame(handle, fen, moves, limits, [workers], [packed])");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    request->limits = limits_from_js(env, argv[3]);
+    if (argc > 4 && type_of(env, argv[4]) == js_number) {
+        int32_t workers;
+        js_get_value_int32(env, argv[4], &workers);
+        request->workers = workers;
+    }
+    if (argc > 5 && type_of(env, argv[5]) == js_boolean) {
+        js_get_value_bool(env, argv[5], &request->packed);
+    }
+
+    int err;
+    uv_loop_t* loop;
+    err = js_get_env_loop(env, &loop);
+    assert(err == 0);
+
+    js_value_t* promise;
+    err = js_create_promise(env, &request->deferred, &promise);
+    assert(err == 0);
+    err = js_create_reference(env, argv[0], 1, &request->handle);
+    assert(err == 0);
+
+    drop_pending_start(handle);
+    handle->engine.set_info_callback(nullptr);
+    handle->analyzing = true;
+    request->env = env;
+    request->engine = handle;
+    request->work.data = request.get();
+
+    err = uv_queue_work(loop, &request->work, analyze_work, analyze_done);
+    assert(err == 0);
+    request.release();
+
+    return promise;
+}
+
+// PGN import, on the thread pool. Archives are read a batch of games at a
+// time through PgnReader's fixed window; JS pages through with the offset.
+
+void import_work(uv_work_t* work) {
+    auto* request = static_cast<PgnImportRequest*>(work->data);
+    std::ifstream in(request->path, std::ios::binary);
+    if (!in || !in.seekg(request->offset)) {
+        request->readable = false;
+        return;
+    }
+
+    PgnReader reader(in);
+    GameReplayer replayer;
+    PgnGame game;
+    request->games.reserve(request->max_games);
+    while (request->games.size() < request->max_games) {
+        if (!reader.next(game)) {
+            request->done = true;
+            break;
+        }
+        ImportedGame& imported = request->games.emplace_back();
+        replayer.replay(game, imported.replay);
+        imported.tags = std::move(game.tags);
+    }
+    request->offset += static_cast<int64_t>(reader.offset());
+}
+
+// { games: [{ tags, fen, result, complete, start, length }], moves, offset,
+// done }: the packed moves of every game share one Uint16Array, each game
+// owning moves[start, start + length). Tags are [name, value] pairs in file
+// order, as the names come from the file and must not become properties.
+js_value_t* to_js(js_env_t* env, PgnImportRequest& request) {
+    int err;
+    size_t total_moves = 0;
+    for (const auto& game : request.games) total_moves += game.replay.moves.size();
+
+    void* data;
+    js_value_t* arena;
+    err = js_create_arraybuffer(env, total_moves * sizeof(uint16_t), &data, &arena);
+    assert(err == 0);
+
+    js_value_t* games;
+    err = js_create_array_with_length(env, request.games.size(), &games);
+    assert(err == 0);
+
+    size_t start = 0;
+    for (size_t i = 0; i < request.games.size(); ++i) {
+        const ImportedGame& imported = request.games[i];
+        const ReplayedGame& replay = imported.replay;
+        if (!replay.moves.empty()) {
+            std::memcpy(static_cast<uint16_t*>(data) + start, replay.moves.data(), replay.moves.size() * sizeof(uint16_t));
+        }
+
+        js_value_t* tags;
+        err = js_create_array_with_length(env, imported.tags.size(), &tags);
+        assert(err == 0);
+        for (size_t t = 0; t < imported.tags.size(); ++t) {
+            js_value_t* tag;
+            err = js_create_array_with_length(env, 2, &tag);
+            assert(err == 0);
+            err = js_set_element(env, tag, 0, to_js(env, imported.tags[t].first));
+            assert(err == 0);
+            err = js_set_element(env, tag, 1, to_js(env, imported.tags[t].second));
+            assert(err == 0);
+            err = js_set_element(env, tags, static_cast<uint32_t>(t), tag);
+            assert(err == 0);
+        }
+
+        js_value_t* game;
+        err = js_create_object(env, &game);
+        assert(err == 0);
+        set(env, game, "tags", tags);
+        set(env, game, "fen", to_js(env, replay.start_fen));
+        set(env, game, "finalFen", to_js(env, replay.final_fen));
+        set(env, game, "result", to_js(env, replay.result));
+        set(env, game, "complete", to_js_bool(env, replay.complete));
+        set(env, game, "start", to_js(env, static_cast<int64_t>(start)));
+        set(env, game, "length", to_js(env, static_cast<int64_t>(replay.moves.size())));
+        err = js_set_element(env, games, static_cast<uint32_t>(i), game);
+        assert(err == 0);
+        start += replay.moves.size();
+    }
+
+    js_value_t* moves;
+    err = js_create_typedarray(env, js_uint16array, total_moves, arena, 0, &moves);
+    assert(err == 0);
+
+    js_value_t* result;
+    err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "games", games);
+    set(env, result, "moves", moves);
+    set(env, result, "offset", to_js(env, request.offset));
+    set(env, result, "done", to_js_bool(env, request.done));
+    return result;
+}
+
+void import_done(uv_work_t* work, int status) {
+    std::unique_ptr<PgnImportRequest> request(static_cast<PgnImportRequest*>(work->data));
+    js_env_t* env = request->env;
+    int err;
+
+    js_handle_scope_t* scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    if (request->readable) {
+        err = js_resolve_deferred(env, request->deferred, to_js(env, *request));
+    } else {
+        js_value_t* message = to_js(env, "importPgn(): cannot read " + request->path);
+        js_value_t* error;
+        err = js_create_error(env, nullptr, message, &error);
+        assert(err == 0);
+        err = js_reject_deferred(env, request->deferred, error);
+    }
+    assert(err == 0);
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+}
+
+js_value_t* import_pgn(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[3];
+    size_t argc = get_args(env, info, argv);
+
+    auto request = std::make_unique<PgnImportRequest>();
+    request->max_games = 1000;
+    if (argc < 1 || !from_js(env, argv[0], request->path)) {
+        js_throw_error(env, nullptr, "importPgn(path, [offset], [maxGames])");
+        return nullptr;
+    }
+    if (argc > 1 && type_of(env, argv[1]) == js_number) {
+        js_get_value_int64(env, argv[1], &request->offset);
+    }
+    if (argc > 2 && type_of(env, argv[2]) == js_number) {
+        js_get_value_uint32(env, argv[2], &request->max_games);
+    }
+    if (request->offset < 0 || request->max_games == 0) {
+        js_throw_error(env, nullptr, "importPgn(): offset must be >= 0 and maxGames > 0");
+        return nullptr;
+    }
+
+    int err;
+    uv_loop_t* loop;
+    err = js_get_env_loop(env, &loop);
+    assert(err == 0);
+
+    js_value_t* promise;
+    err = js_create_promise(env, &request->deferred, &promise);
+    assert(err == 0);
+
+    request->env = env;
+    request->work.data = request.get();
+    err = uv_queue_work(loop, &request->work, import_work, import_done);
+    assert(err == 0);
+    request.release();
+
+    return promise;
+}
+
+// Notation, without an engine: each returns null for an invalid FEN or an
+// illegal move
+
+js_value_t* to_js_or_null(js_env_t* env, const std::string& value) {
+    if (!value.empty()) return to_js(env, value);
+
+    js_value_t* result;
+    int err = js_get_null(env, &result);
+    assert(err == 0);
+    return result;
+}
+
+js_value_t* is_valid_fen(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    std::string fen;
+    if (get_args(env, info, argv) < 1 || !from_js(env, argv[0], fen)) {
+        js_throw_error(env, nullptr, "isValidFen(fen)");
+        return nullptr;
+    }
+    return to_js_bool(env, StockfishBinding::Utils::is_valid_fen(fen));
+}
+
+js_value_t* fen_after_move(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string fen, move;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[0], fen) || !from_js(env, argv[1], move)) {
+        js_throw_error(env, nullptr, "fenAfterMove(fen, uci)");
+        return nullptr;
+    }
+    return to_js_or_null(env, StockfishBinding::Utils::fen_after_move(fen, move));
+}
+
+js_value_t* san_to_uci(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string fen, san;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[0], fen) || !from_js(env, argv[1], san)) {
+        js_throw_error(env, nullptr, "sanToUci(fen, san)");
+        return nullptr;
+    }
+    return to_js_or_null(env, StockfishBinding::Notation::san_to_uci(fen, san));
+}
+
+js_value_t* uci_to_san(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string fen, uci;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[0], fen) || !from_js(env, argv[1], uci)) {
+        js_throw_error(env, nullptr, "uciToSan(fen, uci)");
+        return nullptr;
+    }
+    return to_js_or_null(env, StockfishBinding::Notation::uci_to_san(fen, uci));
+}
+
+// Evaluation
+
+js_value_t* evaluate(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "evaluate(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js(env, handle->engine.evaluate_current_position());
+}
+
+// Positions without an evaluation come back as null
+js_value_t* evaluate_many(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::vector<std::string> fens;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[1], fens)) {
+        js_throw_error(env, nullptr, "evaluateMany(handle, fens)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    std::vector<int> scores = handle->engine.evaluate_many(fens);
+
+    int err;
+    js_value_t* result;
+    err = js_create_array_with_length(env, scores.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < scores.size(); ++i) {
+        js_value_t* score;
+        if (scores[i] == StockfishEngine::NoEvaluation) {
+            err = js_get_null(env, &score);
+        } else {
+            err = js_create_int32(env, scores[i], &score);
+        }
+        assert(err == 0);
+        err = js_set_element(env, result, static_cast<uint32_t>(i), score);
+        assert(err == 0);
+    }
+    return result;
+}
+
+// Opening book
+
+js_value_t* set_book(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string path;
+    size_t argc = get_args(env, info, argv);
+    bool clear = argc > 1 && (type_of(env, argv[1]) == js_null || type_of(env, argv[1]) == js_undefined);
+    if (argc < 2 || (!clear && !from_js(env, argv[1], path))) {
+        js_throw_error(env, nullptr, "setBook(handle, path | null)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    if (clear) {
+        handle->engine.set_book(nullptr);
+        return undefined(env);
+    }
+
+    auto book = std::make_shared<OpeningBook>();
+    if (!book->open(path)) {
+        js_throw_error(env, nullptr, "setBook(): not a readable opening book");
+        return nullptr;
+    }
+    if (!handle->engine.set_book(book)) {
+        js_throw_error(env, nullptr, "setBook(): book was built for a different engine");
+        return nullptr;
+    }
+    return undefined(env);
+}
+
+js_value_t* book_moves(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "bookMoves(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js(env, handle->engine.book_moves());
+}
+
+// Tablebases
+
+js_value_t* probe_tablebase(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "probeTablebase(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js(env, handle->engine.probe_tablebase());
+}
+
+// Search queue, shared by all engines
+
+js_value_t* queue_stats(js_env_t* env, js_callback_info_t* info) {
+    SearchQueue::Stats stats = search_queue().stats();
+    int err;
+
+    js_value_t* classes;
+    err = js_create_object(env, &classes);
+    assert(err == 0);
+    for (size_t i = 0; i < SearchPriorityCount; ++i) {
+        const SearchQueue::ClassStats& counts = stats.classes[i];
+        js_value_t* entry;
+        err = js_create_object(env, &entry);
+        assert(err == 0);
+        set(env, entry, "submitted", to_js(env, static_cast<int64_t>(counts.submitted)));
+        set(env, entry, "completed", to_js(env, static_cast<int64_t>(counts.completed)));
+        set(env, entry, "preempted", to_js(env, static_cast<int64_t>(counts.preempted)));
+        set(env, entry, "cancelled", to_js(env, static_cast<int64_t>(counts.cancelled)));
+        set(env, entry, "deadlineMissed", to_js(env, static_cast<int64_t>(counts.deadline_missed)));
+        set(env, entry, "waitMs", to_js(env, static_cast<int64_t>(counts.wait_ms)));
+        set(env, classes, StockfishBinding::priority_name(static_cast<SearchPriority>(i)), entry);
+    }
+
+    js_value_t* result;
+    err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "slots", to_js(env, static_cast<int64_t>(stats.slots)));
+    set(env, result, "running", to_js(env, static_cast<int64_t>(stats.running)));
+    set(env, result, "queued", to_js(env, static_cast<int64_t>(stats.queued)));
+    set(env, result, "classes", classes);
+    return result;
+}
+
+js_value_t* set_search_slots(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    uint32_t slots;
+    if (get_args(env, info, argv) < 1 || js_get_value_uint32(env, argv[0], &slots) != 0 || slots == 0) {
+        js_throw_error(env, nullptr, "setSearchSlots(count)");
+        return nullptr;
+    }
+
+    search_queue().set_slots(slots);
+    return undefined(env);
+}
+
+// Metrics and log, shared by all engines
+
+js_value_t* to_js(js_env_t* env, const Histogram& histogram) {
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "count", to_js(env, static_cast<int64_t>(snapshot.count)));
+    set(env, result, "sum", to_js(env, static_cast<int64_t>(snapshot.sum)));
+    set(env, result, "p50", to_js(env, static_cast<int64_t>(snapshot.quantile(0.5))));
+    set(env, result, "p90", to_js(env, static_cast<int64_t>(snapshot.quantile(0.9))));
+    set(env, result, "p99", to_js(env, static_cast<int64_t>(snapshot.quantile(0.99))));
+    return result;
+}
+
+js_value_t* metrics_snapshot(js_env_t* env, js_callback_info_t* info) {
+    const Metrics& metrics = StockfishBinding::metrics();
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "searches", to_js(env, static_cast<int64_t>(metrics.searches.value())));
+    set(env, result, "bookHits", to_js(env, static_cast<int64_t>(metrics.book_hits.value())));
+    set(env, result, "tablebaseHits", to_js(env, static_cast<int64_t>(metrics.tablebase_hits.value())));
+    set(env, result, "cacheHits", to_js(env, static_cast<int64_t>(metrics.cache_hits.value())));
+    set(env, result, "cacheMisses", to_js(env, static_cast<int64_t>(metrics.cache_misses.value())));
+    set(env, result, "searchMs", to_js(env, metrics.search_ms));
+    set(env, result, "nps", to_js(env, metrics.nps));
+    set(env, result, "hashfull", to_js(env, metrics.hashfull));
+    set(env, result, "queueWaitMs", to_js(env, metrics.queue_wait_ms));
+    set(env, result, "initMs", to_js(env, metrics.init_ms));
+    set(env, result, "engines", to_js(env, metrics.engines.value()));
+    set(env, result, "memoryBytes", to_js(env, metrics.memory_bytes.value()));
+    return result;
+}
+
+js_value_t* metrics_text(js_env_t* env, js_callback_info_t* info) {
+    return to_js(env, StockfishBinding::metrics_text());
+}
+
+js_value_t* set_log_level(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    std::string name;
+    LogLevel level;
+    if (get_args(env, info, argv) < 1 || !from_js(env, argv[0], name)
+        || !StockfishBinding::parse_log_level(name, level)) {
+        js_throw_error(env, nullptr, "setLogLevel('error' | 'warn' | 'info' | 'debug')");
+        return nullptr;
+    }
+
+    StockfishBinding::set_log_level(level);
+    return undefined(env);
+}
+
+// Analysis cache, shared by all engines
+
+js_value_t* cache_stats(js_env_t* env, js_callback_info_t* info) {
+    AnalysisCache::Stats stats = shared_cache()->stats();
+
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "hits", to_js(env, static_cast<int64_t>(stats.hits)));
+    set(env, result, "misses", to_js(env, static_cast<int64_t>(stats.misses)));
+    set(env, result, "stores", to_js(env, static_cast<int64_t>(stats.stores)));
+    set(env, result, "evictions", to_js(env, static_cast<int64_t>(stats.evictions)));
+    set(env, result, "entries", to_js(env, static_cast<int64_t>(stats.entries)));
+    set(env, result, "bytes", to_js(env, static_cast<int64_t>(stats.bytes)));
+    set(env, result, "capacity", to_js(env, static_cast<int64_t>(stats.capacity)));
+    return result;
+}
+
+js_value_t* set_cache_size(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    uint32_t size_mb;
+    if (get_args(env, info, argv) < 1 || js_get_value_uint32(env, argv[0], &size_mb) != 0) {
+        js_throw_error(env, nullptr, "setCacheSize(mb)");
+        return nullptr;
+    }
+
+    shared_cache()->set_capacity(static_cast<size_t>(size_mb) * 1024 * 1024);
+    return undefined(env);
+}
+
+js_value_t* seed_cache(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    SearchResult result;
+    if (get_args(env, info, argv) < 2 || !result_from_js(env, argv[1], result)) {
+        js_throw_error(env, nullptr, "seedCache(handle, result)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.seed_cache(result));
+}
+
+js_value_t* clear_cache(js_env_t* env, js_callback_info_t* info) {
+    shared_cache()->clear();
+    peer_cache()->clear();
+    return undefined(env);
+}
+
+// Move generation and game state
+
+js_value_t* legal_moves(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "legalMoves(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js(env, handle->engine.get_legal_moves());
+}
+
+js_value_t* is_legal_move(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[2];
+    std::string move;
+    if (get_args(env, info, argv) < 2 || !from_js(env, argv[1], move)) {
+        js_throw_error(env, nullptr, "isLegalMove(handle, move)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    return to_js_bool(env, handle->engine.is_legal_move(move));
+}
+
+js_value_t* game_state(js_env_t* env, js_callback_info_t* info) {
+    js_value_t* argv[1];
+    if (get_args(env, info, argv) < 1) {
+        js_throw_error(env, nullptr, "gameState(handle)");
+        return nullptr;
+    }
+    EngineHandle* handle = get_idle_handle(env, argv[0]);
+    if (!handle) return nullptr;
+
+    StockfishEngine& engine = handle->engine;
+    js_value_t* result;
+    int err = js_create_object(env, &result);
+    assert(err == 0);
+    set(env, result, "check", to_js_bool(env, engine.is_check()));
+    set(env, result, "checkmate", to_js_bool(env, engine.is_checkmate()));
+    set(env, result, "stalemate", to_js_bool(env, engine.is_stalemate()));
+    set(env, result, "draw", to_js_bool(env, engine.is_draw()));
+    return result;
+}
+
+} // namespace
+
+static js_value_t* init(js_env_t* env, js_value_t* exports) {
+    int err;
+
+    // Loading a variant the CPU cannot run would crash on the first search;
+    // fail the load instead so index.js falls back to the baseline
+    const std::string arch = STOCKFISH_BINDING_ARCH;
+    if (arch != "unknown" && !StockfishBinding::cpu_supports(arch)) {
+        js_throw_error(env, nullptr, "CPU does not support Stockfish build " STOCKFISH_BINDING_ARCH);
+        return nullptr;
+    }
+
+#define V(name, fn) \
+    { \
+        js_value_t* val; \
+        err = js_create_function(env, name, -1, fn, nullptr, &val); \
+        assert(err == 0); \
+        err = js_set_named_property(env, exports, name, val); \
+        assert(err == 0); \
+    }
+
+    V("create", create)
+    V("initialize", initialize)
+    V("shutdown", shutdown)
+    V("newGame", new_game)
+    V("prewarm", prewarm)
+    V("setOption", set_option)
+    V("setStrength", set_strength)
+    V("setInfoInterval", set_info_interval)
+
+    V("setPosition", set_position)
+    V("pushMove", push_move)
+    V("popMove", pop_move)
+    V("getFen", get_fen)
+
+    V("search", search)
+    V("stop", stop)
+    V("isSearching", is_searching)
+    V("engineStats", engine_stats)
+    V("ponder", ponder)
+    V("ponderHit", ponder_hit)
+    V("stopPondering", stop_pondering)
+    V("isPondering", is_pondering)
+    V("analyzeGame", analyze_game)
+    V("follow", follow)
+    V("followMove", follow_move)
+    V("unfollow", unfollow)
+    V("queueStats", queue_stats)
+    V("setSearchSlots", set_search_slots)
+    V("metrics", metrics_snapshot)
+    V("metricsText", metrics_text)
+    V("setLogLevel", set_log_level)
+    V("setBook", set_book)
+    V("bookMoves", book_moves)
+    V("probeTablebase", probe_tablebase)
+    V("cacheStats", cache_stats)
+    V("setCacheSize", set_cache_size)
+    V("seedCache", seed_cache)
+    V("clearCache", clear_cache)
+
+    V("evaluate", evaluate)
+    V("evaluateMany", evaluate_many)
+
+    V("importPgn", import_pgn)
+    V("isValidFen", is_valid_fen)
+    V("fenAfterMove", fen_after_move)
+    V("sanToUci", san_to_uci)
+    V("uciToSan", uci_to_san)
+
+    V("legalMoves", legal_moves)
+    V("isLegalMove", is_legal_move)
+    V("gameState", game_state)
+#undef V
+
+    set(env, exports, "arch", to_js(env, arch));
+
+    return exports;
+}
+
+BARE_MODULE(stockfish_binding, init)
+
+#else
+
 extern "C" {
     // Simple C interface for testing
     void* stockfish_create() {
         return new StockfishBinding::StockfishEngine();
     }
-    
+
     bool stockfish_initialize(void* engine) {
         return static_cast<StockfishBinding::StockfishEngine*>(engine)->initialize();
     }
-    
+
     bool stockfish_set_position(void* engine, const char* fen) {
         return static_cast<StockfishBinding::StockfishEngine*>(engine)->set_position(fen);
     }
-    
+
     void stockfish_destroy(void* engine) {
         delete static_cast<StockfishBinding::StockfishEngine*>(engine);
     }
 }
 
-// This file will be expanded later to include:
-// - Bare runtime JavaScript bindings
-// - N-API bindings for Node.js
-// - Conversion between C++ and JavaScript types
-// - Async search operations
-// - Callback handling
\ No newline at end of file
+#endif
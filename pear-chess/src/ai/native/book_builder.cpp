@@ -0,0 +1,88 @@
+// Builds a native opening book (see opening_book.h) from PGN collections.
+// Games are replayed on Stockfish, so the keys match what the binding
+// probes; the result can be loaded with setBook().
+//
+//   book_builder --out FILE [--max-ply N] [--min-games N] [--keep-losses]
+//                games.pgn [more.pgn ...]
+
+#include "opening_book.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace StockfishBinding;
+
+struct Options {
+    std::string out;
+    BookBuildOptions build;
+    std::vector<std::string> inputs;
+};
+
+static bool parse_args(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keep-losses") {
+            options.build.skip_losses = false;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0) {
+            options.inputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "book_builder: missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--out") options.out = value;
+        else if (arg == "--max-ply") options.build.max_ply = std::atoi(value.c_str());
+        else if (arg == "--min-games") options.build.min_games = static_cast<uint32_t>(std::atoi(value.c_str()));
+        else {
+            std::cerr << "book_builder: unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return !options.out.empty() && !options.inputs.empty() && options.build.max_ply > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) {
+        std::cerr << "usage: book_builder --out FILE [--max-ply N] [--min-games N] [--keep-losses] games.pgn..." << std::endl;
+        return 2;
+    }
+
+    BookBuilder builder(options.build);
+    if (!builder.ready()) {
+        std::cerr << "book_builder: engine initialization failed" << std::endl;
+        return 1;
+    }
+
+    size_t games = 0;
+    for (const auto& input : options.inputs) {
+        std::ifstream in(input);
+        if (!in) {
+            std::cerr << "book_builder: cannot read " << input << std::endl;
+            return 1;
+        }
+        size_t read = builder.add_pgn(in);
+        std::cerr << input << ": " << read << " games" << std::endl;
+        games += read;
+    }
+
+    if (!builder.write(options.out)) {
+        return 1;
+    }
+
+    OpeningBook book;
+    if (!book.open(options.out)) {
+        std::cerr << "book_builder: written book does not validate" << std::endl;
+        return 1;
+    }
+    std::cerr << options.out << ": " << games << " games, " << builder.positions()
+              << " positions, " << book.size() << " entries" << std::endl;
+    return 0;
+}
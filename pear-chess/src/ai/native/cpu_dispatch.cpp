@@ -0,0 +1,163 @@
+// CPU feature detection for picking a Stockfish build at load time. The
+// stockfish_cpu module compiles this file without any -m flags, so it runs
+// on every host of the platform, including ones too old for the variants it
+// rejects.
+
+#include "cpu_dispatch.h"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CPU_DISPATCH_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_DISPATCH_ARM
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace StockfishBinding {
+
+namespace {
+
+#ifdef CPU_DISPATCH_X86
+struct CpuidRegs {
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+};
+
+CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf = 0) {
+    CpuidRegs regs;
+#ifdef _MSC_VER
+    int out[4];
+    __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+    regs.eax = out[0];
+    regs.ebx = out[1];
+    regs.ecx = out[2];
+    regs.edx = out[3];
+#else
+    __cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+#endif
+    return regs;
+}
+
+// Register state the OS saves on context switch (XCR0)
+uint64_t xgetbv0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+bool bit(uint32_t reg, int n) {
+    return (reg >> n) & 1;
+}
+#endif
+
+CpuFeatures detect() {
+    CpuFeatures f;
+
+#ifdef CPU_DISPATCH_X86
+    CpuidRegs vendor = cpuid(0);
+    uint32_t max_leaf = vendor.eax;
+    if (max_leaf < 1) return f;
+
+    CpuidRegs leaf1 = cpuid(1);
+    f.sse41 = bit(leaf1.ecx, 19);
+    f.popcnt = bit(leaf1.ecx, 23);
+
+    // AVX needs the OS to save YMM state, AVX-512 also opmask and ZMM state
+    uint64_t xcr0 = bit(leaf1.ecx, 27) ? xgetbv0() : 0;
+    bool os_avx = (xcr0 & 0x06) == 0x06;
+    bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+    if (max_leaf >= 7) {
+        CpuidRegs leaf7 = cpuid(7, 0);
+        bool bmi1 = bit(leaf7.ebx, 3);
+        f.avx2 = os_avx && bit(leaf7.ebx, 5) && bmi1;
+        f.bmi2 = bit(leaf7.ebx, 8);
+        f.avx512 = os_avx512 && bit(leaf7.ebx, 16) && bit(leaf7.ebx, 30);
+        f.vnni512 = f.avx512 && bit(leaf7.ebx, 17) && bit(leaf7.ebx, 31) && bit(leaf7.ecx, 11);
+    }
+
+    // AMD implemented pext/pdep in microcode before Zen 3 (family 19h), which
+    // makes Stockfish's bmi2 build slower than its avx2 one there
+    f.fast_pext = f.bmi2;
+    bool amd = vendor.ebx == 0x68747541;  // "Auth"enticAMD
+    if (amd) {
+        uint32_t family = (leaf1.eax >> 8) & 0xf;
+        if (family == 0xf) family += (leaf1.eax >> 20) & 0xff;
+        f.fast_pext = f.bmi2 && family >= 0x19;
+    }
+#elif defined(CPU_DISPATCH_ARM)
+    f.neon = true;  // Mandatory on AArch64
+#if defined(__APPLE__)
+    f.dotprod = true;  // Every Apple Silicon core has it
+#elif defined(__linux__) && defined(HWCAP_ASIMDDP)
+    f.dotprod = (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) != 0;
+#endif
+#endif
+
+    return f;
+}
+
+struct Variant {
+    const char* arch;
+    bool (*runs)(const CpuFeatures&);
+};
+
+// Every Stockfish build the port knows, fastest first. The AVX-512 builds
+// are compiled with AVX2 and BMI2 too
+const Variant kVariants[] = {
+    {"x86-64-vnni512", [](const CpuFeatures& f) { return f.vnni512 && f.avx2 && f.bmi2 && f.popcnt; }},
+    {"x86-64-avx512", [](const CpuFeatures& f) { return f.avx512 && f.avx2 && f.bmi2 && f.popcnt; }},
+    {"x86-64-bmi2", [](const CpuFeatures& f) { return f.avx2 && f.fast_pext && f.popcnt; }},
+    {"x86-64-avx2", [](const CpuFeatures& f) { return f.avx2 && f.popcnt; }},
+    {"x86-64-sse41-popcnt", [](const CpuFeatures& f) { return f.sse41 && f.popcnt; }},
+    {"apple-silicon", [](const CpuFeatures& f) { return f.neon && f.dotprod; }},
+    {"armv8", [](const CpuFeatures& f) { return f.neon; }},
+};
+
+} // namespace
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+bool cpu_supports(const std::string& arch) {
+    for (const auto& variant : kVariants) {
+        if (arch == variant.arch) {
+            return variant.runs(cpu_features());
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> supported_variants() {
+    std::vector<std::string> result;
+    for (const auto& variant : kVariants) {
+        if (variant.runs(cpu_features())) {
+            result.push_back(variant.arch);
+        }
+    }
+    return result;
+}
+
+std::string best_variant(const std::vector<std::string>& available) {
+    for (const auto& arch : supported_variants()) {
+        if (std::find(available.begin(), available.end(), arch) != available.end()) {
+            return arch;
+        }
+    }
+    return available.empty() ? std::string() : available.front();
+}
+
+} // namespace StockfishBinding
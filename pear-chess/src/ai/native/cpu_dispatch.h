@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace StockfishBinding {
+
+// Instruction set extensions that select a Stockfish build
+struct CpuFeatures {
+    bool popcnt = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool fast_pext = false;  // pext/pdep are microcoded on AMD before Zen 3
+    bool avx512 = false;     // F and BW, as Stockfish's avx512 build needs
+    bool vnni512 = false;    // Plus VNNI, DQ and VL
+    bool neon = false;
+    bool dotprod = false;
+};
+
+// Features of the running CPU, including OS support for the wider registers
+const CpuFeatures& cpu_features();
+
+// Whether a Stockfish ARCH name (e.g. "x86-64-avx2") can run on this host
+bool cpu_supports(const std::string& arch);
+
+// Stockfish architectures this host can run, fastest first
+std::vector<std::string> supported_variants();
+
+// Fastest of the available architectures this host can run, or the first
+// entry (the baseline) when none match
+std::string best_variant(const std::vector<std::string>& available);
+
+} // namespace StockfishBinding
@@ -0,0 +1,40 @@
+// Bare module that reports which Stockfish builds the host can run. It
+// links no Stockfish code, so index.js can load it on any CPU before
+// choosing the stockfish_binding variant to load.
+
+#include "cpu_dispatch.h"
+
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+
+namespace {
+
+js_value_t* supported_variants(js_env_t* env, js_callback_info_t* info) {
+    auto variants = StockfishBinding::supported_variants();
+
+    js_value_t* result;
+    int err = js_create_array_with_length(env, variants.size(), &result);
+    assert(err == 0);
+    for (size_t i = 0; i < variants.size(); ++i) {
+        js_value_t* arch;
+        err = js_create_string_utf8(env, reinterpret_cast<const utf8_t*>(variants[i].data()), variants[i].size(), &arch);
+        assert(err == 0);
+        err = js_set_element(env, result, static_cast<uint32_t>(i), arch);
+        assert(err == 0);
+    }
+    return result;
+}
+
+} // namespace
+
+static js_value_t* init(js_env_t* env, js_value_t* exports) {
+    js_value_t* fn;
+    int err = js_create_function(env, "supportedVariants", -1, supported_variants, nullptr, &fn);
+    assert(err == 0);
+    err = js_set_named_property(env, exports, "supportedVariants", fn);
+    assert(err == 0);
+    return exports;
+}
+
+BARE_MODULE(stockfish_cpu, init)
@@ -0,0 +1,381 @@
+#include "engine_pool.h"
+#include "metrics.h"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace StockfishBinding {
+
+// Stockfish defaults for the options games commonly tune per lease. An
+// override outside this table and EnginePoolConfig::base_options cannot be
+// undone, so the engine is retired instead of going back to the pool.
+static const EngineOptions& default_options() {
+    static const EngineOptions defaults = {
+        {"MultiPV", "1"},
+        {"Skill Level", "20"},
+        {"UCI_LimitStrength", "false"},
+        {"UCI_Elo", "1320"},
+        {"UCI_ShowWDL", "false"},
+        {"Ponder", "false"},
+        {"Move Overhead", "10"},
+        {"Threads", "1"},
+        {"Hash", "16"},
+    };
+    return defaults;
+}
+
+// Lease
+
+EnginePool::Lease::Lease(EnginePool* pool, std::unique_ptr<StockfishEngine> engine, EngineOptions overrides)
+    : pool_(pool), engine_(std::move(engine)), overrides_(std::move(overrides)) {
+}
+
+EnginePool::Lease::Lease(Lease&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)),
+      engine_(std::move(other.engine_)),
+      overrides_(std::move(other.overrides_)) {
+}
+
+EnginePool::Lease& EnginePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        engine_ = std::move(other.engine_);
+        overrides_ = std::move(other.overrides_);
+    }
+    return *this;
+}
+
+EnginePool::Lease::~Lease() {
+    release();
+}
+
+void EnginePool::Lease::release() {
+    if (pool_ && engine_) {
+        pool_->release(std::move(engine_), overrides_);
+    }
+    pool_ = nullptr;
+    engine_.reset();
+    overrides_.clear();
+}
+
+// EnginePool
+
+EnginePool::EnginePool(EnginePoolConfig config)
+    : config_(std::move(config)) {
+    if (config_.max_engines == 0) {
+        config_.max_engines = 1;
+    }
+
+    size_t warm = std::min(config_.prewarm, config_.max_engines);
+    for (size_t i = 0; i < warm; ++i) {
+        auto engine = create_engine();
+        if (!engine) break;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(std::move(engine));
+        ++live_;
+    }
+}
+
+EnginePool::~EnginePool() {
+    close();
+
+    // Leases must not outlive the pool; wait for the stragglers
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] { return live_ == 0; });
+}
+
+EnginePool::Lease EnginePool::acquire(const EngineOptions& options) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] {
+        return closed_ || !idle_.empty() || live_ < config_.max_engines;
+    });
+    return take(lock, options);
+}
+
+EnginePool::Lease EnginePool::try_acquire(const EngineOptions& options) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (idle_.empty() && live_ >= config_.max_engines) {
+        return Lease();
+    }
+    return take(lock, options);
+}
+
+EnginePool::Lease EnginePool::take(std::unique_lock<std::mutex>& lock, const EngineOptions& options) {
+    if (closed_) {
+        return Lease();
+    }
+
+    if (!idle_.empty()) {
+        auto engine = std::move(idle_.back());
+        idle_.pop_back();
+        lock.unlock();
+        return lease(std::move(engine), options);
+    }
+
+    // Reserve the slot, then build the engine outside the lock since
+    // initialization is the slow part
+    ++live_;
+    lock.unlock();
+
+    auto engine = create_engine();
+    if (!engine) {
+        lock.lock();
+        --live_;
+        available_.notify_all();
+        return Lease();
+    }
+    return lease(std::move(engine), options);
+}
+
+void EnginePool::close() {
+    std::vector<std::unique_ptr<StockfishEngine>> doomed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        doomed.swap(idle_);
+        live_ -= doomed.size();
+        for (const auto& engine : doomed) {
+            forget_locked(engine.get());
+        }
+    }
+    available_.notify_all();
+    // Engines shut down as doomed goes out of scope, outside the lock
+}
+
+size_t EnginePool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_;
+}
+
+size_t EnginePool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+std::unique_ptr<StockfishEngine> EnginePool::create_engine() {
+    auto engine = std::make_unique<StockfishEngine>();
+    if (!engine->initialize()) {
+        BINDING_LOG(Error, "EnginePool: engine initialization failed");
+        return nullptr;
+    }
+
+    for (const auto& [name, value] : config_.base_options) {
+        engine->set_option(name, value);
+    }
+    engine->set_analysis_cache(config_.analysis_cache);
+    fit_hash(*engine);
+    return engine;
+}
+
+EnginePool::Lease EnginePool::lease(std::unique_ptr<StockfishEngine> engine, const EngineOptions& options) {
+    fit_hash(*engine);
+
+    // No more threads than the machine has CPUs, or no search would ever
+    // get them all
+    EngineOptions requested = options;
+    if (config_.scheduler) {
+        size_t threads = std::min(lease_threads(options), config_.scheduler->capacity());
+        if (threads != lease_threads(options)) {
+            requested["Threads"] = std::to_string(threads);
+        }
+        bind(*engine, threads);
+    }
+
+    EngineOptions applied;
+    for (const auto& [name, value] : requested) {
+        // Hash is the pool's to manage while a budget is set, NumaPolicy
+        // while a scheduler is
+        if (name == "Hash" && hash_budget() != 0) continue;
+        if (name == "NumaPolicy" && config_.scheduler) continue;
+        if (engine->set_option(name, value)) {
+            applied.emplace(name, value);
+        }
+    }
+    if (applied.count("Hash")) {
+        fit_hash(*engine);  // Only counts it: there is no budget to fit
+    }
+    return Lease(this, std::move(engine), std::move(applied));
+}
+
+// Search threads a lease with options would run
+size_t EnginePool::lease_threads(const EngineOptions& options) const {
+    auto it = options.find("Threads");
+    auto base = config_.base_options.find("Threads");
+    if (it == options.end() && base == config_.base_options.end()) return 1;
+    try {
+        const std::string& value = it != options.end() ? it->second : base->second;
+        return static_cast<size_t>(std::max(1, std::stoi(value)));
+    } catch (const std::exception&) {
+        return 1;
+    }
+}
+
+// Confine the engine's threads to the NUMA node with the fewest engines
+// that has CPUs for all of them, or to every node when none has. Stockfish
+// rebuilds its threads and reallocates the table on a NumaPolicy change, so
+// an engine stays on its node from lease to lease; only a lease with more
+// Threads than the node holds moves it. Its searches then prefer that node.
+// On a single node there is nothing to gain, and the OS is left to it.
+void EnginePool::bind(StockfishEngine& engine, size_t threads) {
+    const auto& nodes = config_.scheduler->topology().nodes();
+    size_t node = ThreadScheduler::Grant::Spanning;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = bindings_.find(&engine);
+        if (it != bindings_.end()
+            && (it->second == ThreadScheduler::Grant::Spanning || nodes[it->second].cpus.size() >= threads)) {
+            return;
+        }
+        if (nodes.size() >= 2) {
+            std::vector<size_t> engines(nodes.size(), 0);
+            for (const auto& [bound, at] : bindings_) {
+                if (bound != &engine && at != ThreadScheduler::Grant::Spanning) ++engines[at];
+            }
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i].cpus.size() < threads) continue;
+                if (node == ThreadScheduler::Grant::Spanning || engines[i] < engines[node]) node = i;
+            }
+        }
+    }
+
+    if (nodes.size() >= 2) {
+        std::vector<size_t> policy_nodes(nodes.size());
+        std::iota(policy_nodes.begin(), policy_nodes.end(), 0);
+        if (node != ThreadScheduler::Grant::Spanning) policy_nodes = {node};
+        if (!engine.set_option("NumaPolicy", config_.scheduler->topology().numa_policy(policy_nodes))) {
+            node = ThreadScheduler::Grant::Spanning;
+        }
+    }
+    engine.set_scheduler(config_.scheduler, node);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bindings_[&engine] = node;
+}
+
+void EnginePool::release(std::unique_ptr<StockfishEngine> engine, const EngineOptions& overrides) {
+    // Reset outside the lock: stopping a search and clearing the hash
+    // can take a while
+    engine->set_info_callback(nullptr);
+    engine->set_info_interval(0);
+    engine->new_game();
+
+    bool reusable = restore(*engine, overrides);
+    if (reusable) {
+        fit_hash(*engine);
+    }
+
+    // Notify while holding the lock: once live_ drops to zero a closing
+    // pool may be destroyed as soon as the mutex is free
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_ || !reusable) {
+        --live_;
+        forget_locked(engine.get());
+        available_.notify_all();
+        lock.unlock();
+        engine.reset();
+        return;
+    }
+    idle_.push_back(std::move(engine));
+    available_.notify_one();
+}
+
+bool EnginePool::restore(StockfishEngine& engine, const EngineOptions& overrides) {
+    bool reusable = true;
+    for (const auto& [name, value] : overrides) {
+        auto base = config_.base_options.find(name);
+        if (base != config_.base_options.end()) {
+            engine.set_option(name, base->second);
+            continue;
+        }
+        auto def = default_options().find(name);
+        if (def != default_options().end()) {
+            engine.set_option(name, def->second);
+            continue;
+        }
+        reusable = false;
+    }
+    return reusable;
+}
+
+void EnginePool::set_hash_budget(size_t mb) {
+    std::vector<std::unique_ptr<StockfishEngine>> resize;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_.hash_budget_mb = mb;
+        resize.swap(idle_);
+    }
+
+    // Resizing reallocates and clears the table, so do it with the idle
+    // engines checked out rather than under the lock. Clearing the budget
+    // recounts them instead; leased engines are recounted when they return.
+    for (auto& engine : resize) {
+        fit_hash(*engine);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& engine : resize) {
+        if (closed_) {
+            --live_;
+            forget_locked(engine.get());
+        } else {
+            idle_.push_back(std::move(engine));
+        }
+    }
+    available_.notify_all();
+}
+
+size_t EnginePool::hash_budget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_.hash_budget_mb;
+}
+
+size_t EnginePool::hash_allocated() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocated_locked();
+}
+
+// Size an engine's table to an equal share of the budget, but never past
+// what the other engines leave free: a leased engine keeps its larger share
+// until it comes back, and the budget must hold in the meantime. Without a
+// budget the engine's own Hash is only counted, so a budget set later sees
+// what every engine already holds.
+void EnginePool::fit_hash(StockfishEngine& engine) {
+    const size_t actual = engine.memory_bytes() / (1024 * 1024);
+    size_t target = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t budget = config_.hash_budget_mb;
+        if (budget == 0) {
+            hash_mb_[&engine] = actual;
+            return;
+        }
+
+        auto it = hash_mb_.find(&engine);
+        size_t current = it != hash_mb_.end() ? it->second : actual;
+        size_t others = allocated_locked() - current;
+        size_t share = budget / std::max<size_t>(live_, 1);
+        size_t free = budget > others ? budget - others : 0;
+        target = std::max<size_t>(1, std::min(share, free));
+
+        if (target == current) return;
+        hash_mb_[&engine] = target;
+    }
+    engine.set_option("Hash", std::to_string(target));
+}
+
+size_t EnginePool::allocated_locked() const {
+    size_t total = 0;
+    for (const auto& entry : hash_mb_) {
+        total += entry.second;
+    }
+    return total;
+}
+
+void EnginePool::forget_locked(const StockfishEngine* engine) {
+    hash_mb_.erase(engine);
+    bindings_.erase(engine);
+}
+
+} // namespace StockfishBinding
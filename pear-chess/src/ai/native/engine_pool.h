@@ -0,0 +1,134 @@
+#pragma once
+
+#include "stockfish_wrapper.h"
+#include "thread_scheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace StockfishBinding {
+
+// Option overrides applied to an engine for the duration of one lease
+using EngineOptions = std::map<std::string, std::string>;
+
+struct EnginePoolConfig {
+    size_t max_engines = 4;   // Upper bound on live engines
+    size_t prewarm = 0;       // Engines created up front by the constructor
+
+    // Baseline applied to every engine when created and restored after a
+    // lease that overrode it. Options not listed here fall back to the
+    // Stockfish defaults the pool knows about (see engine_pool.cpp).
+    // SyzygyPath belongs here: tables are mapped once for the process, and
+    // a lease switching paths would reload them under every other engine.
+    EngineOptions base_options;
+
+    // Total transposition table memory for all live engines, in MB. Each
+    // engine gets an equal share that is rebalanced as engines come and go;
+    // 0 leaves every engine at its own Hash setting.
+    size_t hash_budget_mb = 0;
+
+    // Analysis cache attached to every engine the pool creates, if any
+    std::shared_ptr<AnalysisCache> analysis_cache;
+
+    // CPUs for the engines' searches, possibly shared with other pools.
+    // With one, each search holds as many CPUs as its engine runs Threads
+    // while it runs (see StockfishEngine::set_scheduler()), so idle leases
+    // hold none. Each engine is bound to one NUMA node through NumaPolicy
+    // when first leased, and its searches prefer that node. Threads above
+    // the machine's CPU count are cut to it.
+    std::shared_ptr<ThreadScheduler> scheduler;
+};
+
+// Pool of initialized engines shared by many games. Global Stockfish tables
+// are built once by the first engine; later games lease a warm engine
+// instead of paying engine construction and network load again.
+class EnginePool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        StockfishEngine* get() const { return engine_.get(); }
+        StockfishEngine* operator->() const { return engine_.get(); }
+        StockfishEngine& operator*() const { return *engine_; }
+        explicit operator bool() const { return engine_ != nullptr; }
+
+        // Hand the engine back early; also done by the destructor
+        void release();
+
+    private:
+        friend class EnginePool;
+        Lease(EnginePool* pool, std::unique_ptr<StockfishEngine> engine, EngineOptions overrides);
+
+        EnginePool* pool_ = nullptr;
+        std::unique_ptr<StockfishEngine> engine_;
+        EngineOptions overrides_;
+    };
+
+    explicit EnginePool(EnginePoolConfig config = {});
+    ~EnginePool();
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    // Blocks until an engine is free or a new one may be created. Returns
+    // an empty lease if engine creation fails or the pool is closing.
+    Lease acquire(const EngineOptions& options = {});
+
+    // Never blocks; returns an empty lease when every engine is busy
+    Lease try_acquire(const EngineOptions& options = {});
+
+    // Stop handing out engines and destroy the idle ones. Outstanding
+    // leases are destroyed as they are released.
+    void close();
+
+    size_t size() const;       // Live engines, idle plus leased
+    size_t idle() const;
+    size_t max_size() const { return config_.max_engines; }
+
+    // Change the hash budget at runtime. Idle engines are resized at once;
+    // leased ones keep their table until returned, so a shrink takes full
+    // effect only once current games end.
+    void set_hash_budget(size_t mb);
+    size_t hash_budget() const;
+    size_t hash_allocated() const;  // Sum of the engines' current Hash, MB
+
+private:
+    Lease take(std::unique_lock<std::mutex>& lock, const EngineOptions& options);
+    std::unique_ptr<StockfishEngine> create_engine();
+    Lease lease(std::unique_ptr<StockfishEngine> engine, const EngineOptions& options);
+    size_t lease_threads(const EngineOptions& options) const;
+    void bind(StockfishEngine& engine, size_t threads);
+    void release(std::unique_ptr<StockfishEngine> engine, const EngineOptions& overrides);
+    bool restore(StockfishEngine& engine, const EngineOptions& overrides);
+    void fit_hash(StockfishEngine& engine);
+    size_t allocated_locked() const;
+    void forget_locked(const StockfishEngine* engine);
+
+    EnginePoolConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<std::unique_ptr<StockfishEngine>> idle_;
+    size_t live_ = 0;
+    std::atomic<bool> closed_{false};
+
+    // Current Hash of every live engine, MB, as fit_hash() last sized or
+    // counted it
+    std::map<const StockfishEngine*, size_t> hash_mb_;
+
+    // Node each live engine is bound to, or Grant::Spanning, see bind()
+    std::map<const StockfishEngine*, size_t> bindings_;
+};
+
+} // namespace StockfishBinding
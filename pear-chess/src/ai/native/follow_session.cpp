@@ -0,0 +1,144 @@
+#include "follow_session.h"
+#include "metrics.h"
+#include <algorithm>
+
+namespace StockfishBinding {
+
+FollowSession::FollowSession(StockfishEngine& engine, int interval_ms)
+    : engine_(engine), interval_ms_(std::max(0, interval_ms)) {
+    // Set once, while nothing searches; a steer only swaps the search. The
+    // packed stream keeps one record per line, so a search followed for
+    // hours allocates only for the updates published.
+    engine_.set_packed_info_callback([this](const SearchArena& arena, const PackedInfo& record) {
+        publish(arena.info(record));
+    });
+    engine_.set_info_interval(interval_ms_);
+}
+
+FollowSession::~FollowSession() {
+    stop();
+    engine_.set_packed_info_callback(nullptr);
+    engine_.set_info_interval(0);
+}
+
+uint64_t FollowSession::subscribe(Listener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t id = next_id_++;
+    if (has_latest_ && listener) {
+        listener(latest_);
+    }
+    listeners_.emplace(id, std::move(listener));
+    return id;
+}
+
+void FollowSession::unsubscribe(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.erase(id);
+}
+
+size_t FollowSession::subscribers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return listeners_.size();
+}
+
+bool FollowSession::start(const std::string& fen, const std::vector<std::string>& moves) {
+    return resync(fen, moves);
+}
+
+bool FollowSession::push_move(const std::string& uci_move) {
+    std::lock_guard<std::mutex> steer(steer_mutex_);
+    if (!running_) return false;
+
+    // Nothing publishes between the old search ending and the new one
+    // starting, so the ply and FEN cannot be torn
+    halt_locked();
+    bool pushed = engine_.push_move(uci_move);
+    if (pushed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ply_++;
+        fen_ = engine_.get_fen();
+        has_latest_ = false;
+    } else {
+        BINDING_LOG(Debug, "Follow: illegal move " << uci_move << " at ply " << ply_);
+    }
+    launch_locked();
+    return pushed;
+}
+
+bool FollowSession::resync(const std::string& fen, const std::vector<std::string>& moves) {
+    std::lock_guard<std::mutex> steer(steer_mutex_);
+    halt_locked();
+    if (!engine_.set_position_with_moves(fen, moves)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ply_ = moves.size();
+        fen_ = engine_.get_fen();
+        has_latest_ = false;
+    }
+    launch_locked();
+    return true;
+}
+
+void FollowSession::stop() {
+    std::lock_guard<std::mutex> steer(steer_mutex_);
+    halt_locked();
+}
+
+bool FollowSession::running() const {
+    std::lock_guard<std::mutex> steer(steer_mutex_);
+    return running_;
+}
+
+uint64_t FollowSession::ply() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ply_;
+}
+
+bool FollowSession::latest(FollowUpdate& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_latest_) return false;
+    out = latest_;
+    return true;
+}
+
+void FollowSession::launch_locked() {
+    SearchLimits limits;
+    limits.infinite = true;
+    // Watchers want a live line in book and tablebase positions too, and
+    // an infinite search has no cacheable result
+    limits.use_book = false;
+    limits.use_tablebase = false;
+    limits.use_cache = false;
+    search_ = engine_.search_async(limits);
+    running_ = true;
+}
+
+void FollowSession::halt_locked() {
+    if (!running_) return;
+    // The last line is flushed before bestmove, so once the future is ready
+    // the old search publishes nothing more
+    engine_.stop_search();
+    if (search_.valid()) {
+        search_.wait();
+    }
+    running_ = false;
+}
+
+void FollowSession::publish(const SearchInfo& info) {
+    // Listeners run under the lock: they are few, post a copy elsewhere and
+    // return, and this keeps unsubscribe() from racing a delivery
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_.ply = ply_;
+    latest_.fen = fen_;
+    latest_.info = info;
+    has_latest_ = true;
+    for (const auto& entry : listeners_) {
+        if (entry.second) {
+            entry.second(latest_);
+        }
+    }
+}
+
+} // namespace StockfishBinding
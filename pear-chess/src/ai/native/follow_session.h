@@ -0,0 +1,90 @@
+#pragma once
+
+#include "stockfish_wrapper.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace StockfishBinding {
+
+// Newest line of a followed game, tagged with the position it belongs to
+struct FollowUpdate {
+    uint64_t ply = 0;   // Moves played since the FEN given to start() or resync()
+    std::string fen;    // Position being searched
+    SearchInfo info;
+};
+
+// One engine analysing a live game for everyone watching it. The engine
+// runs an infinite search of the current position; push_move() stops it,
+// plays the move on the engine's game and searches again at once, so the
+// transposition table carries the previous position's work into the next
+// one. Updates are coalesced to one per interval and handed to every
+// subscriber, however many there are.
+class FollowSession {
+public:
+    using Listener = std::function<void(const FollowUpdate&)>;
+
+    // The engine must be initialized, and is the session's until stop()
+    explicit FollowSession(StockfishEngine& engine, int interval_ms = 250);
+
+    // Stops the search and waits for it to end
+    ~FollowSession();
+
+    FollowSession(const FollowSession&) = delete;
+    FollowSession& operator=(const FollowSession&) = delete;
+
+    // Listeners run on a search thread and must not steer the session.
+    // A new one is handed the latest update, if there is one, before
+    // subscribe() returns.
+    uint64_t subscribe(Listener listener);
+    void unsubscribe(uint64_t id);
+    size_t subscribers() const;
+
+    // Starts following from fen with moves played; false if the position
+    // is invalid, leaving the session stopped
+    bool start(const std::string& fen, const std::vector<std::string>& moves = {});
+
+    // Next move of the game. An illegal move is rejected, and the search of
+    // the current position carries on.
+    bool push_move(const std::string& uci_move);
+
+    // Jumps to another position, e.g. after missing moves; the table is
+    // kept, and ply restarts from the moves given
+    bool resync(const std::string& fen, const std::vector<std::string>& moves = {});
+
+    // Ends the search; start() or resync() resumes
+    void stop();
+
+    bool running() const;
+    uint64_t ply() const;
+
+    // Newest update of the current position; false before the first one
+    bool latest(FollowUpdate& out) const;
+
+private:
+    void launch_locked();
+    void halt_locked();
+    void publish(const SearchInfo& info);
+
+    StockfishEngine& engine_;
+    const int interval_ms_;
+
+    mutable std::mutex steer_mutex_;  // Serializes start, push_move, resync and stop
+    std::future<SearchResult> search_;
+    bool running_ = false;
+
+    mutable std::mutex mutex_;  // Guards what publish() touches
+    std::map<uint64_t, Listener> listeners_;
+    uint64_t next_id_ = 1;
+    uint64_t ply_ = 0;
+    std::string fen_;
+    FollowUpdate latest_;
+    bool has_latest_ = false;
+};
+
+} // namespace StockfishBinding
@@ -34,25 +34,65 @@ function getPlatformBinary() {
   return `${platformName}-${archName}`
 }
 
-// Load the native module
-function loadNativeModule() {
+// Path of the compiled addon in prebuilds/<platform>. The baseline build
+// is stockfish_binding.bare; faster CPU variants add their Stockfish ARCH
+// suffix, e.g. stockfish_binding-avx2.bare for x86-64-avx2.
+function getBinaryPath(arch = null) {
   const binaryName = getPlatformBinary()
   const prebuildsPath = path.join(__dirname, '..', '..', '..', 'prebuilds', binaryName)
-  const binaryPath = path.join(prebuildsPath, 'stockfish.node')
-  
-  if (!fs.existsSync(binaryPath)) {
+  const fileName = arch
+    ? `stockfish_binding-${arch.replace(/^x86-64-/, '')}.bare`
+    : 'stockfish_binding.bare'
+  return path.join(prebuildsPath, fileName)
+}
+
+// Bindings to try, fastest first. stockfish_cpu.bare links no Stockfish
+// code, so it loads on any CPU and reports which variants this one runs.
+function getCandidateBinaries() {
+  const candidates = []
+  const probePath = path.join(path.dirname(getBinaryPath()), 'stockfish_cpu.bare')
+
+  if (typeof require.addon === 'function' && fs.existsSync(probePath)) {
+    try {
+      for (const arch of require.addon(probePath).supportedVariants()) {
+        candidates.push(getBinaryPath(arch))
+      }
+    } catch (error) {
+      console.warn('Stockfish CPU detection failed, using the baseline build:', error.message)
+    }
+  }
+
+  candidates.push(getBinaryPath())
+  return candidates.filter(candidate => fs.existsSync(candidate))
+}
+
+// Load the native module. The binding is a Bare addon, so it needs a
+// runtime that provides require.addon().
+function loadNativeModule() {
+  if (typeof require.addon !== 'function') {
+    throw new Error('Native Stockfish module requires the Bare runtime')
+  }
+
+  const candidates = getCandidateBinaries()
+  if (candidates.length === 0) {
     throw new Error(
-      `Native Stockfish module not found for ${binaryName}.\n` +
-      `Expected: ${binaryPath}\n` +
+      `Native Stockfish module not found for ${getPlatformBinary()}.\n` +
+      `Expected: ${getBinaryPath()}\n` +
       `Please run 'npm run build' to compile the native module.`
     )
   }
-  
-  try {
-    return require(binaryPath)
-  } catch (error) {
-    throw new Error(`Failed to load native Stockfish module: ${error.message}`)
+
+  // A variant refuses to load on a CPU it cannot run; fall through to the
+  // next one, ending at the baseline
+  let lastError = null
+  for (const binaryPath of candidates) {
+    try {
+      return require.addon(binaryPath)
+    } catch (error) {
+      lastError = error
+    }
   }
+  throw new Error(`Failed to load native Stockfish module: ${lastError.message}`)
 }
 
 // Export the native module
@@ -61,141 +101,239 @@ let nativeModule = null
 try {
   nativeModule = loadNativeModule()
 } catch (error) {
-  // Fallback to external process implementation if native module fails
+  // Callers fall back to the external process engine (see src/ai/index.js)
   console.warn('Native Stockfish module not available:', error.message)
-  console.warn('Falling back to external process implementation')
-  
-  // Re-export the external engine as fallback
-  const { SimpleStockfishEngine } = require('../external-engine-simple.js')
-  
+
   module.exports = {
-    StockfishEngine: SimpleStockfishEngine,
+    StockfishEngine: null,
+    binding: null,
     isNative: false,
     fallback: true
   }
-} 
+}
 
 if (nativeModule) {
-  // Wrap the native engine with a more JavaScript-friendly interface
+  // Wrap the engine handle with a more JavaScript-friendly interface.
+  // Searches run on native threads and settle their promise from there,
+  // so none of these calls block the event loop for long.
   class NativeStockfishEngine {
     constructor(options = {}) {
-      this.engine = new nativeModule.StockfishEngine()
+      this.handle = nativeModule.create()
       this.options = {
         debug: options.debug || false,
         ...options
       }
     }
-    
+
+    // The analysis cache is shared by every engine in the process; searches
+    // pass useCache: false to bypass it
+    static cacheStats() {
+      return nativeModule.cacheStats()
+    }
+
+    static setCacheSize(mb) {
+      nativeModule.setCacheSize(mb)
+    }
+
+    static clearCache() {
+      nativeModule.clearCache()
+    }
+
+    // Searches given a priority wait in one queue for the process, with at
+    // most setSearchSlots() of them running; reviews yield to live games
+    static queueStats() {
+      return nativeModule.queueStats()
+    }
+
+    static setSearchSlots(count) {
+      nativeModule.setSearchSlots(count)
+    }
+
+    // Builds count engines in the background for later start() calls to
+    // take; a stopped engine is kept for the next start() either way
+    static prewarm(count = 1) {
+      nativeModule.prewarm(count)
+    }
+
+    // Counters and latency histograms for every engine in the process, as
+    // an object or in Prometheus text format
+    static metrics() {
+      return nativeModule.metrics()
+    }
+
+    static metricsText() {
+      return nativeModule.metricsText()
+    }
+
+    // 'error', 'warn' (default), 'info' or 'debug'; release builds only
+    // have warnings and errors to show
+    static setLogLevel(level) {
+      nativeModule.setLogLevel(level)
+    }
+
+    // One batch of games from a PGN archive, replayed on the thread pool;
+    // pass the returned offset back in for the next batch
+    static importPgn(path, offset = 0, maxGames = 1000) {
+      return nativeModule.importPgn(path, offset, maxGames)
+    }
+
+    static isValidFen(fen) {
+      return nativeModule.isValidFen(fen)
+    }
+
+    // The conversions return null for an invalid FEN or an illegal move
+    static fenAfterMove(fen, uci) {
+      return nativeModule.fenAfterMove(fen, uci)
+    }
+
+    static sanToUci(fen, san) {
+      return nativeModule.sanToUci(fen, san)
+    }
+
+    static uciToSan(fen, uci) {
+      return nativeModule.uciToSan(fen, uci)
+    }
+
     async start() {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.start()
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      if (!nativeModule.initialize(this.handle)) {
+        throw new Error('Failed to initialize native Stockfish engine')
+      }
+      if (this.options.syzygyPath) {
+        nativeModule.setOption(this.handle, 'SyzygyPath', this.options.syzygyPath)
+      }
+      return true
+    }
+
     async stop() {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.stop()
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      nativeModule.stop(this.handle)
+    }
+
     async setOption(name, value) {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.setOption(name, value)
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      return nativeModule.setOption(this.handle, name, String(value))
+    }
+
+    // Play at about this Elo (1320 to 3190), or full strength for 0. Weak
+    // searches stop at the depth Stockfish picks its move at.
+    async setStrength(elo) {
+      return nativeModule.setStrength(this.handle, elo)
+    }
+
+    // Clear hash and history and return to the start position, keeping the
+    // engine and its options
+    async newGame() {
+      nativeModule.newGame(this.handle)
+    }
+
     async position(fen, moves = []) {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.position(fen, moves)
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      return nativeModule.setPosition(this.handle, fen, moves)
+    }
+
+    // options: UCI go parameters plus an optional onInfo(info) callback
     async go(options = {}) {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.go(options)
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      const { onInfo, ...limits } = options
+      return nativeModule.search(this.handle, limits, onInfo && ((packed) => onInfo(packedSearchInfo(packed))))
+    }
+
+    // Search the position after expectedMove on the opponent's time; the
+    // promise settles after ponderHit() (the answer) or stopPondering()
+    async ponder(fen, moves, expectedMove, options = {}) {
+      const { onInfo, ...limits } = options
+      await this.position(fen, moves)
+      return nativeModule.ponder(this.handle, expectedMove, limits, onInfo && ((packed) => onInfo(packedSearchInfo(packed))))
+    }
+
+    async ponderHit() {
+      return nativeModule.ponderHit(this.handle)
+    }
+
+    async stopPondering() {
+      nativeModule.stopPondering(this.handle)
+    }
+
+    // Opening book file answering searches in book; null removes it
+    async setBook(path) {
+      nativeModule.setBook(this.handle, path)
+    }
+
+    async bookMoves(fen, moves = []) {
+      await this.position(fen, moves)
+      return nativeModule.bookMoves(this.handle)
+    }
+
+    // { wdl, dtz } for the side to move, or null outside the tables
+    async probeTablebase(fen) {
+      await this.position(fen)
+      return nativeModule.probeTablebase(this.handle)
+    }
+
     async analyze(fen, options = {}) {
-      return new Promise((resolve, reject) => {
-        const depth = options.depth || 20
-        
-        this.engine.analyzeAsync(fen, depth, (error, result) => {
-          if (error) {
-            reject(new Error(error))
-          } else {
-            // Convert native result to match external engine format
-            const analysis = {
-              fen: result.fen,
-              depth: result.depth,
-              bestMove: result.bestMove,
-              lines: [{
-                moves: result.pv || [],
-                score: {
-                  unit: 'cp',
-                  value: result.evaluation
-                },
-                depth: result.depth
-              }]
-            }
-            resolve(analysis)
-          }
-        })
-      })
-    }
-    
+      await this.position(fen)
+      const result = await this.go({ depth: 20, ...options })
+      const infos = result.lines.length > 0 ? result.lines : [result.finalInfo]
+
+      // Same shape as the external engine's analysis, one line per MultiPV
+      return {
+        fen,
+        depth: result.finalInfo.depth,
+        bestMove: result.bestMove,
+        lines: infos.map(info => ({
+          moves: info.pv.length > 0 ? info.pv : [result.bestMove],
+          score: {
+            unit: info.isMate ? 'mate' : 'cp',
+            value: info.isMate ? info.mateIn : info.scoreCp
+          },
+          depth: info.depth
+        })),
+        tablebase: result.tablebase,
+        exact: result.fromTablebase
+      }
+    }
+
+    // packed: resolve with { records, moves } buffers instead of objects
+    async analyzeGame(fen, moves, limits = {}, workers = 1, packed = false) {
+      return nativeModule.analyzeGame(this.handle, fen, moves, limits, workers, packed)
+    }
+
+    // Search a live game until unfollow(); followMove() steers the search
+    // to the next position, keeping the hash. onUpdate(info) gets at most
+    // one line per interval, with the ply and FEN it belongs to.
+    async follow(fen, moves, onUpdate, intervalMs = 250) {
+      return nativeModule.follow(this.handle, fen, moves, onUpdate, intervalMs)
+    }
+
+    async followMove(uci) {
+      return nativeModule.followMove(this.handle, uci)
+    }
+
+    async unfollow() {
+      nativeModule.unfollow(this.handle)
+    }
+
+    async evaluate(fen) {
+      if (fen) await this.position(fen)
+      return nativeModule.evaluate(this.handle)
+    }
+
+    getStats() {
+      return nativeModule.engineStats(this.handle)
+    }
+
     async isReady() {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.isReady()
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
-    }
-    
+      return true
+    }
+
     async quit() {
-      return new Promise((resolve, reject) => {
-        try {
-          const result = this.engine.quit()
-          resolve(result)
-        } catch (error) {
-          reject(error)
-        }
-      })
+      nativeModule.shutdown(this.handle)
+      return true
     }
   }
-  
+
   module.exports = {
     StockfishEngine: NativeStockfishEngine,
+    binding: nativeModule,
     isNative: true,
     fallback: false,
+    arch: nativeModule.arch,
     version: require('./package.json').version
   }
 }
@@ -207,17 +345,87 @@ module.exports.createEngine = function(options = {}) {
 
 module.exports.isSupported = function() {
   try {
-    const binaryName = getPlatformBinary()
-    const prebuildsPath = path.join(__dirname, '..', '..', '..', 'prebuilds', binaryName)
-    const binaryPath = path.join(prebuildsPath, 'stockfish.node')
-    return fs.existsSync(binaryPath)
+    return getCandidateBinaries().length > 0
   } catch {
     return false
   }
 }
 
-module.exports.getBinaryPath = function() {
-  const binaryName = getPlatformBinary()
-  const prebuildsPath = path.join(__dirname, '..', '..', '..', 'prebuilds', binaryName)
-  return path.join(prebuildsPath, 'stockfish.node')
-}
\ No newline at end of file
+module.exports.getBinaryPath = getBinaryPath
+
+// Packed results (see PackedInfo in stockfish_wrapper.h). Records are read
+// in place from the native buffers; moves stay 16-bit until a caller
+// decodes them with packedMoveToUci().
+const PACKED_INFO_SIZE = 48
+const PACKED_MATE = 1
+
+function packedMoveToUci(packed) {
+  const from = (packed >> 6) & 0x3f
+  let to = packed & 0x3f
+  const type = packed >> 14
+  if (from === to) return '0000'
+
+  // Stockfish stores castling as king-takes-rook
+  if (type === 3) {
+    to = (to > from ? 6 : 2) + (from & ~7)
+  }
+
+  const square = (sq) => String.fromCharCode(97 + (sq & 7), 49 + (sq >> 3))
+  let uci = square(from) + square(to)
+  if (type === 1) {
+    uci += 'nbrq'[(packed >> 12) & 3]
+  }
+  return uci
+}
+
+function packedInfoCount(packed) {
+  return packed.records.byteLength / PACKED_INFO_SIZE
+}
+
+function readPackedInfo(packed, index) {
+  const view = new DataView(packed.records, index * PACKED_INFO_SIZE, PACKED_INFO_SIZE)
+  const pvOffset = view.getUint32(24, true)
+  const pvLength = view.getUint16(28, true)
+  const flags = view.getUint16(38, true)
+  const score = view.getInt32(20, true)
+  const isMate = (flags & PACKED_MATE) !== 0
+
+  return {
+    nodes: Number(view.getBigInt64(0, true)),
+    nps: Number(view.getBigInt64(8, true)),
+    timeMs: view.getInt32(16, true),
+    scoreCp: isMate ? 0 : score,
+    isMate,
+    mateIn: isMate ? score : 0,
+    depth: view.getUint16(30, true),
+    seldepth: view.getUint16(32, true),
+    multipv: view.getUint16(34, true),
+    hashfull: view.getUint16(36, true),
+    move: view.getUint16(40, true),
+    bestMove: view.getUint16(42, true),
+    ply: view.getUint32(44, true),
+    pv: packed.moves.subarray(pvOffset, pvOffset + pvLength)
+  }
+}
+
+// A search info update, which the binding hands over packed: the fields
+// are read from the record, and the PV is only decoded to UCI when read
+function packedSearchInfo(packed, index = 0) {
+  const info = readPackedInfo(packed, index)
+  if (info.isMate) {
+    info.scoreCp = info.mateIn > 0 ? 30000 : -30000
+  }
+  const moves = info.pv
+  let pv = null
+  Object.defineProperty(info, 'pv', {
+    enumerable: true,
+    get: () => (pv ??= Array.from(moves, packedMoveToUci))
+  })
+  return info
+}
+
+module.exports.PACKED_INFO_SIZE = PACKED_INFO_SIZE
+module.exports.packedMoveToUci = packedMoveToUci
+module.exports.packedInfoCount = packedInfoCount
+module.exports.readPackedInfo = readPackedInfo
+module.exports.packedSearchInfo = packedSearchInfo
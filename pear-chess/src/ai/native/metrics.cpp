@@ -0,0 +1,128 @@
+#include "metrics.h"
+#include <cstdio>
+#include <mutex>
+
+namespace StockfishBinding {
+
+// Histogram
+
+void Histogram::observe(uint64_t value) {
+    size_t bucket = 0;
+    while (bucket + 1 < Buckets && value > (unit_ << bucket)) {
+        ++bucket;
+    }
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.unit = unit_;
+    for (size_t i = 0; i < Buckets; ++i) {
+        snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return bound(i);
+    }
+    return bound(Buckets - 1);
+}
+
+// Metrics
+
+Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+namespace {
+
+void write_counter(std::ostringstream& out, const char* name, const char* help, uint64_t value) {
+    out << "# HELP stockfish_" << name << ' ' << help << '\n'
+        << "# TYPE stockfish_" << name << " counter\n"
+        << "stockfish_" << name << ' ' << value << '\n';
+}
+
+void write_gauge(std::ostringstream& out, const char* name, const char* help, int64_t value) {
+    out << "# HELP stockfish_" << name << ' ' << help << '\n'
+        << "# TYPE stockfish_" << name << " gauge\n"
+        << "stockfish_" << name << ' ' << value << '\n';
+}
+
+void write_histogram(std::ostringstream& out, const char* name, const char* help, const Histogram& histogram) {
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    out << "# HELP stockfish_" << name << ' ' << help << '\n'
+        << "# TYPE stockfish_" << name << " histogram\n";
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i + 1 < Histogram::Buckets; ++i) {
+        cumulative += snapshot.counts[i];
+        out << "stockfish_" << name << "_bucket{le=\"" << snapshot.bound(i) << "\"} " << cumulative << '\n';
+    }
+    out << "stockfish_" << name << "_bucket{le=\"+Inf\"} " << snapshot.count << '\n'
+        << "stockfish_" << name << "_sum " << snapshot.sum << '\n'
+        << "stockfish_" << name << "_count " << snapshot.count << '\n';
+}
+
+} // namespace
+
+std::string metrics_text() {
+    const Metrics& m = metrics();
+    std::ostringstream out;
+    write_counter(out, "searches_total", "Searches run on an engine", m.searches.value());
+    write_counter(out, "book_hits_total", "Moves answered from the opening book", m.book_hits.value());
+    write_counter(out, "tablebase_hits_total", "Moves answered from endgame tablebases", m.tablebase_hits.value());
+    write_counter(out, "cache_hits_total", "Searches answered from the analysis cache", m.cache_hits.value());
+    write_counter(out, "cache_misses_total", "Cacheable searches the analysis cache could not answer",
+                  m.cache_misses.value());
+    write_histogram(out, "search_milliseconds", "Wall time of searches run on an engine", m.search_ms);
+    write_histogram(out, "search_nps", "Nodes per second at the end of a search", m.nps);
+    write_histogram(out, "hashfull_permille", "Transposition table use after a search", m.hashfull);
+    write_histogram(out, "queue_wait_milliseconds", "Time queued searches waited for a slot", m.queue_wait_ms);
+    write_histogram(out, "init_milliseconds", "Engine initialization time", m.init_ms);
+    write_gauge(out, "engines", "Initialized engines", m.engines.value());
+    write_gauge(out, "memory_bytes", "Transposition table memory of initialized engines", m.memory_bytes.value());
+    return out.str();
+}
+
+// Log
+
+static std::atomic<int> runtime_level{static_cast<int>(LogLevel::Warn)};
+static const char* const level_names[] = {"error", "warn", "info", "debug"};
+
+void set_log_level(LogLevel level) {
+    runtime_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel log_level() {
+    return static_cast<LogLevel>(runtime_level.load(std::memory_order_relaxed));
+}
+
+bool parse_log_level(const std::string& name, LogLevel& out) {
+    for (int i = 0; i <= static_cast<int>(LogLevel::Debug); ++i) {
+        if (name == level_names[i]) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void log_write(LogLevel level, const std::string& message) {
+    // One write per line, so lines from search threads do not interleave
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fprintf(stderr, "[stockfish %s] %s\n", level_names[static_cast<int>(level)], message.c_str());
+}
+
+} // namespace StockfishBinding
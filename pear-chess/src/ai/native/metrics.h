@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace StockfishBinding {
+
+// Monotonic count; relaxed, so it costs one uncontended atomic add
+class Counter {
+public:
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// Current level of something that goes up and down
+class Gauge {
+public:
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Distribution over doubling buckets: bucket i holds values up to
+// unit << i, and the last one everything above. observe() is two relaxed
+// adds and a bucket lookup, never a lock.
+class Histogram {
+public:
+    static constexpr size_t Buckets = 24;
+
+    struct Snapshot {
+        uint64_t unit = 1;
+        std::array<uint64_t, Buckets> counts{};  // Per bucket, not cumulative
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        // Upper bound of bucket i; the last is unbounded
+        uint64_t bound(size_t i) const { return unit << i; }
+
+        // Upper bound of the bucket holding the q-th quantile, 0 when empty
+        uint64_t quantile(double q) const;
+    };
+
+    explicit Histogram(uint64_t unit = 1) : unit_(unit ? unit : 1) {}
+
+    void observe(uint64_t value);
+    Snapshot snapshot() const;
+
+private:
+    const uint64_t unit_;
+    std::array<std::atomic<uint64_t>, Buckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+// Everything the binding measures, for all engines in the process
+struct Metrics {
+    Counter searches;          // Searches that ran on an engine
+    Counter book_hits;
+    Counter tablebase_hits;
+    Counter cache_hits;
+    Counter cache_misses;      // Cacheable searches the cache could not answer
+
+    Histogram search_ms{1};
+    Histogram nps{1000};
+    Histogram hashfull{1};     // Permille of the transposition table in use, after a search
+    Histogram queue_wait_ms{1};
+    Histogram init_ms{1};
+
+    Gauge engines;             // Initialized engines
+    Gauge memory_bytes;        // Summed StockfishEngine::memory_bytes()
+};
+
+Metrics& metrics();
+
+// Prometheus text exposition of metrics(), names prefixed stockfish_
+std::string metrics_text();
+
+// Log
+
+enum class LogLevel {
+    Error = 0,
+    Warn = 1,
+    Info = 2,
+    Debug = 3,
+};
+
+// Messages above this level are compiled out: Debug builds (DEBUG_BINDING)
+// keep them all, Release keeps warnings and errors
+#ifdef DEBUG_BINDING
+constexpr LogLevel CompiledLogLevel = LogLevel::Debug;
+#else
+constexpr LogLevel CompiledLogLevel = LogLevel::Warn;
+#endif
+
+// Runtime threshold within the compiled one; Warn by default
+void set_log_level(LogLevel level);
+LogLevel log_level();
+bool parse_log_level(const std::string& name, LogLevel& out);
+
+inline bool log_enabled(LogLevel level) {
+    return level <= log_level();
+}
+
+// One line to stderr, tagged with the level
+void log_write(LogLevel level, const std::string& message);
+
+} // namespace StockfishBinding
+
+// BINDING_LOG(Warn, "Option error: " << name). The message is only
+// formatted when the level is enabled, and not compiled at all above
+// CompiledLogLevel.
+#define BINDING_LOG(level, message)                                                        \
+    do {                                                                                   \
+        if (::StockfishBinding::LogLevel::level <= ::StockfishBinding::CompiledLogLevel    \
+            && ::StockfishBinding::log_enabled(::StockfishBinding::LogLevel::level)) {     \
+            std::ostringstream binding_log_;                                               \
+            binding_log_ << message;                                                       \
+            ::StockfishBinding::log_write(::StockfishBinding::LogLevel::level,             \
+                                          binding_log_.str());                             \
+        }                                                                                  \
+    } while (0)
@@ -0,0 +1,245 @@
+#include "opening_book.h"
+#include "metrics.h"
+#include "pgn_codec.h"
+#include "stockfish_wrapper.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace StockfishBinding {
+
+static constexpr char BookMagic[8] = {'P', 'G', 'B', 'O', 'O', 'K', '\0', '\0'};
+
+OpeningBook::~OpeningBook() {
+    close();
+}
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < static_cast<LONGLONG>(sizeof(BookHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = map ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        if (map) CloseHandle(map);
+        CloseHandle(file);
+        return false;
+    }
+    file_handle_ = file;
+    map_handle_ = map;
+    size_t bytes = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BookHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (data == MAP_FAILED) return false;
+
+    // Probes jump around the file; read-ahead would only waste memory
+    madvise(data, bytes, MADV_RANDOM);
+#endif
+
+    mapping_ = data;
+    mapped_bytes_ = bytes;
+
+    BookHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    bool valid = std::memcmp(header.magic, BookMagic, sizeof(BookMagic)) == 0
+              && header.version == Version
+              && header.entry_size == sizeof(BookEntry)
+              && header.entries == (bytes - sizeof(BookHeader)) / sizeof(BookEntry)
+              && (bytes - sizeof(BookHeader)) % sizeof(BookEntry) == 0;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    entries_ = reinterpret_cast<const BookEntry*>(static_cast<const char*>(data) + sizeof(BookHeader));
+    count_ = static_cast<size_t>(header.entries);
+    start_key_ = header.start_key;
+    return true;
+}
+
+void OpeningBook::close() {
+    if (mapping_) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping_);
+        CloseHandle(map_handle_);
+        CloseHandle(file_handle_);
+        map_handle_ = nullptr;
+        file_handle_ = nullptr;
+#else
+        munmap(mapping_, mapped_bytes_);
+#endif
+    }
+    mapping_ = nullptr;
+    mapped_bytes_ = 0;
+    entries_ = nullptr;
+    count_ = 0;
+    start_key_ = 0;
+}
+
+const BookEntry* OpeningBook::lower_bound(uint64_t key) const {
+    return std::lower_bound(entries_, entries_ + count_, key,
+                            [](const BookEntry& entry, uint64_t k) { return entry.key < k; });
+}
+
+std::vector<BookEntry> OpeningBook::probe(uint64_t key) const {
+    std::vector<BookEntry> moves;
+    if (!entries_) return moves;
+
+    for (const BookEntry* it = lower_bound(key); it != entries_ + count_ && it->key == key; ++it) {
+        moves.push_back(*it);
+    }
+    return moves;
+}
+
+bool OpeningBook::pick(uint64_t key, uint64_t random, BookEntry& out) const {
+    if (!entries_) return false;
+
+    const BookEntry* first = lower_bound(key);
+    const BookEntry* last = first;
+    uint64_t total = 0;
+    for (; last != entries_ + count_ && last->key == key; ++last) {
+        total += last->weight;
+    }
+    if (total == 0) return false;  // Out of book, or only moves never to play
+
+    uint64_t target = random % total;
+    for (const BookEntry* it = first; it != last; ++it) {
+        if (target < it->weight) {
+            out = *it;
+            return true;
+        }
+        target -= it->weight;
+    }
+    return false;
+}
+
+BookBuilder::BookBuilder(BookBuildOptions options)
+    : options_(options), engine_(std::make_unique<StockfishEngine>()) {
+    engine_->initialize();
+}
+
+BookBuilder::~BookBuilder() = default;
+
+bool BookBuilder::ready() const {
+    return engine_->is_ready();
+}
+
+bool BookBuilder::add_game(const std::string& fen, const std::vector<std::string>& san_moves, const std::string& result) {
+    if (!ready()) return false;
+
+    const std::string start = fen.empty() ? std::string(StartFEN) : fen;
+    if (!engine_->set_position(start)) return false;
+
+    // Score of the side to move at ply 0, in Polyglot units
+    int white_score = -1;
+    if (result == "1-0") white_score = 2;
+    else if (result == "0-1") white_score = 0;
+    else if (result == "1/2-1/2") white_score = 1;
+
+    std::istringstream fields(start);
+    std::string board, side;
+    fields >> board >> side;
+    bool white = side != "b";
+
+    int plies = std::min<int>(options_.max_ply, static_cast<int>(san_moves.size()));
+    for (int ply = 0; ply < plies; ++ply) {
+        uint16_t move = engine_->parse_san(san_moves[ply]);
+        if (move == 0) break;
+
+        MoveStats& stats = stats_[engine_->position_key()][move];
+        stats.games++;
+        if (white_score >= 0) {
+            stats.weight += white ? white_score : 2 - white_score;
+        }
+
+        if (!engine_->push_move(Utils::packed_move_to_uci(move))) break;
+        white = !white;
+    }
+    return true;
+}
+
+size_t BookBuilder::add_pgn(std::istream& in) {
+    PgnReader reader(in);
+    PgnGame game;
+    size_t games = 0;
+    while (reader.next(game)) {
+        if (add_game(game.tag("FEN"), game.san, game.result)) games++;
+    }
+    return games;
+}
+
+bool BookBuilder::write(const std::string& path) const {
+    std::vector<BookEntry> entries;
+    for (const auto& [key, moves] : stats_) {
+        uint64_t heaviest = 0;
+        for (const auto& [move, stats] : moves) {
+            heaviest = std::max(heaviest, stats.weight);
+        }
+
+        // Scale per position so the main line fits Polyglot's 16 bits
+        size_t first = entries.size();
+        for (const auto& [move, stats] : moves) {
+            if (stats.games < options_.min_games) continue;
+            if (options_.skip_losses && stats.weight == 0) continue;
+
+            uint64_t weight = heaviest > 0xffff ? std::max<uint64_t>(1, stats.weight * 0xffff / heaviest) : stats.weight;
+            entries.push_back({key, move, static_cast<uint16_t>(weight), stats.games});
+        }
+        std::stable_sort(entries.begin() + first, entries.end(),
+                         [](const BookEntry& a, const BookEntry& b) { return a.weight > b.weight; });
+    }
+
+    BookHeader header{};
+    std::memcpy(header.magic, BookMagic, sizeof(BookMagic));
+    header.version = OpeningBook::Version;
+    header.entry_size = sizeof(BookEntry);
+    header.entries = entries.size();
+
+    if (!engine_->set_position(StartFEN)) return false;
+    header.start_key = engine_->position_key();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        BINDING_LOG(Error, "Book error: cannot write " << path);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BookEntry)));
+    return static_cast<bool>(out);
+}
+
+} // namespace StockfishBinding
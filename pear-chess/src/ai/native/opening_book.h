@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace StockfishBinding {
+
+class StockfishEngine;
+
+// On-disk book format. Entries follow Polyglot's 16-byte layout and order
+// (sorted by key, then by weight, descending) but are keyed by Stockfish's
+// own Zobrist hash and stored little-endian, so the file is mapped and
+// binary-searched in place without any parsing. start_key identifies the
+// hashing scheme; a book built with a different one is refused.
+struct BookHeader {
+    char magic[8];       // "PGBOOK\0\0"
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t start_key;  // Key of the standard starting position
+    uint64_t entries;
+};
+static_assert(sizeof(BookHeader) == 32, "BookHeader is part of the file format");
+
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;    // Packed, see StockfishEngine::get_legal_moves()
+    uint16_t weight;  // Relative frequency/score, as in Polyglot
+    uint32_t games;   // Games in the source collection that played it
+};
+static_assert(sizeof(BookEntry) == 16, "BookEntry is part of the file format");
+
+// Read-only view of a book file. The file is memory-mapped, so opening is
+// constant time and probes touch only the pages they need. Safe to share
+// between engines and threads once open.
+class OpeningBook {
+public:
+    static constexpr uint32_t Version = 1;
+
+    OpeningBook() = default;
+    ~OpeningBook();
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // Returns false if the file is missing, truncated or not a book
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return entries_ != nullptr; }
+
+    size_t size() const { return count_; }
+    uint64_t start_key() const { return start_key_; }
+
+    // Every entry for a position, heaviest first. No allocation beyond the
+    // result; an unknown key costs one binary search.
+    std::vector<BookEntry> probe(uint64_t key) const;
+
+    // Weighted random choice among a position's entries: random is any
+    // uniformly distributed 64-bit value. Returns false when out of book.
+    bool pick(uint64_t key, uint64_t random, BookEntry& out) const;
+
+private:
+    const BookEntry* lower_bound(uint64_t key) const;
+
+    const BookEntry* entries_ = nullptr;
+    size_t count_ = 0;
+    uint64_t start_key_ = 0;
+
+    void* mapping_ = nullptr;
+    size_t mapped_bytes_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* map_handle_ = nullptr;
+#endif
+};
+
+struct BookBuildOptions {
+    int max_ply = 20;         // Plies recorded from the start of each game
+    uint32_t min_games = 1;   // Moves played fewer times are dropped
+    bool skip_losses = true;  // Drop moves that only ever lost (weight 0)
+};
+
+// Builds a book from PGN collections. Moves are replayed on a Stockfish
+// position, so keys match what the engine probes. Weights follow
+// Polyglot's builder: 2 per win and 1 per draw for the side that moved.
+class BookBuilder {
+public:
+    explicit BookBuilder(BookBuildOptions options = {});
+    ~BookBuilder();
+
+    // False if the engine used for replaying moves cannot start
+    bool ready() const;
+
+    // Games read (streamed by PgnReader); a game ends at its first move
+    // that cannot be played
+    size_t add_pgn(std::istream& in);
+
+    // One game from fen (empty for the standard start) with SAN moves.
+    // result is "1-0", "0-1" or "1/2-1/2"; other results count as unknown
+    // and only add to the game counts.
+    bool add_game(const std::string& fen, const std::vector<std::string>& san_moves, const std::string& result);
+
+    size_t positions() const { return stats_.size(); }
+    bool write(const std::string& path) const;
+
+private:
+    struct MoveStats {
+        uint64_t weight = 0;
+        uint32_t games = 0;
+    };
+
+    BookBuildOptions options_;
+    std::unique_ptr<StockfishEngine> engine_;
+    std::map<uint64_t, std::map<uint16_t, MoveStats>> stats_;
+};
+
+} // namespace StockfishBinding
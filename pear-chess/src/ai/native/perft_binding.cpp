@@ -0,0 +1,174 @@
+// Perft suite for StockfishEngine's move generation: counts the leaves of
+// the standard test positions against their published counts, single- and
+// multi-threaded, and reports leaves per second as JSON. Exits non-zero on
+// any miscount.
+//
+//   perft_binding [--depth N] [--threads N] [--hash MB] [--divide] [--out FILE]
+
+#include "stockfish_wrapper.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace StockfishBinding;
+
+struct PerftPosition {
+    std::string name;
+    std::string fen;
+    std::vector<uint64_t> leaves;  // leaves[d - 1] at depth d
+    int depth;                     // Depth run by default
+};
+
+// The positions and counts of the Chess Programming Wiki's perft results
+static const std::vector<PerftPosition>& positions() {
+    static const std::vector<PerftPosition> all = {
+        {"initial", StartFEN,
+         {20, 400, 8902, 197281, 4865609, 119060324}, 5},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+         {48, 2039, 97862, 4085603, 193690690}, 4},
+        {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+         {14, 191, 2812, 43238, 674624, 11030083}, 6},
+        {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+         {6, 264, 9467, 422333, 15833292}, 5},
+        {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+         {44, 1486, 62379, 2103487, 89941194}, 4},
+        {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P3/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+         {46, 2079, 89890, 3894594, 164075551}, 4},
+    };
+    return all;
+}
+
+struct Options {
+    int depth = 0;     // Caps every position's depth; 0 runs the defaults
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int hash_mb = 64;
+    bool divide = false;
+    std::string out;
+};
+
+struct Run {
+    uint64_t nodes = 0;
+    int64_t time_ms = 0;
+    bool ok = true;
+
+    int64_t nps() const {
+        return time_ms > 0 ? static_cast<int64_t>(nodes * 1000.0 / time_ms) : 0;
+    }
+};
+
+static bool parse_args(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--divide") {
+            options.divide = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "perft: missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--depth") options.depth = std::atoi(value.c_str());
+        else if (arg == "--threads") options.threads = std::atoi(value.c_str());
+        else if (arg == "--hash") options.hash_mb = std::atoi(value.c_str());
+        else if (arg == "--out") options.out = value;
+        else {
+            std::cerr << "perft: unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return options.depth >= 0 && options.threads > 0 && options.hash_mb >= 0;
+}
+
+// Runs every position under one configuration, appending its JSON section
+static Run run_mode(StockfishEngine& engine, const std::string& mode, const PerftOptions& perft,
+                    const Options& options, std::ostream& json) {
+    Run total;
+    json << "    \"" << mode << "\": {\"threads\": " << perft.threads
+         << ", \"hash_mb\": " << perft.hash_mb << ", \"positions\": {\n";
+
+    bool first = true;
+    for (const auto& position : positions()) {
+        int depth = options.depth > 0 ? std::min<int>(options.depth, position.leaves.size()) : position.depth;
+        uint64_t expected = position.leaves[depth - 1];
+
+        engine.set_position(position.fen);
+        PerftResult result = engine.perft(depth, perft);
+        bool ok = result.nodes == expected;
+
+        total.nodes += result.nodes;
+        total.time_ms += result.time_ms;
+        total.ok = total.ok && ok;
+
+        json << (first ? "" : ",\n") << "      \"" << position.name << "\": {\"depth\": " << depth
+             << ", \"nodes\": " << result.nodes << ", \"expected\": " << expected
+             << ", \"time_ms\": " << result.time_ms << ", \"nps\": " << result.nps
+             << ", \"ok\": " << (ok ? "true" : "false") << "}";
+        first = false;
+
+        std::cerr << mode << " " << position.name << " depth " << depth << ": " << result.nodes
+                  << (ok ? "" : " (expected " + std::to_string(expected) + ")")
+                  << ", " << result.nps << " nps" << std::endl;
+
+        // Per-move counts locate a miscount by comparison with another engine
+        if (options.divide || !ok) {
+            for (const auto& [move, nodes] : result.divide) {
+                std::cerr << "  " << move << ": " << nodes << std::endl;
+            }
+        }
+    }
+
+    json << "\n    }, \"nodes\": " << total.nodes << ", \"time_ms\": " << total.time_ms
+         << ", \"nps\": " << total.nps() << "}";
+    return total;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) {
+        return 2;
+    }
+
+    StockfishEngine engine;
+    if (!engine.initialize()) {
+        std::cerr << "perft: engine initialization failed" << std::endl;
+        return 1;
+    }
+
+    // One thread without a hash is the plain recursive count the others
+    // have to agree with, and the per-core throughput baseline
+    PerftOptions single;
+    PerftOptions parallel;
+    parallel.threads = options.threads;
+    parallel.hash_mb = options.hash_mb;
+
+    std::ostringstream json;
+    json << "{\n  \"modes\": {\n";
+    Run serial = run_mode(engine, "single", single, options, json);
+    json << ",\n";
+    Run split = run_mode(engine, "parallel", parallel, options, json);
+    json << "\n  },\n  \"speedup\": "
+         << (serial.nps() > 0 ? static_cast<double>(split.nps()) / serial.nps() : 0)
+         << ",\n  \"ok\": " << (serial.ok && split.ok ? "true" : "false") << "\n}\n";
+
+    engine.shutdown();
+
+    const std::string report = json.str();
+    std::cout << report;
+    if (!options.out.empty()) {
+        std::ofstream(options.out) << report;
+    }
+
+    if (!serial.ok || !split.ok) {
+        std::cerr << "perft: node counts differ from the published ones" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,637 @@
+#include "pgn_codec.h"
+#include "stockfish_wrapper.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <istream>
+
+#ifdef BUILDING_WITH_REAL_STOCKFISH
+#include "bitboard.h"
+#include "movegen.h"
+#include "position.h"
+using namespace Stockfish;
+#endif
+
+namespace StockfishBinding {
+
+// PGN reading
+
+std::string PgnGame::tag(std::string_view name) const {
+    for (const auto& [tag_name, value] : tags) {
+        if (tag_name == name) return value;
+    }
+    return {};
+}
+
+void PgnGame::clear() {
+    tags.clear();
+    san.clear();
+    result.clear();
+}
+
+PgnReader::PgnReader(std::istream& in, size_t window)
+    : in_(in), window_(std::max<size_t>(window, 4096)) {
+    token_.reserve(MaxToken);
+}
+
+bool PgnReader::fill() {
+    if (!in_) return false;
+    in_.read(window_.data(), static_cast<std::streamsize>(window_.size()));
+    pos_ = 0;
+    end_ = static_cast<size_t>(in_.gcount());
+    consumed_ += end_;
+    return end_ > 0;
+}
+
+int PgnReader::get() {
+    if (pos_ == end_ && !fill()) return EOF;
+    return static_cast<unsigned char>(window_[pos_++]);
+}
+
+// After the '[': Name "Value" up to the ']' or the end of the line
+void PgnReader::read_tag(PgnGame& game) {
+    std::string name;
+    std::string value;
+    bool in_value = false;
+    bool escaped = false;
+    int c;
+    while ((c = get()) != EOF && c != '\n') {
+        if (in_value) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+                continue;
+            } else if (c == '"') {
+                in_value = false;
+                continue;
+            }
+            if (value.size() < MaxTagValue) value += static_cast<char>(c);
+        } else if (c == '"') {
+            in_value = true;
+        } else if (c == ']') {
+            break;
+        } else if (!std::isspace(c) && name.size() < MaxToken) {
+            name += static_cast<char>(c);
+        }
+    }
+    if (!name.empty()) {
+        game.tags.emplace_back(std::move(name), std::move(value));
+    }
+}
+
+bool PgnReader::next(PgnGame& game) {
+    game.clear();
+    bool started = false;     // Any tag or move seen
+    bool in_movetext = false;
+    bool in_comment = false;  // { }, which do not nest
+    bool in_line_comment = false;
+    int variation_depth = 0;
+    bool ended = false;
+
+    // True once the token ends the game
+    auto flush_token = [&]() {
+        if (token_.empty()) return false;
+        std::string_view token = token_;
+        bool ends = false;
+        if (variation_depth == 0) {
+            // "12.", "12.e4" and "12...e4" carry the move after the dots
+            size_t dot = token.find_last_of('.');
+            if (dot != std::string_view::npos && std::isdigit(static_cast<unsigned char>(token[0]))) {
+                token.remove_prefix(dot + 1);
+            }
+
+            if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+                if (game.result.empty()) game.result = std::string(token);
+                ends = true;
+            } else if (!token.empty() && token[0] != '$' &&
+                       !std::all_of(token.begin(), token.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; })) {
+                game.san.emplace_back(token);
+                in_movetext = true;
+                started = true;
+            }
+        }
+        token_.clear();
+        return ends;
+    };
+
+    int c;
+    while (!ended && (c = get()) != EOF) {
+        if (in_comment) {
+            in_comment = c != '}';
+            line_start_ = c == '\n';
+            continue;
+        }
+        if (in_line_comment) {
+            in_line_comment = c != '\n';
+            line_start_ = c == '\n';
+            continue;
+        }
+
+        if (line_start_ && variation_depth == 0) {
+            if (c == '[') {
+                // A tag after movetext starts the next game
+                if (in_movetext) {
+                    unget();
+                    break;
+                }
+                read_tag(game);
+                started = true;
+                continue;
+            }
+            if (c == '%') {  // Escape line
+                in_line_comment = true;
+                continue;
+            }
+        }
+        line_start_ = c == '\n';
+
+        switch (c) {
+            case '{':
+                ended = flush_token();
+                in_comment = true;
+                break;
+            case ';':
+                ended = flush_token();
+                in_line_comment = true;
+                break;
+            case '(':
+                ended = flush_token();
+                variation_depth++;
+                break;
+            case ')':
+                ended = flush_token();
+                variation_depth = std::max(0, variation_depth - 1);
+                break;
+            case ' ': case '\t': case '\n': case '\r':
+                ended = flush_token();
+                break;
+            default:
+                if (token_.size() < MaxToken) token_ += static_cast<char>(c);
+                break;
+        }
+    }
+    if (!ended) flush_token();
+    token_.clear();
+
+    // The Result tag is authoritative; the marker only fills in for it
+    std::string tagged = game.tag("Result");
+    if (!tagged.empty()) game.result = tagged;
+
+    if (!started) return false;
+    games_++;
+    return true;
+}
+
+// FEN validation. Needs no engine, so it guards every Position::set(),
+// which trusts its input.
+
+namespace {
+
+bool is_number(std::string_view field, size_t max_digits) {
+    return !field.empty() && field.size() <= max_digits &&
+           std::all_of(field.begin(), field.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; });
+}
+
+// Squares a1 = 0 .. h8 = 63, '.' when empty
+bool parse_board(std::string_view field, char board[64]) {
+    int rank = 7;
+    int file = 0;
+    bool after_digit = false;
+    for (char c : field) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            rank--;
+            file = 0;
+            after_digit = false;
+        } else if (c >= '1' && c <= '8') {
+            if (after_digit || file + (c - '0') > 8) return false;
+            for (int i = 0; i < c - '0'; ++i) board[rank * 8 + file++] = '.';
+            after_digit = true;
+        } else if (std::string_view("pnbrqkPNBRQK").find(c) != std::string_view::npos) {
+            if (file == 8) return false;
+            board[rank * 8 + file++] = c;
+            after_digit = false;
+        } else {
+            return false;
+        }
+    }
+    return rank == 0 && file == 8;
+}
+
+// Whether sq is attacked by white's pieces (by_white) or black's
+bool attacked(const char board[64], int sq, bool by_white) {
+    auto piece_at = [&](int file, int rank, char white_piece) {
+        if (file < 0 || file > 7 || rank < 0 || rank > 7) return false;
+        char piece = board[rank * 8 + file];
+        return piece == (by_white ? white_piece : static_cast<char>(std::tolower(white_piece)));
+    };
+    int file = sq & 7;
+    int rank = sq >> 3;
+
+    int pawn_rank = by_white ? rank - 1 : rank + 1;
+    if (piece_at(file - 1, pawn_rank, 'P') || piece_at(file + 1, pawn_rank, 'P')) return true;
+
+    static const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    for (const auto& d : knight) {
+        if (piece_at(file + d[0], rank + d[1], 'N')) return true;
+    }
+
+    static const int rays[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    for (int r = 0; r < 8; ++r) {
+        char slider = r < 4 ? 'R' : 'B';
+        int f = file + rays[r][0];
+        int k = rank + rays[r][1];
+        if (piece_at(f, k, 'K')) return true;
+        for (; f >= 0 && f <= 7 && k >= 0 && k <= 7; f += rays[r][0], k += rays[r][1]) {
+            if (piece_at(f, k, slider) || piece_at(f, k, 'Q')) return true;
+            if (board[k * 8 + f] != '.') break;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+namespace Utils {
+    // Strict: board, side, castling and en passant fields, optionally
+    // followed by both move counters. The position must be one a game can
+    // reach as far as each field goes: one king a side, no pawns on the
+    // back ranks, castling rights backed by unmoved pieces, an en passant
+    // square behind a pawn that just advanced two squares, and the side
+    // not to move not in check.
+    bool is_valid_fen(const std::string& fen) {
+        std::vector<std::string_view> fields;
+        std::string_view rest = fen;
+        while (!rest.empty()) {
+            size_t start = rest.find_first_not_of(' ');
+            if (start == std::string_view::npos) break;
+            rest.remove_prefix(start);
+            size_t end = std::min(rest.find(' '), rest.size());
+            fields.push_back(rest.substr(0, end));
+            rest.remove_prefix(end);
+        }
+        if (fields.size() != 4 && fields.size() != 6) return false;
+
+        char board[64];
+        if (!parse_board(fields[0], board)) return false;
+
+        int white_king = -1;
+        int black_king = -1;
+        int pieces[2] = {0, 0};
+        int pawns[2] = {0, 0};
+        for (int sq = 0; sq < 64; ++sq) {
+            char piece = board[sq];
+            if (piece == '.') continue;
+            bool white = std::isupper(static_cast<unsigned char>(piece)) != 0;
+            pieces[white]++;
+            if (piece == 'K') {
+                if (white_king >= 0) return false;
+                white_king = sq;
+            } else if (piece == 'k') {
+                if (black_king >= 0) return false;
+                black_king = sq;
+            } else if (piece == 'P' || piece == 'p') {
+                if (sq < 8 || sq >= 56) return false;
+                pawns[white]++;
+            }
+        }
+        if (white_king < 0 || black_king < 0) return false;
+        if (pieces[0] > 16 || pieces[1] > 16 || pawns[0] > 8 || pawns[1] > 8) return false;
+
+        if (fields[1] != "w" && fields[1] != "b") return false;
+        bool white_to_move = fields[1] == "w";
+        if (attacked(board, white_to_move ? black_king : white_king, white_to_move)) return false;
+
+        std::string_view castling = fields[2];
+        if (castling != "-") {
+            static constexpr std::string_view order = "KQkq";
+            size_t last = 0;
+            for (char right : castling) {
+                size_t at = order.find(right, last);
+                if (at == std::string_view::npos) return false;
+                last = at + 1;
+
+                bool white = right == 'K' || right == 'Q';
+                int king_sq = white ? 4 : 60;
+                int rook_sq = (white ? 0 : 56) + (right == 'K' || right == 'k' ? 7 : 0);
+                if (board[king_sq] != (white ? 'K' : 'k') || board[rook_sq] != (white ? 'R' : 'r')) return false;
+            }
+        }
+
+        std::string_view ep = fields[3];
+        if (ep != "-") {
+            if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (white_to_move ? '6' : '3')) return false;
+            int sq = (ep[1] - '1') * 8 + (ep[0] - 'a');
+            int pushed = white_to_move ? sq - 8 : sq + 8;  // The pawn that just moved
+            int origin = white_to_move ? sq + 8 : sq - 8;
+            if (board[sq] != '.' || board[origin] != '.' || board[pushed] != (white_to_move ? 'p' : 'P')) return false;
+        }
+
+        if (fields.size() == 6) {
+            if (!is_number(fields[4], 4) || !is_number(fields[5], 5)) return false;
+            if (fields[5].find_first_not_of('0') == std::string_view::npos) return false;  // Move 0
+        }
+        return true;
+    }
+}
+
+#ifdef BUILDING_WITH_REAL_STOCKFISH
+
+// Notation on Stockfish's Position
+
+namespace Notation {
+    // Match a UCI string against the legal moves by squares, without
+    // formatting every candidate to a string as UCIEngine::to_move() does
+    Move parse_uci(const Position& pos, std::string_view uci_move) {
+        if (uci_move.size() < 4 || uci_move.size() > 5) return Move::none();
+
+        auto square = [](char f, char r) -> int {
+            if (f < 'a' || f > 'h' || r < '1' || r > '8') return -1;
+            return (r - '1') * 8 + (f - 'a');
+        };
+        int from = square(uci_move[0], uci_move[1]);
+        int to = square(uci_move[2], uci_move[3]);
+        if (from < 0 || to < 0) return Move::none();
+
+        PieceType promotion = NO_PIECE_TYPE;
+        if (uci_move.size() == 5) {
+            switch (uci_move[4]) {
+                case 'n': case 'N': promotion = KNIGHT; break;
+                case 'b': case 'B': promotion = BISHOP; break;
+                case 'r': case 'R': promotion = ROOK; break;
+                case 'q': case 'Q': promotion = QUEEN; break;
+                default: return Move::none();
+            }
+        }
+
+        for (const auto& m : MoveList<LEGAL>(pos)) {
+            Square m_from = m.from_sq();
+            Square m_to = m.to_sq();
+
+            // Castling is stored king-takes-rook; standard UCI names the
+            // king's destination square
+            if (m.type_of() == CASTLING && !pos.is_chess960()) {
+                m_to = make_square(m_to > m_from ? FILE_G : FILE_C, rank_of(m_from));
+            }
+
+            PieceType m_promotion = m.type_of() == PROMOTION ? m.promotion_type() : NO_PIECE_TYPE;
+            if (m_from == from && m_to == to && m_promotion == promotion) {
+                return m;
+            }
+        }
+        return Move::none();
+    }
+
+    Move parse_san(const Position& pos, std::string_view san) {
+        while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos) {
+            san.remove_suffix(1);
+        }
+        if (san.empty()) return Move::none();
+
+        if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+            bool king_side = san.size() == 3;
+            for (const auto& m : MoveList<LEGAL>(pos)) {
+                if (m.type_of() == CASTLING && (m.to_sq() > m.from_sq()) == king_side) {
+                    return m;
+                }
+            }
+            return Move::none();
+        }
+
+        PieceType piece = PAWN;
+        switch (san.front()) {
+            case 'N': piece = KNIGHT; break;
+            case 'B': piece = BISHOP; break;
+            case 'R': piece = ROOK; break;
+            case 'Q': piece = QUEEN; break;
+            case 'K': piece = KING; break;
+            default: break;
+        }
+        if (piece != PAWN) san.remove_prefix(1);
+
+        // Promotion suffix, with or without the '='
+        PieceType promotion = NO_PIECE_TYPE;
+        if (san.size() > 2) {
+            switch (san.back()) {
+                case 'N': promotion = KNIGHT; break;
+                case 'B': promotion = BISHOP; break;
+                case 'R': promotion = ROOK; break;
+                case 'Q': promotion = QUEEN; break;
+                default: break;
+            }
+            if (promotion != NO_PIECE_TYPE) {
+                san.remove_suffix(1);
+                if (san.back() == '=') san.remove_suffix(1);
+            }
+        }
+
+        if (san.size() < 2) return Move::none();
+        char to_file = san[san.size() - 2];
+        char to_rank = san.back();
+        if (to_file < 'a' || to_file > 'h' || to_rank < '1' || to_rank > '8') return Move::none();
+        Square to = make_square(File(to_file - 'a'), Rank(to_rank - '1'));
+
+        // Whatever precedes the destination disambiguates the origin
+        int from_file = -1;
+        int from_rank = -1;
+        for (char c : san.substr(0, san.size() - 2)) {
+            if (c >= 'a' && c <= 'h') from_file = c - 'a';
+            else if (c >= '1' && c <= '8') from_rank = c - '1';
+            else if (c != 'x') return Move::none();
+        }
+
+        Move found = Move::none();
+        for (const auto& m : MoveList<LEGAL>(pos)) {
+            if (m.type_of() == CASTLING || m.to_sq() != to) continue;
+            if (type_of(pos.moved_piece(m)) != piece) continue;
+            if (from_file >= 0 && file_of(m.from_sq()) != from_file) continue;
+            if (from_rank >= 0 && rank_of(m.from_sq()) != from_rank) continue;
+
+            PieceType m_promotion = m.type_of() == PROMOTION ? m.promotion_type() : NO_PIECE_TYPE;
+            if (m_promotion != promotion) continue;
+
+            if (found != Move::none()) return Move::none();  // Ambiguous
+            found = m;
+        }
+        return found;
+    }
+
+    // Minimal SAN: the origin file, rank or square only as needed to tell
+    // the move apart, "+" or "#" after checks
+    std::string to_san(Position& pos, Move m) {
+        std::string san;
+        if (m.type_of() == CASTLING) {
+            san = m.to_sq() > m.from_sq() ? "O-O" : "O-O-O";
+        } else {
+            Square from = m.from_sq();
+            Square to = m.to_sq();
+            PieceType piece = type_of(pos.moved_piece(m));
+
+            if (piece == PAWN) {
+                if (pos.capture(m)) san += char('a' + file_of(from));
+            } else {
+                san += " PNBRQK"[piece];
+                bool ambiguous = false, same_file = false, same_rank = false;
+                for (const auto& other : MoveList<LEGAL>(pos)) {
+                    if (other == m || other.to_sq() != to || type_of(pos.moved_piece(other)) != piece) continue;
+                    ambiguous = true;
+                    same_file |= file_of(other.from_sq()) == file_of(from);
+                    same_rank |= rank_of(other.from_sq()) == rank_of(from);
+                }
+                if (ambiguous) {
+                    if (!same_file) san += char('a' + file_of(from));
+                    else if (!same_rank) san += char('1' + rank_of(from));
+                    else san += {char('a' + file_of(from)), char('1' + rank_of(from))};
+                }
+            }
+
+            if (pos.capture(m)) san += 'x';
+            san += {char('a' + file_of(to)), char('1' + rank_of(to))};
+            if (m.type_of() == PROMOTION) {
+                san += '=';
+                san += " PNBRQK"[m.promotion_type()];
+            }
+        }
+
+        if (pos.gives_check(m)) {
+            StateInfo st;
+            pos.do_move(m, st);
+            san += MoveList<LEGAL>(pos).size() == 0 ? '#' : '+';
+            pos.undo_move(m);
+        }
+        return san;
+    }
+
+    std::string san_to_uci(const std::string& fen, const std::string& san) {
+        if (!Utils::is_valid_fen(fen)) return {};
+        init_globals();
+
+        Position pos;
+        StateInfo st;
+        pos.set(fen, false, &st);
+        Move m = parse_san(pos, san);
+        return m == Move::none() ? std::string() : Utils::packed_move_to_uci(m.raw());
+    }
+
+    std::string uci_to_san(const std::string& fen, const std::string& uci) {
+        if (!Utils::is_valid_fen(fen)) return {};
+        init_globals();
+
+        Position pos;
+        StateInfo st;
+        pos.set(fen, false, &st);
+        Move m = parse_uci(pos, uci);
+        return m == Move::none() ? std::string() : to_san(pos, m);
+    }
+
+    std::string normalize_fen(const std::string& fen) {
+        if (!Utils::is_valid_fen(fen)) return {};
+        init_globals();
+
+        Position pos;
+        StateInfo st;
+        pos.set(fen, false, &st);
+        return pos.fen();
+    }
+}
+
+namespace Utils {
+    std::string fen_after_move(const std::string& fen, const std::string& move) {
+        if (!is_valid_fen(fen)) return {};
+        init_globals();
+
+        Position pos;
+        StateInfo st;
+        pos.set(fen, false, &st);
+        Move m = Notation::parse_uci(pos, move);
+        if (m == Move::none()) return {};
+
+        StateInfo next;
+        pos.do_move(m, next);
+        return pos.fen();
+    }
+}
+
+class GameReplayer::Impl {
+public:
+    Impl() {
+        init_globals();
+    }
+
+    bool replay(const std::string& fen, const std::vector<std::string>& san, ReplayedGame& out) {
+        out.start_fen = fen.empty() ? std::string(StartFEN) : fen;
+        out.moves.clear();
+        out.final_fen.clear();
+        out.complete = false;
+        if (!Utils::is_valid_fen(out.start_fen)) return false;
+
+        // StateInfo chains back through the game, so the deque keeps them
+        // in place; its blocks are reused by the next game
+        states_.resize(1);
+        pos_.set(out.start_fen, false, &states_.front());
+
+        out.moves.reserve(san.size());
+        for (const auto& token : san) {
+            Move m = Notation::parse_san(pos_, token);
+            if (m == Move::none()) break;
+            out.moves.push_back(m.raw());
+            states_.emplace_back();
+            pos_.do_move(m, states_.back());
+        }
+        out.complete = out.moves.size() == san.size();
+        out.final_fen = pos_.fen();
+        return true;
+    }
+
+private:
+    Position pos_;
+    std::deque<StateInfo> states_;
+};
+
+#else
+
+// Without Stockfish there are no move rules: conversions fail, and games
+// replay to their start position only
+
+namespace Notation {
+    std::string san_to_uci(const std::string&, const std::string&) { return {}; }
+    std::string uci_to_san(const std::string&, const std::string&) { return {}; }
+    std::string normalize_fen(const std::string& fen) {
+        return Utils::is_valid_fen(fen) ? fen : std::string();
+    }
+}
+
+namespace Utils {
+    std::string fen_after_move(const std::string&, const std::string&) {
+        return {};
+    }
+}
+
+class GameReplayer::Impl {
+public:
+    bool replay(const std::string& fen, const std::vector<std::string>& san, ReplayedGame& out) {
+        out.start_fen = fen.empty() ? std::string(StartFEN) : fen;
+        out.moves.clear();
+        out.final_fen = out.start_fen;
+        out.complete = san.empty();
+        return Utils::is_valid_fen(out.start_fen);
+    }
+};
+
+#endif
+
+GameReplayer::GameReplayer() : impl_(std::make_unique<Impl>()) {}
+GameReplayer::~GameReplayer() = default;
+
+bool GameReplayer::replay(const std::string& fen, const std::vector<std::string>& san, ReplayedGame& out) {
+    return impl_->replay(fen, san, out);
+}
+
+bool GameReplayer::replay(const PgnGame& game, ReplayedGame& out) {
+    out.result = game.result;
+    return impl_->replay(game.tag("FEN"), game.san, out);
+}
+
+} // namespace StockfishBinding
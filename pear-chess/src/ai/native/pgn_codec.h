@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef BUILDING_WITH_REAL_STOCKFISH
+namespace Stockfish {
+class Position;
+class Move;
+}
+#endif
+
+namespace StockfishBinding {
+
+// One game of an archive: tags, and the main line as SAN tokens. Comments,
+// variations, NAGs and move numbers are dropped while reading.
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<std::string> san;
+    std::string result;  // Result tag, else the termination marker
+
+    // Value of a tag, empty if absent
+    std::string tag(std::string_view name) const;
+    void clear();  // Keeps the capacity for the next game
+};
+
+// Streams games out of a PGN archive through a fixed window, so memory use
+// does not depend on the size of the archive or of any single line. Tokens
+// and tag values past the limits below are truncated, not buffered.
+class PgnReader {
+public:
+    static constexpr size_t DefaultWindow = 64 * 1024;
+    static constexpr size_t MaxToken = 64;
+    static constexpr size_t MaxTagValue = 1024;
+
+    explicit PgnReader(std::istream& in, size_t window = DefaultWindow);
+
+    // Reads the next game into game; false at the end of the stream
+    bool next(PgnGame& game);
+
+    size_t games() const { return games_; }
+
+    // Bytes of the stream consumed by the games read so far. Seeking a new
+    // stream there and reading on resumes at the next game.
+    uint64_t offset() const { return consumed_ - (end_ - pos_); }
+
+private:
+    int get();
+    void unget() { pos_--; }
+    bool fill();
+    void read_tag(PgnGame& game);
+
+    std::istream& in_;
+    std::vector<char> window_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    uint64_t consumed_ = 0;
+    size_t games_ = 0;
+    bool line_start_ = true;
+    std::string token_;
+};
+
+// A game replayed to its moves
+struct ReplayedGame {
+    std::string start_fen;
+    std::vector<uint16_t> moves;  // Packed, see Utils::packed_move_to_uci()
+    std::string final_fen;
+    std::string result;
+    bool complete = false;        // False if a SAN token did not parse as a legal move
+};
+
+// Replays SAN move lists on Stockfish's Position, without an engine. One
+// replayer per thread; it reuses its buffers from game to game.
+class GameReplayer {
+public:
+    GameReplayer();
+    ~GameReplayer();
+
+    // Replays up to the first unparseable or illegal move. Returns false
+    // only when the start position is invalid.
+    bool replay(const std::string& fen, const std::vector<std::string>& san, ReplayedGame& out);
+    bool replay(const PgnGame& game, ReplayedGame& out);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// Conversions between notations, for one position at a time. Each returns
+// an empty string for an invalid FEN or an illegal move.
+namespace Notation {
+    std::string san_to_uci(const std::string& fen, const std::string& san);
+    std::string uci_to_san(const std::string& fen, const std::string& uci);
+
+    // FEN as Stockfish writes it back, which drops an en passant square
+    // no capture can use
+    std::string normalize_fen(const std::string& fen);
+
+#ifdef BUILDING_WITH_REAL_STOCKFISH
+    // The same on Stockfish types. Move::none() when no legal move matches;
+    // an ambiguous SAN matches nothing.
+    Stockfish::Move parse_uci(const Stockfish::Position& pos, std::string_view uci);
+    Stockfish::Move parse_san(const Stockfish::Position& pos, std::string_view san);
+    std::string to_san(Stockfish::Position& pos, Stockfish::Move move);
+#endif
+}
+
+#ifdef BUILDING_WITH_REAL_STOCKFISH
+// Bitboard and Zobrist tables, built once per process (stockfish_wrapper.cpp)
+void init_globals();
+#endif
+
+} // namespace StockfishBinding
@@ -0,0 +1,257 @@
+#include "search_queue.h"
+#include "metrics.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace StockfishBinding {
+
+static const char* const priority_names[SearchPriorityCount] = {"live", "hint", "spectator", "review"};
+
+bool parse_priority(const std::string& name, SearchPriority& out) {
+    for (size_t i = 0; i < SearchPriorityCount; ++i) {
+        if (name == priority_names[i]) {
+            out = static_cast<SearchPriority>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* priority_name(SearchPriority priority) {
+    return priority_names[static_cast<size_t>(priority)];
+}
+
+// Left between a deadline movetime and the deadline for bestmove to come
+// back, as Move Overhead does for clock searches
+static constexpr int DeadlineMarginMs = 10;
+
+static int elapsed_ms(std::chrono::steady_clock::time_point since) {
+    auto elapsed = std::chrono::steady_clock::now() - since;
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+SearchQueue::SearchQueue(size_t slots, SearchPriority preemptible)
+    : preemptible_(preemptible), slots_(std::max<size_t>(1, slots)) {
+    dispatcher_ = std::thread([this] { dispatch(); });
+}
+
+SearchQueue::~SearchQueue() {
+    std::map<Order, std::shared_ptr<Request>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+        dropped.swap(queued_);
+        for (auto& entry : running_) {
+            stop_locked(*entry.second);
+        }
+        for (const auto& entry : dropped) {
+            stats_[static_cast<size_t>(entry.second->priority)].cancelled++;
+        }
+    }
+    work_.notify_all();
+    dispatcher_.join();
+
+    for (const auto& entry : dropped) {
+        QueueOutcome outcome;
+        outcome.cancelled = true;
+        outcome.wait_ms = elapsed_ms(entry.second->submitted);
+        if (entry.second->on_complete) {
+            entry.second->on_complete(SearchResult(), outcome);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return running_.empty() && finishing_ == 0; });
+}
+
+uint64_t SearchQueue::submit(StockfishEngine& engine, const SearchLimits& limits, const QueueOptions& options,
+                             Callback on_complete) {
+    auto request = std::make_shared<Request>();
+    request->engine = &engine;
+    request->limits = limits;
+    request->priority = options.priority;
+    request->submitted = Clock::now();
+    request->has_deadline = options.deadline_ms > 0;
+    request->deadline = request->submitted + std::chrono::milliseconds(options.deadline_ms);
+    request->on_complete = std::move(on_complete);
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = request->id = next_id_++;
+        stats_[static_cast<size_t>(request->priority)].submitted++;
+        queued_.emplace(order(*request), request);
+        if (running_.size() >= slots_) {
+            preempt_locked(request->priority);
+        }
+    }
+    pump();
+    return id;
+}
+
+bool SearchQueue::cancel(uint64_t id) {
+    std::shared_ptr<Request> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto running = running_.find(id);
+        if (running != running_.end()) {
+            stop_locked(*running->second);
+            return true;
+        }
+
+        auto queued = std::find_if(queued_.begin(), queued_.end(),
+                                   [id](const auto& entry) { return entry.second->id == id; });
+        if (queued == queued_.end()) return false;
+        dropped = queued->second;
+        queued_.erase(queued);
+        stats_[static_cast<size_t>(dropped->priority)].cancelled++;
+    }
+
+    QueueOutcome outcome;
+    outcome.cancelled = true;
+    outcome.wait_ms = elapsed_ms(dropped->submitted);
+    if (dropped->on_complete) {
+        dropped->on_complete(SearchResult(), outcome);
+    }
+    return true;
+}
+
+void SearchQueue::set_slots(size_t slots) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_ = std::max<size_t>(1, slots);
+    }
+    pump();
+}
+
+size_t SearchQueue::slots() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_;
+}
+
+SearchQueue::Stats SearchQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.classes = stats_;
+    stats.running = running_.size();
+    stats.queued = queued_.size();
+    stats.slots = slots_;
+    return stats;
+}
+
+SearchQueue::Order SearchQueue::order(const Request& request) const {
+    int64_t deadline = request.has_deadline
+        ? std::chrono::duration_cast<std::chrono::microseconds>(request.deadline.time_since_epoch()).count()
+        : std::numeric_limits<int64_t>::max();
+    return Order(static_cast<int>(request.priority), deadline, request.id);
+}
+
+// Frees one slot for a search of the given priority: the least urgent
+// preemptible search below it, the newest of those on a tie since it has
+// the least work to lose. Searches already being stopped count as free.
+void SearchQueue::preempt_locked(SearchPriority priority) {
+    Request* victim = nullptr;
+    for (auto& entry : running_) {
+        Request& running = *entry.second;
+        if (running.stop_requested) return;
+        if (running.priority <= priority || running.priority < preemptible_) continue;
+        if (!victim || running.priority > victim->priority
+            || (running.priority == victim->priority && running.id > victim->id)) {
+            victim = &running;
+        }
+    }
+    if (victim) {
+        victim->preempted = true;
+        stop_locked(*victim);
+    }
+}
+
+// StockfishEngine::stop_search() only raises a flag, so it is safe under
+// the lock. A search not launched yet is stopped by start() instead.
+void SearchQueue::stop_locked(Request& request) {
+    request.stop_requested = true;
+    if (request.launched) {
+        request.engine->stop_search();
+    }
+}
+
+// Queued searches may start. Callers include finish(), on the search
+// thread of an engine inside its bestmove callback: starting a search there
+// could wait on that very thread, so the dispatcher does the starting.
+void SearchQueue::pump() {
+    work_.notify_one();
+}
+
+// Start queued searches while there are free slots; the search itself is
+// started outside the lock, as an instant result completes on this thread
+void SearchQueue::dispatch() {
+    for (;;) {
+        std::shared_ptr<Request> next;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] {
+                return closing_ || (!queued_.empty() && running_.size() < slots_);
+            });
+            if (closing_) return;
+
+            next = queued_.begin()->second;
+            queued_.erase(queued_.begin());
+            running_.emplace(next->id, next);
+            next->wait_ms = elapsed_ms(next->submitted);
+            stats_[static_cast<size_t>(next->priority)].wait_ms += next->wait_ms;
+            metrics().queue_wait_ms.observe(static_cast<uint64_t>(next->wait_ms));
+        }
+        start(next);
+    }
+}
+
+void SearchQueue::start(const std::shared_ptr<Request>& request) {
+    SearchLimits limits = request->limits;
+    if (request->has_deadline && !limits.infinite) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(request->deadline - Clock::now()).count();
+        int cap = static_cast<int>(std::max<int64_t>(1, left - DeadlineMarginMs));
+        if (limits.movetime_ms == 0 || limits.movetime_ms > cap) {
+            limits.movetime_ms = cap;
+        }
+    }
+
+    request->engine->search_async(limits, [this, request](const SearchResult& result) {
+        finish(request, result);
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    request->launched = true;
+    if (request->stop_requested && running_.count(request->id)) {
+        request->engine->stop_search();
+    }
+}
+
+void SearchQueue::finish(const std::shared_ptr<Request>& request, const SearchResult& result) {
+    QueueOutcome outcome;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.erase(request->id);
+        finishing_++;
+
+        outcome.preempted = request->preempted;
+        outcome.wait_ms = request->wait_ms;
+        outcome.deadline_missed = request->has_deadline && Clock::now() > request->deadline;
+
+        ClassStats& stats = stats_[static_cast<size_t>(request->priority)];
+        stats.completed++;
+        if (outcome.preempted) stats.preempted++;
+        if (outcome.deadline_missed) stats.deadline_missed++;
+    }
+
+    if (request->on_complete) {
+        request->on_complete(result, outcome);
+    }
+    pump();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    finishing_--;
+    idle_.notify_all();
+}
+
+} // namespace StockfishBinding
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "stockfish_wrapper.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+namespace StockfishBinding {
+
+// Who is waiting for a search, most urgent first
+enum class SearchPriority {
+    Live = 0,       // Engine move in a game being played
+    Hint = 1,       // A player asked for a suggestion
+    Spectator = 2,  // Evaluation bar for people watching
+    Review = 3,     // Post-game analysis, run on idle CPU
+};
+constexpr size_t SearchPriorityCount = 4;
+
+// "live", "hint", "spectator" or "review"
+bool parse_priority(const std::string& name, SearchPriority& out);
+const char* priority_name(SearchPriority priority);
+
+struct QueueOptions {
+    SearchPriority priority = SearchPriority::Live;
+
+    // Milliseconds from submission by which the result is wanted; 0 for
+    // none. A search that starts late gets a movetime that ends it on time
+    // (or at once, when the deadline has passed).
+    int deadline_ms = 0;
+};
+
+// How a queued search went, alongside its result
+struct QueueOutcome {
+    bool preempted = false;        // Stopped for a more urgent search; the result is partial
+    bool cancelled = false;        // Dropped before it started; the result is empty
+    bool deadline_missed = false;  // Finished after its deadline
+    int wait_ms = 0;               // Time spent queued
+};
+
+// Admission control for searches on any number of engines. At most slots()
+// searches run at once, and the rest wait in priority order, earliest
+// deadline first within a class. A search that finds every slot taken
+// preempts the least urgent running search below it, provided that one is
+// of a preemptible class: it is stopped, and resolves with what it had
+// found, flagged preempted. Searches are started on the queue's own
+// dispatcher thread, never from a caller or a search callback.
+class SearchQueue {
+public:
+    using Callback = std::function<void(const SearchResult&, const QueueOutcome&)>;
+
+    struct ClassStats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t preempted = 0;
+        uint64_t cancelled = 0;
+        uint64_t deadline_missed = 0;
+        uint64_t wait_ms = 0;  // Summed over started searches
+    };
+
+    struct Stats {
+        std::array<ClassStats, SearchPriorityCount> classes;
+        size_t running = 0;
+        size_t queued = 0;
+        size_t slots = 0;
+    };
+
+    // Review and less urgent classes are preempted by default
+    explicit SearchQueue(size_t slots, SearchPriority preemptible = SearchPriority::Review);
+
+    // Cancels what is queued and waits for the running searches to end
+    ~SearchQueue();
+
+    SearchQueue(const SearchQueue&) = delete;
+    SearchQueue& operator=(const SearchQueue&) = delete;
+
+    // Queues a search of the engine's current position. The engine is the
+    // queue's until on_complete, which runs on a search thread (or on the
+    // dispatcher, when the search starts and ends at once); it must not
+    // position or search the engine until then. Returns an id for cancel().
+    uint64_t submit(StockfishEngine& engine, const SearchLimits& limits, const QueueOptions& options,
+                    Callback on_complete);
+
+    // Drops a queued search, or stops a running one with its partial result.
+    // False once it has completed.
+    bool cancel(uint64_t id);
+
+    void set_slots(size_t slots);
+    size_t slots() const;
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Order = std::tuple<int, int64_t, uint64_t>;  // Priority, deadline, id
+
+    struct Request {
+        uint64_t id = 0;
+        StockfishEngine* engine = nullptr;
+        SearchLimits limits;
+        SearchPriority priority = SearchPriority::Live;
+        bool has_deadline = false;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+        Callback on_complete;
+
+        bool launched = false;        // search_async() has returned
+        bool stop_requested = false;  // Stop as soon as it is launched
+        bool preempted = false;
+        int wait_ms = 0;
+    };
+
+    Order order(const Request& request) const;
+    void preempt_locked(SearchPriority priority);
+    void stop_locked(Request& request);
+    void pump();
+    void dispatch();
+    void start(const std::shared_ptr<Request>& request);
+    void finish(const std::shared_ptr<Request>& request, const SearchResult& result);
+
+    const SearchPriority preemptible_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    std::condition_variable work_;  // Wakes the dispatcher
+    size_t slots_;
+    bool closing_ = false;
+    size_t finishing_ = 0;  // finish() calls still touching the queue
+    uint64_t next_id_ = 1;
+    std::map<Order, std::shared_ptr<Request>> queued_;
+    std::unordered_map<uint64_t, std::shared_ptr<Request>> running_;
+    std::array<ClassStats, SearchPriorityCount> stats_;
+    std::thread dispatcher_;  // Started last, once the rest is set up
+};
+
+} // namespace StockfishBinding
@@ -1,7 +1,20 @@
 #include "stockfish_wrapper.h"
-#include <iostream>
+#include "analysis_cache.h"
+#include "pgn_codec.h"
+#include "metrics.h"
+#include "thread_scheduler.h"
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <deque>
+#include <set>
+#include <string_view>
+#include <thread>
 #include <type_traits>
 
 // Check if we can include Stockfish headers
@@ -15,162 +28,1562 @@
 #include "engine.h"
 #include "misc.h"
 #include "tune.h"
+#include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
+#include "syzygy/tbprobe.h"
 using namespace Stockfish;
 #endif
 
 namespace StockfishBinding {
 
+// Scalar fields of a packed record; the moves are filled by the Impl
+static PackedInfo pack_fields(const SearchInfo& info) {
+    PackedInfo rec{};
+    rec.nodes = info.nodes;
+    rec.nps = info.nps;
+    rec.time_ms = info.time_ms;
+    rec.score = info.is_mate ? info.mate_in : info.score_cp;
+    rec.depth = static_cast<uint16_t>(std::max(0, info.depth));
+    rec.seldepth = static_cast<uint16_t>(std::max(0, info.seldepth));
+    rec.multipv = static_cast<uint16_t>(std::max(0, info.multipv));
+    rec.hashfull = static_cast<uint16_t>(std::max(0, info.hashfull));
+    rec.flags = info.is_mate ? PackedMate : 0;
+    return rec;
+}
+
+// SearchArena
+
+SearchInfo SearchArena::info(const PackedInfo& record) const {
+    return unpack(record, pv(record));
+}
+
+SearchInfo SearchArena::unpack(const PackedInfo& record, const uint16_t* moves) {
+    SearchInfo info;
+    info.depth = record.depth;
+    info.seldepth = record.seldepth;
+    info.nodes = record.nodes;
+    info.nps = record.nps;
+    info.time_ms = record.time_ms;
+    info.is_mate = (record.flags & PackedMate) != 0;
+    info.mate_in = info.is_mate ? record.score : 0;
+    info.score_cp = info.is_mate ? (record.score > 0 ? 30000 : -30000) : record.score;
+    info.multipv = record.multipv;
+    info.hashfull = record.hashfull;
+    
+    info.pv.reserve(record.pv_length);
+    for (uint16_t i = 0; i < record.pv_length; ++i) {
+        info.pv.push_back(Utils::packed_move_to_uci(moves[i]));
+    }
+    return info;
+}
+
+SearchResult SearchArena::to_result() const {
+    SearchResult result;
+    result.lines.reserve(lines.size());
+    for (uint32_t index : lines) {
+        result.lines.push_back(info(packed.records[index]));
+    }
+    if (!result.lines.empty()) {
+        result.final_info = result.lines.front();
+    }
+    if (best_move) result.best_move = Utils::packed_move_to_uci(best_move);
+    if (ponder_move) result.ponder_move = Utils::packed_move_to_uci(ponder_move);
+    result.from_book = from_book;
+    result.from_tablebase = from_tablebase;
+    result.from_cache = from_cache;
+    result.stopped = stopped;
+    return result;
+}
+
 #ifdef BUILDING_WITH_REAL_STOCKFISH
 
+// Bitboard and Zobrist tables are process-wide and read-only once built,
+// so every engine after the first skips straight to creating its Engine
+void init_globals() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        Bitboards::init();
+        Position::init();
+    });
+}
+
+// Built engines waiting to be used, so that initialize() does not have to
+// construct one. Constructing an Engine is nearly all of start-up: it
+// decodes both networks from the embedded weights, sizes the hash and
+// starts its threads. The weights are stored compressed and are laid out
+// for the CPU as they are read, so they cannot be mapped in place; reusing
+// a built engine is what saves the work. Engines come from prewarm(),
+// which builds them in the background, or from shutdown(), which hands
+// back an engine with default options and a cleared hash.
+class EngineReserve {
+public:
+    // Never destroyed: a background build may still be running at exit
+    static EngineReserve& instance() {
+        static auto* reserve = new EngineReserve();
+        return *reserve;
+    }
+    
+    // A built engine, waiting for one already being built; null when none
+    // is idle or on the way. Taking one under a prewarm() target starts
+    // building its replacement.
+    std::unique_ptr<Engine> take() {
+        std::unique_ptr<Engine> engine;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            built_.wait(lock, [this] { return !idle_.empty() || building_ == 0; });
+            if (idle_.empty()) return nullptr;
+            engine = std::move(idle_.back());
+            idle_.pop_back();
+        }
+        top_up();
+        return engine;
+    }
+    
+    // Keeps the engine if fewer than the target (at least one) are idle;
+    // otherwise it is destroyed, outside the lock as that joins its threads
+    void give_back(std::unique_ptr<Engine> engine) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < std::max<size_t>(target_, 1)) {
+            idle_.push_back(std::move(engine));
+            built_.notify_all();
+        }
+    }
+    
+    // Keep count engines built and idle from now on
+    void prewarm(size_t count) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            target_ = std::max(target_, count);
+        }
+        top_up();
+    }
+    
+private:
+    void top_up() {
+        size_t missing;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t have = idle_.size() + building_;
+            missing = target_ > have ? target_ - have : 0;
+            building_ += missing;
+        }
+        if (missing == 0) return;
+        
+        std::thread([this, missing] {
+            init_globals();
+            for (size_t i = 0; i < missing; ++i) {
+                std::unique_ptr<Engine> engine;
+                try {
+                    engine = std::make_unique<Engine>();
+                } catch (const std::exception& e) {
+                    BINDING_LOG(Error, "Stockfish prewarm error: " << e.what());
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    building_--;
+                    if (engine) idle_.push_back(std::move(engine));
+                }
+                built_.notify_all();
+            }
+        }).detach();
+    }
+    
+    std::mutex mutex_;
+    std::condition_variable built_;
+    std::vector<std::unique_ptr<Engine>> idle_;
+    size_t building_ = 0;
+    size_t target_ = 0;
+};
+
+// Default value of every option, from the engine's UCI option listing. A
+// string option without one is listed as "<empty>"; buttons have none.
+static std::map<std::string, std::string> option_defaults(const OptionsMap& options) {
+    std::map<std::string, std::string> defaults;
+    std::ostringstream listing;
+    listing << options;
+    
+    std::istringstream lines(listing.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+        const std::string name_tag = "option name ", type_tag = " type ", default_tag = " default ";
+        size_t type = line.find(type_tag);
+        size_t value = line.find(default_tag);
+        if (line.compare(0, name_tag.size(), name_tag) != 0 || type == std::string::npos || value == std::string::npos) {
+            continue;
+        }
+        
+        std::string name = line.substr(name_tag.size(), type - name_tag.size());
+        value += default_tag.size();
+        std::string fallback = line.substr(value, line.find(" min ", value) - value);
+        defaults[name] = fallback == "<empty>" ? "" : fallback;
+    }
+    return defaults;
+}
+
+// Engine keeps its networks private, so static evaluation uses a second,
+// process-wide copy of the embedded weights. It is read-only once loaded
+// and shared by every engine; built on the first evaluation.
+static const Eval::NNUE::Networks& eval_networks() {
+    namespace NN = Eval::NNUE;
+    static const std::unique_ptr<NN::Networks> networks = [] {
+        auto loaded = std::make_unique<NN::Networks>(
+            NN::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NN::EmbeddedNNUEType::BIG),
+            NN::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NN::EmbeddedNNUEType::SMALL));
+        loaded->big.load("", EvalFileDefaultNameBig);
+        loaded->small.load("", EvalFileDefaultNameSmall);
+        return loaded;
+    }();
+    return *networks;
+}
+
+// Syzygy tables are process-wide in Stockfish: Tablebases::init() maps the
+// files into one global table set, used by every engine's search. So one
+// path serves all engines and is mapped once; setting the same path again
+// is free. Another path unmaps the old files, so load() waits until no
+// search or root probe is using them. Nothing waits on a load: searches
+// that start meanwhile run without the tables, and probes miss.
+namespace SharedTablebases {
+
+struct State {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::string path;
+    int users = 0;  // Searches and probes in flight, on any engine
+    int cardinality = 0;  // Tablebases::MaxCardinality, read under the lock
+    bool loading = false;
+};
+
+static State& state() {
+    static State instance;
+    return instance;
+}
+
+// False while a load is pending: the caller goes on without the tables
+static bool acquire() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.loading) return false;
+    ++s.users;
+    return true;
+}
+
+static void release() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    --s.users;
+    s.changed.notify_all();
+}
+
+static int cardinality() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.cardinality;
+}
+
+// Blocks the calling thread until the tables are swapped; the binding runs
+// it on the libuv thread pool
+static bool load(const std::string& path) {
+    State& s = state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    s.changed.wait(lock, [&s] { return !s.loading; });
+    if (path == s.path) return true;
+    
+    s.loading = true;
+    s.changed.wait(lock, [&s] { return s.users == 0; });
+    try {
+        Tablebases::init(path);
+        s.path = path;
+    } catch (const std::exception& e) {
+        BINDING_LOG(Error, "Tablebase error: " << path << ": " << e.what());
+    }
+    s.cardinality = Tablebases::MaxCardinality;
+    s.loading = false;
+    s.changed.notify_all();
+    return s.path == path;
+}
+
+// Holds the tables for a probe on the calling thread, if they are not
+// being swapped
+struct Use {
+    Use() : held(acquire()) {}
+    ~Use() { if (held) release(); }
+    Use(const Use&) = delete;
+    Use& operator=(const Use&) = delete;
+    
+    const bool held;
+};
+
+} // namespace SharedTablebases
+
+// Subtree counts by position and remaining depth for perft, shared by its
+// threads without a lock. A slot holds its tag xor its count, so a slot
+// torn by two threads writing at once fails the check rather than
+// answering with another position's count.
+class PerftTable {
+public:
+    explicit PerftTable(size_t mb)
+        : slots_(std::max<size_t>(1, mb * 1024 * 1024 / sizeof(Slot))) {
+    }
+    
+    bool probe(Key key, int depth, uint64_t& nodes) const {
+        uint64_t t = tag(key, depth);
+        const Slot& slot = slots_[t % slots_.size()];
+        uint64_t count = slot.nodes.load(std::memory_order_relaxed);
+        if ((slot.check.load(std::memory_order_relaxed) ^ count) != t) return false;
+        nodes = count;
+        return true;
+    }
+    
+    void store(Key key, int depth, uint64_t nodes) {
+        uint64_t t = tag(key, depth);
+        Slot& slot = slots_[t % slots_.size()];
+        slot.check.store(t ^ nodes, std::memory_order_relaxed);
+        slot.nodes.store(nodes, std::memory_order_relaxed);
+    }
+    
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> nodes{0};
+    };
+    
+    static uint64_t tag(Key key, int depth) {
+        return key ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ULL);
+    }
+    
+    std::vector<Slot> slots_;
+};
+
+// Leaves depth plies below pos. The last ply is counted off the move list
+// instead of being played.
+static uint64_t perft_leaves(Position& pos, int depth, PerftTable* table) {
+    if (depth == 0) return 1;
+    
+    uint64_t nodes = 0;
+    if (depth > 1 && table && table->probe(pos.key(), depth, nodes)) return nodes;
+    
+    MoveList<LEGAL> moves(pos);
+    if (depth == 1) return moves.size();
+    
+    StateInfo state;
+    for (const auto& m : moves) {
+        pos.do_move(m, state);
+        nodes += perft_leaves(pos, depth - 1, table);
+        pos.undo_move(m);
+    }
+    if (table) table->store(pos.key(), depth, nodes);
+    return nodes;
+}
+
 // Real Stockfish implementation using the Engine class
 class StockfishEngine::Impl {
 public:
     bool initialize() {
         try {
             // Initialize Stockfish core components first
-            Bitboards::init();
-            Position::init();
+            init_globals();
             
-            // Create engine instance with default settings
-            engine_ = std::make_unique<Engine>();
+            // Create engine instance with default settings, unless a built
+            // one is waiting
+            engine_ = EngineReserve::instance().take();
+            if (!engine_) {
+                engine_ = std::make_unique<Engine>();
+            }
             
             // Initialize tunable parameters
             Tune::init(engine_->get_options());
             
-            // Set up callbacks to capture search info
+            states_ = StateListPtr(new std::deque<StateInfo>(1));
+            pos_.set(StartFEN, false, &states_->back());
+            current_fen_ = StartFEN;
+            played_.clear();
+            played_uci_.clear();
+            engine_dirty_ = true;
+            
+            // Set up callbacks to capture search info. Both fire on the
+            // engine's main search thread, so they only touch pending_
+            // under search_mutex_.
             engine_->set_on_bestmove([this](std::string_view best, std::string_view ponder) {
-                last_best_move_ = std::string(best);
-                last_ponder_move_ = std::string(ponder);
+                finish_search(best, ponder);
             });
             
             engine_->set_on_update_full([this](const Engine::InfoFull& info) {
-                last_search_info_ = info;
+                // An arena search is this thread's alone until bestmove
+                if (SearchArena* arena = arena_search_.arena.load(std::memory_order_acquire)) {
+                    pack_update(*arena, info);
+                    return;
+                }
+                
+                // An infinite search keeps no history, so when only packed
+                // updates are wanted the stream arena is all it needs: its
+                // lines become the result's at bestmove
+                if (streaming_ && !keep_history_ && !info_wanted_) {
+                    pack_update(stream_arena_, info);
+                    return;
+                }
+                
+                // InfoFull only holds views into the engine's buffers, so
+                // convert before the callback returns
+                SearchInfo converted = to_search_info(info);
+                std::vector<SearchInfo> deliver;
+                {
+                    std::lock_guard<std::mutex> lock(search_mutex_);
+                    if (!pending_) return;
+                    if (info_wanted_) {
+                        record(pending_->result, converted, keep_history_);
+                        deliver = throttle(*pending_, std::move(converted));
+                    } else {
+                        record(pending_->result, std::move(converted), keep_history_);
+                    }
+                }
+                for (const auto& update : deliver) {
+                    info_sink_(update);
+                }
+                if (streaming_) {
+                    pack_update(stream_arena_, info);
+                }
             });
             
             initialized_ = true;
             return true;
         } catch (const std::exception& e) {
-            std::cerr << "Stockfish initialization error: " << e.what() << std::endl;
+            BINDING_LOG(Error, "Stockfish initialization error: " << e.what());
             return false;
         }
     }
     
+    // The engine goes back to the reserve for the next initialize(), as it
+    // was built: default options, empty hash, no callbacks into this Impl
     void shutdown() {
         if (initialized_) {
+            stop();
+            engine_->wait_for_search_finished();
+            if (restore_defaults()) {
+                engine_->search_clear();
+                engine_->set_on_bestmove([](std::string_view, std::string_view) {});
+                engine_->set_on_update_full([](const Engine::InfoFull&) {});
+                EngineReserve::instance().give_back(std::move(engine_));
+            }
             engine_.reset();
             initialized_ = false;
         }
     }
     
-    bool set_position(const std::string& fen) {
+    static void prewarm(size_t count) {
+        EngineReserve::instance().prewarm(count);
+    }
+    
+    static bool load_tablebases(const std::string& path) {
+        return SharedTablebases::load(path);
+    }
+    
+    bool set_position(const std::string& fen, const std::vector<std::string>& moves) {
         try {
             if (!engine_) return false;
             
+            // Position::set() trusts its input
+            if (!Utils::is_valid_fen(fen)) {
+                BINDING_LOG(Warn, "Position error: invalid FEN " << fen);
+                return false;
+            }
+            
+            // Replay the moves on a scratch position first: an illegal one
+            // part-way must leave the current game as it was
+            {
+                StateListPtr scratch_states(new std::deque<StateInfo>(1));
+                Position scratch;
+                scratch.set(fen, false, &scratch_states->back());
+                for (const auto& move : moves) {
+                    Move m = parse_move(scratch, move);
+                    if (m == Move::none()) {
+                        BINDING_LOG(Warn, "Position error: illegal move " << move);
+                        return false;
+                    }
+                    scratch_states->emplace_back();
+                    scratch.do_move(m, scratch_states->back());
+                }
+            }
+            
+            // The wrapper keeps its own copy of the game so moves can be
+            // applied one ply at a time; the engine's root is only rebuilt
+            // from it when the next search starts
+            states_ = StateListPtr(new std::deque<StateInfo>(1));
+            pos_.set(fen, false, &states_->back());
+            
             current_fen_ = fen;
-            std::vector<std::string> moves; // Empty moves vector for just FEN
-            engine_->set_position(fen, moves);
+            played_.clear();
+            played_uci_.clear();
+            engine_dirty_ = true;
+            ponder_pushed_ = false;
+            
+            for (const auto& move : moves) {
+                if (!push_move(move)) {
+                    BINDING_LOG(Warn, "Position error: illegal move " << move);
+                    return false;
+                }
+            }
             return true;
         } catch (const std::exception& e) {
-            std::cerr << "Position error: " << e.what() << std::endl;
+            BINDING_LOG(Warn, "Position error: " << e.what());
+            return false;
+        }
+    }
+    
+    bool push_move(const std::string& uci_move) {
+        if (!initialized_) return false;
+        
+        Move m = parse_move(uci_move);
+        if (m == Move::none()) return false;
+        
+        // std::deque keeps earlier StateInfo addresses stable, which the
+        // Position's previous-state chain relies on
+        states_->emplace_back();
+        pos_.do_move(m, states_->back());
+        played_.push_back(m);
+        played_uci_.push_back(UCIEngine::move(m, pos_.is_chess960()));
+        engine_dirty_ = true;
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    bool pop_move() {
+        if (!initialized_ || played_.empty()) return false;
+        
+        pos_.undo_move(played_.back());
+        states_->pop_back();
+        played_.pop_back();
+        played_uci_.pop_back();
+        engine_dirty_ = true;
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    std::string get_fen() const {
+        return initialized_ ? pos_.fen() : std::string();
+    }
+    
+    const std::string& root_fen() const {
+        return current_fen_;
+    }
+    
+    const std::vector<std::string>& moves() const {
+        return played_uci_;
+    }
+    
+    // The raw Zobrist key: Position::key() also folds in the 50-move
+    // counter, which would split one book position into several
+    uint64_t position_key() const {
+        return initialized_ ? pos_.state()->key : 0;
+    }
+    
+    uint64_t key_of(const std::string& fen) const {
+        if (!initialized_ || !Utils::is_valid_fen(fen)) return 0;
+        Position pos;
+        StateInfo st;
+        pos.set(fen, false, &st);
+        return st.key;
+    }
+    
+    uint16_t parse_san(const std::string& san) const {
+        return initialized_ ? parse_san(pos_, san).raw() : 0;
+    }
+    
+    SearchResult search(const SearchLimits& limits) {
+        return search_async(limits, nullptr).get();
+    }
+    
+    std::future<SearchResult> search_async(const SearchLimits& search_limits, SearchCallback on_complete) {
+        return start_search(search_limits, std::move(on_complete), false);
+    }
+    
+    // See StockfishEngine::search_into(). Updates are packed on the search
+    // thread against a copy of the root, walked down each PV and back.
+    bool search_into(const SearchLimits& search_limits, SearchArena& arena) {
+        if (!initialized_ || !engine_) return false;
+        
+        stop();
+        engine_->wait_for_search_finished();
+        
+        try {
+            Search::LimitsType limits = to_limits(search_limits);
+            sync_engine_position();
+            set_arena_root();
+            arena_search_.held.clear();
+            arena_search_.last_emit = {};
+            arena_search_.arena.store(&arena, std::memory_order_release);
+            
+            stop_requested_ = false;
+            searching_ = true;
+            hold_tablebases();
+            engine_->go(limits);
+        } catch (const std::exception& e) {
+            BINDING_LOG(Error, "Search error: " << e.what());
+            arena_search_.arena.store(nullptr, std::memory_order_release);
+            searching_ = false;
+            if (holds_tablebases_.exchange(false)) {
+                SharedTablebases::release();
+            }
             return false;
         }
+        
+        std::unique_lock<std::mutex> lock(search_mutex_);
+        arena_done_.wait(lock, [this] { return arena_search_.arena.load() == nullptr; });
+        return true;
+    }
+    
+    // An answer found without a search, in arena form
+    void pack_result(const SearchResult& result, SearchArena& arena) const {
+        arena.clear();
+        if (initialized_) {
+            Position root;
+            StateInfo root_state;
+            std::vector<StateInfo> scratch;
+            root.set(pos_.fen(), pos_.is_chess960(), &root_state);
+            for (const auto& line : result.lines) {
+                arena.lines.push_back(static_cast<uint32_t>(arena.packed.records.size()));
+                arena.packed.records.push_back(pack_info(root, line, scratch, arena.packed.moves));
+            }
+            arena.best_move = parse_move(result.best_move).raw();
+            Move best(arena.best_move);
+            if (best != Move::none() && !result.ponder_move.empty()) {
+                StateInfo state;
+                root.do_move(best, state);
+                arena.ponder_move = parse_move(root, result.ponder_move).raw();
+                root.undo_move(best);
+            }
+        }
+        arena.from_book = result.from_book;
+        arena.from_tablebase = result.from_tablebase;
+        arena.from_cache = result.from_cache;
+    }
+    
+    std::future<SearchResult> ponder_async(const std::string& expected_move, const SearchLimits& search_limits,
+                                           SearchCallback on_complete) {
+        if (engine_) {
+            stop();
+            engine_->wait_for_search_finished();
+        }
+        
+        // An illegal guess resolves at once with an empty result, like a
+        // search on an uninitialized engine
+        if (!push_move(expected_move)) {
+            auto pending = std::make_unique<PendingSearch>();
+            pending->on_complete = std::move(on_complete);
+            auto future = pending->promise.get_future();
+            complete(std::move(pending));
+            return future;
+        }
+        ponder_pushed_ = true;
+        return start_search(search_limits, std::move(on_complete), true);
+    }
+    
+    bool ponder_hit() {
+        // Stockfish's own "ponderhit": the search carries on as a normal
+        // one, and time management counts from when pondering started
+        if (!engine_ || !pondering_.exchange(false)) return false;
+        engine_->set_ponderhit(false);
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    void stop_pondering() {
+        if (engine_ && pondering_.exchange(false)) {
+            stop_requested_ = true;
+            engine_->stop();
+            engine_->wait_for_search_finished();
+        }
+        if (ponder_pushed_) {
+            pop_move();
+        }
+    }
+    
+    bool is_pondering() const {
+        return pondering_;
+    }
+    
+    TablebaseProbe probe_tablebase() {
+        if (!in_tablebase_range()) return TablebaseProbe();
+        
+        SharedTablebases::Use use;
+        if (!use.held) return TablebaseProbe();
+        return probe_wdl_dtz();
+    }
+    
+    // Root-probe fast path: with DTZ tables for the position, Stockfish's
+    // own root ranking already knows the exact result and the moves that
+    // keep it, so the search would only confirm it. Lines follow MultiPV.
+    bool tablebase_result(SearchResult& result) {
+        if (!in_tablebase_range()) return false;
+        
+        Search::RootMoves root_moves;
+        for (const auto& m : MoveList<LEGAL>(pos_)) {
+            root_moves.emplace_back(m);
+        }
+        if (root_moves.empty()) return false;  // Mate and stalemate are searched
+        
+        SharedTablebases::Use use;
+        if (!use.held) return false;
+        result.tablebase = probe_wdl_dtz();
+        if (!result.tablebase.has_dtz) return false;
+        
+        const auto& options = engine_->get_options();
+        auto config = Tablebases::rank_root_moves(options, pos_, root_moves, true);
+        if (!config.rootInTB) return false;
+        
+        size_t lines = std::min<size_t>(std::max(1, int(options["MultiPV"])), root_moves.size());
+        for (size_t i = 0; i < lines; ++i) {
+            SearchInfo info;
+            info.multipv = static_cast<int>(i + 1);
+            info.pv.push_back(UCIEngine::move(root_moves[i].pv[0], pos_.is_chess960()));
+            set_score(info, Score(root_moves[i].tbScore, pos_));
+            result.lines.push_back(info);
+            result.all_info.push_back(info);
+        }
+        result.final_info = result.lines.front();
+        result.best_move = result.final_info.pv.front();
+        result.from_tablebase = true;
+        return true;
+    }
+    
+private:
+    // Syzygy covers castling-free positions up to the largest table loaded
+    bool in_tablebase_range() const {
+        if (!initialized_ || pos_.can_castle(ANY_CASTLING)) return false;
+        int cardinality = SharedTablebases::cardinality();
+        return cardinality > 0 && popcount(pos_.pieces()) <= cardinality;
+    }
+    
+    // A search started while the tables are being swapped runs without
+    // them: Stockfish probes whatever is mapped, so its probe limit drops
+    // to 0 for that search and comes back for the next one
+    void hold_tablebases() {
+        holds_tablebases_ = SharedTablebases::acquire();
+        int limit = holds_tablebases_ ? probe_limit_ : 0;
+        if (limit == applied_probe_limit_) return;
+        
+        std::istringstream is("name SyzygyProbeLimit value " + std::to_string(limit));
+        engine_->get_options().setoption(is);
+        applied_probe_limit_ = limit;
+    }
+    
+    // Caller holds the tables
+    TablebaseProbe probe_wdl_dtz() {
+        TablebaseProbe probe;
+        Tablebases::ProbeState state;
+        Tablebases::WDLScore wdl = Tablebases::probe_wdl(pos_, &state);
+        if (state == Tablebases::FAIL) return probe;
+        probe.wdl = static_cast<int>(wdl);
+        probe.found = true;
+        
+        int dtz = Tablebases::probe_dtz(pos_, &state);
+        if (state != Tablebases::FAIL) {
+            probe.dtz = dtz;
+            probe.has_dtz = true;
+        }
+        return probe;
     }
     
-    SearchResult search(int depth) {
+    std::future<SearchResult> start_search(const SearchLimits& search_limits, SearchCallback on_complete, bool ponder) {
+        auto pending = std::make_unique<PendingSearch>();
+        pending->on_complete = std::move(on_complete);
+        auto future = pending->promise.get_future();
+        
         if (!initialized_ || !engine_) {
-            return SearchResult(); // Return empty result
+            complete(std::move(pending));
+            return future;
         }
         
+        // One search per engine: cancel the running one so its caller gets
+        // the partial result and this call does not block behind it
+        stop();
+        engine_->wait_for_search_finished();
+        
         try {
-            Search::LimitsType limits;
-            limits.depth = depth;
-            limits.infinite = false;
+            sync_engine_position();
             
-            // Clear previous results
-            last_best_move_.clear();
-            last_ponder_move_.clear();
-            last_search_info_ = Engine::InfoFull{};
+            Search::LimitsType limits = to_limits(search_limits);
+            limits.ponderMode = ponder;
             
-            // Start search (non-blocking)
-            engine_->go(limits);
+            // Packed updates go through a per-line arena, so however long
+            // the search runs, streaming it allocates nothing after the
+            // first iteration
+            // An infinite search has no end to keep every update for. That
+            // includes one given no bound at all, which to_limits() makes
+            // infinite, so go by the converted limits.
+            keep_history_ = !limits.infinite;
+            streaming_ = packed_wanted_;
+            if (streaming_) {
+                set_arena_root();
+                stream_arena_.keep_history = false;
+                stream_arena_.clear();
+                arena_search_.held.clear();
+                arena_search_.last_emit = {};
+            }
             
-            // Wait for search to complete
-            // NOTE: This may take a long time on older hardware (2010 Xeon)
-            // with NNUE neural network evaluation. Should be tested on faster hardware.
-            engine_->wait_for_search_finished();
+            {
+                std::lock_guard<std::mutex> lock(search_mutex_);
+                pending_ = std::move(pending);
+            }
+            stop_requested_ = false;
+            searching_ = true;
+            pondering_ = ponder;
             
-            // Build result from captured info
-            SearchResult result;
-            result.best_move = last_best_move_;
-            result.ponder_move = last_ponder_move_;
+            // Released by finish_search(); every search may probe the tables
+            hold_tablebases();
             
-            // Fill in search info if available
-            if (last_search_info_.depth > 0) {
-                result.final_info.depth = last_search_info_.depth;
-                result.final_info.nodes = last_search_info_.nodes;
-                result.final_info.time_ms = last_search_info_.timeMs;
-                
-                // Convert Score to centipawns using visitor pattern
-                result.final_info.score_cp = last_search_info_.score.visit([](const auto& score_variant) -> int {
-                    if constexpr (std::is_same_v<std::decay_t<decltype(score_variant)>, Score::InternalUnits>) {
-                        return score_variant.value;
-                    } else if constexpr (std::is_same_v<std::decay_t<decltype(score_variant)>, Score::Mate>) {
-                        return score_variant.plies > 0 ? 30000 : -30000; // Large positive/negative for mate
-                    } else if constexpr (std::is_same_v<std::decay_t<decltype(score_variant)>, Score::Tablebase>) {
-                        return score_variant.win ? 20000 - score_variant.plies : -20000 - score_variant.plies;
-                    }
-                    return 0;
-                });
-                
-                result.final_info.nps = last_search_info_.nps;
-                
-                // Convert PV string to vector of moves
-                std::istringstream iss(std::string(last_search_info_.pv));
-                std::string move;
-                while (iss >> move) {
-                    result.final_info.pv.push_back(move);
-                }
+            // Start search (non-blocking); bestmove resolves the future
+            engine_->go(limits);
+        } catch (const std::exception& e) {
+            BINDING_LOG(Error, "Search error: " << e.what());
+            searching_ = false;
+            pondering_ = false;
+            if (holds_tablebases_.exchange(false)) {
+                SharedTablebases::release();
             }
-            
-            return result;
+            std::unique_ptr<PendingSearch> failed;
+            {
+                std::lock_guard<std::mutex> lock(search_mutex_);
+                failed = std::move(pending_);
+            }
+            if (failed) {
+                failed->result = SearchResult();
+                complete(std::move(failed));
+            }
+        }
+        
+        return future;
+    }
+    
+public:
+    void stop() {
+        // Engine::stop() only raises the stop flag; the search thread then
+        // unwinds within a few nodes and reports bestmove
+        if (engine_ && searching_) {
+            stop_requested_ = true;
+            engine_->stop();
+        }
+    }
+    
+    bool is_searching() const {
+        return searching_;
+    }
+    
+    bool set_option(const std::string& name, const std::string& value) {
+        if (!engine_) return false;
+        
+        // Stockfish's own handler re-inits the tables for the whole process
+        // on every engine; see SharedTablebases::load()
+        if (name == "SyzygyPath") {
+            stop();
+            engine_->wait_for_search_finished();
+            return SharedTablebases::load(value);
+        }
+        
+        auto& options = engine_->get_options();
+        if (!options.count(name)) return false;
+        
+        // Same rule as the UCI loop: options (Threads, Hash) must not
+        // change under a running search
+        stop();
+        engine_->wait_for_search_finished();
+        
+        try {
+            std::istringstream is("name " + name + " value " + value);
+            options.setoption(is);
+            changed_options_.insert(name);
+            if (name == "SyzygyProbeLimit") {
+                probe_limit_ = applied_probe_limit_ = int(options[name]);
+            }
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << "Search error: " << e.what() << std::endl;
-            return SearchResult();
+            BINDING_LOG(Warn, "Option error: " << name << " = " << value << ": " << e.what());
+            return false;
         }
     }
     
+    int get_hashfull() const {
+        return engine_ ? engine_->get_hashfull() : 0;
+    }
+    
+    void new_game() {
+        if (!engine_) return;
+        
+        stop();
+        engine_->wait_for_search_finished();
+        
+        // ucinewgame: clears the transposition table and search history
+        engine_->search_clear();
+        set_position(StartFEN, {});
+    }
+    
+    void set_info_sink(InfoCallback sink) {
+        info_sink_ = std::move(sink);
+    }
+    
+    void set_packed_sink(PackedInfoCallback sink) {
+        packed_sink_ = std::move(sink);
+    }
+    
+    // Whether anyone listens to info or packed updates; without listeners
+    // updates are only recorded, not coalesced for delivery
+    void set_info_wanted(bool info, bool packed) {
+        info_wanted_ = info;
+        packed_wanted_ = packed;
+    }
+    
+    void set_info_interval(int interval_ms) {
+        info_interval_ms_ = std::max(0, interval_ms);
+    }
+    
     int evaluate_current_position() {
-        // Note: Direct evaluation requires position access which isn't exposed in Engine API
-        // For now, run a quick 1-ply search to get evaluation
-        auto result = search(1);
-        return result.final_info.score_cp;
+        if (!initialized_) return 0;
+        
+        // Static eval is undefined in check; a 1-ply search resolves it
+        if (pos_.checkers()) {
+            SearchLimits limits;
+            limits.depth = 1;
+            return search(limits).final_info.score_cp;
+        }
+        return static_eval(pos_);
+    }
+    
+    std::vector<int> evaluate_many(const std::vector<std::string>& fens) {
+        std::vector<int> scores;
+        if (!initialized_) return scores;
+        
+        // One scratch position and one set of accumulator caches for the
+        // whole batch
+        scores.reserve(fens.size());
+        for (const auto& fen : fens) {
+            if (!Utils::is_valid_fen(fen)) {
+                scores.push_back(NoEvaluation);
+                continue;
+            }
+            scratch_pos_.set(fen, false, &scratch_state_);
+            scores.push_back(scratch_pos_.checkers() ? NoEvaluation : static_eval(scratch_pos_));
+        }
+        return scores;
     }
     
     std::vector<std::string> get_legal_moves() {
-        // For now, return basic starting moves to avoid position manipulation issues
-        // TODO: Implement proper move generation through Engine API
         std::vector<std::string> moves;
+        if (!initialized_) return moves;
         
-        if (current_fen_.find("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR") != std::string::npos) {
-            // Starting position - return common opening moves
-            moves = {"e2e4", "d2d4", "g1f3", "b1c3", "e2e3", "d2d3", "c2c4", "f2f4"};
-        } else {
-            // For other positions, return placeholder moves
-            moves = {"e7e6", "d7d6", "g8f6", "b8c6"};
+        MoveList<LEGAL> legal(pos_);
+        moves.reserve(legal.size());
+        for (const auto& m : legal) {
+            moves.push_back(UCIEngine::move(m, pos_.is_chess960()));
         }
-        
         return moves;
     }
     
-private:
-    bool initialized_ = false;
-    std::string current_fen_;
+    size_t get_legal_moves(uint16_t* out, size_t capacity) {
+        if (!initialized_) return 0;
+        
+        size_t count = 0;
+        for (const auto& m : MoveList<LEGAL>(pos_)) {
+            if (count == capacity) break;
+            out[count++] = m.raw();
+        }
+        return count;
+    }
+    
+    bool is_legal_move(const std::string& uci_move) {
+        return initialized_ && parse_move(uci_move) != Move::none();
+    }
+    
+    bool is_legal_move(uint16_t packed) {
+        if (!initialized_) return false;
+        
+        // pseudo_legal() guards TT moves, so other move types are matched
+        // against a move list and no list has to be generated here. It only
+        // asserts that a normal move has no promotion bits, which TT moves
+        // never set but an arbitrary 16-bit value can.
+        Move m(packed);
+        if (m.type_of() == NORMAL && (packed & 0x3000) != 0) return false;
+        return m.is_ok() && pos_.pseudo_legal(m) && pos_.legal(m);
+    }
+    
+    // Each thread walks whole root moves on its own copy of the position,
+    // taking the next unclaimed one until none are left
+    PerftResult perft(int depth, int threads, size_t hash_mb) {
+        PerftResult result;
+        if (!initialized_) return result;
+        if (depth == 0) {
+            result.nodes = 1;
+            return result;
+        }
+        
+        std::vector<Move> roots;
+        for (const auto& m : MoveList<LEGAL>(pos_)) {
+            roots.push_back(m);
+        }
+        std::vector<uint64_t> counts(roots.size());
+        std::unique_ptr<PerftTable> table;
+        if (hash_mb > 0 && depth > 2) {
+            table = std::make_unique<PerftTable>(hash_mb);
+        }
+        
+        const std::string fen = pos_.fen();
+        const bool chess960 = pos_.is_chess960();
+        std::atomic<size_t> next{0};
+        auto walk = [&] {
+            Position pos;
+            StateInfo root, state;
+            pos.set(fen, chess960, &root);
+            for (size_t i; (i = next++) < roots.size();) {
+                pos.do_move(roots[i], state);
+                counts[i] = perft_leaves(pos, depth - 1, table.get());
+                pos.undo_move(roots[i]);
+            }
+        };
+        
+        std::vector<std::thread> helpers;
+        for (size_t t = 1; t < std::min<size_t>(threads, roots.size()); ++t) {
+            helpers.emplace_back(walk);
+        }
+        walk();
+        for (auto& helper : helpers) {
+            helper.join();
+        }
+        
+        result.divide.reserve(roots.size());
+        for (size_t i = 0; i < roots.size(); ++i) {
+            result.divide.emplace_back(UCIEngine::move(roots[i], chess960), counts[i]);
+            result.nodes += counts[i];
+        }
+        return result;
+    }
+    
+    PackedResults pack_infos(const std::string& root_fen, const std::vector<SearchInfo>& infos) const {
+        PackedResults out;
+        if (!initialized_ || !Utils::is_valid_fen(root_fen)) return out;
+        
+        Position root;
+        StateInfo root_state;
+        std::vector<StateInfo> scratch;
+        root.set(root_fen, false, &root_state);
+        
+        out.records.reserve(infos.size());
+        for (const auto& info : infos) {
+            out.records.push_back(pack_info(root, info, scratch, out.moves));
+        }
+        return out;
+    }
+    
+    PackedResults pack_game_analysis(const std::string& start_fen, const std::vector<PlyAnalysis>& plies) const {
+        PackedResults out;
+        if (!initialized_ || !Utils::is_valid_fen(start_fen)) return out;
+        
+        Position pos;
+        std::deque<StateInfo> states(1);
+        std::vector<StateInfo> scratch;
+        pos.set(start_fen, false, &states.back());
+        
+        // Plies come in game order; each one is one move past the last
+        out.records.reserve(plies.size());
+        int at = 0;
+        for (const auto& ply : plies) {
+            Move move = Move::none();
+            if (ply.ply == at + 1) {
+                move = parse_move(pos, ply.move);
+                if (move == Move::none()) break;
+                states.emplace_back();
+                pos.do_move(move, states.back());
+                ++at;
+            } else if (ply.ply != at) {
+                break;
+            }
+            
+            PackedInfo rec = pack_info(pos, ply.info, scratch, out.moves);
+            rec.ply = static_cast<uint32_t>(ply.ply);
+            rec.move = move.raw();
+            rec.best_move = parse_move(pos, ply.best_move).raw();
+            out.records.push_back(rec);
+        }
+        return out;
+    }
+    
+    bool is_check() const {
+        return initialized_ && pos_.checkers();
+    }
+    
+    bool is_checkmate() const {
+        return initialized_ && pos_.checkers() && MoveList<LEGAL>(pos_).size() == 0;
+    }
+    
+    bool is_stalemate() const {
+        return initialized_ && !pos_.checkers() && MoveList<LEGAL>(pos_).size() == 0;
+    }
+    
+    bool is_draw() const {
+        if (!initialized_) return false;
+        
+        // Fifty-move rule, unless the hundredth half-move delivered mate
+        if (pos_.rule50_count() >= 100 && (!pos_.checkers() || MoveList<LEGAL>(pos_).size() > 0)) {
+            return true;
+        }
+        
+        // Stockfish marks a third occurrence with a negative distance
+        if (pos_.state()->repetition < 0) {
+            return true;
+        }
+        
+        return is_stalemate() || insufficient_material();
+    }
+    
+private:
+    // Record for one info, its PV appended to arena as far as it can be
+    // played from pos. pos is walked down the PV and back.
+    static PackedInfo pack_info(Position& pos, const SearchInfo& info,
+                                std::vector<StateInfo>& scratch, std::vector<uint16_t>& arena) {
+        PackedInfo rec = pack_fields(info);
+        rec.pv_offset = static_cast<uint32_t>(arena.size());
+        
+        if (scratch.size() < info.pv.size()) {
+            scratch.resize(info.pv.size());
+        }
+        
+        size_t played = 0;
+        for (const auto& uci : info.pv) {
+            Move m = parse_move(pos, uci);
+            if (m == Move::none()) break;
+            arena.push_back(m.raw());
+            pos.do_move(m, scratch[played++]);
+        }
+        while (played > 0) {
+            pos.undo_move(Move(arena[rec.pv_offset + --played]));
+        }
+        
+        rec.pv_length = static_cast<uint16_t>(arena.size() - rec.pv_offset);
+        rec.best_move = rec.pv_length > 0 ? arena[rec.pv_offset] : 0;
+        return rec;
+    }
+    
+    struct PendingSearch {
+        std::promise<SearchResult> promise;
+        SearchCallback on_complete;
+        SearchResult result;
+        
+        // Coalescing state for info_sink_, at most one update per line
+        std::chrono::steady_clock::time_point last_emit{};
+        std::vector<SearchInfo> held;
+    };
+    
+    // Stockfish reports the MultiPV lines of an iteration one after the
+    // other; keep the newest of each. Line 1 becomes the final info at
+    // bestmove, rather than being copied on every update.
+    static void record(SearchResult& result, SearchInfo info, bool history) {
+        size_t line = static_cast<size_t>(std::max(1, info.multipv)) - 1;
+        if (result.lines.size() <= line) {
+            result.lines.resize(line + 1);
+        }
+        if (!history) {
+            result.lines[line] = std::move(info);
+            return;
+        }
+        result.lines[line] = info;
+        result.all_info.push_back(std::move(info));
+    }
+    
+    // Updates inside the coalescing window replace earlier ones for the
+    // same MultiPV line; the newest of every line goes out with the next
+    // update past the window or at bestmove
+    std::vector<SearchInfo> throttle(PendingSearch& search, SearchInfo info) {
+        auto same_line = [&info](const SearchInfo& held) { return held.multipv == info.multipv; };
+        std::vector<SearchInfo> out;
+        
+        auto now = std::chrono::steady_clock::now();
+        if (info_interval_ms_ == 0 ||
+            now - search.last_emit >= std::chrono::milliseconds(info_interval_ms_)) {
+            search.last_emit = now;
+            out.swap(search.held);
+            out.erase(std::remove_if(out.begin(), out.end(), same_line), out.end());
+            out.push_back(std::move(info));
+            return out;
+        }
+        
+        auto it = std::find_if(search.held.begin(), search.held.end(), same_line);
+        if (it != search.held.end()) {
+            *it = std::move(info);
+        } else {
+            search.held.push_back(std::move(info));
+        }
+        return out;
+    }
+    
+    // Arena search in flight, see search_into(). Its buffers belong to the
+    // Impl and keep their size from one search to the next.
+    struct ArenaSearch {
+        std::atomic<SearchArena*> arena{nullptr};
+        Position root;
+        std::vector<StateInfo> root_states;  // Root FEN, then one per move played
+        std::vector<StateInfo> scratch;      // Walking a PV, MaxPv deep
+        std::chrono::steady_clock::time_point last_emit{};
+        std::vector<uint32_t> held;          // Records waiting for the next window
+    };
+    
+    // The root is rebuilt from the game mirror's FEN and moves rather than
+    // copied; Stockfish positions cannot be
+    void set_arena_root() {
+        auto& search = arena_search_;
+        search.root_states.resize(played_.size() + 1);  // Before any do_move: states are chained
+        search.scratch.resize(SearchArena::MaxPv);
+        search.root.set(current_fen_, pos_.is_chess960(), &search.root_states[0]);
+        for (size_t i = 0; i < played_.size(); ++i) {
+            search.root.do_move(played_[i], search.root_states[i + 1]);
+        }
+    }
+    
+    void pack_update(SearchArena& arena, const Engine::InfoFull& info) {
+        auto& search = arena_search_;
+        
+        SearchInfo fields;  // Scalars only; the PV is packed below
+        fields.depth = info.depth;
+        fields.seldepth = info.selDepth;
+        fields.nodes = static_cast<int64_t>(info.nodes);
+        fields.nps = static_cast<int64_t>(info.nps);
+        fields.time_ms = static_cast<int>(info.timeMs);
+        fields.multipv = static_cast<int>(info.multiPV);
+        fields.hashfull = info.hashfull;
+        set_score(fields, info.score);
+        
+        PackedInfo rec = pack_fields(fields);
+        uint16_t pv_moves[SearchArena::MaxPv];
+        
+        std::string_view pv = info.pv;
+        size_t played = 0;
+        while (!pv.empty() && played < SearchArena::MaxPv) {
+            size_t end = pv.find(' ');
+            std::string_view uci = pv.substr(0, end);
+            pv.remove_prefix(end == std::string_view::npos ? pv.size() : end + 1);
+            if (uci.empty()) continue;
+            
+            Move m = parse_move(search.root, uci);
+            if (m == Move::none()) break;
+            pv_moves[played] = m.raw();
+            search.root.do_move(m, search.scratch[played++]);
+        }
+        rec.pv_length = static_cast<uint16_t>(played);
+        rec.best_move = played > 0 ? pv_moves[0] : 0;
+        while (played > 0) {
+            search.root.undo_move(Move(pv_moves[--played]));
+        }
+        
+        auto& records = arena.packed.records;
+        auto& moves = arena.packed.moves;
+        size_t line = static_cast<size_t>(std::max<uint16_t>(1, rec.multipv)) - 1;
+        uint32_t index;
+        if (arena.keep_history) {
+            index = static_cast<uint32_t>(records.size());
+            rec.pv_offset = static_cast<uint32_t>(moves.size());
+            moves.insert(moves.end(), pv_moves, pv_moves + rec.pv_length);
+            records.push_back(rec);
+        } else {
+            // The line's slot, PV room included, is overwritten in place
+            if (records.size() <= line) {
+                records.resize(line + 1);
+                moves.resize((line + 1) * SearchArena::MaxPv);
+            }
+            index = static_cast<uint32_t>(line);
+            rec.pv_offset = static_cast<uint32_t>(line * SearchArena::MaxPv);
+            std::copy(pv_moves, pv_moves + rec.pv_length, moves.begin() + rec.pv_offset);
+            records[line] = rec;
+        }
+        if (arena.lines.size() <= line) {
+            arena.lines.resize(line + 1, index);
+        }
+        arena.lines[line] = index;
+        
+        if (!packed_wanted_) return;
+        
+        // Same coalescing as throttle(), on record indices
+        auto now = std::chrono::steady_clock::now();
+        if (info_interval_ms_ == 0 ||
+            now - search.last_emit >= std::chrono::milliseconds(info_interval_ms_)) {
+            search.last_emit = now;
+            for (uint32_t held : search.held) {
+                if (records[held].multipv != rec.multipv) {
+                    packed_sink_(arena, records[held]);
+                }
+            }
+            search.held.clear();
+            packed_sink_(arena, records[index]);
+            return;
+        }
+        
+        auto it = std::find_if(search.held.begin(), search.held.end(),
+                               [&](uint32_t held) { return records[held].multipv == rec.multipv; });
+        if (it != search.held.end()) {
+            *it = index;
+        } else {
+            search.held.push_back(index);
+        }
+    }
+    
+    void finish_arena_search(SearchArena& arena, std::string_view best, std::string_view ponder) {
+        auto& search = arena_search_;
+        searching_ = false;
+        if (holds_tablebases_.exchange(false)) {
+            SharedTablebases::release();
+        }
+        
+        for (uint32_t held : search.held) {
+            packed_sink_(arena, arena.packed.records[held]);
+        }
+        search.held.clear();
+        
+        Move best_move = parse_move(search.root, best);
+        arena.best_move = best_move.raw();
+        arena.stopped = stop_requested_;
+        if (best_move != Move::none() && !ponder.empty()) {
+            search.root.do_move(best_move, search.scratch[0]);
+            arena.ponder_move = parse_move(search.root, ponder).raw();
+            search.root.undo_move(best_move);
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(search_mutex_);
+            search.arena.store(nullptr, std::memory_order_release);
+        }
+        arena_done_.notify_all();
+    }
+    
+    Move parse_move(std::string_view uci_move) const {
+        return parse_move(pos_, uci_move);
+    }
+    
+    static Move parse_move(const Position& pos, std::string_view uci_move) {
+        return Notation::parse_uci(pos, uci_move);
+    }
+    
+    static Move parse_san(const Position& pos, std::string_view san) {
+        return Notation::parse_san(pos, san);
+    }
+    
+    // NNUE evaluation in centipawns from the side to move's point of view,
+    // matching the search's score_cp
+    int static_eval(const Position& pos) {
+        const auto& networks = eval_networks();
+        if (!eval_caches_) {
+            eval_caches_ = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
+        }
+        Value v = Eval::evaluate(networks, pos, *eval_caches_, VALUE_ZERO);
+        return UCIEngine::to_cp(v, pos);
+    }
+    
+    // Only the cases that can never be mated: bare kings, or a single minor
+    bool insufficient_material() const {
+        if (pos_.count<PAWN>() || pos_.count<ROOK>() || pos_.count<QUEEN>()) {
+            return false;
+        }
+        return pos_.count<KNIGHT>() + pos_.count<BISHOP>() <= 1;
+    }
+    
+    // Rebuilding from the root FEN plus the move list keeps the game
+    // history the engine needs for repetition detection. The transposition
+    // table is untouched, so entries from earlier plies stay usable.
+    void sync_engine_position() {
+        if (engine_dirty_) {
+            engine_->set_position(current_fen_, played_uci_);
+            engine_dirty_ = false;
+        }
+    }
+    
+    static Search::LimitsType to_limits(const SearchLimits& in) {
+        Search::LimitsType limits;
+        limits.startTime = now();  // The search starts as early as possible
+        
+        limits.depth = std::max(0, in.depth);
+        limits.nodes = in.nodes > 0 ? static_cast<uint64_t>(in.nodes) : 0;
+        limits.movetime = std::max(0, in.movetime_ms);
+        limits.mate = std::max(0, in.mate);
+        
+        limits.time[WHITE] = std::max(0, in.wtime_ms);
+        limits.time[BLACK] = std::max(0, in.btime_ms);
+        limits.inc[WHITE] = std::max(0, in.winc_ms);
+        limits.inc[BLACK] = std::max(0, in.binc_ms);
+        limits.movestogo = std::max(0, in.movestogo);
+        
+        // Without any bound Stockfish would iterate to MAX_PLY; make that
+        // explicit so the search waits for stop_search()
+        bool bounded = limits.depth || limits.nodes || limits.movetime || limits.mate
+                    || limits.use_time_management();
+        limits.infinite = in.infinite || !bounded;
+        
+        return limits;
+    }
+    
+    // Convert Score to centipawns using visitor pattern
+    static void set_score(SearchInfo& out, const Score& score) {
+        score.visit([&out](const auto& score_variant) {
+            using T = std::decay_t<decltype(score_variant)>;
+            if constexpr (std::is_same_v<T, Score::InternalUnits>) {
+                out.score_cp = score_variant.value;
+            } else if constexpr (std::is_same_v<T, Score::Mate>) {
+                out.is_mate = true;
+                out.mate_in = (score_variant.plies > 0 ? score_variant.plies + 1 : score_variant.plies) / 2;
+                out.score_cp = score_variant.plies > 0 ? 30000 : -30000; // Large positive/negative for mate
+            } else if constexpr (std::is_same_v<T, Score::Tablebase>) {
+                out.score_cp = score_variant.win ? 20000 - score_variant.plies : -20000 - score_variant.plies;
+            }
+        });
+    }
+    
+    static SearchInfo to_search_info(const Engine::InfoFull& info) {
+        SearchInfo out;
+        out.depth = info.depth;
+        out.seldepth = info.selDepth;
+        out.nodes = static_cast<int64_t>(info.nodes);
+        out.nps = static_cast<int64_t>(info.nps);
+        out.time_ms = static_cast<int>(info.timeMs);
+        out.multipv = static_cast<int>(info.multiPV);
+        out.hashfull = info.hashfull;
+        
+        set_score(out, info.score);
+        
+        // Split the PV in place; UCI moves fit std::string's inline buffer,
+        // so this does not allocate per move
+        std::string_view pv = info.pv;
+        out.pv.reserve(std::count(pv.begin(), pv.end(), ' ') + 1);
+        while (!pv.empty()) {
+            size_t end = pv.find(' ');
+            if (end != 0) {
+                out.pv.emplace_back(pv.substr(0, end));
+            }
+            pv.remove_prefix(end == std::string_view::npos ? pv.size() : end + 1);
+        }
+        
+        return out;
+    }
+    
+    void finish_search(std::string_view best, std::string_view ponder) {
+        if (SearchArena* arena = arena_search_.arena.load(std::memory_order_acquire)) {
+            finish_arena_search(*arena, best, ponder);
+            return;
+        }
+        
+        std::unique_ptr<PendingSearch> done;
+        {
+            std::lock_guard<std::mutex> lock(search_mutex_);
+            done = std::move(pending_);
+        }
+        searching_ = false;
+        pondering_ = false;
+        if (holds_tablebases_.exchange(false)) {
+            SharedTablebases::release();
+        }
+        
+        if (!done) return;
+        for (const auto& update : done->held) {
+            info_sink_(update);
+        }
+        if (streaming_) {
+            for (uint32_t held : arena_search_.held) {
+                packed_sink_(stream_arena_, stream_arena_.packed.records[held]);
+            }
+            arena_search_.held.clear();
+            if (!keep_history_) {
+                done->result.lines.clear();
+                for (uint32_t index : stream_arena_.lines) {
+                    done->result.lines.push_back(stream_arena_.info(stream_arena_.packed.records[index]));
+                }
+            }
+            streaming_ = false;
+        }
+        if (!done->result.lines.empty()) {
+            done->result.final_info = done->result.lines.front();
+        }
+        done->result.best_move = std::string(best);
+        done->result.ponder_move = std::string(ponder);
+        done->result.stopped = stop_requested_;
+        complete(std::move(done));
+    }
+    
+    // Sets every option changed on this engine back to its default; false
+    // if one would not go back, and the engine is not fit to reuse
+    bool restore_defaults() {
+        if (changed_options_.empty()) return true;
+        
+        auto& options = engine_->get_options();
+        auto defaults = option_defaults(options);
+        try {
+            for (const auto& name : changed_options_) {
+                auto it = defaults.find(name);
+                if (it == defaults.end()) return false;
+                std::istringstream is("name " + name + " value " + it->second);
+                options.setoption(is);
+            }
+        } catch (const std::exception& e) {
+            BINDING_LOG(Warn, "Option reset error: " << e.what());
+            return false;
+        }
+        changed_options_.clear();
+        return true;
+    }
+    
+    static void complete(std::unique_ptr<PendingSearch> done) {
+        if (done->on_complete) {
+            try {
+                done->on_complete(done->result);
+            } catch (const std::exception& e) {
+                BINDING_LOG(Error, "Search callback error: " << e.what());
+            }
+        }
+        done->promise.set_value(std::move(done->result));
+    }
+    
+    bool initialized_ = false;
+    std::string current_fen_;  // Root FEN, before played_
     std::unique_ptr<Engine> engine_;
+    std::set<std::string> changed_options_;  // Reset before the engine is reused
+    
+    // Game mirror: root position plus every move applied since
+    Position pos_;
+    StateListPtr states_;
+    std::vector<Move> played_;
+    std::vector<std::string> played_uci_;
+    bool engine_dirty_ = true;
     
-    // Capture search results
-    std::string last_best_move_;
-    std::string last_ponder_move_;
-    Engine::InfoFull last_search_info_;
+    // Static evaluation context, reused across calls
+    std::unique_ptr<Eval::NNUE::AccumulatorCaches> eval_caches_;
+    Position scratch_pos_;
+    StateInfo scratch_state_;
+    
+    // Search in flight, resolved from the bestmove callback
+    std::mutex search_mutex_;
+    std::unique_ptr<PendingSearch> pending_;
+    std::atomic<bool> searching_{false};
+    
+    // Ponder search in flight, until ponder_hit() or it ends. The expected
+    // move stays on the game mirror until stop_pondering() takes it back
+    // or the game moves on.
+    std::atomic<bool> pondering_{false};
+    bool ponder_pushed_ = false;
+    
+    // Raised by stop() and stop_pondering() for the search in flight
+    std::atomic<bool> stop_requested_{false};
+    
+    // Search in flight counts as a tablebase user, see SharedTablebases::load()
+    std::atomic<bool> holds_tablebases_{false};
+    int probe_limit_ = 7;  // SyzygyProbeLimit as set; Stockfish's default
+    int applied_probe_limit_ = 7;
+    
+    // Arena search in flight; search_into() waits on arena_done_ for it
+    ArenaSearch arena_search_;
+    
+    // Packed stream of an async search, one record per line; see start_search()
+    SearchArena stream_arena_;
+    bool streaming_ = false;
+    bool keep_history_ = true;  // Updates go to all_info; not for infinite searches
+    std::condition_variable arena_done_;
+    
+    // Live info stream, see StockfishEngine::set_info_interval()
+    InfoCallback info_sink_;
+    PackedInfoCallback packed_sink_;
+    std::atomic<bool> info_wanted_{false};
+    std::atomic<bool> packed_wanted_{false};
+    std::atomic<int> info_interval_ms_{0};
 };
 
 #else
@@ -179,54 +1592,386 @@ private:
 class StockfishEngine::Impl {
 public:
     bool initialize() {
-        std::cout << "*** STUB IMPLEMENTATION INITIALIZING ***" << std::endl;
-        std::cout << "StockfishEngine::Impl::initialize() - stub implementation" << std::endl;
+        BINDING_LOG(Info, "Stub engine initialized, built without Stockfish");
+        return true;
+    }
+    
+    void shutdown() {
+        BINDING_LOG(Debug, "Stub engine shut down");
+    }
+    
+    static void prewarm(size_t) {
+    }
+    
+    static bool load_tablebases(const std::string&) {
+        return true;
+    }
+    
+    bool set_position(const std::string& fen, const std::vector<std::string>& moves) {
+        BINDING_LOG(Debug, "Setting position to: " << fen);
+        if (!Utils::is_valid_fen(fen)) return false;
+        std::string from, to, promotion;
+        for (const auto& move : moves) {
+            if (!Utils::parse_uci_move(move, from, to, promotion)) return false;
+        }
+        current_fen_ = fen;
+        played_ = moves;
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    bool push_move(const std::string& uci_move) {
+        std::string from, to, promotion;
+        if (!Utils::parse_uci_move(uci_move, from, to, promotion)) return false;
+        played_.push_back(uci_move);
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    bool pop_move() {
+        if (played_.empty()) return false;
+        played_.pop_back();
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    std::string get_fen() const {
+        // The stub does not track the board, so only the root is known
+        return played_.empty() ? current_fen_ : std::string();
+    }
+    
+    const std::string& root_fen() const {
+        return current_fen_;
+    }
+    
+    const std::vector<std::string>& moves() const {
+        return played_;
+    }
+    
+    // Stable stand-in for a Zobrist key: a hash of the root and the moves
+    uint64_t position_key() const {
+        uint64_t key = key_of(current_fen_);
+        for (const auto& move : played_) {
+            key = fnv1a(key ^ fnv1a(14695981039346656037ULL, move), " ");
+        }
+        return key;
+    }
+    
+    uint64_t key_of(const std::string& fen) const {
+        return fnv1a(14695981039346656037ULL, fen);
+    }
+    
+    uint16_t parse_san(const std::string&) const {
+        return 0;  // Without a board SAN cannot be resolved
+    }
+    
+    SearchResult search(const SearchLimits& limits, bool notify = true) {
+        // The stub has no clock, so approximate every limit with a depth
+        int depth = limits.depth;
+        if (depth <= 0 && limits.movetime_ms > 0) depth = limits.movetime_ms / 100;
+        if (depth <= 0 && limits.nodes > 0) depth = static_cast<int>(limits.nodes / 1000);
+        depth = std::max(1, std::min(depth > 0 ? depth : 20, 40));
+        
+        BINDING_LOG(Debug, "Searching to depth " << depth);
+        
+        SearchResult result;
+        result.best_move = "e2e4";  // Stub best move
+        result.ponder_move = "e7e5";
+        
+        // One line per MultiPV index, each a stub move a little worse
+        static const char* first_moves[] = {"e2e4", "d2d4", "g1f3", "b1c3"};
+        for (int line = 0; line < multipv_; ++line) {
+            SearchInfo info;
+            info.depth = depth;
+            info.nodes = 1000 * depth;
+            info.nps = 100000;
+            info.time_ms = depth * 10;
+            info.score_cp = 25 - 10 * line;
+            info.pv = {first_moves[line % 4], "e7e5", "g1f3"};
+            info.multipv = line + 1;
+            result.all_info.push_back(info);
+            result.lines.push_back(info);
+            
+            if (notify && info_sink_) {
+                info_sink_(info);
+            }
+        }
+        result.final_info = result.lines.front();
+        
+        if (notify && packed_wanted_) {
+            pack_result(result, stream_arena_);
+            for (const auto& rec : stream_arena_.packed.records) {
+                packed_sink_(stream_arena_, rec);
+            }
+        }
+        
+        return result;
+    }
+    
+    bool search_into(const SearchLimits& limits, SearchArena& arena) {
+        pack_result(search(limits, false), arena);
+        if (packed_wanted_) {
+            for (const auto& rec : arena.packed.records) {
+                packed_sink_(arena, rec);
+            }
+        }
+        return true;
+    }
+    
+    void pack_result(const SearchResult& result, SearchArena& arena) const {
+        arena.clear();
+        for (const auto& line : result.lines) {
+            arena.lines.push_back(static_cast<uint32_t>(arena.packed.records.size()));
+            arena.packed.records.push_back(pack_info(line, arena.packed.moves));
+        }
+        arena.best_move = pack_move(result.best_move);
+        arena.ponder_move = pack_move(result.ponder_move);
+        arena.from_book = result.from_book;
+        arena.from_tablebase = result.from_tablebase;
+        arena.from_cache = result.from_cache;
+    }
+    
+    std::future<SearchResult> search_async(const SearchLimits& limits, SearchCallback on_complete) {
+        // The stub answers instantly, so the future is already resolved
+        std::promise<SearchResult> promise;
+        SearchResult result = search(limits);
+        if (on_complete) {
+            on_complete(result);
+        }
+        promise.set_value(std::move(result));
+        return promise.get_future();
+    }
+    
+    // The stub's ponder search finishes at once, but the engine still
+    // counts as pondering until the guess is confirmed or dropped
+    std::future<SearchResult> ponder_async(const std::string& expected_move, const SearchLimits& limits,
+                                           SearchCallback on_complete) {
+        if (!push_move(expected_move)) {
+            std::promise<SearchResult> promise;
+            if (on_complete) {
+                on_complete(SearchResult());
+            }
+            promise.set_value(SearchResult());
+            return promise.get_future();
+        }
+        ponder_pushed_ = true;
+        pondering_ = true;
+        return search_async(limits, std::move(on_complete));
+    }
+    
+    bool ponder_hit() {
+        if (!pondering_) return false;
+        pondering_ = false;
+        ponder_pushed_ = false;
+        return true;
+    }
+    
+    void stop_pondering() {
+        pondering_ = false;
+        if (ponder_pushed_) {
+            pop_move();
+        }
+    }
+    
+    bool is_pondering() const {
+        return pondering_;
+    }
+    
+    void stop() {
+    }
+    
+    bool is_searching() const {
+        return false;
+    }
+    
+    void set_info_sink(InfoCallback sink) {
+        info_sink_ = std::move(sink);
+    }
+    
+    void set_packed_sink(PackedInfoCallback sink) {
+        packed_sink_ = std::move(sink);
+    }
+    
+    void set_info_wanted(bool, bool packed) {
+        packed_wanted_ = packed;
+    }
+    
+    void set_info_interval(int) {
+    }
+    
+    bool set_option(const std::string& name, const std::string& value) {
+        static const std::vector<std::string> known = {
+            "Threads", "Hash", "MultiPV", "Skill Level", "UCI_LimitStrength",
+            "UCI_Elo", "Ponder", "Move Overhead", "SyzygyPath", "UCI_ShowWDL", "NumaPolicy"
+        };
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            return false;
+        }
+        BINDING_LOG(Debug, "Setting option " << name << " = " << value);
+        if (name == "MultiPV") {
+            try {
+                multipv_ = std::max(1, std::min(std::stoi(value), 500));
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
         return true;
     }
     
-    void shutdown() {
-        std::cout << "StockfishEngine::Impl::shutdown() - stub implementation" << std::endl;
+    int get_hashfull() const {
+        return 0;
+    }
+    
+    // The stub has no tables; SyzygyPath is accepted and ignored
+    TablebaseProbe probe_tablebase() {
+        return TablebaseProbe();
+    }
+    
+    bool tablebase_result(SearchResult&) {
+        return false;
+    }
+    
+    void new_game() {
+        set_position(StartFEN, {});
+    }
+    
+    int evaluate_current_position() {
+        return 25; // Stub evaluation
+    }
+    
+    std::vector<int> evaluate_many(const std::vector<std::string>& fens) {
+        return std::vector<int>(fens.size(), 25);
+    }
+    
+    std::vector<std::string> get_legal_moves() {
+        return {"e2e4", "d2d4", "g1f3", "b1c3"}; // Stub moves
     }
     
-    bool set_position(const std::string& fen) {
-        std::cout << "Setting position to: " << fen << std::endl;
-        current_fen_ = fen;
-        return true;
+    size_t get_legal_moves(uint16_t* out, size_t capacity) {
+        // Same encoding as Stockfish: from square in bits 6-11, to in 0-5
+        static const uint16_t stub_moves[] = {
+            (12 << 6) | 28, (11 << 6) | 27, (6 << 6) | 21, (1 << 6) | 18
+        };
+        size_t count = std::min(capacity, sizeof(stub_moves) / sizeof(stub_moves[0]));
+        std::copy(stub_moves, stub_moves + count, out);
+        return count;
     }
     
-    SearchResult search(int depth) {
-        std::cout << "Searching to depth " << depth << std::endl;
-        
-        SearchResult result;
-        result.best_move = "e2e4";  // Stub best move
-        result.ponder_move = "e7e5";
-        
-        result.final_info.depth = depth;
-        result.final_info.nodes = 1000 * depth;
-        result.final_info.nps = 100000;
-        result.final_info.time_ms = depth * 10;
-        result.final_info.score_cp = 25;
-        result.final_info.pv = {"e2e4", "e7e5", "g1f3"};
+    bool is_legal_move(const std::string& uci_move) {
+        auto moves = get_legal_moves();
+        return std::find(moves.begin(), moves.end(), uci_move) != moves.end();
+    }
+    
+    bool is_legal_move(uint16_t packed) {
+        if ((packed >> 14) == 0 && (packed & 0x3000) != 0) return false;  // As the real one
+        return is_legal_move(Utils::packed_move_to_uci(packed));
+    }
+    
+    // Every stub position has the same four moves
+    PerftResult perft(int depth, int, size_t) {
+        PerftResult result;
+        if (depth == 0) {
+            result.nodes = 1;
+            return result;
+        }
         
+        uint64_t below = 1;
+        for (int i = 1; i < depth; ++i) below *= 4;
+        for (const auto& move : get_legal_moves()) {
+            result.divide.emplace_back(move, below);
+            result.nodes += below;
+        }
         return result;
     }
     
-    int evaluate_current_position() {
-        return 25; // Stub evaluation
+    PackedResults pack_infos(const std::string&, const std::vector<SearchInfo>& infos) const {
+        PackedResults out;
+        for (const auto& info : infos) {
+            out.records.push_back(pack_info(info, out.moves));
+        }
+        return out;
     }
     
-    std::vector<std::string> get_legal_moves() {
-        return {"e2e4", "d2d4", "g1f3", "b1c3"}; // Stub moves
+    PackedResults pack_game_analysis(const std::string&, const std::vector<PlyAnalysis>& plies) const {
+        PackedResults out;
+        for (const auto& ply : plies) {
+            PackedInfo rec = pack_info(ply.info, out.moves);
+            rec.ply = static_cast<uint32_t>(ply.ply);
+            rec.move = pack_move(ply.move);
+            rec.best_move = pack_move(ply.best_move);
+            out.records.push_back(rec);
+        }
+        return out;
     }
     
+    bool is_check() const { return false; }
+    bool is_checkmate() const { return false; }
+    bool is_stalemate() const { return false; }
+    bool is_draw() const { return false; }
+    
 private:
+    static uint64_t fnv1a(uint64_t hash, const std::string& text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    // Without a board there are no move types, so only squares and
+    // promotion are encoded
+    static uint16_t pack_move(const std::string& uci) {
+        std::string from, to, promotion;
+        if (!Utils::parse_uci_move(uci, from, to, promotion)) return 0;
+        
+        auto square = [](const std::string& sq) {
+            if (sq[0] < 'a' || sq[0] > 'h' || sq[1] < '1' || sq[1] > '8') return -1;
+            return (sq[1] - '1') * 8 + (sq[0] - 'a');
+        };
+        int from_sq = square(from);
+        int to_sq = square(to);
+        if (from_sq < 0 || to_sq < 0 || from_sq == to_sq) return 0;
+        
+        uint16_t packed = static_cast<uint16_t>((from_sq << 6) | to_sq);
+        size_t piece = promotion.empty() ? std::string::npos : std::string("nbrq").find(promotion[0]);
+        if (piece != std::string::npos) {
+            packed |= static_cast<uint16_t>((1 << 14) | (piece << 12));
+        }
+        return packed;
+    }
+    
+    static PackedInfo pack_info(const SearchInfo& info, std::vector<uint16_t>& arena) {
+        PackedInfo rec = pack_fields(info);
+        rec.pv_offset = static_cast<uint32_t>(arena.size());
+        for (const auto& uci : info.pv) {
+            uint16_t packed = pack_move(uci);
+            if (packed == 0) break;
+            arena.push_back(packed);
+        }
+        rec.pv_length = static_cast<uint16_t>(arena.size() - rec.pv_offset);
+        rec.best_move = rec.pv_length > 0 ? arena[rec.pv_offset] : 0;
+        return rec;
+    }
+    
     std::string current_fen_;
+    std::vector<std::string> played_;
+    int multipv_ = 1;
+    bool pondering_ = false;
+    bool ponder_pushed_ = false;
+    InfoCallback info_sink_;
+    PackedInfoCallback packed_sink_;
+    bool packed_wanted_ = false;
+    SearchArena stream_arena_;
 };
 
 #endif
 
 StockfishEngine::StockfishEngine() 
-    : impl_(std::make_unique<Impl>()), ready_(false) {
+    : impl_(std::make_unique<Impl>()), ready_(false),
+      book_random_(static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())) {
+    impl_->set_info_sink([this](const SearchInfo& info) { on_search_info(info); });
+    impl_->set_packed_sink([this](const SearchArena& arena, const PackedInfo& info) {
+        on_packed_info(arena, info);
+    });
 }
 
 StockfishEngine::~StockfishEngine() {
@@ -236,7 +1981,15 @@ StockfishEngine::~StockfishEngine() {
 }
 
 bool StockfishEngine::initialize() {
+    auto started = std::chrono::steady_clock::now();
+    bool was_ready = ready_;
     ready_ = impl_->initialize();
+    if (ready_ && !was_ready) {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        metrics().init_ms.observe(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        metrics().engines.add(1);
+    }
+    count_memory();
     return ready_;
 }
 
@@ -244,97 +1997,691 @@ void StockfishEngine::shutdown() {
     if (ready_) {
         impl_->shutdown();
         ready_ = false;
+        // A later initialize() starts from default options again
+        applied_options_.clear();
+        metrics().engines.add(-1);
+        count_memory();
     }
 }
 
+void StockfishEngine::prewarm(size_t count) {
+    Impl::prewarm(count);
+}
+
+bool StockfishEngine::load_tablebases(const std::string& path) {
+    return Impl::load_tablebases(path);
+}
+
 bool StockfishEngine::set_position(const std::string& fen) {
-    return impl_->set_position(fen);
+    return impl_->set_position(fen, {});
 }
 
 bool StockfishEngine::set_position_with_moves(const std::string& fen, const std::vector<std::string>& moves) {
-    if (!impl_->set_position(fen)) {
+    return impl_->set_position(fen, moves);
+}
+
+bool StockfishEngine::set_startpos_with_moves(const std::vector<std::string>& moves) {
+    return set_position_with_moves(StartFEN, moves);
+}
+
+bool StockfishEngine::push_move(const std::string& uci_move) {
+    return impl_->push_move(uci_move);
+}
+
+bool StockfishEngine::pop_move() {
+    return impl_->pop_move();
+}
+
+std::string StockfishEngine::get_fen() const {
+    return impl_->get_fen();
+}
+
+std::string StockfishEngine::get_root_fen() const {
+    return impl_->root_fen();
+}
+
+std::vector<std::string> StockfishEngine::get_moves() const {
+    return impl_->moves();
+}
+
+uint64_t StockfishEngine::position_key() const {
+    return impl_->position_key();
+}
+
+uint16_t StockfishEngine::parse_san(const std::string& san) const {
+    return impl_->parse_san(san);
+}
+
+SearchResult StockfishEngine::search(int depth) {
+    SearchLimits limits;
+    limits.depth = std::max(1, depth);
+    return search(limits);
+}
+
+SearchResult StockfishEngine::search(const SearchLimits& requested) {
+    SearchLimits limits = strength().apply(requested);
+    SearchResult result;
+    if (instant_result(limits, result)) {
+        return result;
+    }
+    
+    int multipv = 1;
+    auto cache = cache_for(limits, multipv);
+    uint64_t key = impl_->position_key();
+    SearchCallback release_cpus = hold_cpus(nullptr);
+    auto started = std::chrono::steady_clock::now();
+    result = impl_->search(limits);
+    if (release_cpus) {
+        release_cpus(result);
+    }
+    if (ready_) {
+        record_search(result.final_info.nps, started);
+    }
+    if (cache) {
+        cache->store(key, limits, multipv, result);
+    }
+    return result;
+}
+
+bool StockfishEngine::search_into(const SearchLimits& requested, SearchArena& arena) {
+    SearchLimits limits = strength().apply(requested);
+    SearchResult result;
+    if (instant_result(limits, result)) {
+        impl_->pack_result(result, arena);
+        return true;
+    }
+    if (!ready_) return false;
+    
+    arena.clear();
+    int multipv = 1;
+    auto cache = cache_for(limits, multipv);
+    uint64_t key = impl_->position_key();
+    SearchCallback release_cpus = hold_cpus(nullptr);
+    auto started = std::chrono::steady_clock::now();
+    bool searched = impl_->search_into(limits, arena);
+    if (release_cpus) {
+        release_cpus(SearchResult());
+    }
+    if (!searched) {
         return false;
     }
-    // TODO: Apply moves
+    
+    const PackedInfo* final_info = arena.final_info();
+    record_search(final_info ? final_info->nps : 0, started);
+    if (cache) {
+        // The cache keeps results as strings; only cacheable searches pay
+        cache->store(key, limits, multipv, arena.to_result());
+    }
     return true;
 }
 
-bool StockfishEngine::set_startpos_with_moves(const std::vector<std::string>& moves) {
-    return set_position_with_moves("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", moves);
+std::future<SearchResult> StockfishEngine::search_async(int depth, SearchCallback on_complete) {
+    SearchLimits limits;
+    limits.depth = std::max(1, depth);
+    return search_async(limits, std::move(on_complete));
 }
 
-SearchResult StockfishEngine::search(int depth) {
-    return impl_->search(depth);
+std::future<SearchResult> StockfishEngine::search_async(const SearchLimits& requested, SearchCallback on_complete) {
+    SearchLimits limits = strength().apply(requested);
+    SearchResult result;
+    if (instant_result(limits, result)) {
+        // In book or tablebase the answer is already known, so resolve on
+        // this thread the way an uninitialized engine's search does
+        if (on_complete) {
+            on_complete(result);
+        }
+        std::promise<SearchResult> promise;
+        promise.set_value(std::move(result));
+        return promise.get_future();
+    }
+    
+    if (ready_) {
+        auto started = std::chrono::steady_clock::now();
+        on_complete = [this, started, next = std::move(on_complete)](const SearchResult& done) {
+            record_search(done.final_info.nps, started);
+            if (next) {
+                next(done);
+            }
+        };
+    }
+    
+    // The position may change before the search ends, so the key is taken now
+    int multipv = 1;
+    if (auto cache = cache_for(limits, multipv)) {
+        uint64_t key = impl_->position_key();
+        on_complete = [cache, key, limits, multipv, next = std::move(on_complete)](const SearchResult& done) {
+            cache->store(key, limits, multipv, done);
+            if (next) {
+                next(done);
+            }
+        };
+    }
+    return impl_->search_async(limits, hold_cpus(std::move(on_complete)));
 }
 
 SearchResult StockfishEngine::search_time(int time_ms) {
-    // For stub, just use depth based on time
-    int depth = std::max(1, time_ms / 100);
-    return search(depth);
+    SearchLimits limits;
+    limits.movetime_ms = std::max(1, time_ms);
+    return search(limits);
 }
 
 SearchResult StockfishEngine::search_nodes(int64_t nodes) {
-    // For stub, just use depth based on nodes
-    int depth = std::max(1, static_cast<int>(nodes / 1000));
-    return search(depth);
+    SearchLimits limits;
+    limits.nodes = std::max<int64_t>(1, nodes);
+    return search(limits);
+}
+
+SearchResult StockfishEngine::search_clock(int wtime_ms, int btime_ms, int winc_ms, int binc_ms, int movestogo) {
+    SearchLimits limits;
+    limits.wtime_ms = wtime_ms;
+    limits.btime_ms = btime_ms;
+    limits.winc_ms = winc_ms;
+    limits.binc_ms = binc_ms;
+    limits.movestogo = movestogo;
+    return search(limits);
 }
 
 void StockfishEngine::stop_search() {
-    // TODO: Implement search stopping
+    impl_->stop();
+}
+
+std::future<SearchResult> StockfishEngine::ponder_async(const std::string& expected_move, const SearchLimits& limits,
+                                                        SearchCallback on_complete) {
+    return impl_->ponder_async(expected_move, strength().apply(limits), hold_cpus(std::move(on_complete)));
+}
+
+bool StockfishEngine::ponder_hit() {
+    return impl_->ponder_hit();
+}
+
+void StockfishEngine::stop_pondering() {
+    impl_->stop_pondering();
+}
+
+bool StockfishEngine::is_pondering() const {
+    return impl_->is_pondering();
+}
+
+bool StockfishEngine::is_searching() const {
+    return impl_->is_searching();
+}
+
+bool StockfishEngine::set_book(std::shared_ptr<const OpeningBook> book) {
+    if (book && (!book->is_open() || book->start_key() != impl_->key_of(StartFEN))) {
+        return false;
+    }
+    book_ = std::move(book);
+    return true;
+}
+
+std::vector<BookEntry> StockfishEngine::book_moves() const {
+    std::vector<BookEntry> moves;
+    if (!book_ || !ready_) return moves;
+    
+    for (const auto& entry : book_->probe(impl_->position_key())) {
+        if (impl_->is_legal_move(entry.move)) {
+            moves.push_back(entry);
+        }
+    }
+    return moves;
+}
+
+bool StockfishEngine::instant_result(const SearchLimits& limits, SearchResult& result) {
+    if (book_move(limits, result)) {
+        metrics().book_hits.add();
+        return true;
+    }
+    
+    if (limits.use_tablebase && ready_) {
+        if (impl_->tablebase_result(result)) {
+            metrics().tablebase_hits.add();
+            return true;
+        }
+        result = SearchResult();  // A failed probe may have filled part of it
+    }
+    
+    int multipv = 1;
+    auto cache = cache_for(limits, multipv);
+    if (!cache) return false;
+    
+    uint64_t key = impl_->position_key();
+    bool hit = cache->lookup(key, limits, multipv, result);
+    if (!hit && limits.use_peer_cache && peer_cache_) {
+        hit = result.from_peer = peer_cache_->lookup(key, limits, multipv, result);
+    }
+    (hit ? metrics().cache_hits : metrics().cache_misses).add();
+    return hit;
+}
+
+// Runs on the search thread once a search that reached the engine ends.
+// get_hashfull() samples a thousand table entries, not the whole table.
+void StockfishEngine::record_search(int64_t nps, std::chrono::steady_clock::time_point started) const {
+    Metrics& m = metrics();
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    m.searches.add();
+    m.search_ms.observe(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    if (nps > 0) {
+        m.nps.observe(static_cast<uint64_t>(nps));
+    }
+    m.hashfull.observe(static_cast<uint64_t>(std::max(0, impl_->get_hashfull())));
+}
+
+size_t StockfishEngine::memory_bytes() const {
+    if (!ready_) return 0;
+    auto it = applied_options_.find("Hash");
+    size_t hash_mb = 16;  // Stockfish's default
+    if (it != applied_options_.end()) {
+        try {
+            hash_mb = static_cast<size_t>(std::max(1, std::stoi(it->second)));
+        } catch (const std::exception&) {
+        }
+    }
+    return hash_mb * 1024 * 1024;
+}
+
+// Moves the gauge by the change in this engine's memory since last counted
+void StockfishEngine::count_memory() {
+    int64_t now = static_cast<int64_t>(memory_bytes());
+    metrics().memory_bytes.add(now - counted_memory_);
+    counted_memory_ = now;
+}
+
+void StockfishEngine::set_analysis_cache(std::shared_ptr<AnalysisCache> cache) {
+    cache_ = std::move(cache);
+}
+
+void StockfishEngine::set_scheduler(std::shared_ptr<ThreadScheduler> scheduler, size_t node) {
+    scheduler_ = std::move(scheduler);
+    scheduler_node_ = node;
+}
+
+// Waits for this engine's CPUs and returns on_complete wrapped to give
+// them back first, so a search started from it finds them free. Unchanged
+// without a scheduler.
+StockfishEngine::SearchCallback StockfishEngine::hold_cpus(SearchCallback on_complete) {
+    if (!scheduler_) return on_complete;
+    
+    auto grant = std::make_shared<ThreadScheduler::Grant>(scheduler_->acquire(search_threads(), scheduler_node_));
+    return [grant, next = std::move(on_complete)](const SearchResult& done) {
+        grant->release();
+        if (next) {
+            next(done);
+        }
+    };
+}
+
+void StockfishEngine::set_peer_cache(std::shared_ptr<AnalysisCache> cache) {
+    peer_cache_ = std::move(cache);
+}
+
+bool StockfishEngine::seed_cache(const SearchResult& result) {
+    if (!peer_cache_ || !ready_ || result.final_info.depth <= 0 || !is_legal_move(result.best_move)) {
+        return false;
+    }
+    for (const auto& line : result.lines) {
+        if (!line.pv.empty() && !is_legal_move(line.pv.front())) return false;
+    }
+    
+    int multipv = std::max<int>(1, static_cast<int>(result.lines.size()));
+    peer_cache_->insert(impl_->position_key(), multipv, result);
+    return true;
+}
+
+// The cache for a search with these limits, if it may use one, and the
+// number of lines the search produces
+std::shared_ptr<AnalysisCache> StockfishEngine::cache_for(const SearchLimits& limits, int& multipv) const {
+    if (!cache_ || !ready_ || !AnalysisCache::cacheable(limits)) return nullptr;
+    
+    auto option = [this](const char* name, const char* fallback) {
+        auto it = applied_options_.find(name);
+        return it != applied_options_.end() ? it->second : std::string(fallback);
+    };
+    if (option("UCI_LimitStrength", "false") == "true" || option("Skill Level", "20") != "20") {
+        return nullptr;
+    }
+    
+    try {
+        multipv = std::max(1, std::stoi(option("MultiPV", "1")));
+    } catch (const std::exception&) {
+        multipv = 1;
+    }
+    return cache_;
+}
+
+// Fill result from the book. A key collision can map to a move that is
+// illegal here, so every book move is checked before it is played.
+bool StockfishEngine::book_move(const SearchLimits& limits, SearchResult& result) {
+    if (!book_ || !limits.use_book || !ready_) return false;
+    
+    // splitmix64: cheap, and good enough to spread a weighted choice
+    book_random_ += 0x9e3779b97f4a7c15ULL;
+    uint64_t random = book_random_;
+    random = (random ^ (random >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    random = (random ^ (random >> 27)) * 0x94d049bb133111ebULL;
+    random ^= random >> 31;
+    
+    BookEntry entry;
+    if (!book_->pick(impl_->position_key(), random, entry) || !impl_->is_legal_move(entry.move)) {
+        return false;
+    }
+    
+    result.best_move = Utils::packed_move_to_uci(entry.move);
+    result.from_book = true;
+    
+    if (impl_->push_move(result.best_move)) {
+        auto replies = book_moves();
+        if (!replies.empty()) {
+            result.ponder_move = Utils::packed_move_to_uci(replies.front().move);
+        }
+        impl_->pop_move();
+    }
+    return true;
 }
 
 bool StockfishEngine::set_option(const std::string& name, const std::string& value) {
-    std::cout << "Setting option " << name << " = " << value << std::endl;
+    if (!impl_->set_option(name, value)) {
+        return false;
+    }
+    applied_options_[name] = value;
+    if (name == "Hash") {
+        count_memory();
+    }
+    return true;
+}
+
+// Hash of the temporary engines analyze_game() starts, in MB: Stockfish's
+// default
+static constexpr size_t HelperHashMb = 16;
+
+// Threads a search on this engine runs, from its options
+size_t StockfishEngine::search_threads() const {
+    auto it = applied_options_.find("Threads");
+    if (it != applied_options_.end()) {
+        try {
+            return static_cast<size_t>(std::max(1, std::stoi(it->second)));
+        } catch (const std::exception&) {
+        }
+    }
+    return 1;
+}
+
+// Search plies [first, last] of the game on one engine, last to first, so
+// every search reuses the hash of the later positions. out is pre-sized.
+static bool analyze_range(StockfishEngine& engine, const std::string& start_fen,
+                          const std::vector<std::string>& moves, size_t first, size_t last,
+                          const SearchLimits& limits, std::vector<PlyAnalysis>& out) {
+    std::vector<std::string> prefix(moves.begin(), moves.begin() + last);
+    if (!engine.set_position_with_moves(start_fen, prefix)) {
+        return false;
+    }
+    
+    // One arena for the range: after the first search or two it has the
+    // room it needs, and only the kept lines are unpacked
+    SearchArena arena;
+    for (size_t ply = last + 1; ply-- > first; ) {
+        if (engine.search_into(limits, arena)) {
+            if (arena.best_move != 0) {
+                out[ply].best_move = Utils::packed_move_to_uci(arena.best_move);
+            }
+            if (const PackedInfo* final_info = arena.final_info()) {
+                out[ply].info = arena.info(*final_info);
+            }
+        }
+        if (ply > first) {
+            engine.pop_move();
+        }
+    }
     return true;
 }
 
+std::vector<PlyAnalysis> StockfishEngine::analyze_game(const std::string& start_fen,
+                                                       const std::vector<std::string>& moves,
+                                                       const SearchLimits& limits,
+                                                       int workers) {
+    std::vector<PlyAnalysis> out;
+    if (!ready_ || !set_position(start_fen)) {
+        return out;
+    }
+    
+    // Review needs real evaluations, even of book positions
+    SearchLimits search_limits = limits;
+    search_limits.use_book = false;
+    
+    // Keep only the legal prefix of the move list
+    std::vector<std::string> legal;
+    legal.reserve(moves.size());
+    for (const auto& move : moves) {
+        if (!push_move(move)) break;
+        legal.push_back(move);
+    }
+    
+    const size_t plies = legal.size() + 1;
+    out.resize(plies);
+    for (size_t ply = 0; ply < plies; ++ply) {
+        out[ply].ply = static_cast<int>(ply);
+        if (ply > 0) out[ply].move = legal[ply - 1];
+    }
+    
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(workers > 0 ? workers : 1, plies));
+    const size_t per_chunk = (plies + chunks - 1) / chunks;
+    
+    // Helpers are outside any pool's Hash budget, so they get a small
+    // table rather than a copy of this engine's. They share this engine's
+    // threads too, and its scheduler counts them.
+    const int helper_hash = static_cast<int>(std::min<size_t>(memory_bytes() / (1024 * 1024), HelperHashMb));
+    const int helper_threads = static_cast<int>(std::max<size_t>(1, search_threads() / chunks));
+    
+    // Chunk 0 stays on this engine; the others get a helper engine each
+    std::vector<std::thread> helpers;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    std::vector<char> started(chunks, 0);  // Per helper, not vector<bool>: written from its thread
+    for (size_t c = 1; c < chunks; ++c) {
+        size_t first = c * per_chunk;
+        if (first >= plies) break;
+        size_t last = std::min(plies, first + per_chunk) - 1;
+        ranges.emplace_back(first, last);
+        
+        helpers.emplace_back([&, first, last, slot = ranges.size() - 1] {
+            StockfishEngine helper;
+            if (!helper.initialize()) return;
+            for (const auto& [name, value] : applied_options_) {
+                if (name != "Hash" && name != "Threads") helper.set_option(name, value);
+            }
+            helper.set_option("Hash", helper_hash);
+            helper.set_option("Threads", helper_threads);
+            helper.set_scheduler(scheduler_, scheduler_node_);
+            started[slot] = true;
+            analyze_range(helper, start_fen, legal, first, last, search_limits, out);
+        });
+    }
+    
+    analyze_range(*this, start_fen, legal, 0, std::min(plies, per_chunk) - 1, search_limits, out);
+    
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+    
+    // Chunks whose helper never started are searched here instead
+    for (size_t slot = 0; slot < ranges.size(); ++slot) {
+        if (!started[slot]) {
+            BINDING_LOG(Warn, "analyze_game: helper failed to start, searching plies "
+                        << ranges[slot].first << "-" << ranges[slot].second << " here");
+            analyze_range(*this, start_fen, legal, ranges[slot].first, ranges[slot].second, search_limits, out);
+        }
+    }
+    
+    set_position_with_moves(start_fen, legal);
+    return out;
+}
+
+PackedResults StockfishEngine::pack_infos(const std::string& root_fen, const std::vector<SearchInfo>& infos) const {
+    return impl_->pack_infos(root_fen, infos);
+}
+
+PackedResults StockfishEngine::pack_game_analysis(const std::string& start_fen, const std::vector<PlyAnalysis>& plies) const {
+    return impl_->pack_game_analysis(start_fen, plies);
+}
+
 bool StockfishEngine::set_option(const std::string& name, int value) {
     return set_option(name, std::to_string(value));
 }
 
 bool StockfishEngine::set_option(const std::string& name, bool value) {
-    return set_option(name, value ? "true" : "false");
+    return set_option(name, std::string(value ? "true" : "false"));
+}
+
+// Strength
+
+// Stockfish's Skill: the level an Elo maps to, fitted to its rating tests
+Strength Strength::from_elo(int elo) {
+    double e = double(std::clamp(elo, MinElo, MaxElo) - MinElo) / (MaxElo - MinElo);
+    double level = ((37.2473 * e - 40.8525) * e + 22.2943) * e - 0.311438;
+    return from_skill_level(std::clamp(level, 0.0, 19.0));
+}
+
+// The node budget is roughly what a four-line search needs to finish the
+// picking depth, so it only cuts searches that would run long there:
+// 2,000 nodes at level 0, about 200,000 at 10 and 15 million at 19
+Strength Strength::from_skill_level(double level) {
+    Strength strength;
+    strength.level = std::clamp(level, 0.0, 20.0);
+    strength.limited = strength.level < 20.0;
+    if (strength.limited) {
+        strength.depth = 1 + static_cast<int>(strength.level);
+        strength.nodes = static_cast<int64_t>(2000 * std::pow(1.6, strength.level));
+    }
+    return strength;
+}
+
+SearchLimits Strength::apply(SearchLimits limits) const {
+    if (!limited || limits.infinite || limits.mate > 0) return limits;
+    
+    limits.depth = limits.depth > 0 ? std::min(limits.depth, depth) : depth;
+    limits.nodes = limits.nodes > 0 ? std::min(limits.nodes, nodes) : nodes;
+    return limits;
+}
+
+Strength StockfishEngine::strength() const {
+    auto option = [this](const char* name) {
+        auto it = applied_options_.find(name);
+        return it != applied_options_.end() ? it->second : std::string();
+    };
+    
+    try {
+        if (option("UCI_LimitStrength") == "true") {
+            std::string elo = option("UCI_Elo");
+            return Strength::from_elo(elo.empty() ? Strength::MinElo : std::stoi(elo));
+        }
+        std::string level = option("Skill Level");
+        return Strength::from_skill_level(level.empty() ? 20.0 : std::stod(level));
+    } catch (const std::exception&) {
+        return Strength();
+    }
+}
+
+bool StockfishEngine::set_strength(int elo) {
+    if (elo <= 0 || elo >= Strength::MaxElo) {
+        return set_option("UCI_LimitStrength", false) && set_option("Skill Level", 20);
+    }
+    return set_option("UCI_Elo", std::max(elo, Strength::MinElo)) && set_option("UCI_LimitStrength", true);
+}
+
+void StockfishEngine::new_game() {
+    impl_->new_game();
+}
+
+TablebaseProbe StockfishEngine::probe_tablebase() {
+    return impl_->probe_tablebase();
+}
+
+int StockfishEngine::get_hashfull() const {
+    return impl_->get_hashfull();
 }
 
 int StockfishEngine::evaluate_current_position() {
     return impl_->evaluate_current_position();
 }
 
+std::vector<int> StockfishEngine::evaluate_many(const std::vector<std::string>& fens) {
+    return impl_->evaluate_many(fens);
+}
+
 std::vector<std::string> StockfishEngine::get_legal_moves() {
     return impl_->get_legal_moves();
 }
 
+size_t StockfishEngine::get_legal_moves(uint16_t* out, size_t capacity) {
+    return impl_->get_legal_moves(out, capacity);
+}
+
 bool StockfishEngine::is_legal_move(const std::string& move) {
-    auto moves = get_legal_moves();
-    return std::find(moves.begin(), moves.end(), move) != moves.end();
+    return impl_->is_legal_move(move);
+}
+
+bool StockfishEngine::is_legal_move(uint16_t packed_move) {
+    return impl_->is_legal_move(packed_move);
+}
+
+PerftResult StockfishEngine::perft(int depth, const PerftOptions& options) {
+    if (!ready_ || depth < 0) return PerftResult();
+    
+    auto started = std::chrono::steady_clock::now();
+    PerftResult result = impl_->perft(depth, std::max(1, options.threads), options.hash_mb);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    
+    result.time_ms = elapsed.count() / 1000;
+    if (elapsed.count() > 0) {
+        result.nps = static_cast<int64_t>(result.nodes * 1000000.0 / elapsed.count());
+    }
+    return result;
 }
 
 bool StockfishEngine::is_check() {
-    return false; // Stub
+    return impl_->is_check();
 }
 
 bool StockfishEngine::is_checkmate() {
-    return false; // Stub
+    return impl_->is_checkmate();
 }
 
 bool StockfishEngine::is_stalemate() {
-    return false; // Stub
+    return impl_->is_stalemate();
 }
 
 bool StockfishEngine::is_draw() {
-    return false; // Stub
+    return impl_->is_draw();
 }
 
 void StockfishEngine::set_info_callback(InfoCallback callback) {
-    info_callback_ = callback;
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    info_callback_ = std::move(callback);
+    impl_->set_info_wanted(bool(info_callback_), bool(packed_info_callback_));
+}
+
+void StockfishEngine::set_packed_info_callback(PackedInfoCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    packed_info_callback_ = std::move(callback);
+    impl_->set_info_wanted(bool(info_callback_), bool(packed_info_callback_));
+}
+
+void StockfishEngine::set_info_interval(int interval_ms) {
+    impl_->set_info_interval(interval_ms);
 }
 
 void StockfishEngine::on_search_info(const SearchInfo& info) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
     if (info_callback_) {
         info_callback_(info);
     }
 }
 
+void StockfishEngine::on_packed_info(const SearchArena& arena, const PackedInfo& record) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (packed_info_callback_) {
+        packed_info_callback_(arena, record);
+    }
+}
+
 // Utility functions
 namespace Utils {
     std::string move_to_uci(const std::string& from, const std::string& to, const std::string& promotion) {
@@ -351,15 +2698,29 @@ namespace Utils {
         return true;
     }
     
-    std::string fen_after_move(const std::string& fen, const std::string& move) {
-        // Stub implementation
-        return fen;
+    std::string packed_move_to_uci(uint16_t packed) {
+        int from = (packed >> 6) & 0x3F;
+        int to = packed & 0x3F;
+        int type = packed >> 14;
+        if (from == to) return "0000";  // Move::none() / Move::null()
+        
+        // Stockfish stores castling as king-takes-rook
+        if (type == 3) {
+            to = (to > from ? 6 : 2) + (from & ~7);
+        }
+        
+        std::string uci = {
+            char('a' + (from & 7)), char('1' + (from >> 3)),
+            char('a' + (to & 7)), char('1' + (to >> 3))
+        };
+        if (type == 1) {
+            uci += "nbrq"[(packed >> 12) & 3];
+        }
+        return uci;
     }
     
-    bool is_valid_fen(const std::string& fen) {
-        // Basic validation
-        return fen.find(' ') != std::string::npos;
-    }
+    // fen_after_move() and is_valid_fen() are in pgn_codec.cpp, with the
+    // rest of the notation code
 }
 
 } // namespace StockfishBinding
\ No newline at end of file
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include "opening_book.h"
 
 namespace StockfishBinding {
 
+class AnalysisCache;
+class ThreadScheduler;
+
+inline constexpr const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
 struct SearchInfo {
     int depth = 0;
     int seldepth = 0;
@@ -21,11 +34,201 @@ struct SearchInfo {
     int hashfull = 0;
 };
 
+// Search limits, mirroring the UCI "go" parameters. Zero means "not set";
+// a search with no limit at all runs until stop_search().
+struct SearchLimits {
+    int depth = 0;
+    int64_t nodes = 0;
+    int movetime_ms = 0;
+    int mate = 0;
+    
+    // Clock-based time management
+    int wtime_ms = 0;
+    int btime_ms = 0;
+    int winc_ms = 0;
+    int binc_ms = 0;
+    int movestogo = 0;
+    
+    bool infinite = false;
+    
+    // Answer from the opening book, if one is set, without searching
+    bool use_book = true;
+    
+    // Answer tablebase positions from a root probe, without searching
+    bool use_tablebase = true;
+    
+    // Serve and store the result through the analysis cache, if one is set
+    bool use_cache = true;
+    
+    // Also accept an answer seeded from peers (see seed_cache()). Peer data
+    // is unverified, so only reviews and displays should ask for it, never
+    // searches whose move is played.
+    bool use_peer_cache = false;
+};
+
+// Playing strength set through Skill Level, or UCI_LimitStrength with
+// UCI_Elo. Below level 20 Stockfish searches four lines and, at depth
+// 1 + level, picks among them with an error that grows as the level drops;
+// deeper iterations cannot change that pick. So a limited search stops at
+// that depth, and within a node budget that grows with the level.
+struct Strength {
+    bool limited = false;
+    double level = 20.0;  // 0 to 20, fractional when derived from an Elo
+    int depth = 0;        // Depth cap, 0 at full strength
+    int64_t nodes = 0;    // Node cap, 0 at full strength
+
+    // Stockfish's UCI_Elo range
+    static constexpr int MinElo = 1320;
+    static constexpr int MaxElo = 3190;
+
+    static Strength from_skill_level(double level);
+    static Strength from_elo(int elo);
+
+    // limits with the caps applied; infinite and mate searches are left
+    // alone, as are tighter caps of the caller's
+    SearchLimits apply(SearchLimits limits) const;
+};
+
+// Syzygy result for the side to move. wdl is -2 loss, -1 loss saved by the
+// 50-move rule, 0 draw, 1 win spoiled by the 50-move rule, 2 win; dtz
+// counts plies to the next zeroing move and needs the DTZ tables.
+struct TablebaseProbe {
+    bool found = false;
+    bool has_dtz = false;
+    int wdl = 0;
+    int dtz = 0;
+};
+
 struct SearchResult {
     std::string best_move;
     std::string ponder_move;
-    SearchInfo final_info;
-    std::vector<SearchInfo> all_info;
+    SearchInfo final_info;            // Newest update of the best line
+    std::vector<SearchInfo> all_info; // Every update, all lines and depths; empty for infinite searches
+    
+    // Newest update of each line under MultiPV, best line first: lines[i]
+    // has multipv == i + 1. The per-depth history of a line is in all_info.
+    std::vector<SearchInfo> lines;
+    
+    // best_move was taken from the opening book; no search ran, so there
+    // is no info and ponder_move is the book's main reply, if any
+    bool from_book = false;
+    
+    // best_move and lines come from a tablebase root probe, with the probe
+    // itself in tablebase: the scores are exact and no search ran
+    bool from_tablebase = false;
+    TablebaseProbe tablebase;
+    
+    // Served from the analysis cache; the search behind it may have gone
+    // deeper than asked, and infos were not streamed
+    bool from_cache = false;
+    
+    // Served from the peer cache: from_cache is set too, and nothing of
+    // it was searched or checked here beyond move legality
+    bool from_peer = false;
+    
+    // stop() or stop_pondering() ended the search before its limits, so
+    // the result is partial and is not cached
+    bool stopped = false;
+};
+
+// One analysed position of a game. Ply n is the position after n moves,
+// so a game of N moves yields N + 1 entries.
+struct PlyAnalysis {
+    int ply = 0;
+    std::string move;       // Move that led here, empty at ply 0
+    std::string best_move;
+    SearchInfo info;
+};
+
+// Compact binary form of search output for bulk transfer, e.g. to JS as a
+// typed array view. Moves use the packed 16-bit encoding described at
+// get_legal_moves(); principal variations live in a shared move arena.
+// The layout is fixed and free of padding.
+struct PackedInfo {
+    int64_t nodes;
+    int64_t nps;
+    int32_t time_ms;
+    int32_t score;         // Centipawns, or moves to mate with PackedMate
+    uint32_t pv_offset;    // First PV move in PackedResults::moves
+    uint16_t pv_length;
+    uint16_t depth;
+    uint16_t seldepth;
+    uint16_t multipv;
+    uint16_t hashfull;
+    uint16_t flags;
+    uint16_t move;         // Move that led to the position, 0 if none
+    uint16_t best_move;
+    uint32_t ply;
+};
+static_assert(sizeof(PackedInfo) == 48, "PackedInfo layout is shared with JS");
+
+constexpr uint16_t PackedMate = 1;  // PackedInfo::flags
+
+struct PackedResults {
+    std::vector<PackedInfo> records;
+    std::vector<uint16_t> moves;
+};
+
+// Reusable storage for the output of search_into(), for callers that search
+// again and again. Every update is a PackedInfo record, its PV (at most
+// MaxPv moves) in the shared move arena; lines[i] is the index of the
+// newest record of MultiPV line i + 1. clear() keeps the capacity, so once
+// an arena has held a search as long as the next one, filling it takes no
+// heap allocation. Without keep_history an arena holds one record per line,
+// overwritten by each update with its PV in a fixed MaxPv slot, so a search
+// of any length (infinite, ponder) fits once every line has been seen.
+struct SearchArena {
+    static constexpr size_t MaxPv = 64;
+
+    PackedResults packed;
+    std::vector<uint32_t> lines;
+    bool keep_history = true;  // Kept by clear()
+    uint16_t best_move = 0;    // Packed, 0 if there is none
+    uint16_t ponder_move = 0;
+    bool from_book = false;
+    bool from_tablebase = false;
+    bool from_cache = false;
+    bool stopped = false;      // As in SearchResult
+
+    void clear() {
+        packed.records.clear();
+        packed.moves.clear();
+        lines.clear();
+        best_move = ponder_move = 0;
+        from_book = from_tablebase = from_cache = stopped = false;
+    }
+
+    // Room for this many updates of full-length PVs
+    void reserve(size_t records) {
+        packed.records.reserve(records);
+        packed.moves.reserve(records * MaxPv);
+    }
+
+    // Newest record of line 1, nullptr before the first update
+    const PackedInfo* final_info() const {
+        return lines.empty() ? nullptr : &packed.records[lines.front()];
+    }
+
+    const uint16_t* pv(const PackedInfo& record) const {
+        return packed.moves.data() + record.pv_offset;
+    }
+
+    // Unpacked copies, for callers that want strings once the search is done
+    SearchInfo info(const PackedInfo& record) const;
+    static SearchInfo unpack(const PackedInfo& record, const uint16_t* pv);
+    SearchResult to_result() const;  // all_info stays empty
+};
+
+struct PerftOptions {
+    int threads = 1;     // Root moves are shared out among this many threads
+    size_t hash_mb = 0;  // Table of subtree counts shared by the threads, 0 for none
+};
+
+struct PerftResult {
+    uint64_t nodes = 0;  // Leaves of the tree
+    std::vector<std::pair<std::string, uint64_t>> divide;  // Leaves under each root move
+    int64_t time_ms = 0;
+    int64_t nps = 0;     // Leaves per second
 };
 
 class StockfishEngine {
@@ -37,29 +240,191 @@ public:
     bool initialize();
     void shutdown();
     bool is_ready() const { return ready_; }
+    
+    // ucinewgame: stop any search, clear hash and history and go back to
+    // the start position, so the next game starts cold without recreating
+    // the engine
+    void new_game();
+    
+    // Start-up is building Stockfish's engine, mostly decoding the
+    // networks. shutdown() keeps its engine for the next initialize() in
+    // the process, with default options and a cleared hash, so a new game
+    // on a fresh StockfishEngine starts in milliseconds. prewarm() builds
+    // count engines ahead on a background thread, and keeps that many
+    // ready as initialize() takes them. Engine memory stays allocated
+    // while parked.
+    static void prewarm(size_t count);
 
     // Position management
     bool set_position(const std::string& fen);
     bool set_position_with_moves(const std::string& fen, const std::vector<std::string>& moves);
     bool set_startpos_with_moves(const std::vector<std::string>& moves);
+    
+    // Incremental updates: play or take back one move on the current
+    // position without re-parsing the FEN. Illegal moves are rejected.
+    bool push_move(const std::string& uci_move);
+    bool pop_move();
+    std::string get_fen() const;
+    
+    // The position as set: its root and the moves played from it, for
+    // set_position_with_moves() to restore
+    std::string get_root_fen() const;
+    std::vector<std::string> get_moves() const;
+    
+    // Zobrist key of the current position, as used by opening books
+    uint64_t position_key() const;
+    
+    // Packed move for a SAN string ("Nf3", "exd5", "O-O", "e8=Q+") on the
+    // current position, or 0 if it is illegal or ambiguous
+    uint16_t parse_san(const std::string& san) const;
 
     // Search operations
     SearchResult search(int depth);
+    SearchResult search(const SearchLimits& limits);
     SearchResult search_time(int time_ms);
     SearchResult search_nodes(int64_t nodes);
+    SearchResult search_clock(int wtime_ms, int btime_ms, int winc_ms = 0, int binc_ms = 0, int movestogo = 0);
+
+    // Non-blocking search. The search runs on the engine's own threads and
+    // on_complete fires from the search thread once bestmove is known; it
+    // must not start another search on this engine. Starting a search while
+    // one is running stops the old one, whose future resolves with its
+    // partial result.
+    using SearchCallback = std::function<void(const SearchResult&)>;
+    std::future<SearchResult> search_async(int depth, SearchCallback on_complete = nullptr);
+    std::future<SearchResult> search_async(const SearchLimits& limits, SearchCallback on_complete = nullptr);
     void stop_search();
+    bool is_searching() const;
+    
+    // Blocking search into a reusable arena instead of a new SearchResult.
+    // Book, tablebase and cache answers and strength caps apply as for
+    // search(). Updates are packed straight from Stockfish's buffers and go
+    // to the packed info callback, so apart from Stockfish's own per-search
+    // setup, no allocation is made once the arena has grown to size.
+    // Ponder searches are not supported. False if the engine cannot search.
+    bool search_into(const SearchLimits& limits, SearchArena& arena);
+    
+    // Thinking on the opponent's time. ponder_async() plays the expected
+    // reply (usually the last result's ponder_move) on the current position
+    // and searches from there in ponder mode, where the limits' clock does
+    // not run out until ponder_hit(). If the opponent plays that move,
+    // ponder_hit() turns the search into a normal one that keeps its tree
+    // and the time already spent, and the future resolves with the answer.
+    // Otherwise stop_pondering() abandons the search and takes the expected
+    // move back, leaving the position the opponent actually faced.
+    // An illegal expected move resolves the future at once, empty.
+    std::future<SearchResult> ponder_async(const std::string& expected_move, const SearchLimits& limits,
+                                           SearchCallback on_complete = nullptr);
+    bool ponder_hit();
+    void stop_pondering();
+    bool is_pondering() const;
+    
+    // Opening book consulted by every search whose limits have use_book
+    // set. While the position is in book the search returns a weighted
+    // random book move at once, with from_book set. Refuses books keyed by
+    // a different hashing scheme; nullptr removes the book.
+    bool set_book(std::shared_ptr<const OpeningBook> book);
+    
+    // Legal book moves of the current position, heaviest first
+    std::vector<BookEntry> book_moves() const;
+    
+    // CPUs for this engine's searches: each search, ponder included, holds
+    // as many of the scheduler's CPUs as the engine runs Threads, preferring
+    // node, from start to bestmove, and waits for them to start. EnginePool
+    // sets this for its engines. nullptr runs searches unmetered.
+    void set_scheduler(std::shared_ptr<ThreadScheduler> scheduler, size_t node);
+    
+    // Cache consulted before, and filled after, every repeatable search
+    // (see AnalysisCache::cacheable()). Engines playing at reduced
+    // strength neither read nor write it. nullptr detaches the cache.
+    void set_analysis_cache(std::shared_ptr<AnalysisCache> cache);
+    
+    // Cache of results computed elsewhere, such as analyses replicated from
+    // peers. Kept apart from the analysis cache: it only answers searches
+    // with use_peer_cache set. nullptr detaches it.
+    void set_peer_cache(std::shared_ptr<AnalysisCache> cache);
+    
+    // Adds a result computed elsewhere (say, by a peer) for the current
+    // position to the peer cache, one line per MultiPV index. Refused
+    // unless the best move and the first move of every line are legal here.
+    bool seed_cache(const SearchResult& result);
+    
+    // Whole-game review in one call. Plies are searched from the end of the
+    // game backwards so each search starts from a hash already filled by the
+    // positions that follow it. With workers > 1 the game is cut into
+    // contiguous chunks and each extra chunk runs on a temporary engine
+    // with this engine's options, but a Hash of at most 16 MB so helpers
+    // stay small beside a pool's budget, and this engine's Threads split
+    // between the workers. Helpers take their CPUs from this engine's
+    // scheduler, if it has one. A chunk whose helper fails to
+    // start is searched here afterwards. Stops at the first illegal move; leaves
+    // this engine at the final position of the analysed moves.
+    std::vector<PlyAnalysis> analyze_game(const std::string& start_fen,
+                                          const std::vector<std::string>& moves,
+                                          const SearchLimits& limits,
+                                          int workers = 1);
+
+    // Pack search output. PV moves are validated against the position they
+    // were searched from, and a PV is cut at its first unplayable move.
+    // pack_infos() takes the root of every info; pack_game_analysis() the
+    // start of the game given to analyze_game().
+    PackedResults pack_infos(const std::string& root_fen, const std::vector<SearchInfo>& infos) const;
+    PackedResults pack_game_analysis(const std::string& start_fen, const std::vector<PlyAnalysis>& plies) const;
 
-    // Engine options
+    // Engine options. Returns false for options the engine does not know.
+    // Waits for a running search to stop before applying.
     bool set_option(const std::string& name, const std::string& value);
     bool set_option(const std::string& name, int value);
     bool set_option(const std::string& name, bool value);
 
-    // Evaluation
+    // Current strength, from the options above. set_strength(elo) sets
+    // UCI_LimitStrength and UCI_Elo; an Elo of 0, or MaxElo and above,
+    // returns to full strength.
+    Strength strength() const;
+    bool set_strength(int elo);
+
+    // Syzygy tables are loaded with set_option("SyzygyPath", dirs), which
+    // maps them once for the whole process and shares them with every
+    // engine. A different path waits for searches on all engines to end;
+    // searches started meanwhile run without tables and probes miss, so
+    // only the loading thread waits. load_tablebases() is the same load
+    // without an engine, for a thread other than the one searching.
+    // probe_tablebase() looks the current position up without a search.
+    static bool load_tablebases(const std::string& path);
+    TablebaseProbe probe_tablebase();
+    
+    // Transposition table fill, in permille, as reported by "info hashfull"
+    int get_hashfull() const;
+    
+    // Memory this engine's options allocate: its transposition table, the
+    // part that grows with Hash. 0 until initialized. Summed over engines
+    // in metrics().memory_bytes.
+    size_t memory_bytes() const;
+    
+    // Static NNUE evaluation in centipawns for the side to move, without a
+    // search. In check, where static eval is undefined, the current position
+    // falls back to a 1-ply search and evaluate_many() reports NoEvaluation
+    // (as it does for invalid FENs).
+    static constexpr int NoEvaluation = -32768;
     int evaluate_current_position();
+    std::vector<int> evaluate_many(const std::vector<std::string>& fens);
     
-    // Move generation and validation
+    // Move generation and validation. The packed form is Stockfish's own
+    // 16-bit encoding (to square in bits 0-5, from in 6-11, promotion piece
+    // in 12-13, move type in 14-15; castling is stored king-takes-rook) and
+    // involves no allocation. The buffer overload writes at most capacity
+    // moves; MaxMoves always suffices.
+    static constexpr size_t MaxMoves = 256;
     std::vector<std::string> get_legal_moves();
+    size_t get_legal_moves(uint16_t* out, size_t capacity);
     bool is_legal_move(const std::string& move);
+    bool is_legal_move(uint16_t packed_move);
+    
+    // Counts the leaves of the legal move tree depth plies below the
+    // current position, the standard check of a move generator against
+    // published counts. Threads split the root moves between them; with a
+    // hash, subtrees reached by transposition are counted once.
+    PerftResult perft(int depth, const PerftOptions& options = PerftOptions());
     
     // Game state queries
     bool is_check();
@@ -67,17 +432,51 @@ public:
     bool is_stalemate();
     bool is_draw();
     
-    // Callbacks for search info
+    // Callbacks for search info. The callback runs on the search thread for
+    // every depth/PV update. Callbacks may be set or cleared from any thread,
+    // during a search too: a delivery under way finishes first, and none
+    // starts once the call returns, so a callback must not set callbacks
+    // itself. A non-zero interval coalesces updates so at most one is
+    // delivered per window, always the newest, and the last line is
+    // flushed before bestmove.
+    // SearchResult::all_info still records every update.
     using InfoCallback = std::function<void(const SearchInfo&)>;
     void set_info_callback(InfoCallback callback);
+    void set_info_interval(int interval_ms);
+    
+    // The same in packed form, throttled alike: for search_into() in the
+    // caller's arena, and for async and ponder searches in a per-line arena
+    // of the engine's (see SearchArena::keep_history), so streaming a long
+    // search allocates nothing. The record lives in the arena and may move
+    // or be overwritten once the callback returns.
+    using PackedInfoCallback = std::function<void(const SearchArena&, const PackedInfo&)>;
+    void set_packed_info_callback(PackedInfoCallback callback);
 
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
     bool ready_;
+    std::mutex callback_mutex_;  // Held for every delivery, see set_info_callback()
     InfoCallback info_callback_;
+    PackedInfoCallback packed_info_callback_;
+    std::map<std::string, std::string> applied_options_;  // Replayed on helper engines
+    std::shared_ptr<const OpeningBook> book_;
+    uint64_t book_random_;
+    std::shared_ptr<AnalysisCache> cache_;
+    std::shared_ptr<AnalysisCache> peer_cache_;
+    std::shared_ptr<ThreadScheduler> scheduler_;
+    size_t scheduler_node_ = 0;
+    int64_t counted_memory_ = 0;  // This engine's share of metrics().memory_bytes
     
     void on_search_info(const SearchInfo& info);
+    void on_packed_info(const SearchArena& arena, const PackedInfo& record);
+    void count_memory();
+    void record_search(int64_t nps, std::chrono::steady_clock::time_point started) const;
+    bool book_move(const SearchLimits& limits, SearchResult& result);
+    bool instant_result(const SearchLimits& limits, SearchResult& result);
+    std::shared_ptr<AnalysisCache> cache_for(const SearchLimits& limits, int& multipv) const;
+    SearchCallback hold_cpus(SearchCallback on_complete);
+    size_t search_threads() const;
 };
 
 // Utility functions
@@ -85,6 +484,7 @@ namespace Utils {
     std::string move_to_uci(const std::string& from, const std::string& to, const std::string& promotion = "");
     bool parse_uci_move(const std::string& uci, std::string& from, std::string& to, std::string& promotion);
     std::string fen_after_move(const std::string& fen, const std::string& move);
+    std::string packed_move_to_uci(uint16_t packed_move);
     bool is_valid_fen(const std::string& fen);
 }
 
@@ -1,365 +0,0 @@
-#include "stockfish_wrapper.h"
-#include <iostream>
-#include <sstream>
-#include <algorithm>
-#include <memory>
-
-// Include real Stockfish headers
-#include "bitboard.h"
-#include "engine.h"
-#include "position.h"
-#include "search.h"
-#include "thread.h"
-#include "tt.h"
-#include "uci.h"
-#include "evaluate.h"
-#include "movegen.h"
-#include "ucioption.h"
-
-using namespace Stockfish;
-
-namespace StockfishBinding {
-
-// Real Stockfish implementation
-class StockfishEngine::Impl {
-public:
-    bool initialize() {
-        try {
-            std::cout << "Initializing real Stockfish engine..." << std::endl;
-            
-            // Initialize Stockfish components in the correct order
-            UCI::init(Options);
-            Bitboards::init();
-            Position::init();
-            Threads.set(1);
-            Search::init();
-            Eval::NNUE::init();
-            
-            // Set up default position
-            pos_ = std::make_unique<Position>();
-            states_.emplace_back();
-            pos_->set(startFEN, false, &states_.back(), &Threads.main());
-            
-            initialized_ = true;
-            std::cout << "✅ Real Stockfish initialized successfully" << std::endl;
-            return true;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "❌ Stockfish initialization failed: " << e.what() << std::endl;
-            return false;
-        } catch (...) {
-            std::cerr << "❌ Stockfish initialization failed with unknown error" << std::endl;
-            return false;
-        }
-    }
-    
-    void shutdown() {
-        if (initialized_) {
-            std::cout << "Shutting down real Stockfish engine..." << std::endl;
-            
-            // Stop any ongoing search
-            Search::Signals.stop = true;
-            
-            // Clean up
-            pos_.reset();
-            states_.clear();
-            
-            initialized_ = false;
-            std::cout << "✅ Real Stockfish shutdown complete" << std::endl;
-        }
-    }
-    
-    bool set_position(const std::string& fen) {
-        if (!initialized_) {
-            return false;
-        }
-        
-        try {
-            std::cout << "Setting position to: " << fen << std::endl;
-            
-            // Add new state for this position
-            states_.emplace_back();
-            pos_->set(fen, false, &states_.back(), &Threads.main());
-            
-            current_fen_ = fen;
-            return true;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "❌ Failed to set position: " << e.what() << std::endl;
-            return false;
-        } catch (...) {
-            std::cerr << "❌ Failed to set position with unknown error" << std::endl;
-            return false;
-        }
-    }
-    
-    SearchResult search(int depth) {
-        if (!initialized_ || !pos_) {
-            SearchResult result;
-            result.best_move = "e2e4";  // Fallback
-            return result;
-        }
-        
-        try {
-            std::cout << "Searching to depth " << depth << std::endl;
-            
-            SearchResult result;
-            
-            // Set up search limits
-            Search::LimitsType limits;
-            limits.depth = depth;
-            limits.infinite = false;
-            
-            // Perform search
-            Threads.start_thinking(*pos_, states_, limits, false);
-            Threads.main()->wait_for_search_finished();
-            
-            // Get the best move
-            Move bestMove = Threads.main()->bestThread->bestMove;
-            if (bestMove != MOVE_NONE) {
-                result.best_move = UCI::move(bestMove, false);
-            } else {
-                result.best_move = "e2e4";  // Fallback
-            }
-            
-            // Get search info
-            result.final_info.depth = depth;
-            result.final_info.nodes = Threads.nodes_searched();
-            result.final_info.time_ms = Threads.main()->bestThread->elapsed_time().count();
-            result.final_info.nps = result.final_info.time_ms > 0 ? 
-                (result.final_info.nodes * 1000) / result.final_info.time_ms : 0;
-            
-            // Get evaluation score
-            Value eval = Threads.main()->bestThread->bestValue;
-            result.final_info.score_cp = eval;
-            result.final_info.is_mate = abs(eval) > VALUE_MATE_IN_MAX_PLY;
-            
-            if (result.final_info.is_mate) {
-                result.final_info.mate_in = (VALUE_MATE - abs(eval) + 1) / 2;
-                if (eval < 0) result.final_info.mate_in = -result.final_info.mate_in;
-            }
-            
-            std::cout << "✅ Search completed: " << result.best_move 
-                      << " (eval: " << eval << ", nodes: " << result.final_info.nodes << ")" << std::endl;
-            
-            return result;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "❌ Search failed: " << e.what() << std::endl;
-            SearchResult result;
-            result.best_move = "e2e4";  // Fallback
-            return result;
-        } catch (...) {
-            std::cerr << "❌ Search failed with unknown error" << std::endl;
-            SearchResult result;
-            result.best_move = "e2e4";  // Fallback
-            return result;
-        }
-    }
-    
-    int evaluate_current_position() {
-        if (!initialized_ || !pos_) {
-            return 25; // Fallback
-        }
-        
-        try {
-            Value eval = Eval::evaluate(*pos_);
-            return static_cast<int>(eval);
-        } catch (...) {
-            return 25; // Fallback
-        }
-    }
-    
-    std::vector<std::string> get_legal_moves() {
-        if (!initialized_ || !pos_) {
-            return {"e2e4", "d2d4", "g1f3", "b1c3"}; // Fallback
-        }
-        
-        try {
-            std::vector<std::string> moves;
-            ExtMove moveList[MAX_MOVES];
-            ExtMove* end = generate<LEGAL>(*pos_, moveList);
-            
-            for (ExtMove* it = moveList; it != end; ++it) {
-                moves.push_back(UCI::move(it->move, false));
-            }
-            
-            return moves;
-            
-        } catch (...) {
-            return {"e2e4", "d2d4", "g1f3", "b1c3"}; // Fallback
-        }
-    }
-    
-    bool set_option(const std::string& name, const std::string& value) {
-        try {
-            if (Options.count(name)) {
-                Options[name] = value;
-                return true;
-            }
-            return false;
-        } catch (...) {
-            return false;
-        }
-    }
-
-private:
-    bool initialized_ = false;
-    std::string current_fen_;
-    std::unique_ptr<Position> pos_;
-    std::deque<StateInfo> states_;
-    
-    static constexpr std::string_view startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-};
-
-// Update the main class implementation to use the real impl
-StockfishEngine::StockfishEngine() 
-    : impl_(std::make_unique<Impl>()), ready_(false) {
-}
-
-StockfishEngine::~StockfishEngine() {
-    if (ready_) {
-        shutdown();
-    }
-}
-
-bool StockfishEngine::initialize() {
-    ready_ = impl_->initialize();
-    return ready_;
-}
-
-void StockfishEngine::shutdown() {
-    if (ready_) {
-        impl_->shutdown();
-        ready_ = false;
-    }
-}
-
-bool StockfishEngine::set_position(const std::string& fen) {
-    return impl_->set_position(fen);
-}
-
-bool StockfishEngine::set_position_with_moves(const std::string& fen, const std::vector<std::string>& moves) {
-    if (!impl_->set_position(fen)) {
-        return false;
-    }
-    
-    // TODO: Apply moves by parsing and playing them on the position
-    // For now, just set the initial position
-    return true;
-}
-
-bool StockfishEngine::set_startpos_with_moves(const std::vector<std::string>& moves) {
-    return set_position_with_moves("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", moves);
-}
-
-SearchResult StockfishEngine::search(int depth) {
-    return impl_->search(depth);
-}
-
-SearchResult StockfishEngine::search_time(int time_ms) {
-    // For real implementation, convert time to appropriate depth
-    // This is a simplified approach
-    int depth = std::max(1, time_ms / 100);
-    return search(depth);
-}
-
-SearchResult StockfishEngine::search_nodes(int64_t nodes) {
-    // For real implementation, convert nodes to appropriate depth
-    // This is a simplified approach
-    int depth = std::max(1, static_cast<int>(nodes / 1000));
-    return search(depth);
-}
-
-void StockfishEngine::stop_search() {
-    // Signal Stockfish to stop searching
-    Search::Signals.stop = true;
-}
-
-bool StockfishEngine::set_option(const std::string& name, const std::string& value) {
-    return impl_->set_option(name, value);
-}
-
-bool StockfishEngine::set_option(const std::string& name, int value) {
-    return set_option(name, std::to_string(value));
-}
-
-bool StockfishEngine::set_option(const std::string& name, bool value) {
-    return set_option(name, value ? "true" : "false");
-}
-
-int StockfishEngine::evaluate_current_position() {
-    return impl_->evaluate_current_position();
-}
-
-std::vector<std::string> StockfishEngine::get_legal_moves() {
-    return impl_->get_legal_moves();
-}
-
-bool StockfishEngine::is_legal_move(const std::string& move) {
-    auto moves = get_legal_moves();
-    return std::find(moves.begin(), moves.end(), move) != moves.end();
-}
-
-bool StockfishEngine::is_check() {
-    if (!ready_ || !impl_) return false;
-    // TODO: Implement using pos_->checkers()
-    return false;
-}
-
-bool StockfishEngine::is_checkmate() {
-    if (!ready_ || !impl_) return false;
-    // TODO: Implement checkmate detection
-    return false;
-}
-
-bool StockfishEngine::is_stalemate() {
-    if (!ready_ || !impl_) return false;
-    // TODO: Implement stalemate detection
-    return false;
-}
-
-bool StockfishEngine::is_draw() {
-    if (!ready_ || !impl_) return false;
-    // TODO: Implement draw detection
-    return false;
-}
-
-void StockfishEngine::set_info_callback(InfoCallback callback) {
-    info_callback_ = callback;
-}
-
-void StockfishEngine::on_search_info(const SearchInfo& info) {
-    if (info_callback_) {
-        info_callback_(info);
-    }
-}
-
-// Utility functions remain mostly the same
-namespace Utils {
-    std::string move_to_uci(const std::string& from, const std::string& to, const std::string& promotion) {
-        return from + to + promotion;
-    }
-    
-    bool parse_uci_move(const std::string& uci, std::string& from, std::string& to, std::string& promotion) {
-        if (uci.length() < 4) return false;
-        
-        from = uci.substr(0, 2);
-        to = uci.substr(2, 2);
-        promotion = uci.length() > 4 ? uci.substr(4) : "";
-        
-        return true;
-    }
-    
-    std::string fen_after_move(const std::string& fen, const std::string& move) {
-        // TODO: Implement using Stockfish position
-        return fen;
-    }
-    
-    bool is_valid_fen(const std::string& fen) {
-        // Basic validation
-        return fen.find(' ') != std::string::npos && fen.length() > 10;
-    }
-}
-
-} // namespace StockfishBinding
\ No newline at end of file
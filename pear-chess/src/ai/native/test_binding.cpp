@@ -1,6 +1,22 @@
 #include "stockfish_wrapper.h"
+#include "analysis_cache.h"
+#include "pgn_codec.h"
+#include "thread_scheduler.h"
+#include "search_queue.h"
+#include "follow_session.h"
+#include "metrics.h"
+#include "engine_pool.h"
+#include "cpu_dispatch.h"
 #include <iostream>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 using namespace StockfishBinding;
 
@@ -59,7 +75,8 @@ int main() {
         std::cout << "8. Testing engine options..." << std::endl;
         assert(engine.set_option("Hash", 64));
         assert(engine.set_option("Threads", 1));
-        assert(engine.set_option("MultiPV", true));
+        assert(engine.set_option("MultiPV", 1));
+        assert(!engine.set_option("NoSuchOption", 1));
         std::cout << " Engine options set successfully" << std::endl;
         
         // Test utility functions
@@ -76,8 +93,808 @@ int main() {
         
         std::cout << " Utility functions working" << std::endl;
         
+        // Test async search and cancellation
+        std::cout << "10. Testing async search..." << std::endl;
+        std::atomic<bool> callback_fired{false};
+        auto pending = engine.search_async(5, [&callback_fired](const SearchResult& r) {
+            callback_fired = !r.best_move.empty();
+        });
+        SearchResult async_result = pending.get();
+        assert(!async_result.best_move.empty());
+        assert(callback_fired);
+        
+        auto long_search = engine.search_async(60);
+        auto stop_start = std::chrono::steady_clock::now();
+        engine.stop_search();
+        SearchResult stopped = long_search.get();
+        auto stop_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - stop_start).count();
+        assert(!stopped.best_move.empty());
+        assert(!engine.is_searching());
+        std::cout << " Async search completed, stop took " << stop_ms << " ms" << std::endl;
+        
+        // Test live info streaming
+        std::cout << "11. Testing info streaming..." << std::endl;
+        std::atomic<int> info_updates{0};
+        engine.set_info_callback([&info_updates](const SearchInfo& info) {
+            if (info.depth > 0) ++info_updates;
+        });
+        SearchResult streamed = engine.search(8);
+        assert(info_updates > 0);
+        assert(!streamed.all_info.empty());
+        assert(static_cast<size_t>(info_updates.load()) <= streamed.all_info.size());
+        
+        engine.set_info_interval(50);
+        info_updates = 0;
+        streamed = engine.search(8);
+        assert(info_updates > 0);
+        engine.set_info_interval(0);
+        engine.set_info_callback(nullptr);
+        std::cout << " Streamed " << info_updates << " of " << streamed.all_info.size()
+                  << " updates with a 50 ms window" << std::endl;
+        
+        // Test time, node and clock limits
+        std::cout << "12. Testing search limits..." << std::endl;
+        auto timed_start = std::chrono::steady_clock::now();
+        SearchResult timed = engine.search_time(200);
+        auto timed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - timed_start).count();
+        assert(!timed.best_move.empty());
+        assert(timed_ms < 1000);
+        
+        SearchResult counted = engine.search_nodes(20000);
+        assert(!counted.best_move.empty());
+        
+        SearchResult clocked = engine.search_clock(3000, 3000, 20, 20);
+        assert(!clocked.best_move.empty());
+        std::cout << " movetime 200 ms took " << timed_ms << " ms, nodes limit searched "
+                  << counted.final_info.nodes << " nodes" << std::endl;
+        
+        // Test incremental position updates
+        std::cout << "13. Testing incremental moves..." << std::endl;
+        assert(engine.set_startpos_with_moves({"e2e4", "e7e5"}));
+        const std::string after_e4_e5 = engine.get_fen();
+        assert(after_e4_e5 != starting_fen);
+        assert(engine.push_move("g1f3"));
+        assert(!engine.push_move("e1e3"));
+        assert(engine.pop_move());
+        assert(engine.get_fen() == after_e4_e5);
+        assert(engine.pop_move() && engine.pop_move());
+        assert(engine.get_fen() == starting_fen);
+        assert(!engine.pop_move());
+        assert(!engine.set_startpos_with_moves({"e2e4", "e2e4"}));
+        assert(engine.get_fen() == starting_fen);  // Nothing of the failed list applied
+        assert(!engine.set_position("8/8/8/8/8/8/8/8 w - - 0 1"));  // No kings
+        assert(engine.get_fen() == starting_fen);
+        assert(engine.set_position(starting_fen));
+        std::cout << " push_move/pop_move round-trip to the start position" << std::endl;
+        
+        // Test engine pool
+        std::cout << "14. Testing engine pool..." << std::endl;
+        {
+            EnginePoolConfig pool_config;
+            pool_config.max_engines = 2;
+            pool_config.prewarm = 1;
+            EnginePool pool(pool_config);
+            assert(pool.size() == 1 && pool.idle() == 1);
+            
+            auto first = pool.acquire({{"Skill Level", "5"}, {"MultiPV", "2"}});
+            auto second = pool.acquire();
+            assert(first && second);
+            assert(pool.size() == 2);
+            assert(!pool.try_acquire());
+            assert(!first->search(4).best_move.empty());
+            
+            StockfishEngine* recycled = first.get();
+            first.release();
+            assert(pool.idle() == 1);
+            auto third = pool.try_acquire();
+            assert(third.get() == recycled);
+            assert(pool.size() == 2);
+            
+            // Two live engines split the budget, both shares fit. The
+            // leased one still counts at its own Hash in the meantime.
+            assert(pool.hash_allocated() == 32);
+            pool.set_hash_budget(64);
+            third.release();
+            assert(pool.hash_allocated() <= 64);
+            auto fourth = pool.acquire();
+            assert(pool.hash_allocated() <= 64);
+            assert(!fourth->search(4).best_move.empty());
+            assert(fourth->get_hashfull() >= 0);
+        }
+        
+        // Scheduled leases hold CPUs, one node per lease while it fits
+        {
+            ThreadScheduler cores(CpuTopology({{0, {0, 1, 2, 3}}, {1, {4, 5, 6, 7}}}));
+            auto left = cores.acquire(3);
+            auto right = cores.acquire(3);
+            assert(left.node() != right.node() && left.numa_policy() != right.numa_policy());
+            assert(!cores.try_acquire(2) && cores.try_acquire(1));
+            left.release();
+            auto spanning = cores.try_acquire(6);
+            assert(!spanning);
+            right.release();
+            spanning = cores.try_acquire(20);
+            assert(spanning.threads() == 8 && spanning.numa_policy() == "0-3:4-7");
+            
+            EnginePoolConfig pool_config;
+            pool_config.max_engines = 2;
+            pool_config.scheduler = std::make_shared<ThreadScheduler>();
+            EnginePool pool(pool_config);
+            size_t cpus = pool_config.scheduler->capacity();
+            
+            // CPUs are held per search, not per lease: this one waits until
+            // the CPUs taken elsewhere come back
+            auto whole = pool.acquire({{"Threads", std::to_string(cpus + 4)}});
+            assert(whole && pool_config.scheduler->in_use() == 0);
+            assert(pool.try_acquire());
+            auto elsewhere = pool_config.scheduler->acquire(cpus);
+            std::thread giver([&elsewhere] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                elsewhere.release();
+            });
+            auto asked = std::chrono::steady_clock::now();
+            assert(!whole->search(4).best_move.empty());
+            assert(std::chrono::steady_clock::now() - asked >= std::chrono::milliseconds(40));
+            giver.join();
+            assert(pool_config.scheduler->in_use() == 0);
+            whole.release();
+        }
+        std::cout << " Pool leased, recycled and reset engines" << std::endl;
+        
+        // Test whole-game analysis
+        std::cout << "15. Testing game analysis..." << std::endl;
+        const std::vector<std::string> game = {"e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6"};
+        SearchLimits review_limits;
+        review_limits.depth = 6;
+        auto review = engine.analyze_game(starting_fen, game, review_limits);
+        assert(review.size() == game.size() + 1);
+        assert(review[0].move.empty() && review[1].move == "e2e4");
+        for (const auto& ply : review) {
+            assert(!ply.best_move.empty());
+        }
+        
+        auto parallel_review = engine.analyze_game(starting_fen, game, review_limits, 2);
+        assert(parallel_review.size() == review.size());
+        assert(!parallel_review.back().best_move.empty());
+        
+        // Helpers split the engine's threads, and its scheduler counts them:
+        // with every CPU held elsewhere, the engine's search and its
+        // helper's both wait
+        {
+            auto cores = std::make_shared<ThreadScheduler>(CpuTopology({{0, {0, 1}}}));
+            StockfishEngine counted;
+            assert(counted.initialize());
+            assert(counted.set_option("Threads", 2));
+            counted.set_scheduler(cores, 0);
+            auto held = cores->acquire(2);
+            std::vector<PlyAnalysis> counted_review;
+            std::thread reviewer([&] {
+                counted_review = counted.analyze_game(starting_fen, game, review_limits, 2);
+            });
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (cores->waiting() < 2 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            assert(cores->waiting() == 2 && cores->in_use() == 2);
+            held.release();
+            reviewer.join();
+            assert(counted_review.size() == review.size());
+            assert(cores->in_use() == 0);
+        }
+        
+        auto truncated = engine.analyze_game(starting_fen, {"e2e4", "e2e4"}, review_limits);
+        assert(truncated.size() == 2);
+        std::cout << " Analysed " << review.size() << " plies, last eval "
+                  << review.back().info.score_cp << " cp" << std::endl;
+        
+        // Test real move generation and game state
+        std::cout << "16. Testing move generation and game state..." << std::endl;
+        assert(engine.set_position(starting_fen));
+        assert(engine.get_legal_moves().size() == 20);
+        uint16_t packed[StockfishEngine::MaxMoves];
+        size_t packed_count = engine.get_legal_moves(packed, StockfishEngine::MaxMoves);
+        assert(packed_count == 20);
+        assert(engine.is_legal_move(packed[0]));
+        assert(engine.is_legal_move(Utils::packed_move_to_uci(packed[0])));
+        assert(!engine.is_legal_move(uint16_t(0)));
+        assert(!engine.is_legal_move(uint16_t(packed[0] | 0x3000)));  // Promotion bits on a normal move
+        assert(!engine.is_legal_move("e2e5"));
+        assert(!engine.is_check() && !engine.is_checkmate() && !engine.is_draw());
+        
+        assert(engine.set_startpos_with_moves({"f2f3", "e7e5", "g2g4", "d8h4"}));
+        assert(engine.is_check() && engine.is_checkmate() && !engine.is_stalemate());
+        assert(engine.get_legal_moves(packed, StockfishEngine::MaxMoves) == 0);
+        
+        assert(engine.set_position("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+        assert(engine.is_stalemate() && engine.is_draw() && !engine.is_check());
+        
+        assert(engine.set_position("8/8/4k3/8/8/3NK3/8/8 w - - 0 1"));
+        assert(engine.is_draw());
+        
+        assert(engine.set_position("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1"));
+        assert(engine.is_legal_move("e1g1") && engine.is_legal_move("e1c1"));
+        engine.get_legal_moves(packed, StockfishEngine::MaxMoves);
+        assert(engine.set_position(starting_fen));
+        std::cout << " Legal moves, mate, stalemate and draw detection working" << std::endl;
+        
+        // Test static evaluation
+        std::cout << "17. Testing static evaluation..." << std::endl;
+        auto eval_start = std::chrono::steady_clock::now();
+        int static_score = engine.evaluate_current_position();
+        auto eval_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - eval_start).count();
+        assert(static_score > -200 && static_score < 200);
+        
+        auto batch = engine.evaluate_many({
+            starting_fen,
+            "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3",
+            "invalid",
+            "4k3/8/8/8/8/8/8/QQQQK3 w - - 0 1"
+        });
+        assert(batch.size() == 4);
+        assert(batch[0] == static_score);
+        assert(batch[1] == StockfishEngine::NoEvaluation);
+        assert(batch[2] == StockfishEngine::NoEvaluation);
+        assert(batch[3] > 1000);
+        std::cout << " Static eval " << static_score << " cp in " << eval_us << " us" << std::endl;
+        
+        // Test packed results
+        std::cout << "18. Testing packed results..." << std::endl;
+        engine.set_position(starting_fen);
+        SearchResult unpacked = engine.search(6);
+        auto packed_search = engine.pack_infos(starting_fen, unpacked.all_info);
+        assert(packed_search.records.size() == unpacked.all_info.size());
+        const PackedInfo& last = packed_search.records.back();
+        assert(last.depth == unpacked.final_info.depth);
+        assert(last.pv_length == unpacked.final_info.pv.size());
+        for (uint16_t i = 0; i < last.pv_length; ++i) {
+            assert(Utils::packed_move_to_uci(packed_search.moves[last.pv_offset + i]) == unpacked.final_info.pv[i]);
+        }
+        
+        auto packed_review = engine.pack_game_analysis(starting_fen, review);
+        assert(packed_review.records.size() == review.size());
+        assert(packed_review.records[0].move == 0);
+        assert(Utils::packed_move_to_uci(packed_review.records[1].move) == "e2e4");
+        assert(Utils::packed_move_to_uci(packed_review.records.back().best_move) == review.back().best_move);
+        
+        const std::string castling_fen = "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1";
+        auto castled = engine.analyze_game(castling_fen, {"e1g1"}, review_limits);
+        auto packed_castle = engine.pack_game_analysis(castling_fen, castled);
+        assert(packed_castle.records.size() == 2);
+        assert((packed_castle.records[1].move >> 14) == 3);
+        assert(Utils::packed_move_to_uci(packed_castle.records[1].move) == "e1g1");
+        std::cout << " Packed " << packed_search.records.size() << " infos and "
+                  << packed_search.moves.size() << " PV moves" << std::endl;
+        
+        // Test MultiPV
+        std::cout << "19. Testing MultiPV..." << std::endl;
+        engine.set_position(starting_fen);
+        assert(engine.set_option("MultiPV", 3));
+        SearchResult multi = engine.search(8);
+        assert(multi.lines.size() == 3);
+        for (size_t i = 0; i < multi.lines.size(); ++i) {
+            assert(multi.lines[i].multipv == static_cast<int>(i) + 1);
+            assert(!multi.lines[i].pv.empty());
+        }
+        assert(multi.lines[0].pv[0] != multi.lines[1].pv[0]);
+        assert(multi.lines[1].pv[0] != multi.lines[2].pv[0]);
+        assert(multi.final_info.multipv == 1);
+        assert(multi.final_info.pv == multi.lines[0].pv);
+        assert(engine.set_option("MultiPV", 1));
+        std::cout << " Top lines: " << multi.lines[0].pv[0] << " " << multi.lines[1].pv[0]
+                  << " " << multi.lines[2].pv[0] << std::endl;
+        
+        // Test CPU variant selection
+        std::cout << "20. Testing CPU dispatch..." << std::endl;
+        auto variants = supported_variants();
+        assert(!variants.empty());
+        assert(cpu_supports(variants.back()));
+        assert(!cpu_supports("no-such-arch"));
+        assert(best_variant({"no-such-arch"}) == "no-such-arch");
+        assert(best_variant({variants.back(), variants.front()}) == variants.front());
+        std::cout << " Best variant on this host: " << variants.front() << std::endl;
+        
+        // Test pondering
+        std::cout << "21. Testing pondering..." << std::endl;
+        engine.set_position(starting_fen);
+        engine.push_move("e2e4");
+        SearchResult reply = engine.search(10);
+        assert(!reply.ponder_move.empty());
+        assert(engine.push_move(reply.best_move));
+        const std::string expected_fen = engine.get_fen();
+        
+        // Miss: the opponent plays something else, the guess is taken back
+        auto missed = engine.ponder_async(reply.ponder_move, SearchLimits{});
+        assert(engine.is_pondering());
+        engine.stop_pondering();
+        assert(!engine.is_pondering());
+        assert(engine.get_fen() == expected_fen);
+        missed.get();
+        
+        // Hit: a depth-limited ponder search keeps going until ponderhit
+        SearchLimits ponder_limits;
+        ponder_limits.depth = 6;
+        auto hit = engine.ponder_async(reply.ponder_move, ponder_limits);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(engine.is_pondering());
+        assert(engine.ponder_hit());
+        assert(!engine.ponder_hit());
+        SearchResult answer = hit.get();
+        assert(engine.is_legal_move(answer.best_move));
+        assert(engine.get_fen() != expected_fen);
+        std::cout << " Pondered " << reply.ponder_move << ", answered " << answer.best_move << std::endl;
+        
+        // Test opening book
+        std::cout << "22. Testing opening book..." << std::endl;
+        std::istringstream pgn(
+            "[Event \"Test\"]\n[Result \"1-0\"]\n\n"
+            "1. e4 e5 2. Nf3 Nc6 3. Bc4 {Italian} Bc5 4. O-O Nf6 1-0\n\n"
+            "[Result \"1/2-1/2\"]\n\n"
+            "1. d4 d5 (1... Nf6 2. c4) 2. c4 $1 e6 1/2-1/2\n\n"
+            "[Result \"0-1\"]\n\n"
+            "1. e4 c5 2. Nf3 d6 0-1\n");
+        BookBuilder builder;
+        assert(builder.ready());
+        assert(builder.add_pgn(pgn) == 3);
+        
+        const std::string book_path = (std::filesystem::temp_directory_path() / "test_binding.book").string();
+        assert(builder.write(book_path));
+        auto book = std::make_shared<OpeningBook>();
+        assert(book->open(book_path));
+        assert(engine.set_book(book));
+        
+        engine.set_position(starting_fen);
+        auto book_moves = engine.book_moves();
+        assert(book_moves.size() == 2);
+        assert(Utils::packed_move_to_uci(book_moves[0].move) == "e2e4");
+        assert(book_moves[0].games == 2);
+        
+        SearchResult book_result = engine.search(10);
+        assert(book_result.from_book);
+        assert(book_result.best_move == "e2e4" || book_result.best_move == "d2d4");
+        
+        // Replies that only ever lost are left out; castling is found by SAN
+        engine.push_move("e2e4");
+        book_moves = engine.book_moves();
+        assert(book_moves.size() == 1 && Utils::packed_move_to_uci(book_moves[0].move) == "c7c5");
+        engine.set_position_with_moves(starting_fen, {"e2e4", "e7e5", "g1f3", "b8c6", "f1c4", "f8c5"});
+        assert(engine.get_root_fen() == starting_fen && engine.get_moves().size() == 6 && engine.get_moves()[5] == "f8c5");
+        book_moves = engine.book_moves();
+        assert(book_moves.size() == 1 && Utils::packed_move_to_uci(book_moves[0].move) == "e1g1");
+        
+        SearchLimits no_book;
+        no_book.depth = 5;
+        no_book.use_book = false;
+        assert(!engine.search(no_book).from_book);
+        assert(engine.set_book(nullptr));
+        std::cout << " Book of " << book->size() << " entries, chose " << book_result.best_move << std::endl;
+        book->close();
+        std::filesystem::remove(book_path);
+        
+        // Test tablebases; the probes need SYZYGY_PATH pointing at 3-5 man tables
+        std::cout << "23. Testing tablebases..." << std::endl;
+        const char* syzygy_path = std::getenv("SYZYGY_PATH");
+        assert(engine.set_option("SyzygyPath", std::string(syzygy_path ? syzygy_path : "")));
+        engine.set_position(starting_fen);
+        assert(!engine.probe_tablebase().found);
+        
+        engine.set_position("8/8/8/8/8/4k3/8/4K2R w - - 0 1");
+        SearchResult tb_result = engine.search(10);
+        assert(engine.is_legal_move(tb_result.best_move));
+        if (syzygy_path) {
+            assert(tb_result.from_tablebase);
+            assert(tb_result.tablebase.wdl == 2 && tb_result.tablebase.has_dtz);
+            
+            // A second engine with the same path shares the mapped tables
+            StockfishEngine tb_engine;
+            assert(tb_engine.initialize());
+            assert(tb_engine.set_option("SyzygyPath", std::string(syzygy_path)));
+            tb_engine.set_position("8/8/8/8/8/4k3/8/4K2R b - - 0 1");
+            assert(tb_engine.probe_tablebase().wdl == -2);
+            tb_engine.shutdown();
+            std::cout << " KRvK: " << tb_result.best_move << ", dtz " << tb_result.tablebase.dtz << std::endl;
+        } else {
+            assert(!tb_result.from_tablebase);
+            std::cout << " SYZYGY_PATH not set, probes skipped" << std::endl;
+        }
+        
+        // Test analysis cache
+        std::cout << "24. Testing analysis cache..." << std::endl;
+        auto cache = std::make_shared<AnalysisCache>();
+        engine.set_analysis_cache(cache);
+        const std::string cache_fen = "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3";
+        engine.set_position(cache_fen);
+        SearchResult searched = engine.search(8);
+        assert(!searched.from_cache);
+        
+        // A deeper result serves the shallower request, from a new position
+        // object that reaches the same key
+        engine.set_position(cache_fen);
+        SearchResult cached = engine.search(6);
+        assert(cached.from_cache);
+        assert(cached.best_move == searched.best_move);
+        assert(cached.final_info.depth >= 8);
+        
+        assert(!engine.search(12).from_cache);
+        SearchLimits uncached;
+        uncached.depth = 6;
+        uncached.use_cache = false;
+        assert(!engine.search(uncached).from_cache);
+        
+        // Clock searches are never served, and more lines than stored miss
+        SearchLimits clock;
+        clock.wtime_ms = clock.btime_ms = 1000;
+        assert(!AnalysisCache::cacheable(clock));
+        assert(engine.set_option("MultiPV", 2));
+        assert(!engine.search(6).from_cache);
+        assert(engine.set_option("MultiPV", 1));
+        
+        AnalysisCache::Stats cache_stats = cache->stats();
+        assert(cache_stats.hits == 1 && cache_stats.misses >= 2);
+        assert(cache_stats.entries == 1 && cache_stats.bytes <= cache_stats.capacity);
+        
+        // Shrinking the budget evicts
+        cache->set_capacity(1);
+        assert(cache->stats().entries == 0 && cache->stats().evictions >= 1);
+        cache->set_capacity(32 * 1024 * 1024);
+        
+        // Seeded peer results only answer searches that accept them
+        auto peers = std::make_shared<AnalysisCache>();
+        engine.set_peer_cache(peers);
+        engine.set_position(cache_fen);
+        SearchResult seeded;
+        seeded.best_move = "f1c4";
+        seeded.final_info.depth = 40;
+        seeded.final_info.pv = {"f1c4"};
+        seeded.lines = {seeded.final_info};
+        assert(engine.seed_cache(seeded));
+        assert(!engine.search(6).from_peer && cache->stats().entries == 1);
+        SearchLimits peer_review;
+        peer_review.depth = 30;
+        peer_review.use_peer_cache = true;
+        SearchResult from_peer = engine.search(peer_review);
+        assert(from_peer.from_peer && from_peer.from_cache && from_peer.best_move == "f1c4");
+        
+        // A shallower result at the same width keeps the deeper entry, and
+        // a stopped search is partial and never kept
+        SearchResult shallow = seeded;
+        shallow.best_move = "d2d4";
+        shallow.final_info.depth = 10;
+        peers->insert(1, 1, seeded);
+        peers->insert(1, 1, shallow);
+        SearchResult kept;
+        assert(peers->lookup(1, peer_review, 1, kept) && kept.best_move == "f1c4");
+        shallow.stopped = true;
+        peers->insert(2, 1, shallow);
+        assert(!peers->lookup(2, peer_review, 1, kept));
+        engine.set_peer_cache(nullptr);
+        engine.set_analysis_cache(nullptr);
+        std::cout << " " << cache_stats.hits << " hit, " << cache_stats.misses << " misses, "
+                  << cache_stats.bytes << " bytes" << std::endl;
+        
+        // Test PGN and FEN codec
+        std::cout << "25. Testing PGN and FEN codec..." << std::endl;
+        assert(Utils::is_valid_fen("8/8/8/8/8/4k3/8/4K2R w K - 0 1"));
+        assert(!Utils::is_valid_fen("8/8/8/8/8/4k3/8/4K2R w Q - 0 1"));          // No rook on a1
+        assert(!Utils::is_valid_fen("4k3/8/8/8/8/8/4R3/4K3 w - - 0 1"));         // Side not to move in check
+        assert(!Utils::is_valid_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1"));
+        assert(!Utils::is_valid_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1"));
+        
+        assert(Utils::fen_after_move(starting_fen, "e2e4") == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+        assert(Utils::fen_after_move(starting_fen, "e2e5").empty());
+        assert(Notation::san_to_uci(starting_fen, "Nf3") == "g1f3");
+        assert(Notation::uci_to_san(starting_fen, "g1f3") == "Nf3");
+        assert(Notation::uci_to_san("4k3/8/8/8/8/8/8/R4RK1 w - - 0 1", "a1c1") == "Rac1");
+        assert(Notation::uci_to_san("rnbqkbnr/pppp1ppp/8/4p3/6P1/5P2/PPPPP2P/RNBQKBNR b KQkq - 0 2", "d8h4") == "Qh4#");
+        assert(Notation::san_to_uci("r3k2r/8/8/8/8/8/8/4K3 b kq - 0 1", "O-O-O") == "e8c8");
+        
+        std::istringstream archive(
+            "[Event \"One\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Bc4 Nc6 3. Qh5 Nf6?? 4. Qxf7# 1-0\n\n"
+            "[Event \"Two\"]\n[FEN \"4k3/8/8/8/8/8/8/4K2R w K - 0 1\"]\n\n1. O-O Kd7 2. Rxh8 *\n");
+        PgnReader reader(archive, 4096);
+        GameReplayer replayer;
+        PgnGame pgn_game;
+        ReplayedGame replayed;
+        
+        assert(reader.next(pgn_game) && replayer.replay(pgn_game, replayed));
+        assert(pgn_game.tag("Event") == "One" && replayed.result == "1-0");
+        assert(replayed.complete && replayed.moves.size() == 7);
+        assert(Utils::packed_move_to_uci(replayed.moves.back()) == "h5f7");
+        
+        // Rxh8 is not a legal move there, so the replay stops before it
+        assert(reader.next(pgn_game) && replayer.replay(pgn_game, replayed));
+        assert(!replayed.complete && replayed.moves.size() == 2);
+        assert(replayed.final_fen == "8/3k4/8/8/8/8/8/5RK1 w - - 2 2");
+        assert(!reader.next(pgn_game) && reader.games() == 2);
+        std::cout << " Replayed " << reader.games() << " games from " << reader.offset() << " bytes" << std::endl;
+        
+        // Test perft against published counts
+        std::cout << "26. Testing perft..." << std::endl;
+        assert(engine.set_position(starting_fen));
+        assert(engine.perft(0).nodes == 1);
+        assert(engine.perft(3).nodes == 8902);
+        
+        // Kiwipete covers castling, en passant and promotions; split over
+        // threads and hashed, the counts must not change
+        assert(engine.set_position("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+        PerftOptions split;
+        split.threads = 4;
+        split.hash_mb = 16;
+        PerftResult kiwipete = engine.perft(3, split);
+        assert(kiwipete.nodes == 97862 && kiwipete.divide.size() == 48);
+        uint64_t divided = 0;
+        for (const auto& entry : kiwipete.divide) divided += entry.second;
+        assert(divided == kiwipete.nodes);
+        assert(engine.perft(3).nodes == kiwipete.nodes);
+        assert(engine.set_position(starting_fen));
+        std::cout << " Kiwipete depth 3: " << kiwipete.nodes << " leaves, " << kiwipete.nps << " nps" << std::endl;
+        
+        // Test the search queue: one slot, reviews yield to live searches
+        std::cout << "27. Testing search queue..." << std::endl;
+        {
+            StockfishEngine reviewer, player;
+            assert(reviewer.initialize() && player.initialize());
+            SearchQueue queue(1);
+            
+            SearchLimits endless;
+            endless.infinite = true;
+            SearchLimits shallow;
+            shallow.depth = 4;
+            QueueOptions review;
+            review.priority = SearchPriority::Review;
+            QueueOptions live;
+            live.deadline_ms = 5000;
+            
+            // Searches start on the queue's dispatcher thread
+            auto wait_running = [&queue](size_t count) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (queue.stats().running < count && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            };
+            
+            std::promise<QueueOutcome> review_done, live_done;
+            queue.submit(reviewer, endless, review, [&](const SearchResult& result, const QueueOutcome& outcome) {
+                assert(!result.best_move.empty());
+                review_done.set_value(outcome);
+            });
+            wait_running(1);
+            queue.submit(player, shallow, live, [&](const SearchResult& result, const QueueOutcome& outcome) {
+                assert(!result.best_move.empty());
+                live_done.set_value(outcome);
+            });
+            QueueOutcome preempted = review_done.get_future().get();
+            QueueOutcome served = live_done.get_future().get();
+            assert(preempted.preempted && !served.preempted && !served.deadline_missed);
+            
+            // A hint is not preemptible; a review behind it can be dropped
+            QueueOptions hint;
+            hint.priority = SearchPriority::Hint;
+            std::promise<QueueOutcome> hint_done, dropped_done;
+            uint64_t hint_id = queue.submit(player, endless, hint, [&](const SearchResult&, const QueueOutcome& outcome) {
+                hint_done.set_value(outcome);
+            });
+            wait_running(1);
+            uint64_t review_id = queue.submit(reviewer, shallow, review, [&](const SearchResult& result, const QueueOutcome& outcome) {
+                assert(result.best_move.empty());
+                dropped_done.set_value(outcome);
+            });
+            assert(queue.stats().queued == 1);
+            assert(queue.cancel(review_id));
+            assert(dropped_done.get_future().get().cancelled);
+            assert(queue.cancel(hint_id));
+            assert(!hint_done.get_future().get().preempted);
+            assert(!queue.cancel(hint_id));
+            
+            SearchQueue::Stats stats = queue.stats();
+            const auto& reviews = stats.classes[static_cast<size_t>(SearchPriority::Review)];
+            assert(reviews.submitted == 2 && reviews.preempted == 1 && reviews.cancelled == 1);
+            assert(stats.running == 0 && stats.queued == 0);
+            std::cout << " Live search waited " << served.wait_ms << " ms for a preempted review" << std::endl;
+        }
+        
+        // Test metrics: the steps above searched, so the counters moved
+        std::cout << "28. Testing metrics..." << std::endl;
+        {
+            Histogram latency(10);
+            latency.observe(5);
+            latency.observe(15);
+            latency.observe(1000000000);
+            Histogram::Snapshot snapshot = latency.snapshot();
+            assert(snapshot.count == 3 && snapshot.sum == 1000000020);
+            assert(snapshot.counts[0] == 1 && snapshot.counts[1] == 1 && snapshot.counts[Histogram::Buckets - 1] == 1);
+            assert(snapshot.quantile(0.5) == 20);
+            
+            const Metrics& counted = metrics();
+            assert(counted.searches.value() > 0 && counted.search_ms.snapshot().count > 0);
+            assert(counted.init_ms.snapshot().count > 0 && counted.engines.value() >= 1);
+            
+            int64_t before = counted.memory_bytes.value();
+            size_t own = engine.memory_bytes();
+            assert(engine.set_option("Hash", 32));
+            assert(engine.memory_bytes() == 32u * 1024 * 1024);
+            assert(counted.memory_bytes.value() - before == static_cast<int64_t>(engine.memory_bytes()) - static_cast<int64_t>(own));
+            
+            std::string text = metrics_text();
+            assert(text.find("# TYPE stockfish_search_milliseconds histogram") != std::string::npos);
+            assert(text.find("stockfish_searches_total " + std::to_string(counted.searches.value())) != std::string::npos);
+            std::cout << " " << counted.searches.value() << " searches, p90 "
+                      << counted.search_ms.snapshot().quantile(0.9) << " ms" << std::endl;
+        }
+        
+        // Test warm start: a stopped engine is reused with default options
+        std::cout << "29. Testing engine reuse..." << std::endl;
+        {
+            auto timed_start = [](StockfishEngine& started) {
+                auto begin = std::chrono::steady_clock::now();
+                assert(started.initialize());
+                return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+            };
+            
+            StockfishEngine first;
+            auto cold_ms = timed_start(first);
+            assert(first.set_option("MultiPV", 3) && first.set_option("Hash", 8));
+            assert(first.search(4).lines.size() == 3);
+            assert(first.set_position("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+            first.new_game();
+            assert(first.get_fen() == starting_fen);
+            first.shutdown();
+            
+            StockfishEngine second;
+            auto warm_ms = timed_start(second);
+            assert(second.memory_bytes() == 16u * 1024 * 1024);
+            assert(second.search(4).lines.size() == 1);
+            
+            StockfishEngine::prewarm(1);
+            StockfishEngine third;
+            timed_start(third);
+            assert(!third.search(4).best_move.empty());
+            std::cout << " Cold start " << cold_ms << " ms, warm start " << warm_ms << " ms" << std::endl;
+        }
+        
+        // Test limited strength: caps follow Stockfish's picking depth
+        std::cout << "30. Testing strength limits..." << std::endl;
+        {
+            Strength full = engine.strength();
+            assert(!full.limited && full.apply(SearchLimits()).depth == 0);
+            
+            Strength weakest = Strength::from_elo(Strength::MinElo);
+            assert(weakest.limited && weakest.level == 0.0 && weakest.depth == 1 && weakest.nodes == 2000);
+            assert(Strength::from_elo(2000).level > weakest.level && Strength::from_elo(2000).level < 19.0);
+            
+            SearchLimits deep;
+            deep.depth = 22;
+            SearchLimits capped = Strength::from_skill_level(5).apply(deep);
+            assert(capped.depth == 6 && capped.nodes > 0 && capped.nodes < 50000);
+            SearchLimits analysis;
+            analysis.infinite = true;
+            assert(Strength::from_skill_level(5).apply(analysis).depth == 0);
+            
+            assert(engine.set_strength(1500) && engine.strength().limited);
+            SearchResult weak = engine.search(deep);
+            assert(!weak.best_move.empty() && weak.final_info.depth <= engine.strength().depth);
+            assert(engine.set_strength(0) && !engine.strength().limited);
+            std::cout << " Elo 1500 searched " << weak.final_info.nodes << " nodes to depth "
+                      << weak.final_info.depth << std::endl;
+        }
+        
+        // Test game follow: one search steered move by move, shared by listeners
+        std::cout << "31. Testing game follow..." << std::endl;
+        {
+            StockfishEngine followed;
+            assert(followed.initialize());
+            
+            std::mutex seen_mutex;
+            std::vector<uint64_t> first_seen, second_seen;
+            std::string last_fen;
+            FollowSession session(followed, 20);
+            session.subscribe([&](const FollowUpdate& update) {
+                std::lock_guard<std::mutex> lock(seen_mutex);
+                first_seen.push_back(update.ply);
+                last_fen = update.fen;
+            });
+            session.subscribe([&](const FollowUpdate& update) {
+                std::lock_guard<std::mutex> lock(seen_mutex);
+                second_seen.push_back(update.ply);
+            });
+            
+            auto wait_for_ply = [&](uint64_t ply) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (std::chrono::steady_clock::now() < deadline) {
+                    FollowUpdate update;
+                    if (session.latest(update) && update.ply == ply && update.info.depth > 0) return update;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                assert(false && "no update for the followed position");
+                return FollowUpdate();
+            };
+            
+            assert(session.start(starting_fen, {"e2e4"}) && session.running());
+            wait_for_ply(1);
+            assert(session.push_move("e7e5") && session.ply() == 2);
+            FollowUpdate reply = wait_for_ply(2);
+            assert(reply.fen == "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+            assert(!session.push_move("e4e5") && session.ply() == 2);
+            assert(session.push_move("g1f3"));
+            wait_for_ply(3);
+            
+            session.stop();
+            assert(!session.running() && !session.push_move("b8c6"));
+            {
+                // Updates of a position stop once the next move is pushed
+                std::lock_guard<std::mutex> lock(seen_mutex);
+                assert(first_seen == second_seen && !first_seen.empty());
+                for (size_t i = 1; i < first_seen.size(); ++i) {
+                    assert(first_seen[i] >= first_seen[i - 1]);
+                }
+                assert(first_seen.back() == 3 && last_fen.find("5N2") != std::string::npos);
+            }
+            
+            assert(session.resync("8/8/8/4k3/8/8/4K3/4R3 w - - 0 1"));
+            assert(session.ply() == 0 && wait_for_ply(0).info.depth > 0);
+            session.stop();
+            std::cout << " " << first_seen.size() << " updates over 3 moves, from one engine" << std::endl;
+        }
+        
+        // Test searching into a reused arena
+        std::cout << "32. Testing search arena..." << std::endl;
+        {
+            StockfishEngine packing;
+            assert(packing.initialize());
+            assert(packing.set_position(starting_fen));
+            
+            size_t streamed = 0;
+            bool streamed_in_arena = true;
+            packing.set_packed_info_callback([&](const SearchArena& arena, const PackedInfo& record) {
+                streamed++;
+                streamed_in_arena = streamed_in_arena && &record >= arena.packed.records.data() &&
+                                    &record < arena.packed.records.data() + arena.packed.records.size();
+            });
+            
+            SearchLimits arena_limits;
+            arena_limits.depth = 8;
+            arena_limits.use_cache = false;
+            arena_limits.use_book = false;
+            
+            SearchArena arena;
+            arena.reserve(64);
+            const PackedInfo* records = arena.packed.records.data();
+            const uint16_t* moves = arena.packed.moves.data();
+            
+            assert(packing.search_into(arena_limits, arena));
+            assert(arena.best_move != 0 && arena.final_info() != nullptr);
+            assert(streamed > 0 && streamed_in_arena);
+            size_t first_count = arena.packed.records.size();
+            
+            // Same storage the second time round
+            assert(packing.search_into(arena_limits, arena));
+            assert(arena.packed.records.data() == records && arena.packed.moves.data() == moves);
+            assert(arena.final_info()->depth == 8);
+            
+            SearchResult unpacked = arena.to_result();
+            assert(unpacked.best_move == Utils::packed_move_to_uci(arena.best_move));
+            assert(unpacked.final_info.pv.size() == arena.final_info()->pv_length);
+            assert(unpacked.final_info.pv.front() == unpacked.best_move);
+            
+            // Without history an arena holds one record per line
+            SearchArena latest;
+            latest.keep_history = false;
+            assert(packing.search_into(arena_limits, latest));
+            assert(latest.packed.records.size() == latest.lines.size() && latest.final_info()->depth == 8);
+            
+            // Async searches stream packed records too
+            size_t before_async = streamed;
+            assert(!packing.search_async(arena_limits).get().best_move.empty());
+            assert(streamed > before_async);
+            
+            packing.set_packed_info_callback(nullptr);
+            std::cout << " " << first_count << " records, " << streamed << " streamed" << std::endl;
+        }
+        
         // Test shutdown
-        std::cout << "10. Testing shutdown..." << std::endl;
+        std::cout << "33. Testing shutdown..." << std::endl;
         engine.shutdown();
         assert(!engine.is_ready());
         std::cout << " Engine shutdown successfully" << std::endl;
@@ -0,0 +1,127 @@
+#include "uci_interface.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A scripted engine: enough UCI for the handshake and one search. "die"
+// exits without a word, as a crashed engine would.
+static const char* kFakeEngine =
+    "while read -r line; do\n"
+    "  case \"$line\" in\n"
+    "    uci) echo 'id name Fake'; echo 'uciok' ;;\n"
+    "    isready) echo 'readyok' ;;\n"
+    "    go*) echo 'info depth 1 score cp 12 pv e2e4'; echo 'bestmove e2e4' ;;\n"
+    "    die) exit 3 ;;\n"
+    "    quit) exit 0 ;;\n"
+    "  esac\n"
+    "done\n";
+
+static bool throws(const std::function<void()>& call) {
+    try {
+        call();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    std::cout << "=== UCI Interface Test ===" << std::endl;
+
+    try {
+        std::cout << "1. Handshake with a scripted engine..." << std::endl;
+        {
+            UCIInterface uci;
+            std::atomic<int> lines{0};
+            uci.SetResponseCallback([&lines](const std::string&) { lines++; });
+            assert(uci.Initialize("/bin/sh", {"-c", kFakeEngine}));
+            assert(uci.IsRunning());
+
+            assert(uci.SendCommandAndWait("uci", "uciok") == "uciok");
+            assert(uci.SendCommandAndWait("isready", "readyok") == "readyok");
+
+            // An answer that arrives before the wait starts is still found
+            assert(uci.SendCommand("go depth 1"));
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            assert(uci.WaitForResponse("bestmove") == "bestmove e2e4");
+
+            // Lines before the last command cannot answer it
+            assert(throws([&] { uci.SendCommandAndWait("isready", "uciok", 100); }));
+
+            // The callback can be swapped while the reader runs
+            std::atomic<int> swapped{0};
+            uci.SetResponseCallback([&swapped](const std::string&) { swapped++; });
+            assert(uci.SendCommandAndWait("isready", "readyok") == "readyok");
+            assert(lines >= 5 && swapped >= 1);
+
+            uci.Shutdown();
+            assert(!uci.IsRunning());
+            assert(!uci.SendCommand("isready"));
+        }
+        std::cout << " Handshake, search and timeout behave" << std::endl;
+
+        std::cout << "2. Engine exit fails pending waits..." << std::endl;
+        {
+            UCIInterface uci;
+            assert(uci.Initialize("/bin/sh", {"-c", kFakeEngine}));
+            assert(uci.SendCommand("die"));
+            assert(throws([&] { uci.WaitForResponse("readyok", 2000); }));
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (uci.IsRunning() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            assert(!uci.IsRunning());
+            assert(!uci.SendCommand("isready"));
+        }
+        std::cout << " Dead engine reported" << std::endl;
+
+        std::cout << "3. Engines started side by side..." << std::endl;
+        {
+            // A child that inherited another engine's pipe would keep that
+            // engine's reader from seeing EOF, and its shutdown would hang
+            UCIInterface engines[6];
+            std::vector<std::thread> starters;
+            for (auto& engine : engines) {
+                starters.emplace_back([&engine] {
+                    assert(engine.Initialize("/bin/sh", {"-c", kFakeEngine}));
+                });
+            }
+            for (auto& starter : starters) {
+                starter.join();
+            }
+            for (auto& engine : engines) {
+                assert(engine.SendCommandAndWait("isready", "readyok") == "readyok");
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            engines[0].Shutdown();
+            assert(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(900));
+            for (size_t i = 1; i < std::size(engines); ++i) {
+                assert(engines[i].SendCommandAndWait("isready", "readyok") == "readyok");
+            }
+        }
+        std::cout << " Independent engines" << std::endl;
+
+        std::cout << "4. Missing engine binary..." << std::endl;
+        {
+            UCIInterface uci;
+            assert(!uci.Initialize("/nonexistent/engine"));
+            assert(!uci.IsRunning());
+        }
+        std::cout << " Start failure reported" << std::endl;
+
+        std::cout << "\n All UCI interface tests passed!" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << " Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "thread_scheduler.h"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace StockfishBinding {
+
+namespace {
+
+// sysfs CPU list: "0-7,16-23"
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        int first = 0, last = 0;
+        char dash = 0;
+        std::istringstream bounds(range);
+        if (!(bounds >> first)) continue;
+        last = first;
+        if (bounds >> dash && dash == '-') {
+            bounds >> last;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// The inverse, with consecutive CPUs folded into ranges
+std::string format_cpu_list(std::vector<int> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+    std::string out;
+    for (size_t i = 0; i < cpus.size(); ) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!out.empty()) out += ',';
+        out += std::to_string(cpus[i]);
+        if (j > i) out += '-' + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out;
+}
+
+} // namespace
+
+// CpuTopology
+
+CpuTopology::CpuTopology(std::vector<NumaNode> nodes) {
+    for (auto& node : nodes) {
+        if (!node.cpus.empty()) {
+            cpus_ += node.cpus.size();
+            nodes_.push_back(std::move(node));
+        }
+    }
+    if (nodes_.empty()) {
+        nodes_.push_back({0, {0}});
+        cpus_ = 1;
+    }
+}
+
+CpuTopology CpuTopology::detect() {
+    std::vector<NumaNode> nodes;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string ids;
+    if (online && std::getline(online, ids)) {
+        for (int id : parse_cpu_list(ids)) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string cpus;
+            if (!list || !std::getline(list, cpus)) continue;
+
+            NumaNode node;
+            node.id = id;
+            for (int cpu : parse_cpu_list(cpus)) {
+                if (!masked || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            nodes.push_back(std::move(node));
+        }
+    }
+#endif
+
+    if (nodes.empty() || std::all_of(nodes.begin(), nodes.end(), [](const NumaNode& n) { return n.cpus.empty(); })) {
+        NumaNode node;
+        unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < count; ++cpu) {
+            node.cpus.push_back(static_cast<int>(cpu));
+        }
+        nodes.assign(1, std::move(node));
+    }
+    return CpuTopology(std::move(nodes));
+}
+
+std::string CpuTopology::numa_policy(const std::vector<size_t>& nodes) const {
+    std::string policy;
+    for (size_t index : nodes) {
+        if (index >= nodes_.size()) continue;
+        if (!policy.empty()) policy += ':';
+        policy += format_cpu_list(nodes_[index].cpus);
+    }
+    return policy;
+}
+
+// Grant
+
+ThreadScheduler::Grant::Grant(ThreadScheduler* scheduler, std::vector<size_t> taken, std::string policy)
+    : scheduler_(scheduler), taken_(std::move(taken)), policy_(std::move(policy)) {
+}
+
+ThreadScheduler::Grant::Grant(Grant&& other) noexcept
+    : scheduler_(std::exchange(other.scheduler_, nullptr)),
+      taken_(std::move(other.taken_)),
+      policy_(std::move(other.policy_)) {
+}
+
+ThreadScheduler::Grant& ThreadScheduler::Grant::operator=(Grant&& other) noexcept {
+    if (this != &other) {
+        release();
+        scheduler_ = std::exchange(other.scheduler_, nullptr);
+        taken_ = std::move(other.taken_);
+        policy_ = std::move(other.policy_);
+    }
+    return *this;
+}
+
+ThreadScheduler::Grant::~Grant() {
+    release();
+}
+
+size_t ThreadScheduler::Grant::threads() const {
+    return std::accumulate(taken_.begin(), taken_.end(), size_t(0));
+}
+
+size_t ThreadScheduler::Grant::node() const {
+    size_t node = Spanning;
+    for (size_t i = 0; i < taken_.size(); ++i) {
+        if (taken_[i] == 0) continue;
+        if (node != Spanning) return Spanning;
+        node = i;
+    }
+    return node;
+}
+
+void ThreadScheduler::Grant::release() {
+    if (scheduler_) {
+        scheduler_->give_back(taken_);
+    }
+    scheduler_ = nullptr;
+    taken_.clear();
+    policy_.clear();
+}
+
+// ThreadScheduler
+
+ThreadScheduler::ThreadScheduler(CpuTopology topology)
+    : topology_(std::move(topology)) {
+    for (const auto& node : topology_.nodes()) {
+        free_.push_back(node.cpus.size());
+    }
+}
+
+ThreadScheduler::Grant ThreadScheduler::acquire(size_t threads, size_t preferred_node,
+                                                const std::atomic<bool>* cancel) {
+    threads = std::clamp<size_t>(threads, 1, capacity());
+    auto cancelled = [cancel] { return cancel && cancel->load(); };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t ticket = next_ticket_++;
+    queue_.push_back(ticket);
+
+    std::vector<size_t> taken;
+    changed_.wait(lock, [&] {
+        return cancelled() || (queue_.front() == ticket && place_locked(threads, preferred_node, taken));
+    });
+    queue_.erase(std::find(queue_.begin(), queue_.end(), ticket));
+
+    // Whoever is next in line may fit in what is left
+    changed_.notify_all();
+    if (cancelled()) {
+        return Grant();
+    }
+    return grant_locked(std::move(taken));
+}
+
+ThreadScheduler::Grant ThreadScheduler::try_acquire(size_t threads, size_t preferred_node) {
+    threads = std::clamp<size_t>(threads, 1, capacity());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<size_t> taken;
+    if (!queue_.empty() || !place_locked(threads, preferred_node, taken)) {
+        return Grant();
+    }
+    return grant_locked(std::move(taken));
+}
+
+void ThreadScheduler::interrupt() {
+    // Taking the lock orders this after a waiter's last check of its flag
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    changed_.notify_all();
+}
+
+size_t ThreadScheduler::in_use() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity() - std::accumulate(free_.begin(), free_.end(), size_t(0));
+}
+
+size_t ThreadScheduler::waiting() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+// A request that fits on one node goes to the preferred node if it has
+// room, else to the node with the most free CPUs; it waits rather than
+// spill over. Only a request larger than every node spans them, taking
+// the most free nodes first.
+bool ThreadScheduler::place_locked(size_t threads, size_t preferred, std::vector<size_t>& taken) const {
+    const auto& nodes = topology_.nodes();
+    taken.assign(nodes.size(), 0);
+
+    size_t largest = 0;
+    for (const auto& node : nodes) {
+        largest = std::max(largest, node.cpus.size());
+    }
+
+    if (threads <= largest) {
+        size_t best = std::max_element(free_.begin(), free_.end()) - free_.begin();
+        if (preferred < free_.size() && free_[preferred] >= threads) {
+            best = preferred;
+        }
+        if (free_[best] < threads) return false;
+        taken[best] = threads;
+        return true;
+    }
+
+    if (std::accumulate(free_.begin(), free_.end(), size_t(0)) < threads) return false;
+
+    std::vector<size_t> order(nodes.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return free_[a] > free_[b]; });
+
+    size_t left = threads;
+    for (size_t i : order) {
+        taken[i] = std::min(free_[i], left);
+        left -= taken[i];
+    }
+    return true;
+}
+
+ThreadScheduler::Grant ThreadScheduler::grant_locked(std::vector<size_t> taken) {
+    std::vector<size_t> nodes;
+    for (size_t i = 0; i < taken.size(); ++i) {
+        if (taken[i] == 0) continue;
+        free_[i] -= taken[i];
+        nodes.push_back(i);
+    }
+    return Grant(this, std::move(taken), topology_.numa_policy(nodes));
+}
+
+void ThreadScheduler::give_back(const std::vector<size_t>& taken) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < taken.size() && i < free_.size(); ++i) {
+            free_[i] += taken[i];
+        }
+    }
+    changed_.notify_all();
+}
+
+} // namespace StockfishBinding
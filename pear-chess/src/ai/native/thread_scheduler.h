@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace StockfishBinding {
+
+// CPUs of one NUMA node, as the OS numbers them
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+// The CPUs this process may run on, grouped by NUMA node
+class CpuTopology {
+public:
+    explicit CpuTopology(std::vector<NumaNode> nodes);
+
+    // Nodes from /sys/devices/system/node, less the CPUs outside the
+    // process's affinity mask. Elsewhere, or when sysfs is unreadable, one
+    // node holding hardware_concurrency() CPUs.
+    static CpuTopology detect();
+
+    const std::vector<NumaNode>& nodes() const { return nodes_; }
+    size_t cpus() const { return cpus_; }
+
+    // Stockfish NumaPolicy value confining threads to the given nodes, one
+    // group per node: "0-7,16-23" or "0-7:8-15"
+    std::string numa_policy(const std::vector<size_t>& nodes) const;
+
+private:
+    std::vector<NumaNode> nodes_;
+    size_t cpus_ = 0;
+};
+
+// Hands out CPUs to searches so that all engines together never run more
+// search threads than the machine has. A request is placed on a single
+// node when it fits one, which keeps its threads, transposition table and
+// network weights on that node's memory; a larger one spans the nodes.
+// Requests that do not fit yet wait, and are served in arrival order so a
+// large one is not starved by a stream of small ones.
+class ThreadScheduler {
+public:
+    // CPUs held for one search or lease, returned when it is destroyed
+    class Grant {
+    public:
+        Grant() = default;
+        Grant(Grant&& other) noexcept;
+        Grant& operator=(Grant&& other) noexcept;
+        Grant(const Grant&) = delete;
+        Grant& operator=(const Grant&) = delete;
+        ~Grant();
+
+        explicit operator bool() const { return scheduler_ != nullptr; }
+        size_t threads() const;
+
+        // Index into CpuTopology::nodes(), or Spanning
+        static constexpr size_t Spanning = static_cast<size_t>(-1);
+        size_t node() const;
+
+        // NumaPolicy binding the search's threads to the granted nodes
+        const std::string& numa_policy() const { return policy_; }
+
+        void release();
+
+    private:
+        friend class ThreadScheduler;
+        Grant(ThreadScheduler* scheduler, std::vector<size_t> taken, std::string policy);
+
+        ThreadScheduler* scheduler_ = nullptr;
+        std::vector<size_t> taken_;  // CPUs held per node
+        std::string policy_;
+    };
+
+    explicit ThreadScheduler(CpuTopology topology = CpuTopology::detect());
+
+    // Grants must not outlive the scheduler
+    ThreadScheduler(const ThreadScheduler&) = delete;
+    ThreadScheduler& operator=(const ThreadScheduler&) = delete;
+
+    // Blocks until threads CPUs are free, on preferred_node if it has
+    // room, else on the node with the most free. Requests above capacity()
+    // are cut to it. Returns an empty grant once cancel is set; setting it
+    // must be followed by interrupt() to wake the waiter.
+    Grant acquire(size_t threads, size_t preferred_node = Grant::Spanning,
+                  const std::atomic<bool>* cancel = nullptr);
+
+    // Never blocks, and never jumps the queue; empty if it would wait
+    Grant try_acquire(size_t threads, size_t preferred_node = Grant::Spanning);
+
+    // Wakes blocked acquire() calls to check their cancel flags
+    void interrupt();
+
+    const CpuTopology& topology() const { return topology_; }
+    size_t capacity() const { return topology_.cpus(); }
+    size_t in_use() const;
+    size_t waiting() const;
+
+private:
+    bool place_locked(size_t threads, size_t preferred, std::vector<size_t>& taken) const;
+    Grant grant_locked(std::vector<size_t> taken);
+    void give_back(const std::vector<size_t>& taken);
+
+    const CpuTopology topology_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<size_t> free_;    // Free CPUs per node
+    std::deque<uint64_t> queue_;  // Tickets of blocked acquire() calls
+    uint64_t next_ticket_ = 0;
+};
+
+} // namespace StockfishBinding
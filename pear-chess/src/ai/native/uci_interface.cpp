@@ -1,172 +1,357 @@
 /**
  * Pear's Gambit - UCI Interface Implementation
- * 
+ *
  * Low-level UCI protocol communication
  */
 
 #include "uci_interface.h"
-#include <iostream>
-#include <sstream>
+#include "metrics.h"
+#include <algorithm>
 #include <chrono>
-#include <thread>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+// Engine process and the parent's ends of its stdin/stdout
+struct Process {
+#ifndef _WIN32
+    pid_t pid = -1;
+    int stdin_fd = -1;   // Socket, so writes can suppress SIGPIPE
+    int stdout_fd = -1;  // Pipe read end
+#endif
+};
+
+#ifndef _WIN32
+[[maybe_unused]] static void SetCloseOnExec(int fd) {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+// Every end is close-on-exec from the start, so an engine spawned from
+// another thread meanwhile inherits none of them; dup2() onto the child's
+// stdin/stdout clears the flag on the copies it keeps. Where the flags
+// cannot be passed at creation they are set right after.
+static bool OpenSocketPair(int fds[2]) {
+#ifdef SOCK_CLOEXEC
+    return socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0;
+#else
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    SetCloseOnExec(fds[0]);
+    SetCloseOnExec(fds[1]);
+    return true;
+#endif
+}
+
+static bool OpenPipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+    SetCloseOnExec(fds[0]);
+    SetCloseOnExec(fds[1]);
+    return true;
+#endif
+}
+#endif
 
 // Constructor
-UCIInterface::UCIInterface() : process_(nullptr), running_(false) {}
+UCIInterface::UCIInterface() : process_(nullptr), running_(false), history_(kHistorySize) {}
 
 // Destructor
 UCIInterface::~UCIInterface() {
     Shutdown();
 }
 
-// Initialize UCI interface
-void UCIInterface::Initialize() {
+// Spawn the engine and start reading its output
+bool UCIInterface::Initialize(const std::string& engine_path, const std::vector<std::string>& args) {
     if (running_) {
-        return;
+        return true;
+    }
+
+#ifdef _WIN32
+    BINDING_LOG(Error, "UCIInterface: external engines are not supported on Windows yet");
+    return false;
+#else
+    // stdin is a socket pair rather than a pipe so a dead engine turns
+    // writes into EPIPE instead of a process-wide SIGPIPE
+    int in_fds[2];
+    int out_fds[2];
+    if (!OpenSocketPair(in_fds)) {
+        return false;
+    }
+    if (!OpenPipe(out_fds)) {
+        close(in_fds[0]);
+        close(in_fds[1]);
+        return false;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(in_fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in_fds[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, in_fds[1]);
+    posix_spawn_file_actions_addclose(&actions, out_fds[1]);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(engine_path.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = -1;
+    int status = posix_spawnp(&pid, engine_path.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // The child owns its ends now
+    close(in_fds[1]);
+    close(out_fds[1]);
+
+    if (status != 0) {
+        BINDING_LOG(Error, "UCIInterface: failed to start " << engine_path);
+        close(in_fds[0]);
+        close(out_fds[0]);
+        return false;
+    }
+
+    process_ = std::make_unique<Process>();
+    process_->pid = pid;
+    process_->stdin_fd = in_fds[0];
+    process_->stdout_fd = out_fds[0];
+
+    {
+        std::lock_guard<std::mutex> lock(response_mutex_);
+        next_seq_ = 0;
+        command_seq_ = 0;
     }
-    
-    // For native binding, we don't spawn a process
-    // Instead, we would integrate directly with Stockfish source
-    // This is a simplified implementation
-    
     running_ = true;
-    
+
     // Start reader thread
     reader_thread_ = std::thread(&UCIInterface::ReaderLoop, this);
+    return true;
+#endif
 }
 
 // Shutdown interface
 void UCIInterface::Shutdown() {
-    if (!running_) {
+    if (!process_) {
         return;
     }
-    
+
+#ifndef _WIN32
+    if (running_) {
+        SendCommand("quit");
+    }
     running_ = false;
-    
-    // Signal shutdown
+
+    // EOF on stdin makes well-behaved engines exit even if quit was lost
+    ::shutdown(process_->stdin_fd, SHUT_WR);
+
+    // Give the engine a second to exit on its own, then kill it
+    int status = 0;
+    bool exited = false;
+    for (int i = 0; i < 100 && !exited; ++i) {
+        exited = waitpid(process_->pid, &status, WNOHANG) == process_->pid;
+        if (!exited) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    if (!exited) {
+        kill(process_->pid, SIGKILL);
+        waitpid(process_->pid, &status, 0);
+    }
+
+    // The reader sees EOF once the process is gone
     if (reader_thread_.joinable()) {
         reader_thread_.join();
     }
-    
-    // Clean up process if any
-    if (process_) {
-        // Terminate process
-        process_ = nullptr;
-    }
+
+    close(process_->stdin_fd);
+    close(process_->stdout_fd);
+#endif
+
+    process_ = nullptr;
+    FailWaiters("Engine shut down");
 }
 
 // Send command to engine
 bool UCIInterface::SendCommand(const std::string& command) {
-    if (!running_) {
+    if (!running_ || !process_) {
         return false;
     }
-    
-    // In a real implementation, this would send to Stockfish
-    // For now, simulate common responses
-    SimulateResponse(command);
-    
+
+    // Only lines read from here on can answer this command
+    {
+        std::lock_guard<std::mutex> lock(response_mutex_);
+        command_seq_ = next_seq_;
+    }
+
+#ifdef _WIN32
+    return false;
+#else
+    std::string line = command + "\n";
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t written = 0;
+    while (written < line.size()) {
+#ifdef MSG_NOSIGNAL
+        ssize_t n = send(process_->stdin_fd, line.data() + written, line.size() - written, MSG_NOSIGNAL);
+#else
+        ssize_t n = send(process_->stdin_fd, line.data() + written, line.size() - written, 0);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
     return true;
+#endif
 }
 
 // Send command and wait for response
-std::string UCIInterface::SendCommandAndWait(const std::string& command, const std::string& expected) {
+std::string UCIInterface::SendCommandAndWait(const std::string& command, const std::string& expected, int timeout_ms) {
     if (!SendCommand(command)) {
         return "";
     }
-    
-    return WaitForResponse(expected);
+
+    return WaitForResponse(expected, timeout_ms);
 }
 
 // Wait for specific response
 std::string UCIInterface::WaitForResponse(const std::string& expected, int timeout_ms) {
-    auto start = std::chrono::steady_clock::now();
-    
-    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(timeout_ms)) {
+    auto waiter = std::make_shared<Waiter>();
+    waiter->expected = expected;
+    auto future = waiter->promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(response_mutex_);
+
+        // The answer may already be in; only scan what the ring still holds
+        uint64_t first = next_seq_ > kHistorySize ? next_seq_ - kHistorySize : 0;
+        for (uint64_t seq = std::max(first, command_seq_); seq < next_seq_; ++seq) {
+            const auto& line = history_[seq % kHistorySize];
+            if (line.find(expected) != std::string::npos) {
+                return line;
+            }
+        }
+
+        if (!running_) {
+            throw std::runtime_error("Engine not running, waiting for: " + expected);
+        }
+        waiters_.push_back(waiter);
+    }
+
+    if (future.wait_for(std::chrono::milliseconds(timeout_ms)) != std::future_status::ready) {
         std::lock_guard<std::mutex> lock(response_mutex_);
-        
-        for (const auto& response : recent_responses_) {
-            if (response.find(expected) != std::string::npos) {
-                return response;
+        for (auto it = waiters_.begin(); it != waiters_.end(); ++it) {
+            if (*it == waiter) {
+                waiters_.erase(it);
+                throw std::runtime_error("Timeout waiting for: " + expected);
             }
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Answered between the timeout and taking the lock
     }
-    
-    throw std::runtime_error("Timeout waiting for: " + expected);
+
+    return future.get();
 }
 
 // Set response callback
 void UCIInterface::SetResponseCallback(ResponseCallback callback) {
-    response_callback_ = callback;
+    std::lock_guard<std::mutex> lock(response_mutex_);
+    response_callback_ = std::move(callback);
 }
 
-// Reader thread loop
+// Reader thread loop: blocks in read() until output or EOF
 void UCIInterface::ReaderLoop() {
-    while (running_) {
-        // In a real implementation, this would read from Stockfish process
-        // For now, just sleep
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+#ifndef _WIN32
+    char buffer[4096];
+    std::string pending;
+
+    while (true) {
+        ssize_t n = read(process_->stdout_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        pending.append(buffer, static_cast<size_t>(n));
+
+        size_t start = 0;
+        size_t newline;
+        while ((newline = pending.find('\n', start)) != std::string::npos) {
+            size_t end = newline;
+            if (end > start && pending[end - 1] == '\r') {
+                --end;
+            }
+            ProcessResponse(pending.substr(start, end - start));
+            start = newline + 1;
+        }
+        pending.erase(0, start);
     }
+#endif
+
+    running_ = false;
+    FailWaiters("Engine exited");
 }
 
 // Process response from engine
 void UCIInterface::ProcessResponse(const std::string& response) {
+    std::vector<std::shared_ptr<Waiter>> answered;
+    ResponseCallback callback;
     {
         std::lock_guard<std::mutex> lock(response_mutex_);
-        recent_responses_.push_back(response);
-        
-        // Keep only recent responses
-        if (recent_responses_.size() > 100) {
-            recent_responses_.erase(recent_responses_.begin());
+        callback = response_callback_;
+        history_[next_seq_ % kHistorySize] = response;
+        ++next_seq_;
+
+        for (auto it = waiters_.begin(); it != waiters_.end(); ) {
+            if (response.find((*it)->expected) != std::string::npos) {
+                answered.push_back(std::move(*it));
+                it = waiters_.erase(it);
+            } else {
+                ++it;
+            }
         }
     }
-    
-    // Call callback if set
-    if (response_callback_) {
-        response_callback_(response);
+
+    // Wake the waiters outside the lock
+    for (auto& waiter : answered) {
+        waiter->promise.set_value(response);
+    }
+
+    // Call callback if set; it may send commands, so not under the lock
+    if (callback) {
+        callback(response);
     }
 }
 
-// Simulate engine responses (for development)
-void UCIInterface::SimulateResponse(const std::string& command) {
-    std::string response;
-    
-    if (command == "uci") {
-        response = "id name Stockfish 16\n";
-        response += "id author The Stockfish developers\n";
-        response += "option name Hash type spin default 16 min 1 max 33554432\n";
-        response += "option name Threads type spin default 1 min 1 max 1024\n";
-        response += "option name Skill Level type spin default 20 min 0 max 20\n";
-        response += "uciok";
-    } else if (command == "isready") {
-        response = "readyok";
-    } else if (command == "ucinewgame") {
-        response = ""; // No response expected
-    } else if (command.starts_with("position")) {
-        response = ""; // No response expected
-    } else if (command.starts_with("go")) {
-        // Simulate analysis
-        response = "info depth 1 score cp 20 nodes 100 pv e2e4\n";
-        response += "info depth 5 score cp 25 nodes 5000 pv e2e4 e7e5\n";
-        response += "info depth 10 score cp 30 nodes 50000 pv e2e4 e7e5 g1f3\n";
-        response += "bestmove e2e4 ponder e7e5";
-    } else if (command == "stop") {
-        response = "bestmove (none)";
-    } else if (command == "quit") {
-        running_ = false;
-        return;
+// Wake every waiter with an error once no more output can arrive
+void UCIInterface::FailWaiters(const std::string& reason) {
+    std::vector<std::shared_ptr<Waiter>> failed;
+    {
+        std::lock_guard<std::mutex> lock(response_mutex_);
+        failed.swap(waiters_);
     }
-    
-    if (!response.empty()) {
-        // Simulate async response
-        std::thread([this, response]() {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            
-            std::istringstream iss(response);
-            std::string line;
-            while (std::getline(iss, line)) {
-                ProcessResponse(line);
-            }
-        }).detach();
+
+    for (auto& waiter : failed) {
+        waiter->promise.set_exception(std::make_exception_ptr(
+            std::runtime_error(reason + ", waiting for: " + waiter->expected)));
     }
-}
\ No newline at end of file
+}
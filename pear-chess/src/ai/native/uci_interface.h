@@ -1,6 +1,6 @@
 /**
  * Pear's Gambit - UCI Interface Header
- * 
+ *
  * Low-level UCI protocol communication
  */
 
@@ -10,9 +10,11 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <future>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <cstdint>
 
 // Forward declarations for process handling
 struct Process;
@@ -22,43 +24,61 @@ using ResponseCallback = std::function<void(const std::string&)>;
 
 /**
  * UCI Interface for communication with chess engines
- * Handles low-level UCI protocol communication
+ * Handles low-level UCI protocol communication with an external engine
+ * binary (another Stockfish build, Lc0, ...) over its stdin/stdout
  */
 class UCIInterface {
 public:
     UCIInterface();
     ~UCIInterface();
-    
-    // Lifecycle
-    void Initialize();
+
+    // Lifecycle. Initialize spawns the engine process; args are passed
+    // after the program name. Returns false if the process cannot start.
+    bool Initialize(const std::string& engine_path, const std::vector<std::string>& args = {});
     void Shutdown();
-    
-    // Communication
+
+    // Communication. WaitForResponse returns the first line containing
+    // expected that arrived since the last SendCommand, sleeping until it
+    // does; throws std::runtime_error on timeout or engine exit.
     bool SendCommand(const std::string& command);
-    std::string SendCommandAndWait(const std::string& command, const std::string& expected);
+    std::string SendCommandAndWait(const std::string& command, const std::string& expected, int timeout_ms = 5000);
     std::string WaitForResponse(const std::string& expected, int timeout_ms = 5000);
-    
-    // Callbacks
+
+    // Callbacks. Runs on the reader thread for every line. May be set at
+    // any time; a line being delivered may still reach the previous one.
     void SetResponseCallback(ResponseCallback callback);
-    
+
     // Status
     bool IsRunning() const { return running_; }
 
 private:
+    struct Waiter {
+        std::string expected;
+        std::promise<std::string> promise;
+    };
+
     // Internal methods
     void ReaderLoop();
     void ProcessResponse(const std::string& response);
-    void SimulateResponse(const std::string& command); // For development
-    
+    void FailWaiters(const std::string& reason);
+
     // State
     std::unique_ptr<Process> process_;
     std::atomic<bool> running_;
-    
+
     // Threading
     std::thread reader_thread_;
+    std::mutex write_mutex_;
     std::mutex response_mutex_;
-    std::vector<std::string> recent_responses_;
-    
-    // Callbacks
+
+    // Recent lines in a fixed ring indexed by sequence number, so the
+    // history never shifts and old lines are simply overwritten
+    static constexpr size_t kHistorySize = 256;
+    std::vector<std::string> history_;
+    uint64_t next_seq_ = 0;     // Sequence number of the next line read
+    uint64_t command_seq_ = 0;  // First line that can answer the last command
+    std::vector<std::shared_ptr<Waiter>> waiters_;
+
+    // Callbacks, under response_mutex_
     ResponseCallback response_callback_;
-};
\ No newline at end of file
+};
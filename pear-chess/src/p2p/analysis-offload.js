@@ -0,0 +1,569 @@
+/**
+ * Pear's Gambit - Distributed Analysis
+ *
+ * Splits game reviews into one job per position and spreads them over
+ * opted-in peers of the game's swarm connection, with the local engine
+ * taking whatever the peers do not answer in time
+ */
+
+import { Chess } from 'chess.js'
+import { analysisKey } from './analysis-store.js'
+
+const MAX_LINES = 8
+const MAX_PV = 64
+const MAX_SCORE = 100000
+const UCI_MOVE = /^[a-h][1-8][a-h][1-8][nbrq]?$/
+const MAX_FAILURES = 3  // Timeouts or bad results before a peer gets no more jobs
+
+// Limits a job may carry; anything else in a peer's request is dropped
+const JOB_LIMITS = ['depth', 'nodes', 'movetime', 'multiPV']
+
+// Limits of a job, each held to what we serve (options maxDepth, maxNodes
+// and maxMovetime), so no request ties up the engine for longer
+function jobLimits(limits, caps) {
+  const out = {}
+  for (const name of JOB_LIMITS) {
+    if (Number.isInteger(limits[name]) && limits[name] > 0) out[name] = limits[name]
+  }
+  if (out.depth) out.depth = Math.min(out.depth, caps.maxDepth)
+  if (out.nodes) out.nodes = Math.min(out.nodes, caps.maxNodes)
+  if (out.movetime) out.movetime = Math.min(out.movetime, caps.maxMovetime)
+  if (out.multiPV) out.multiPV = Math.min(out.multiPV, MAX_LINES)
+  if (!out.depth && !out.nodes && !out.movetime) out.depth = Math.min(15, caps.maxDepth)
+  return out
+}
+
+/**
+ * Whether a local search of a job bears out a peer's analysis of it: the
+ * same best move, or a best-line score within margin centipawns (mates
+ * must at least agree on who mates)
+ */
+export function analysesAgree(remote, local, margin) {
+  if (remote.bestMove === local.bestMove) return true
+
+  const theirs = remote.lines[0].score
+  const ours = local.lines[0]?.score
+  if (!ours || theirs.unit !== ours.unit) return false
+  if (theirs.unit === 'mate') return Math.sign(theirs.value) === Math.sign(ours.value)
+  return Math.abs(theirs.value - ours.value) <= margin
+}
+
+/**
+ * Positions of a game, ply 0 (fen) first, with the move that led to each.
+ * Stops at the first illegal move.
+ */
+export function gamePositions(fen, moves) {
+  const game = new Chess(fen)
+  const positions = [{ ply: 0, fen: game.fen(), move: '' }]
+  for (const uci of moves) {
+    let move = null
+    try {
+      move = game.move({ from: uci.slice(0, 2), to: uci.slice(2, 4), promotion: uci[4] })
+    } catch {
+      move = null
+    }
+    if (!move) break
+    positions.push({ ply: positions.length, fen: game.fen(), move: uci })
+  }
+  return positions
+}
+
+/**
+ * Whether a peer's analysis of fen (the shape of engine.analyze()) is
+ * well formed, reaches the requested depth and only plays legal moves.
+ * Scores cannot be checked without searching again; run() does that for
+ * a sample of results.
+ */
+export function isValidAnalysis(fen, limits, analysis) {
+  if (!analysis || typeof analysis !== 'object') return false
+  if (typeof analysis.bestMove !== 'string' || !UCI_MOVE.test(analysis.bestMove)) return false
+  if (!Number.isInteger(analysis.depth) || analysis.depth < 1 || analysis.depth > 245) return false
+  if (limits.depth && analysis.depth < limits.depth) return false
+
+  const lines = analysis.lines
+  if (!Array.isArray(lines) || lines.length < 1 || lines.length > MAX_LINES) return false
+
+  for (const line of lines) {
+    if (!line || !Array.isArray(line.moves) || line.moves.length < 1 || line.moves.length > MAX_PV) return false
+    if (!line.score || !['cp', 'mate'].includes(line.score.unit)) return false
+    if (!Number.isInteger(line.score.value) || Math.abs(line.score.value) > MAX_SCORE) return false
+
+    const game = new Chess(fen)
+    for (const uci of line.moves) {
+      if (typeof uci !== 'string' || !UCI_MOVE.test(uci)) return false
+      try {
+        if (!game.move({ from: uci.slice(0, 2), to: uci.slice(2, 4), promotion: uci[4] })) return false
+      } catch {
+        return false
+      }
+    }
+  }
+  return lines[0].moves[0] === analysis.bestMove
+}
+
+// Copy of a verified analysis with only the fields we read
+function cleanAnalysis(fen, analysis) {
+  return {
+    fen,
+    bestMove: analysis.bestMove,
+    depth: analysis.depth,
+    lines: analysis.lines.map(line => ({
+      moves: line.moves.slice(),
+      score: { unit: line.score.unit, value: line.score.value },
+      depth: Number.isInteger(line.depth) ? line.depth : analysis.depth
+    }))
+  }
+}
+
+/**
+ * Analysis Offload
+ * Sends position jobs over a swarm transport (see GameSync) and serves the
+ * jobs of other peers when opted in. A share of each peer's results is
+ * searched again locally; a peer whose result disagrees gets no more jobs,
+ * and its other results in the review are searched locally too. Results no
+ * local search checked come back marked untrusted. Wire messages:
+ *   analysis_worker { slots, maxDepth }      - peer takes jobs (slots 0: no longer)
+ *   analysis_job    { jobId, key, fen, limits }
+ *   analysis_result { jobId, key, analysis }
+ *   analysis_reject { jobId, reason }
+ */
+export class AnalysisOffload {
+  constructor(options = {}) {
+    this.options = {
+      serve: false,          // Take other peers' jobs on the local engine
+      slots: 1,              // Jobs served at once
+      maxDepth: 24,          // Deepest job served, and sent
+      maxNodes: 20000000,    // Largest node limit served
+      maxMovetime: 10000,    // Longest movetime served, in ms
+      localSlots: 1,         // Jobs searched locally during a review
+      jobTimeout: 30000,     // ms a peer has for one job before it runs locally
+      verifyShare: 0.1,      // Share of peer results searched again locally
+      verifyMargin: 100,     // Centipawns a checked score may be off by
+      debug: false,
+      ...options
+    }
+
+    this.engine = options.engine || null        // Anything with analyze(fen, options)
+    this.transport = options.transport || null  // { sendToPeer(peerId, message) }
+
+    // State
+    this.workers = new Map()   // peerId -> { slots, maxDepth, busy, failures }
+    this.pending = new Map()   // jobId -> job sent to a peer
+    this.serving = 0
+    this.nextJobId = 1
+    this.reviewing = Promise.resolve()
+    this.stats = { remote: 0, local: 0, timeouts: 0, rejected: 0, invalid: 0, served: 0, verified: 0, disputed: 0 }
+
+    // Wakes the running review when a worker frees up or joins
+    this.onCapacity = null
+  }
+
+  /**
+   * A peer connected; tell it whether we take jobs
+   */
+  addPeer(peerId) {
+    if (this.options.serve) {
+      this.announce(peerId)
+    }
+  }
+
+  /**
+   * A peer left; its jobs go back to the queue at once
+   */
+  removePeer(peerId) {
+    this.workers.delete(peerId)
+    for (const sent of this.pending.values()) {
+      if (sent.peerId === peerId) this.giveBack(sent, 'timeouts')
+    }
+  }
+
+  /**
+   * Start or stop serving, telling the given peers
+   */
+  setServing(serve, peerIds = []) {
+    this.options.serve = Boolean(serve)
+    for (const peerId of peerIds) {
+      this.announce(peerId)
+    }
+  }
+
+  announce(peerId) {
+    if (!this.transport) return
+    this.transport.sendToPeer(peerId, {
+      type: 'analysis_worker',
+      slots: this.options.serve && this.engine ? this.options.slots : 0,
+      maxDepth: this.options.maxDepth,
+      timestamp: Date.now()
+    })
+  }
+
+  /**
+   * Handle an analysis_* message; false for other message types
+   */
+  handleMessage(message, peerId) {
+    switch (message.type) {
+      case 'analysis_worker':
+        this.handleWorker(message, peerId)
+        return true
+
+      case 'analysis_job':
+        this.handleJob(message, peerId).catch(error => this.log('Failed to serve job:', error))
+        return true
+
+      case 'analysis_result':
+        this.handleResult(message, peerId)
+        return true
+
+      case 'analysis_reject':
+        this.handleReject(message, peerId)
+        return true
+
+      default:
+        return false
+    }
+  }
+
+  handleWorker(message, peerId) {
+    const slots = Math.min(Number.isInteger(message.slots) ? message.slots : 0, 16)
+    if (slots <= 0) {
+      this.workers.delete(peerId)
+      return
+    }
+    // Jobs in flight hold the worker object, so update it in place
+    const worker = this.workers.get(peerId) || { busy: 0, failures: 0 }
+    worker.slots = slots
+    worker.maxDepth = Number.isInteger(message.maxDepth) ? message.maxDepth : 0
+    this.workers.set(peerId, worker)
+    this.log(`Peer ${peerId} takes ${slots} analysis jobs`)
+    this.wake()
+  }
+
+  /**
+   * Search a peer's job on the local engine, at review priority so our own
+   * games come first
+   */
+  async handleJob(message, peerId) {
+    const reject = (reason) => this.transport.sendToPeer(peerId, { type: 'analysis_reject', jobId: message.jobId, reason })
+
+    if (!this.options.serve || !this.engine) return reject('not serving')
+    if (this.serving >= this.options.slots) return reject('busy')
+    if (typeof message.fen !== 'string' || analysisKey(message.fen) !== message.key) return reject('bad position')
+
+    const limits = jobLimits(message.limits || {}, this.options)
+    this.serving++
+    try {
+      new Chess(message.fen)  // Throws on a malformed FEN
+      const analysis = await this.engine.analyze(message.fen, { ...limits, priority: 'review' })
+      this.stats.served++
+      this.transport.sendToPeer(peerId, {
+        type: 'analysis_result',
+        jobId: message.jobId,
+        key: message.key,
+        analysis: cleanAnalysis(message.fen, analysis)
+      })
+    } catch (error) {
+      reject('failed')
+    } finally {
+      this.serving--
+    }
+  }
+
+  handleResult(message, peerId) {
+    const sent = this.pending.get(message.jobId)
+    if (!sent || sent.peerId !== peerId) return  // Late, after a timeout, or not ours
+
+    const { job } = sent
+    if (message.key !== job.key || !isValidAnalysis(job.fen, sent.limits, message.analysis)) {
+      this.log(`Invalid analysis from ${peerId} for job ${sent.jobId}`)
+      sent.worker.failures++
+      this.giveBack(sent, 'invalid')
+      return
+    }
+
+    this.settle(sent)
+    this.stats.remote++
+    sent.resolve(cleanAnalysis(job.fen, message.analysis))
+  }
+
+  handleReject(message, peerId) {
+    const sent = this.pending.get(message.jobId)
+    if (!sent || sent.peerId !== peerId) return
+    this.log(`Peer ${peerId} rejected job ${sent.jobId}: ${message.reason}`)
+    this.giveBack(sent, 'rejected')
+  }
+
+  /**
+   * Analyse every position of a game, spread over the local engine and
+   * the peers that take jobs
+   * @param {string} fen - Starting position
+   * @param {string[]} moves - Moves in UCI notation
+   * @param {Object} limits - depth, nodes, movetime and multiPV per position
+   * @returns {Promise<Object[]>} One entry per ply: { ply, move, fen, analysis }
+   */
+  async analyzeGame(fen, moves, limits = {}) {
+    const [game] = await this.analyzeGames([{ fen, moves }], limits)
+    return game
+  }
+
+  /**
+   * analyzeGame() for several games at once. A position reached in more
+   * than one game, or twice in one, is searched once.
+   */
+  async analyzeGames(games, limits = {}) {
+    // One review at a time: the jobs of a review share its workers' slots
+    const review = this.reviewing.then(() => this.review(games, limits))
+    this.reviewing = review.catch(() => {})
+    return review
+  }
+
+  async review(games, limits) {
+    const jobLimit = jobLimits(limits, this.options)
+    const plies = games.map(({ fen, moves }) => gamePositions(fen, moves))
+
+    const byKey = new Map()
+    for (const positions of plies) {
+      for (const position of positions) {
+        const key = analysisKey(position.fen)
+        if (!byKey.has(key)) byKey.set(key, { key, fen: position.fen })
+      }
+    }
+
+    const results = await this.run(Array.from(byKey.values()), jobLimit)
+    return plies.map(positions => positions.map(position => ({
+      ...position,
+      analysis: results.get(analysisKey(position.fen))
+    })))
+  }
+
+  /**
+   * Work through positions: each free local slot or peer slot takes the
+   * next one. Jobs a peer fails or times out on go back to the queue, and
+   * only the local engine takes them the second time round, or any peer
+   * still in good standing when there is no local engine or it has no
+   * slots. A local search that fails goes back to the queue as well, up to
+   * MAX_FAILURES times.
+   */
+  async run(positions, limits) {
+    const results = new Map()
+    const queue = positions.map(position => ({ ...position, limits, remoteTries: 0, localTries: 0 }))
+    const unchecked = new Map()  // peerId -> jobs answered by that peer, not searched here
+    let local = 0
+    let remaining = queue.length
+    if (remaining === 0) return results
+
+    await new Promise((resolve, reject) => {
+      let failed = false
+
+      // Whether jobs can be searched here at all
+      const searchesLocally = () => Boolean(this.engine) && this.options.localSlots > 0
+
+      const done = (job, analysis) => {
+        results.set(job.key, analysis)
+        if (--remaining === 0) {
+          this.onCapacity = null
+          resolve()
+        } else {
+          schedule()
+        }
+      }
+
+      const fail = (error) => {
+        if (failed) return
+        failed = true
+        this.onCapacity = null
+        for (const sent of this.pending.values()) {
+          this.settle(sent)
+        }
+        reject(error)
+      }
+
+      // Local search only from here on
+      const searchLocally = (job) => {
+        queue.push({ ...job, remoteTries: job.remoteTries + 1, check: null })
+      }
+
+      const remoteDone = (job, peerId, worker, analysis) => {
+        if (worker.failures >= MAX_FAILURES && searchesLocally()) {
+          searchLocally(job)
+          schedule()
+          return
+        }
+        if (searchesLocally() && Math.random() < this.options.verifyShare) {
+          queue.unshift({ ...job, remoteTries: job.remoteTries + 1, check: { peerId, worker, analysis } })
+          schedule()
+          return
+        }
+        if (!unchecked.has(peerId)) unchecked.set(peerId, [])
+        unchecked.get(peerId).push(job)
+        done(job, { ...analysis, untrusted: true })
+      }
+
+      // A peer whose result a local search contradicts is done for: its
+      // other answers in this review are searched again too
+      const checked = (job, analysis) => {
+        const { peerId, worker, analysis: theirs } = job.check
+        if (analysesAgree(theirs, analysis, this.options.verifyMargin)) {
+          this.stats.verified++
+          return
+        }
+        this.log(`Peer ${peerId} disagrees with the local search of job ${job.key}`)
+        this.stats.disputed++
+        worker.failures = MAX_FAILURES
+        for (const answered of unchecked.get(peerId) || []) {
+          results.delete(answered.key)
+          remaining++
+          searchLocally(answered)
+        }
+        unchecked.delete(peerId)
+      }
+
+      const schedule = () => {
+        if (failed) return
+
+        const remote = job => job.remoteTries === 0 || !searchesLocally()
+        for (const [peerId, worker] of this.workers) {
+          // A peer that caps depth below the review's would answer shallower
+          if (limits.depth && worker.maxDepth < limits.depth) continue
+          while (worker.busy < worker.slots && worker.failures < MAX_FAILURES) {
+            const index = queue.findIndex(remote)
+            if (index < 0) break
+            const [job] = queue.splice(index, 1)
+            this.send(job, peerId, worker, limits, {
+              resolve: analysis => remoteDone(job, peerId, worker, analysis),
+              requeue: () => {
+                queue.unshift(job)
+                schedule()
+              }
+            })
+          }
+        }
+
+        while (local < this.options.localSlots && queue.length > 0 && this.engine) {
+          const job = queue.shift()
+          local++
+          this.engine.analyze(job.fen, { ...limits, priority: 'review' })
+            .then(analysis => {
+              local--
+              this.stats.local++
+              const clean = cleanAnalysis(job.fen, analysis)
+              if (job.check) checked(job, clean)
+              done(job, clean)
+            }, error => {
+              local--
+              if (++job.localTries >= MAX_FAILURES) return fail(error)
+              this.log(`Local search of job ${job.key} failed, retrying:`, error.message)
+              queue.push(job)
+              schedule()
+            })
+        }
+
+        const usable = Array.from(this.workers.values()).some(worker =>
+          worker.failures < MAX_FAILURES && !(limits.depth && worker.maxDepth < limits.depth))
+        if (!searchesLocally() && queue.length > 0 && this.pending.size === 0 && !usable) {
+          fail(new Error('No engine or peer left to analyse with'))
+        }
+      }
+
+      this.onCapacity = schedule
+      schedule()
+    })
+    return results
+  }
+
+  send(job, peerId, worker, limits, handlers) {
+    const jobId = this.nextJobId++
+    const timeout = limits.movetime ? limits.movetime * 2 + 5000 : this.options.jobTimeout
+    const sent = {
+      job,
+      jobId,
+      peerId,
+      worker,
+      limits,
+      resolve: handlers.resolve,
+      requeue: handlers.requeue,
+      timer: null
+    }
+
+    worker.busy++
+    this.pending.set(jobId, sent)
+    sent.timer = setTimeout(() => {
+      this.log(`Peer ${peerId} timed out on job ${jobId}`)
+      worker.failures++
+      this.giveBack(sent, 'timeouts')
+    }, timeout)
+
+    const delivered = this.transport && this.transport.sendToPeer(peerId, {
+      type: 'analysis_job',
+      jobId,
+      key: job.key,
+      fen: job.fen,
+      limits: sent.limits
+    })
+    if (!delivered) {
+      this.workers.delete(peerId)
+      this.giveBack(sent, 'timeouts')
+    }
+  }
+
+  // Stop waiting on a sent job
+  settle(sent) {
+    clearTimeout(sent.timer)
+    this.pending.delete(sent.jobId)
+    if (sent.worker.busy > 0) sent.worker.busy--
+  }
+
+  // A peer did not deliver; the job goes back to the queue
+  giveBack(sent, reason) {
+    if (!this.pending.has(sent.jobId)) return
+    this.settle(sent)
+    this.stats[reason]++
+    sent.job.remoteTries++
+    sent.requeue()
+  }
+
+  wake() {
+    if (this.onCapacity) this.onCapacity()
+  }
+
+  /**
+   * Get offload statistics
+   */
+  getStats() {
+    return {
+      serving: this.options.serve,
+      workers: this.workers.size,
+      workerSlots: Array.from(this.workers.values()).reduce((sum, worker) => sum + worker.slots, 0),
+      inFlight: this.pending.size,
+      ...this.stats
+    }
+  }
+
+  /**
+   * Log debug messages
+   */
+  log(...args) {
+    if (this.options.debug) {
+      console.log('[AnalysisOffload]', ...args)
+    }
+  }
+
+  /**
+   * Drop in-flight jobs and tell peers we serve no longer
+   */
+  destroy(peerIds = []) {
+    for (const sent of this.pending.values()) {
+      clearTimeout(sent.timer)
+    }
+    this.pending.clear()
+    this.workers.clear()
+    this.onCapacity = null
+    if (this.options.serve) {
+      this.setServing(false, peerIds)
+    }
+  }
+}
+
+// Export factory function
+export function createAnalysisOffload(options = {}) {
+  return new AnalysisOffload(options)
+}
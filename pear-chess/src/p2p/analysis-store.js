@@ -0,0 +1,398 @@
+/**
+ * Pear's Gambit - Shared Analysis Store
+ *
+ * Persists finished engine analyses to an append-only Hypercore and
+ * replicates the cores of other peers, so deep analysis of a position is
+ * computed once and pulled from the swarm afterwards
+ */
+
+/* global Pear */
+
+import Corestore from 'corestore'
+import Hyperswarm from 'hyperswarm'
+import b4a from 'b4a'
+import cenc from 'compact-encoding'
+
+const RECORD_VERSION = 1
+const MAX_LINES = 8
+const MAX_PV = 64
+const UCI_MOVE = /^[a-h][1-8][a-h][1-8][nbrq]?$/
+
+/**
+ * Position key of a FEN: the move counters do not change the analysis
+ */
+export function analysisKey(fen) {
+  return fen.trim().split(/\s+/).slice(0, 4).join(' ')
+}
+
+const lineEncoding = {
+  preencode(state, line) {
+    cenc.uint.preencode(state, line.depth)
+    cenc.bool.preencode(state, line.isMate)
+    cenc.int.preencode(state, line.isMate ? line.mateIn : line.scoreCp)
+    cenc.string.preencode(state, line.pv.join(' '))
+  },
+  encode(state, line) {
+    cenc.uint.encode(state, line.depth)
+    cenc.bool.encode(state, line.isMate)
+    cenc.int.encode(state, line.isMate ? line.mateIn : line.scoreCp)
+    cenc.string.encode(state, line.pv.join(' '))
+  },
+  decode(state) {
+    const depth = cenc.uint.decode(state)
+    const isMate = cenc.bool.decode(state)
+    const score = cenc.int.decode(state)
+    const pv = cenc.string.decode(state)
+    return {
+      depth,
+      isMate,
+      scoreCp: isMate ? 0 : score,
+      mateIn: isMate ? score : 0,
+      pv: pv ? pv.split(' ') : []
+    }
+  }
+}
+
+const linesEncoding = cenc.array(lineEncoding)
+
+/**
+ * One finished analysis: the position, best move, search totals and one
+ * line per MultiPV index, best first
+ */
+export const analysisEncoding = {
+  preencode(state, record) {
+    cenc.uint8.preencode(state, RECORD_VERSION)
+    cenc.string.preencode(state, record.fen)
+    cenc.string.preencode(state, record.bestMove)
+    cenc.string.preencode(state, record.ponderMove || '')
+    cenc.uint.preencode(state, record.depth)
+    cenc.uint.preencode(state, record.seldepth || 0)
+    cenc.uint.preencode(state, record.nodes || 0)
+    cenc.uint.preencode(state, record.timeMs || 0)
+    linesEncoding.preencode(state, record.lines)
+    cenc.uint64.preencode(state, record.timestamp || Date.now())
+  },
+  encode(state, record) {
+    cenc.uint8.encode(state, RECORD_VERSION)
+    cenc.string.encode(state, record.fen)
+    cenc.string.encode(state, record.bestMove)
+    cenc.string.encode(state, record.ponderMove || '')
+    cenc.uint.encode(state, record.depth)
+    cenc.uint.encode(state, record.seldepth || 0)
+    cenc.uint.encode(state, record.nodes || 0)
+    cenc.uint.encode(state, record.timeMs || 0)
+    linesEncoding.encode(state, record.lines)
+    cenc.uint64.encode(state, record.timestamp || Date.now())
+  },
+  decode(state) {
+    const version = cenc.uint8.decode(state)
+    if (version !== RECORD_VERSION) {
+      throw new Error(`Unknown analysis record version: ${version}`)
+    }
+    return {
+      fen: cenc.string.decode(state),
+      bestMove: cenc.string.decode(state),
+      ponderMove: cenc.string.decode(state),
+      depth: cenc.uint.decode(state),
+      seldepth: cenc.uint.decode(state),
+      nodes: cenc.uint.decode(state),
+      timeMs: cenc.uint.decode(state),
+      lines: linesEncoding.decode(state),
+      timestamp: cenc.uint64.decode(state)
+    }
+  }
+}
+
+/**
+ * Record for a native search result (see native/binding.cpp), or null
+ * when the result is not worth sharing
+ */
+export function recordFromResult(fen, result) {
+  if (!result || !result.bestMove || result.fromBook || result.fromTablebase || result.fromCache) {
+    return null
+  }
+
+  const infos = result.lines && result.lines.length > 0 ? result.lines : [result.finalInfo]
+  return {
+    fen: analysisKey(fen),
+    bestMove: result.bestMove,
+    ponderMove: result.ponderMove || '',
+    depth: result.finalInfo.depth,
+    seldepth: result.finalInfo.seldepth || 0,
+    nodes: result.finalInfo.nodes || 0,
+    timeMs: result.finalInfo.timeMs || 0,
+    lines: infos.slice(0, MAX_LINES).map(info => ({
+      depth: info.depth,
+      isMate: Boolean(info.isMate),
+      scoreCp: info.scoreCp || 0,
+      mateIn: info.mateIn || 0,
+      pv: (info.pv || []).slice(0, MAX_PV)
+    })),
+    timestamp: Date.now()
+  }
+}
+
+/**
+ * Search result shape the native binding takes back in seedCache()
+ */
+export function resultFromRecord(record) {
+  const lines = record.lines.map((line, i) => ({
+    depth: line.depth,
+    seldepth: record.seldepth,
+    nodes: record.nodes,
+    timeMs: record.timeMs,
+    scoreCp: line.scoreCp,
+    isMate: line.isMate,
+    mateIn: line.mateIn,
+    pv: line.pv,
+    multipv: i + 1
+  }))
+
+  return {
+    bestMove: record.bestMove,
+    ponderMove: record.ponderMove,
+    finalInfo: { ...lines[0], depth: record.depth },
+    lines
+  }
+}
+
+// Records from peers are untrusted; drop anything malformed. Legality of
+// the moves is checked natively when a record is seeded into the cache.
+function isValidRecord(record) {
+  if (!record || !UCI_MOVE.test(record.bestMove)) return false
+  if (record.fen.split(' ').length !== 4 || !/^[wb]$/.test(record.fen.split(' ')[1])) return false
+  if (record.depth < 1 || record.depth > 245) return false
+  if (record.lines.length < 1 || record.lines.length > MAX_LINES) return false
+  return record.lines.every(line => line.pv.length <= MAX_PV && line.pv.every(move => UCI_MOVE.test(move)))
+}
+
+/**
+ * Analysis Store
+ * Appends local analyses to this peer's core and indexes the cores of
+ * followed peers; lookups answer from whichever holds the deepest result
+ */
+export class AnalysisStore {
+  constructor(options = {}) {
+    this.options = {
+      storage: options.storage || './chess-analysis',
+      minDepth: options.minDepth || 12,   // Shallower results are cheaper to recompute
+      maxPeers: options.maxPeers || 32,   // Followed cores, besides our own
+      maxPositions: options.maxPositions || 100000, // Indexed positions, oldest dropped first
+      debug: options.debug || false,
+      ...options
+    }
+
+    // State
+    this.store = null
+    this.core = null
+    this.swarm = null
+    this.ownsSwarm = false
+    this.peers = new Map()    // Core key (hex) -> core
+    this.indexed = new Map()  // Core -> entries indexed so far
+    this.index = new Map()    // analysisKey(fen) -> deepest record, oldest first
+    this.isReady = false
+
+    this.opening = this.init()
+  }
+
+  /**
+   * Open the local core and index what it already holds
+   */
+  async init() {
+    try {
+      let storageDir = this.options.storage
+      if (typeof Pear !== 'undefined' && Pear.config && Pear.config.storage) {
+        storageDir = `${Pear.config.storage}/${this.options.storage.replace(/^\.\//, '')}`
+      }
+
+      this.store = new Corestore(storageDir)
+      await this.store.ready()
+
+      this.core = this.store.get({ name: 'analyses', valueEncoding: analysisEncoding })
+      await this.core.ready()
+      await this.indexCore(this.core)
+
+      // Replicating the whole store serves our core and fetches followed ones
+      this.swarm = this.options.swarm || new Hyperswarm()
+      this.ownsSwarm = !this.options.swarm
+      this.swarm.on('connection', (socket) => this.store.replicate(socket))
+      this.swarm.join(this.core.discoveryKey)
+
+      this.isReady = true
+      this.log(`Analysis store ready with ${this.index.size} positions:`, this.getKey())
+    } catch (error) {
+      this.log('Failed to initialize analysis store:', error)
+      throw error
+    }
+  }
+
+  async ready() {
+    return this.opening
+  }
+
+  /**
+   * Key of this peer's analysis core, for other peers to follow
+   */
+  getKey() {
+    return this.core ? b4a.toString(this.core.key, 'hex') : null
+  }
+
+  /**
+   * Replicate another peer's analysis core and index its records as they
+   * arrive
+   * @param {string} key - Core key in hex, as returned by getKey()
+   */
+  async follow(key) {
+    await this.ready()
+    if (typeof key !== 'string' || !/^[0-9a-f]{64}$/i.test(key)) return false
+    if (key === this.getKey() || this.peers.has(key)) return true
+    if (this.peers.size >= this.options.maxPeers) {
+      this.log('Not following more analysis cores:', key)
+      return false
+    }
+
+    try {
+      const core = this.store.get({ key: b4a.from(key, 'hex'), valueEncoding: analysisEncoding })
+      await core.ready()
+      this.peers.set(key, core)
+
+      core.on('append', () => {
+        this.indexCore(core).catch(error => this.log('Failed to index peer analyses:', error))
+      })
+      this.swarm.join(core.discoveryKey, { server: false, client: true })
+
+      await core.update({ wait: false })
+      await this.indexCore(core)
+      this.log('Following analysis core:', key)
+      return true
+    } catch (error) {
+      this.log('Failed to follow analysis core:', error)
+      return false
+    }
+  }
+
+  /**
+   * Index records appended to core since the last call
+   */
+  async indexCore(core) {
+    let next = this.indexed.get(core) || 0
+    while (next < core.length) {
+      const index = next++
+      this.indexed.set(core, next)
+      try {
+        this.consider(await core.get(index))
+      } catch (error) {
+        this.log('Skipping unreadable analysis record', index, error.message)
+      }
+    }
+  }
+
+  /**
+   * Index record when it is deeper, or as deep with more lines, than what
+   * is known for its position. Past maxPositions the position indexed
+   * longest ago is forgotten; its records stay in their cores.
+   */
+  consider(record) {
+    if (!isValidRecord(record)) return false
+
+    const known = this.index.get(record.fen)
+    if (known && (known.depth > record.depth || (known.depth === record.depth && known.lines.length >= record.lines.length))) {
+      return false
+    }
+    this.index.delete(record.fen)
+    this.index.set(record.fen, record)
+    if (this.index.size > this.options.maxPositions) {
+      this.index.delete(this.index.keys().next().value)
+    }
+    return true
+  }
+
+  /**
+   * Deepest known analysis of fen that reaches depth with at least multipv
+   * lines, or null
+   */
+  get(fen, { depth = 0, multipv = 1 } = {}) {
+    const record = this.index.get(analysisKey(fen))
+    if (!record || record.depth < depth || record.lines.length < multipv) return null
+    return record
+  }
+
+  /**
+   * get() as a native search result, for seeding the engine's cache
+   */
+  getResult(fen, limits = {}) {
+    const record = this.get(fen, limits)
+    return record ? resultFromRecord(record) : null
+  }
+
+  /**
+   * Append a finished search of fen, unless it is shallow or not deeper
+   * than what is already known
+   * @param {string} fen - Searched position
+   * @param {Object} result - Native search result
+   * @returns {Promise<boolean>} Whether the record was written
+   */
+  async put(fen, result) {
+    await this.ready()
+    const record = recordFromResult(fen, result)
+    if (!record || record.depth < this.options.minDepth || !this.consider(record)) {
+      return false
+    }
+
+    try {
+      await this.core.append(record)
+      this.indexed.set(this.core, this.core.length)
+      return true
+    } catch (error) {
+      this.log('Failed to store analysis:', error)
+      return false
+    }
+  }
+
+  /**
+   * Get store statistics
+   */
+  getStats() {
+    return {
+      key: this.getKey(),
+      positions: this.index.size,
+      localRecords: this.core ? this.core.length : 0,
+      peers: this.peers.size,
+      isReady: this.isReady
+    }
+  }
+
+  /**
+   * Log debug messages
+   */
+  log(...args) {
+    if (this.options.debug) {
+      console.log('[AnalysisStore]', ...args)
+    }
+  }
+
+  /**
+   * Close cores and, if it is ours, the swarm
+   */
+  async close() {
+    this.log('Closing analysis store...')
+    await this.opening.catch(() => {})
+
+    if (this.swarm && this.ownsSwarm) {
+      await this.swarm.destroy()
+    }
+    if (this.store) {
+      await this.store.close()
+    }
+
+    this.peers.clear()
+    this.indexed.clear()
+    this.index.clear()
+    this.isReady = false
+  }
+}
+
+// Export factory function
+export function createAnalysisStore(options = {}) {
+  return new AnalysisStore(options)
+}
@@ -8,6 +8,8 @@ export { SwarmManager, createSwarmManager } from './swarm.js'
 export { GameCore, createGameCore } from './core.js'
 export { GameSync, createGameSync } from './sync.js'
 export { GameDiscovery, createGameDiscovery } from './discovery.js'
+export { AnalysisStore, createAnalysisStore, analysisKey } from './analysis-store.js'
+export { AnalysisOffload, createAnalysisOffload } from './analysis-offload.js'
 
 // Import for internal use
 import { createGameDiscovery } from './discovery.js'
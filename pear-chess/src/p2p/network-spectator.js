@@ -34,6 +34,7 @@ export class NetworkSpectatorManager {
     this.moveHistory = []
     this.gameState = null
     this.hasInitialSync = false
+    this.evaluation = null // Live evaluation shared with other spectators, see ai/game-follower.js
 
     // Event handlers
     this.onGameStateUpdate = options.onGameStateUpdate || (() => {})
@@ -41,6 +42,7 @@ export class NetworkSpectatorManager {
     this.onConnectionChange = options.onConnectionChange || (() => {})
     this.onError = options.onError || (() => {})
     this.onHistoryLoaded = options.onHistoryLoaded || (() => {})
+    this.onEvaluation = options.onEvaluation || null // Evaluation bar; engine lines as moves arrive
   }
 
   /**
@@ -356,6 +358,7 @@ export class NetworkSpectatorManager {
       })
 
       this.onGameStateUpdate(this.gameState)
+      await this.followEvaluation(this.moveHistory.length)
 
       this.log('Full game sync completed successfully - board position set')
     } catch (error) {
@@ -401,11 +404,34 @@ export class NetworkSpectatorManager {
       this.gameState.currentFen = this.chessGame.getFen()
       this.gameState.totalMoves = this.moveHistory.length
       this.onGameStateUpdate(this.gameState)
+      if (this.evaluation) {
+        const uci = chessMove.from + chessMove.to + (chessMove.promotion || '')
+        this.evaluation.update(this.gameState.currentFen, this.moveHistory.length, uci)
+      }
     } else {
       this.log('Failed to apply live move:', result.error)
     }
   }
 
+  /**
+   * Evaluate the game for onEvaluation, on the engine that every spectator
+   * of the game in this process shares
+   */
+  async followEvaluation(ply) {
+    if (!this.onEvaluation) return
+
+    if (!this.evaluation) {
+      try {
+        const { SpectatorEvaluation } = await import('../ai/game-follower.js')
+        this.evaluation ??= new SpectatorEvaluation(this.gameId, this.onEvaluation, (...args) => this.log(...args))
+      } catch (error) {
+        this.log('Failed to start live evaluation:', error)
+        return
+      }
+    }
+    await this.evaluation.watch(this.chessGame.getFen(), ply)
+  }
+
   /**
    * Handle game state response
    */
@@ -522,6 +548,11 @@ export class NetworkSpectatorManager {
 
     this.connectionState = 'disconnected'
 
+    if (this.evaluation) {
+      await this.evaluation.close()
+      this.evaluation = null
+    }
+
     if (this.swarmManager) {
       await this.swarmManager.destroy()
     }
@@ -25,6 +25,8 @@ export class SpectatorSyncManager {
     this.historyManager = null
     this.swarmManager = null
     this.chessGame = null
+    this.analysisStore = options.analysisStore || null // Shared with peers, see analysis-store.js
+    this.evaluation = null // Live evaluation shared with other spectators, see ai/game-follower.js
 
     // State
     this.gameId = null
@@ -40,6 +42,7 @@ export class SpectatorSyncManager {
     this.onConnectionChange = options.onConnectionChange || (() => {})
     this.onError = options.onError || (() => {})
     this.onHistoryLoaded = options.onHistoryLoaded || (() => {})
+    this.onEvaluation = options.onEvaluation || null // Evaluation bar; engine lines as moves arrive
   }
 
   /**
@@ -175,6 +178,7 @@ export class SpectatorSyncManager {
       // Notify that history has been loaded
       this.onHistoryLoaded(currentState)
       this.onGameStateUpdate(currentState.gameState)
+      await this.followEvaluation(currentState.position)
 
       this.log('Game state sync completed successfully')
     } catch (error) {
@@ -195,6 +199,7 @@ export class SpectatorSyncManager {
       type: 'spectator_handshake',
       gameId: this.gameId,
       inviteCode: this.inviteCode,
+      analysisCore: this.analysisStore ? this.analysisStore.getKey() : null,
       timestamp: Date.now(),
       spectator: true
     }
@@ -279,12 +284,36 @@ export class SpectatorSyncManager {
       if (result.success) {
         this.log('Live move applied to chess game:', result.move.san)
         this.onMoveReceived(message.move, message.clockState)
+        if (this.evaluation) {
+          const uci = chessMove.from + chessMove.to + (chessMove.promotion || '')
+          this.evaluation.update(this.chessGame.getFen(), currentState.totalMoves, uci)
+        }
       } else {
         this.log('Failed to apply live move:', result.error)
       }
     }
   }
 
+  /**
+   * Evaluate the game for onEvaluation. Every spectator of the game in
+   * this process shares one engine following it, which re-searches on
+   * each move with what it learned on the last one.
+   */
+  async followEvaluation(ply) {
+    if (!this.onEvaluation) return
+
+    if (!this.evaluation) {
+      try {
+        const { SpectatorEvaluation } = await import('../ai/game-follower.js')
+        this.evaluation ??= new SpectatorEvaluation(this.gameId, this.onEvaluation, (...args) => this.log(...args))
+      } catch (error) {
+        this.log('Failed to start live evaluation:', error)
+        return
+      }
+    }
+    await this.evaluation.watch(this.chessGame.getFen(), ply)
+  }
+
   /**
    * Handle game state response from active players
    */
@@ -307,6 +336,14 @@ export class SpectatorSyncManager {
    */
   handleSpectatorWelcome(message, peerId) {
     this.log('Received spectator welcome from peer:', peerId)
+
+    // Players share their finished analyses; pull them instead of recomputing
+    if (this.analysisStore && message.analysisCore) {
+      this.analysisStore.follow(message.analysisCore).catch(error => {
+        this.log('Failed to follow peer analyses:', error)
+      })
+    }
+
     // This is a good place to request any missing game state
     this.requestGameState(peerId)
   }
@@ -468,6 +505,11 @@ export class SpectatorSyncManager {
 
     this.connectionState = 'disconnected'
 
+    if (this.evaluation) {
+      await this.evaluation.close()
+      this.evaluation = null
+    }
+
     if (this.historyManager) {
       await this.historyManager.destroy()
     }
@@ -26,6 +26,8 @@ export class GameSync {
     this.swarmManager = null
     this.chessGame = null
     this.persistence = null
+    this.analysisStore = options.analysisStore || null // Shared with peers, see analysis-store.js
+    this.analysisOffload = options.analysisOffload || null // Review jobs for peers, see analysis-offload.js
 
     // State
     this.gameId = null
@@ -79,6 +81,9 @@ export class GameSync {
         onPeerData: this.handlePeerMessage.bind(this),
         onError: this.handleSwarmError.bind(this)
       })
+      if (this.analysisOffload && !this.analysisOffload.transport) {
+        this.analysisOffload.transport = this.swarmManager
+      }
 
       // Wait for components to be ready
       await this.gameCore.ready()
@@ -399,10 +404,14 @@ export class GameSync {
       playerId: this.localPlayerId,
       playerColor: this.playerColor,
       isHost: this.isHost,
+      analysisCore: this.analysisStore ? this.analysisStore.getKey() : null,
       timestamp: Date.now()
     }
 
     this.swarmManager.sendToPeer(peerId, handshake)
+    if (this.analysisOffload) {
+      this.analysisOffload.addPeer(peerId)
+    }
 
     // Update connection state
     if (this.gameState === 'waiting' || this.gameState === 'connecting') {
@@ -431,6 +440,9 @@ export class GameSync {
 
     // Store disconnection info for reconnection attempts
     this.remotePlayerId = null
+    if (this.analysisOffload) {
+      this.analysisOffload.removePeer(peerId)
+    }
     
     // If we lose all connections, go back to waiting and attempt reconnection
     if (!this.swarmManager.hasConnections()) {
@@ -524,7 +536,9 @@ export class GameSync {
           break
 
         default:
-          this.log(`Unknown message type: ${message.type}`)
+          if (!this.analysisOffload || !this.analysisOffload.handleMessage(message, peerId)) {
+            this.log(`Unknown message type: ${message.type}`)
+          }
       }
     } catch (error) {
       this.log('Error handling peer message:', error)
@@ -537,6 +551,7 @@ export class GameSync {
    */
   async handleHandshake(message, peerId) {
     this.log('Handling handshake from peer:', message)
+    this.followAnalysis(message.analysisCore)
 
     this.remotePlayerId = peerId
 
@@ -714,11 +729,13 @@ export class GameSync {
     }
 
     this.log('Spectator handshake received from peer:', peerId)
+    this.followAnalysis(message.analysisCore)
 
     // Send welcome message
     const welcome = {
       type: 'spectator_welcome',
       gameId: this.gameId,
+      analysisCore: this.analysisStore ? this.analysisStore.getKey() : null,
       timestamp: Date.now(),
       players: this.chessGame ? {
         white: this.chessGame.getGameInfo()?.players?.white || 'Player 1',
@@ -734,6 +751,17 @@ export class GameSync {
     }
   }
 
+  /**
+   * Replicate the analysis core a peer announced, when sharing analyses
+   */
+  followAnalysis(key) {
+    if (!this.analysisStore || !key) return
+
+    this.analysisStore.follow(key).catch(error => {
+      this.log('Failed to follow peer analyses:', error)
+    })
+  }
+
   /**
    * Handle spectator sync request
    */
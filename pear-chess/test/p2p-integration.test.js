@@ -81,4 +81,152 @@ test('Game discovery utilities', async (t) => {
   const parseResult = P2PUtils.parseGameLink('pears-gambit://join/ABC-123')
   t.ok(parseResult.valid, 'Valid game link parsed successfully')
   t.is(parseResult.inviteCode, 'ABC-123', 'Invite code extracted correctly')
-})
\ No newline at end of file
+})
+
+test('Analysis record encoding', async (t) => {
+  const cenc = (await import('compact-encoding')).default
+  const { analysisEncoding, analysisKey, recordFromResult, resultFromRecord } = await import('../src/p2p/analysis-store.js')
+  
+  const fen = 'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1'
+  t.is(analysisKey(fen), 'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3', 'Move counters dropped from key')
+  
+  const line = { depth: 18, nodes: 500000, timeMs: 900, scoreCp: -24, isMate: false, mateIn: 0, pv: ['c7c5', 'g1f3'], multipv: 1 }
+  const result = { bestMove: 'c7c5', ponderMove: 'g1f3', finalInfo: line, lines: [line, { ...line, isMate: true, mateIn: -7, pv: ['f7f6'], multipv: 2 }] }
+  
+  const record = recordFromResult(fen, result)
+  const decoded = cenc.decode(analysisEncoding, cenc.encode(analysisEncoding, record))
+  t.is(decoded.fen, analysisKey(fen), 'Position round-trips')
+  t.is(decoded.depth, 18, 'Depth round-trips')
+  t.is(decoded.lines.length, 2, 'Every line stored')
+  t.is(decoded.lines[0].scoreCp, -24, 'Centipawn score round-trips')
+  t.is(decoded.lines[1].mateIn, -7, 'Mate score round-trips')
+  t.alike(decoded.lines[0].pv, ['c7c5', 'g1f3'], 'PV round-trips')
+  
+  const seeded = resultFromRecord(decoded)
+  t.is(seeded.bestMove, 'c7c5', 'Result rebuilt for the native cache')
+  t.is(seeded.lines[1].multipv, 2, 'Lines keep their MultiPV index')
+  
+  t.is(recordFromResult(fen, { ...result, fromCache: true }), null, 'Cached results are not shared again')
+})
+
+test('Distributed analysis offload', async (t) => {
+  const { AnalysisOffload, isValidAnalysis } = await import('../src/p2p/analysis-offload.js')
+  const { analysisKey } = await import('../src/p2p/analysis-store.js')
+  
+  const engine = (bestMove = 'e2e4', value = 20) => ({
+    calls: 0,
+    last: null,
+    async analyze(fen, options) {
+      this.calls++
+      this.last = options
+      await new Promise(resolve => setTimeout(resolve, 5))
+      return {
+        fen,
+        bestMove,
+        depth: options.depth || 1,
+        lines: [{ moves: [bestMove], score: { unit: 'cp', value }, depth: options.depth }]
+      }
+    }
+  })
+  
+  // Peers wired directly to each other, delivering asynchronously like a socket
+  const peers = {}
+  const connect = (id, options) => {
+    const offload = new AnalysisOffload({
+      ...options,
+      transport: {
+        sendToPeer(peerId, message) {
+          const peer = peers[peerId]
+          if (!peer) return false
+          setTimeout(() => peer.handleMessage(JSON.parse(JSON.stringify(message)), id), 1)
+          return true
+        }
+      }
+    })
+    peers[id] = offload
+    return offload
+  }
+  
+  const local = engine()
+  const remote = engine()
+  const coordinator = connect('a', { engine: local, jobTimeout: 200, verifyShare: 0 })
+  connect('b', { engine: remote, serve: true, slots: 2 }).addPeer('a')
+  const silent = connect('c', { engine: engine(), serve: true })
+  silent.handleJob = async () => {}  // Takes jobs and never answers
+  silent.addPeer('a')
+  await new Promise(resolve => setTimeout(resolve, 20))
+  t.is(coordinator.getStats().workers, 2, 'Opted-in peers announced')
+  
+  const start = 'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1'
+  const moves = ['e2e4', 'e7e5', 'g1f3', 'b8c6', 'f1b5', 'a7a6']
+  const [game, opening] = await coordinator.analyzeGames([{ fen: start, moves }, { fen: start, moves: moves.slice(0, 2) }], { depth: 12 })
+  
+  t.is(game.length, 7, 'One entry per ply')
+  t.is(opening.length, 3, 'Second game of the batch covered')
+  t.ok(game.every(ply => ply.analysis && ply.analysis.depth === 12), 'Every ply analysed at depth')
+  t.is(local.calls + remote.calls, 7, 'Positions shared by the batch searched once')
+  t.ok(remote.calls > 0, 'Peer took jobs')
+  t.ok(coordinator.getStats().timeouts > 0 && local.calls > 0, 'Timed-out job searched locally')
+  
+  // Served jobs are held to the server's caps
+  await peers.b.handleJob({ jobId: 1, key: analysisKey(start), fen: start, limits: { movetime: 1e9, nodes: 1e12, multiPV: 99 } }, 'z')
+  t.is(remote.last.movetime, 10000, 'Movetime capped')
+  t.is(remote.last.nodes, 20000000, 'Nodes capped')
+  t.is(remote.last.multiPV, 8, 'Lines capped')
+  
+  // A peer whose answer a local search contradicts gets no more jobs, and
+  // the answer is replaced
+  const checker = connect('d', { engine: engine(), verifyShare: 1 })
+  const liar = engine('d2d4', 900)
+  connect('e', { engine: liar, serve: true }).addPeer('d')
+  await new Promise(resolve => setTimeout(resolve, 20))
+  const [checked] = await checker.analyzeGame(start, [], { depth: 12 })
+  t.is(liar.calls, 1, 'Peer took the job')
+  t.is(checked.analysis.bestMove, 'e2e4', 'Local search wins the dispute')
+  t.absent(checked.analysis.untrusted, 'Checked result trusted')
+  t.is(checker.getStats().disputed, 1, 'Dispute counted')
+  await checker.analyzeGame(start, ['e2e4'], { depth: 12 })
+  t.is(liar.calls, 1, 'Disputed peer gets no more jobs')
+  
+  // Unchecked peer results are marked, and a failed local search is retried
+  const trusting = connect('f', { engine: engine(), verifyShare: 0, localSlots: 0 })
+  connect('g', { engine: engine(), serve: true }).addPeer('f')
+  await new Promise(resolve => setTimeout(resolve, 20))
+  const [unchecked] = await trusting.analyzeGame(start, [], { depth: 12 })
+  t.ok(unchecked.analysis.untrusted, 'Peer result marked untrusted')
+  
+  // Without local slots a timed-out job goes to another peer, and with no
+  // peer left the review fails rather than waiting forever
+  const remoteOnly = connect('h', { engine: engine(), verifyShare: 0, localSlots: 0, jobTimeout: 50 })
+  const stalling = connect('i', { engine: engine(), serve: true })
+  stalling.handleJob = async () => {}
+  stalling.addPeer('h')
+  await new Promise(resolve => setTimeout(resolve, 20))  // First in line for jobs
+  const backup = engine()
+  connect('j', { engine: backup, serve: true }).addPeer('h')
+  await new Promise(resolve => setTimeout(resolve, 20))
+  const [rerouted] = await remoteOnly.analyzeGame(start, [], { depth: 12 })
+  t.ok(rerouted.analysis && backup.calls === 1, 'Timed-out job answered by another peer')
+  t.ok(remoteOnly.getStats().timeouts > 0, 'Stalling peer timed out')
+
+  const stranded = connect('k', { engine: engine(), verifyShare: 0, localSlots: 0, jobTimeout: 50 })
+  stalling.addPeer('k')
+  await new Promise(resolve => setTimeout(resolve, 20))
+  await t.exception(stranded.analyzeGame(start, [], { depth: 12 }), /No engine or peer left/, 'Review fails once every peer timed out')
+
+  const flaky = engine()
+  const analyze = flaky.analyze
+  let failures = 0
+  flaky.analyze = function (fen, options) {
+    if (failures++ === 0) return Promise.reject(new Error('Engine busy'))
+    return analyze.call(this, fen, options)
+  }
+  const alone = new AnalysisOffload({ engine: flaky })
+  const plies = await alone.analyzeGame(start, ['e2e4'], { depth: 12 })
+  t.ok(plies.every(ply => ply.analysis), 'Failed local search requeued')
+  
+  const valid = { bestMove: 'e2e4', depth: 12, lines: [{ moves: ['e2e4', 'e7e5'], score: { unit: 'cp', value: 20 } }] }
+  t.ok(isValidAnalysis(start, { depth: 12 }, valid), 'Legal analysis accepted')
+  t.absent(isValidAnalysis(start, { depth: 14 }, valid), 'Shallow analysis rejected')
+  t.absent(isValidAnalysis(start, {}, { ...valid, lines: [{ ...valid.lines[0], moves: ['e2e4', 'e2e4'] }] }), 'Illegal PV rejected')
+})